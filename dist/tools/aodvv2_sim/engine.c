@@ -0,0 +1,783 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Sharded conservative event engine and AODVv2 platform ops
+ *
+ * Every window the shards:
+ *
+ * 1. move the events other shards produced for them into their heaps,
+ * 2. agree on the earliest pending event `t` of the whole network,
+ * 3. handle all their events in `[t, t + lookahead)`.
+ *
+ * Any event created while handling step 3 is at least one lookahead away, so
+ * it belongs to a later window and shards never wait on each other inside a
+ * window.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "net/aodvv2/rcs.h"
+#include "net/manet.h"
+
+#include "sim.h"
+
+#define RFC5444_PKT_FLAG_SEQNUM  (0x08)
+#define RFC5444_PKT_FLAG_TLV     (0x04)
+
+/**
+ * @brief   Time to stay awake after unicast traffic, as the firmware's
+ *          CONFIG_DUTYCYCLE_DATA_HOLD
+ */
+#define SIM_DC_DATA_HOLD         (5 * SIM_US_PER_SEC)
+
+/**
+ * @brief   Time between two SYNC frames, as CONFIG_DUTYCYCLE_SYNC_INTERVAL
+ */
+#define SIM_DC_SYNC_INTERVAL     (60 * SIM_US_PER_SEC)
+
+/**
+ * @brief   SYNC frame length, as DUTYCYCLE_SYNC_LEN
+ */
+#define SIM_DC_SYNC_LEN          (7)
+
+/**
+ * @brief   Neighbor schedules tracked, as CONFIG_DUTYCYCLE_NBR_NUMOF
+ */
+#define SIM_DC_NBR_NUMOF         (8)
+
+void sim_node_ll_addr(uint32_t id, ipv6_addr_t *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0xfe;
+    addr->u8[1] = 0x80;
+    addr->u8[11] = 0xff;
+    addr->u32[3] = byteorder_htonl(id);
+}
+
+void sim_node_client_addr(uint32_t id, ipv6_addr_t *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0x20;
+    addr->u8[1] = 0x01;
+    addr->u8[2] = 0x0d;
+    addr->u8[3] = 0xb8;
+    addr->u32[3] = byteorder_htonl(id);
+}
+
+static bool _ll_addr_to_id(const ipv6_addr_t *addr, uint32_t *id)
+{
+    if (!ipv6_addr_is_link_local(addr) || addr->u8[11] != 0xff) {
+        return false;
+    }
+    *id = byteorder_ntohl(addr->u32[3]);
+    return true;
+}
+
+/* Time covered by wake windows in [phase - period, t) */
+static sim_time_t _windows(const sim_params_t *p, const sim_node_t *node,
+                           sim_time_t t)
+{
+    sim_time_t u = t + p->dc_period - node->dc_phase;
+    sim_time_t rem = u % p->dc_period;
+
+    return (u / p->dc_period) * p->dc_wake + (rem < p->dc_wake ? rem : p->dc_wake);
+}
+
+static bool _awake(const sim_params_t *p, const sim_node_t *node, sim_time_t t)
+{
+    if (p->dc_period == 0 || t < node->awake_until) {
+        return true;
+    }
+    return ((t + p->dc_period - node->dc_phase) % p->dc_period) < p->dc_wake;
+}
+
+/* Keep the radio on until t, accounting the time outside of wake windows */
+static void _stay_awake(sim_node_t *node, sim_time_t until)
+{
+    const sim_params_t *p = &node->shard->sim->params;
+
+    if (p->dc_period == 0 || until <= node->awake_until) {
+        return;
+    }
+    if (until > p->duration) {
+        until = p->duration;
+    }
+
+    sim_time_t from = node->awake_until > node->now ? node->awake_until
+                                                    : node->now;
+    if (until > from) {
+        node->extra_awake += (until - from) -
+                             (_windows(p, node, until) - _windows(p, node, from));
+        node->awake_until = until;
+    }
+}
+
+void sim_node_position(const sim_t *sim, const sim_node_t *node,
+                       aodvv2_position_t *pos)
+{
+    pos->x = (int32_t)(node->x * sim->params.lar_range);
+    pos->y = (int32_t)(node->y * sim->params.lar_range);
+}
+
+sim_time_t sim_node_awake_time(const sim_t *sim, const sim_node_t *node)
+{
+    const sim_params_t *p = &sim->params;
+
+    if (p->dc_period == 0) {
+        return p->duration;
+    }
+    return _windows(p, node, p->duration) - _windows(p, node, 0) +
+           node->extra_awake;
+}
+
+static inline bool _ev_before(const sim_event_t *a, const sim_event_t *b)
+{
+    if (a->time != b->time) {
+        return a->time < b->time;
+    }
+    if (a->origin != b->origin) {
+        return a->origin < b->origin;
+    }
+    return a->origin_seq < b->origin_seq;
+}
+
+static int _vec_push(sim_event_vec_t *vec, const sim_event_t *ev)
+{
+    if (vec->len == vec->cap) {
+        size_t cap = vec->cap ? vec->cap * 2 : 256;
+        sim_event_t *tmp = realloc(vec->ev, cap * sizeof(*tmp));
+        if (tmp == NULL) {
+            return -ENOMEM;
+        }
+        vec->ev = tmp;
+        vec->cap = cap;
+    }
+    vec->ev[vec->len++] = *ev;
+    return 0;
+}
+
+static int _heap_push(sim_event_vec_t *heap, const sim_event_t *ev)
+{
+    if (_vec_push(heap, ev) < 0) {
+        return -ENOMEM;
+    }
+
+    size_t i = heap->len - 1;
+    sim_event_t tmp = heap->ev[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!_ev_before(&tmp, &heap->ev[parent])) {
+            break;
+        }
+        heap->ev[i] = heap->ev[parent];
+        i = parent;
+    }
+    heap->ev[i] = tmp;
+    return 0;
+}
+
+static void _heap_pop(sim_event_vec_t *heap, sim_event_t *out)
+{
+    *out = heap->ev[0];
+    heap->len--;
+    if (heap->len == 0) {
+        return;
+    }
+
+    sim_event_t tmp = heap->ev[heap->len];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= heap->len) {
+            break;
+        }
+        if (child + 1 < heap->len &&
+            _ev_before(&heap->ev[child + 1], &heap->ev[child])) {
+            child++;
+        }
+        if (!_ev_before(&heap->ev[child], &tmp)) {
+            break;
+        }
+        heap->ev[i] = heap->ev[child];
+        i = child;
+    }
+    heap->ev[i] = tmp;
+}
+
+static void _schedule(sim_node_t *from, sim_event_t *ev)
+{
+    sim_t *sim = from->shard->sim;
+    sim_shard_t *dst = sim->nodes[ev->node].shard;
+
+    ev->origin = from->id;
+    ev->origin_seq = from->seq++;
+
+    int res;
+    if (dst == from->shard) {
+        res = _heap_push(&dst->heap, ev);
+    }
+    else {
+        res = _vec_push(&from->shard->outbox[dst->idx], ev);
+    }
+    if (res < 0) {
+        fprintf(stderr, "aodvv2_sim: out of memory\n");
+        abort();
+    }
+}
+
+static sim_time_t _airtime(const sim_params_t *p, size_t len)
+{
+    return ((len + p->phy_overhead) * 8 * SIM_US_PER_SEC) / p->bitrate;
+}
+
+static void _count_tx(sim_stats_t *stats, const uint8_t *buf, size_t len)
+{
+    /* Skip the packet header to find the first message type */
+    size_t off = 1;
+    if (len > 0 && (buf[0] & RFC5444_PKT_FLAG_SEQNUM)) {
+        off += 2;
+    }
+    if (len > off + 1 && (buf[0] & RFC5444_PKT_FLAG_TLV)) {
+        off += 2 + ((buf[off] << 8) | buf[off + 1]);
+    }
+
+    if (off < len && buf[off] == RFC5444_MSGTYPE_RREQ) {
+        stats->rreq_tx++;
+    }
+    else if (off < len && buf[off] == RFC5444_MSGTYPE_RREP) {
+        stats->rrep_tx++;
+    }
+    else {
+        stats->other_tx++;
+    }
+}
+
+static void _deliver(sim_node_t *node, uint32_t nbr_idx, const void *buf,
+                     size_t len, sim_time_t delay, bool unicast)
+{
+    const sim_params_t *p = &node->shard->sim->params;
+    float d = node->nbr_dist[nbr_idx];
+
+    /* Packet error rate grows with the square of the distance */
+    if (p->per_max > 0 && sim_rand_unit(&node->rng) < p->per_max * d * d) {
+        node->shard->stats.lost++;
+        return;
+    }
+
+    sim_event_t ev = {
+        .time = node->now + delay,
+        .node = node->nbrs[nbr_idx],
+        .kind = SIM_EV_RX,
+        .arg = unicast,
+        .len = (uint16_t)len,
+    };
+    memcpy(ev.data, buf, len);
+    _schedule(node, &ev);
+}
+
+static void _op_now(void *ctx, timex_t *now)
+{
+    sim_node_t *node = ctx;
+
+    now->seconds = (uint32_t)(node->now / SIM_US_PER_SEC);
+    now->microseconds = (uint32_t)(node->now % SIM_US_PER_SEC);
+}
+
+static int _delay_cmp(const void *a, const void *b)
+{
+    sim_time_t x = *(const sim_time_t *)a;
+    sim_time_t y = *(const sim_time_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Plans the further copies of a broadcast as the firmware does with the
+ * schedules learned from SYNC frames, which are assumed known from the
+ * start: one copy for each group of neighbors whose windows start within a
+ * quarter window of each other. Returns the number of further copies, at
+ * most max, offsets in at. */
+static unsigned _bcast_plan(sim_node_t *node, sim_time_t *at, unsigned max)
+{
+    const sim_t *sim = node->shard->sim;
+    const sim_params_t *p = &sim->params;
+    sim_time_t guard = p->dc_wake / 4;
+    sim_time_t *delays = at;
+    unsigned numof = 0;
+
+    if (p->dc_blind || p->dc_wake >= p->dc_period ||
+        node->nbrs_numof > SIM_DC_NBR_NUMOF) {
+        goto blind;
+    }
+
+    for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+        const sim_node_t *nbr = &sim->nodes[node->nbrs[i]];
+        sim_time_t into = (node->now + p->dc_period - nbr->dc_phase) %
+                          p->dc_period;
+        if (into >= guard && into + guard < p->dc_wake) {
+            continue;
+        }
+        delays[numof++] = (p->dc_period - into + guard) % p->dc_period;
+    }
+    qsort(delays, numof, sizeof(*delays), _delay_cmp);
+
+    unsigned copies = 0;
+    for (unsigned i = 0; i < numof;) {
+        sim_time_t limit = delays[i] + guard;
+        sim_time_t last = delays[i];
+        while (i < numof && delays[i] <= limit) {
+            last = delays[i++];
+        }
+        at[copies++] = last;
+    }
+    if (copies < max) {
+        return copies;
+    }
+
+blind:
+    for (unsigned c = 0; c < max; c++) {
+        at[c] = (c + 1) * p->dc_wake;
+    }
+    return max;
+}
+
+static void _bcast(sim_node_t *node, const uint8_t *buf, size_t len,
+                   bool sync)
+{
+    sim_stats_t *stats = &node->shard->stats;
+    const sim_params_t *p = &node->shard->sim->params;
+    sim_time_t airtime = _airtime(p, len);
+    sim_time_t delay = p->link_delay + airtime;
+    /* Copies after the first one, when a neighbor schedule is unknown */
+    unsigned blind = p->dc_period
+                   ? (p->dc_period + p->dc_wake - 1) / p->dc_wake - 1 : 0;
+    sim_time_t at[blind > node->nbrs_numof ? blind + 1
+                                           : node->nbrs_numof + 1];
+    unsigned copies = 0;
+
+    at[0] = 0;
+    if (p->dc_period) {
+        if (sync) {
+            /* For the neighbors that don't know us yet */
+            for (unsigned c = 0; c < blind; c++) {
+                at[c + 1] = (c + 1) * p->dc_wake;
+            }
+            copies = blind;
+        }
+        else {
+            copies = _bcast_plan(node, &at[1], blind);
+        }
+        _stay_awake(node, node->now + at[copies] + airtime);
+    }
+
+    for (unsigned c = 0; c <= copies; c++) {
+        stats->airtime_us += airtime;
+        node->tx_time += airtime;
+        if (sync) {
+            stats->sync_tx++;
+            /* Nothing for the routers in there */
+            continue;
+        }
+        _count_tx(stats, buf, len);
+        stats->tx_bytes += len;
+        stats->bcast_copies++;
+        for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+            _deliver(node, i, buf, len, delay + at[c], false);
+        }
+    }
+}
+
+static int _op_send(void *ctx, const ipv6_addr_t *dst, const void *buf,
+                    size_t len)
+{
+    sim_node_t *node = ctx;
+    sim_stats_t *stats = &node->shard->stats;
+    const sim_params_t *p = &node->shard->sim->params;
+
+    if (len > AODVV2_RFC5444_PACKET_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    sim_time_t airtime = _airtime(p, len);
+    sim_time_t delay = p->link_delay + airtime;
+
+    if (ipv6_addr_is_multicast(dst)) {
+        /* With duty cycling a broadcast is sent again in the windows of the
+         * neighbors that were asleep */
+        _bcast(node, buf, len, false);
+        return 0;
+    }
+
+    _count_tx(stats, buf, len);
+    stats->tx_bytes += len;
+    stats->airtime_us += airtime;
+    node->tx_time += airtime;
+    _stay_awake(node, node->now + SIM_DC_DATA_HOLD);
+
+    uint32_t id;
+    if (_ll_addr_to_id(dst, &id)) {
+        for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+            if (node->nbrs[i] == id) {
+                _deliver(node, i, buf, len, delay, true);
+                return 0;
+            }
+        }
+    }
+
+    stats->misrouted++;
+    return -EHOSTUNREACH;
+}
+
+static int _op_fib_add(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len,
+                       const ipv6_addr_t *next_hop, uint32_t lifetime)
+{
+    (void)dst;
+    (void)pfx_len;
+    (void)next_hop;
+    (void)lifetime;
+
+    sim_node_t *node = ctx;
+    node->shard->stats.fib_add++;
+    return 0;
+}
+
+static void _op_fib_del(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len)
+{
+    (void)dst;
+    (void)pfx_len;
+
+    sim_node_t *node = ctx;
+    node->shard->stats.fib_del++;
+}
+
+static void _op_route_found(void *ctx, const ipv6_addr_t *targ_addr)
+{
+    sim_node_t *node = ctx;
+    sim_t *sim = node->shard->sim;
+    uint32_t targ = byteorder_ntohl(targ_addr->u32[3]);
+
+    /* Flows are only written by the shard owning their source */
+    for (uint32_t i = 0; i < node->flows_numof; i++) {
+        sim_flow_t *flow = &sim->flows[node->flows[i]];
+        if (flow->dst == targ && flow->found == SIM_TIME_NEVER &&
+            flow->start <= node->now) {
+            flow->found = node->now;
+        }
+    }
+}
+
+static void _op_stay_awake(void *ctx, uint32_t ms)
+{
+    sim_node_t *node = ctx;
+    _stay_awake(node, node->now + (sim_time_t)ms * 1000);
+}
+
+static const aodvv2_ops_t _ops = {
+    .now = _op_now,
+    .send = _op_send,
+    .fib_add = _op_fib_add,
+    .fib_del = _op_fib_del,
+    .route_found = _op_route_found,
+    .stay_awake = _op_stay_awake,
+};
+
+static void _update_peaks(sim_node_t *node)
+{
+    uint8_t lrs = 0;
+    uint8_t mcmsg = 0;
+
+    for (unsigned i = 0; i < CONFIG_AODVV2_MAX_ROUTING_ENTRIES; i++) {
+        lrs += node->core.lrs.entries[i].used;
+    }
+    for (unsigned i = 0; i < CONFIG_AODVV2_MCMSG_MAX_ENTRIES; i++) {
+        mcmsg += node->core.mcmsg.entries[i].used;
+    }
+
+    if (lrs > node->lrs_peak) {
+        node->lrs_peak = lrs;
+    }
+    if (mcmsg > node->mcmsg_peak) {
+        node->mcmsg_peak = mcmsg;
+    }
+}
+
+static void _handle(sim_shard_t *shard, sim_event_t *ev)
+{
+    sim_t *sim = shard->sim;
+    sim_node_t *node = &sim->nodes[ev->node];
+
+    node->now = ev->time;
+    shard->stats.events++;
+
+    switch (ev->kind) {
+        case SIM_EV_RX: {
+            ipv6_addr_t sender;
+            if (!_awake(&sim->params, node, ev->time)) {
+                shard->stats.slept++;
+                break;
+            }
+            if (ev->arg) {
+                _stay_awake(node, node->now + SIM_DC_DATA_HOLD);
+            }
+            sim_node_ll_addr(ev->origin, &sender);
+            shard->stats.rx++;
+            aodvv2_core_handle_packet(&node->core, &sender, ev->data, ev->len);
+            break;
+        }
+
+        case SIM_EV_FLOW_START: {
+            const sim_flow_t *flow = &sim->flows[ev->arg];
+            ipv6_addr_t orig;
+            ipv6_addr_t targ;
+            sim_node_client_addr(flow->src, &orig);
+            sim_node_client_addr(flow->dst, &targ);
+#if IS_USED(MODULE_AODVV2_LAR)
+            /* The host knows where the target is */
+            if (sim->params.lar_range > 0) {
+                aodvv2_position_t pos;
+                timex_t now;
+                sim_node_position(sim, &sim->nodes[flow->dst], &pos);
+                aodvv2_core_now(&node->core, &now);
+                aodvv2_lar_learn(&node->core.lar, &targ, 128, &pos, &now);
+            }
+#endif
+            aodvv2_core_find_route(&node->core, &orig, &targ);
+            break;
+        }
+
+        case SIM_EV_SYNC: {
+            static const uint8_t sync[SIM_DC_SYNC_LEN];
+            _bcast(node, sync, sizeof(sync), true);
+
+            sim_event_t next = {
+                .time = node->now + SIM_DC_SYNC_INTERVAL,
+                .node = node->id,
+                .kind = SIM_EV_SYNC,
+            };
+            if (next.time < sim->params.duration) {
+                _schedule(node, &next);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    _update_peaks(node);
+}
+
+static sim_time_t _global_next(sim_t *sim)
+{
+    sim_time_t next = SIM_TIME_NEVER;
+
+    for (unsigned i = 0; i < sim->params.threads; i++) {
+        if (sim->shards[i].next < next) {
+            next = sim->shards[i].next;
+        }
+    }
+    return next;
+}
+
+static void *_worker(void *arg)
+{
+    sim_shard_t *shard = arg;
+    sim_t *sim = shard->sim;
+    const sim_time_t end = sim->params.duration;
+
+    for (;;) {
+        /* Outboxes written during the previous window are complete */
+        pthread_barrier_wait(&sim->barrier);
+
+        for (unsigned i = 0; i < sim->params.threads; i++) {
+            sim_event_vec_t *in = &sim->shards[i].outbox[shard->idx];
+            for (size_t j = 0; j < in->len; j++) {
+                if (_heap_push(&shard->heap, &in->ev[j]) < 0) {
+                    fprintf(stderr, "aodvv2_sim: out of memory\n");
+                    abort();
+                }
+            }
+            in->len = 0;
+        }
+        shard->next = shard->heap.len ? shard->heap.ev[0].time : SIM_TIME_NEVER;
+
+        /* Every shard published its earliest event */
+        pthread_barrier_wait(&sim->barrier);
+
+        sim_time_t start = _global_next(sim);
+        if (start == SIM_TIME_NEVER || start > end) {
+            break;
+        }
+        sim_time_t stop = start + sim->lookahead;
+
+        while (shard->heap.len && shard->heap.ev[0].time < stop &&
+               shard->heap.ev[0].time <= end) {
+            sim_event_t ev;
+            _heap_pop(&shard->heap, &ev);
+            _handle(shard, &ev);
+        }
+    }
+
+    return NULL;
+}
+
+static int _init(sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+
+    sim->lookahead = p->link_delay + _airtime(p, 0);
+    if (sim->lookahead == 0) {
+        sim->lookahead = 1;
+    }
+
+    sim->shards = calloc(p->threads, sizeof(*sim->shards));
+    if (sim->shards == NULL) {
+        return -ENOMEM;
+    }
+
+    uint32_t per_shard = (p->nodes + p->threads - 1) / p->threads;
+    for (unsigned i = 0; i < p->threads; i++) {
+        sim_shard_t *shard = &sim->shards[i];
+        shard->sim = sim;
+        shard->idx = i;
+        shard->first = i * per_shard;
+        shard->last = shard->first + per_shard;
+        if (shard->first > p->nodes) {
+            shard->first = p->nodes;
+        }
+        if (shard->last > p->nodes) {
+            shard->last = p->nodes;
+        }
+        shard->outbox = calloc(p->threads, sizeof(*shard->outbox));
+        if (shard->outbox == NULL) {
+            return -ENOMEM;
+        }
+
+        for (uint32_t n = shard->first; n < shard->last; n++) {
+            sim_node_t *node = &sim->nodes[n];
+            ipv6_addr_t client;
+
+            node->shard = shard;
+            node->rng = sim_rand_seed(p->seed, n);
+            if (p->dc_period) {
+                node->dc_phase = sim_rand(&node->rng) % p->dc_period;
+
+                /* Routers don't boot at the same time */
+                sim_event_t ev = {
+                    .time = sim_rand(&node->rng) % SIM_DC_SYNC_INTERVAL,
+                    .node = n,
+                    .kind = SIM_EV_SYNC,
+                };
+                ev.origin = n;
+                ev.origin_seq = node->seq++;
+                if (_heap_push(&shard->heap, &ev) < 0) {
+                    return -ENOMEM;
+                }
+            }
+            aodvv2_core_init(&node->core, &_ops, node);
+            sim_node_ll_addr(n, &client);
+            aodvv2_core_set_addr(&node->core, &client);
+            sim_node_client_addr(n, &client);
+            aodvv2_rcs_add(&node->core.rcs, &client, 128, 1);
+#if IS_USED(MODULE_AODVV2_LAR)
+            if (p->lar_range > 0) {
+                aodvv2_position_t pos;
+                sim_node_position(sim, node, &pos);
+                aodvv2_lar_set_position(&node->core.lar, &pos);
+            }
+#endif
+        }
+    }
+
+    for (unsigned f = 0; f < p->flows; f++) {
+        sim_flow_t *flow = &sim->flows[f];
+        sim_node_t *src = &sim->nodes[flow->src];
+        sim_event_t ev = {
+            .time = flow->start,
+            .node = flow->src,
+            .kind = SIM_EV_FLOW_START,
+            .arg = f,
+        };
+        ev.origin = src->id;
+        ev.origin_seq = src->seq++;
+        if (_heap_push(&src->shard->heap, &ev) < 0) {
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+int sim_run(sim_t *sim)
+{
+    int res = _init(sim);
+    if (res < 0) {
+        return res;
+    }
+
+    if (pthread_barrier_init(&sim->barrier, NULL, sim->params.threads) != 0) {
+        return -EAGAIN;
+    }
+
+    struct timespec t0;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    unsigned started = 0;
+    for (unsigned i = 1; i < sim->params.threads; i++) {
+        if (pthread_create(&sim->shards[i].thread, NULL, _worker,
+                           &sim->shards[i]) != 0) {
+            fprintf(stderr, "aodvv2_sim: couldn't start worker %u\n", i);
+            abort();
+        }
+        started++;
+    }
+    _worker(&sim->shards[0]);
+    for (unsigned i = 1; i <= started; i++) {
+        pthread_join(sim->shards[i].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sim->wall_s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    pthread_barrier_destroy(&sim->barrier);
+    return 0;
+}
+
+void sim_free(sim_t *sim)
+{
+    if (sim->shards) {
+        for (unsigned i = 0; i < sim->params.threads; i++) {
+            sim_shard_t *shard = &sim->shards[i];
+            free(shard->heap.ev);
+            if (shard->outbox) {
+                for (unsigned j = 0; j < sim->params.threads; j++) {
+                    free(shard->outbox[j].ev);
+                }
+                free(shard->outbox);
+            }
+        }
+        free(sim->shards);
+    }
+    if (sim->nodes) {
+        for (unsigned i = 0; i < sim->params.nodes; i++) {
+            free(sim->nodes[i].nbrs);
+            free(sim->nodes[i].nbr_dist);
+            free(sim->nodes[i].flows);
+        }
+        free(sim->nodes);
+    }
+    free(sim->flows);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Host replacement of RIOT's assert.h
+ *
+ * RIOT's version panics through the kernel, here a failed assertion aborts
+ * the simulator.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef ASSERT_H
+#define ASSERT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef NDEBUG
+#define assert(cond) ((void)0)
+#else
+#define assert(cond) \
+    ((cond) ? (void)0 : (fprintf(stderr, "%s:%d: assertion `%s' failed\n", \
+                                 __FILE__, __LINE__, #cond), abort()))
+#endif
+
+#ifndef __cplusplus
+#define static_assert _Static_assert
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ASSERT_H */
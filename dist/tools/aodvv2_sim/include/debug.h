@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Host replacement of RIOT's debug.h
+ *
+ * RIOT's version pulls in the thread API, the simulator only needs the
+ * printing macros.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ENABLE_DEBUG
+#define ENABLE_DEBUG (0)
+#endif
+
+#define DEBUG(...) \
+    do { if (ENABLE_DEBUG) { printf(__VA_ARGS__); } } while (0)
+
+#define DEBUG_PUTS(str) \
+    do { if (ENABLE_DEBUG) { puts(str); } } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEBUG_H */
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       AODVv2 simulator command line and reporting
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+/**
+ * @name    Radio current draw (mA), CC1312R datasheet figures
+ * @{
+ */
+#define SIM_I_RX     (5.8)
+#define SIM_I_TX     (24.9)
+#define SIM_I_SLEEP  (0.00085)
+/** @} */
+
+static void _usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n NODES     number of routers (default 1000)\n"
+            "  -d DEGREE    mean number of neighbors (default 10)\n"
+            "  -f FLOWS     route discoveries (default 100)\n"
+            "  -j THREADS   worker threads (default: online CPUs)\n"
+            "  -s SEED      RNG seed (default 1)\n"
+            "  -t SECONDS   simulated time (default 60)\n"
+            "  -w SECONDS   discoveries start in [1, w] (default 30)\n"
+            "  -l USEC      per hop delay, MAC + processing (default 2000)\n"
+            "  -b BPS       PHY bit rate (default 50000)\n"
+            "  -o BYTES     PHY + lower layer overhead per packet (default 20)\n"
+            "  -p PER       packet error rate at the range edge (default 0.1)\n"
+            "  -D P,W       duty cycle the radio, W ms awake every P ms\n"
+            "  -R           with -D, repeat broadcasts once per wake window\n"
+            "               instead of on the neighbor schedules\n"
+            "  -L METRES    location-aided flooding, with this radio range\n"
+            "               (needs a LAR=1 build)\n"
+            "  -c           print a single CSV line (see -H)\n"
+            "  -H           print the CSV header and exit\n",
+            prog);
+}
+
+static const char _csv_header[] =
+    "nodes,threads,degree,components,flows,reachable,found,"
+    "p50_ms,p95_ms,max_ms,rreq_tx,rrep_tx,tx_bytes,tx_per_node,"
+    "airtime_share,lost,lrs_peak_mean,lrs_full,mcmsg_peak_mean,mcmsg_full,"
+    "dc_period_ms,dc_wake_ms,awake_share,slept,mean_ma,events,wall_s,"
+    "nh_changes,damped,bcast_copies,sync_tx,hysteresis";
+
+static int _cmp_time(const void *a, const void *b)
+{
+    sim_time_t ta = *(const sim_time_t *)a;
+    sim_time_t tb = *(const sim_time_t *)b;
+
+    return (ta > tb) - (ta < tb);
+}
+
+static void _report(const sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    sim_stats_t total = { 0 };
+
+    for (unsigned i = 0; i < p->threads; i++) {
+        const sim_stats_t *s = &sim->shards[i].stats;
+        total.events += s->events;
+        total.rreq_tx += s->rreq_tx;
+        total.rrep_tx += s->rrep_tx;
+        total.other_tx += s->other_tx;
+        total.tx_bytes += s->tx_bytes;
+        total.airtime_us += s->airtime_us;
+        total.rx += s->rx;
+        total.lost += s->lost;
+        total.misrouted += s->misrouted;
+        total.slept += s->slept;
+        total.bcast_copies += s->bcast_copies;
+        total.sync_tx += s->sync_tx;
+        total.fib_add += s->fib_add;
+        total.fib_del += s->fib_del;
+    }
+
+    unsigned reachable = 0;
+    unsigned found = 0;
+    sim_time_t *lat = malloc((p->flows + 1) * sizeof(*lat));
+    for (unsigned f = 0; f < p->flows; f++) {
+        const sim_flow_t *flow = &sim->flows[f];
+        reachable += flow->reachable;
+        if (flow->found != SIM_TIME_NEVER && lat) {
+            lat[found++] = flow->found - flow->start;
+        }
+    }
+    double p50 = 0, p95 = 0, max = 0;
+    if (found && lat) {
+        qsort(lat, found, sizeof(*lat), _cmp_time);
+        p50 = lat[(found - 1) / 2] / 1000.0;
+        p95 = lat[((found - 1) * 95) / 100] / 1000.0;
+        max = lat[found - 1] / 1000.0;
+    }
+    free(lat);
+
+    double degree = 0;
+    double awake = 0;
+    double charge = 0;
+    double lrs_mean = 0;
+    double mcmsg_mean = 0;
+    unsigned lrs_full = 0;
+    unsigned mcmsg_full = 0;
+    uint64_t nh_changes = 0;
+    uint64_t damped = 0;
+    uint64_t hysteresis = 0;
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    aodvv2_template_stats_t tpl = { 0 };
+#endif
+    for (unsigned i = 0; i < p->nodes; i++) {
+        const sim_node_t *node = &sim->nodes[i];
+        degree += node->nbrs_numof;
+        nh_changes += node->core.lrs.stats.next_hop_changes;
+        damped += node->core.lrs.stats.damped;
+        hysteresis += node->core.lrs.stats.hysteresis;
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+        const aodvv2_template_stats_t *ts = &node->core.writer.templates.stats;
+        tpl.hits += ts->hits;
+        tpl.learned += ts->learned;
+        tpl.rejected += ts->rejected;
+        tpl.mismatches += ts->mismatches;
+#endif
+
+        /* Charge in mA·us, the radio is receiving while awake and not
+         * transmitting */
+        double on = sim_node_awake_time(sim, node);
+        awake += on;
+        charge += SIM_I_TX * node->tx_time +
+                  SIM_I_RX * (on > node->tx_time ? on - node->tx_time : 0) +
+                  SIM_I_SLEEP * (p->duration - on);
+        lrs_mean += node->lrs_peak;
+        mcmsg_mean += node->mcmsg_peak;
+        lrs_full += node->lrs_peak >= CONFIG_AODVV2_MAX_ROUTING_ENTRIES;
+        mcmsg_full += node->mcmsg_peak >= CONFIG_AODVV2_MCMSG_MAX_ENTRIES;
+    }
+    degree /= p->nodes;
+    double awake_share = awake / ((double)p->duration * p->nodes);
+    double mean_ma = charge / ((double)p->duration * p->nodes);
+    lrs_mean /= p->nodes;
+    mcmsg_mean /= p->nodes;
+
+    /* Share of the simulated time the average router spent transmitting */
+    double airtime_share = (double)total.airtime_us /
+                           ((double)p->duration * p->nodes);
+
+    if (p->csv) {
+        printf("%u,%u,%.2f,%u,%u,%u,%u,%.1f,%.1f,%.1f,%" PRIu64 ",%" PRIu64
+               ",%" PRIu64 ",%.1f,%.5f,%" PRIu64 ",%.2f,%u,%.2f,%u,%" PRIu64
+               ",%" PRIu64 ",%.4f,%" PRIu64 ",%.4f,%" PRIu64 ",%.2f,%" PRIu64
+               ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+               p->nodes, p->threads, degree, sim->components, p->flows,
+               reachable, found, p50, p95, max, total.rreq_tx, total.rrep_tx,
+               total.tx_bytes, (double)total.tx_bytes / p->nodes,
+               airtime_share, total.lost, lrs_mean, lrs_full, mcmsg_mean,
+               mcmsg_full, p->dc_period / 1000, p->dc_wake / 1000, awake_share,
+               total.slept, mean_ma, total.events, sim->wall_s, nh_changes,
+               damped, total.bcast_copies, total.sync_tx, hysteresis);
+        return;
+    }
+
+    printf("topology\n");
+    printf("  routers             %u (%u threads)\n", p->nodes, p->threads);
+    printf("  mean degree         %.2f\n", degree);
+    printf("  components          %u\n", sim->components);
+    printf("convergence\n");
+    printf("  discoveries         %u (%u reachable)\n", p->flows, reachable);
+    printf("  routes found        %u (%.1f%% of reachable)\n", found,
+           reachable ? 100.0 * found / reachable : 0.0);
+    printf("  latency p50/p95/max %.1f / %.1f / %.1f ms\n", p50, p95, max);
+    printf("control overhead\n");
+    printf("  RREQ / RREP tx      %" PRIu64 " / %" PRIu64 "\n",
+           total.rreq_tx, total.rrep_tx);
+    printf("  bytes sent          %" PRIu64 " (%.1f per router, %.1f per "
+           "discovery)\n", total.tx_bytes, (double)total.tx_bytes / p->nodes,
+           p->flows ? (double)total.tx_bytes / p->flows : 0.0);
+    printf("  airtime share       %.4f%%\n", 100.0 * airtime_share);
+    printf("  rx / lost           %" PRIu64 " / %" PRIu64 "\n", total.rx,
+           total.lost);
+    printf("  bad unicasts        %" PRIu64 "\n", total.misrouted);
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    printf("  templated writes    %" PRIu32 " (%" PRIu32 " learned, %" PRIu32
+           " rejected, %" PRIu32 " mismatches)\n", tpl.hits, tpl.learned,
+           tpl.rejected, tpl.mismatches);
+#endif
+    printf("table pressure\n");
+    printf("  LRS peak mean       %.2f of %u (%u routers full)\n", lrs_mean,
+           CONFIG_AODVV2_MAX_ROUTING_ENTRIES, lrs_full);
+    printf("  McMsg peak mean     %.2f of %u (%u routers full)\n", mcmsg_mean,
+           CONFIG_AODVV2_MCMSG_MAX_ENTRIES, mcmsg_full);
+    printf("  FIB add / del       %" PRIu64 " / %" PRIu64 "\n", total.fib_add,
+           total.fib_del);
+    printf("  next hop changes    %" PRIu64 " (%" PRIu64 " held by damping, %"
+           PRIu64 " by hysteresis)\n", nh_changes, damped, hysteresis);
+    printf("energy\n");
+    if (p->dc_period) {
+        printf("  duty cycle          %" PRIu64 " ms every %" PRIu64 " ms\n",
+               p->dc_wake / 1000, p->dc_period / 1000);
+        printf("  broadcast copies    %" PRIu64 " (%s)\n", total.bcast_copies,
+               p->dc_blind ? "one per window" : "on neighbor schedules");
+        printf("  SYNC frames         %" PRIu64 "\n", total.sync_tx);
+    }
+    else {
+        printf("  duty cycle          off\n");
+    }
+    printf("  radio awake         %.2f%%\n", 100.0 * awake_share);
+    printf("  mean radio current  %.3f mA\n", mean_ma);
+    printf("  missed, asleep      %" PRIu64 "\n", total.slept);
+    printf("run\n");
+    printf("  simulated           %.1f s\n",
+           (double)p->duration / SIM_US_PER_SEC);
+    printf("  wall                %.2f s\n", sim->wall_s);
+    printf("  events              %" PRIu64 " (%.0f/s)\n", total.events,
+           sim->wall_s > 0 ? total.events / sim->wall_s : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    sim_t sim;
+    memset(&sim, 0, sizeof(sim));
+
+    sim_params_t *p = &sim.params;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    p->nodes = 1000;
+    p->degree = 10;
+    p->flows = 100;
+    p->threads = cpus > 0 ? (unsigned)cpus : 1;
+    p->seed = 1;
+    p->duration = 60 * SIM_US_PER_SEC;
+    p->start_window = 30 * SIM_US_PER_SEC;
+    p->link_delay = 2000;
+    p->bitrate = 50000;
+    p->phy_overhead = 20;
+    p->per_max = 0.1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:f:j:s:t:w:l:b:o:p:D:RL:cHh")) != -1) {
+        switch (opt) {
+            case 'n': p->nodes = strtoul(optarg, NULL, 0); break;
+            case 'd': p->degree = strtod(optarg, NULL); break;
+            case 'f': p->flows = strtoul(optarg, NULL, 0); break;
+            case 'j': p->threads = strtoul(optarg, NULL, 0); break;
+            case 's': p->seed = strtoull(optarg, NULL, 0); break;
+            case 't': p->duration = strtod(optarg, NULL) * SIM_US_PER_SEC; break;
+            case 'w': p->start_window = strtod(optarg, NULL) * SIM_US_PER_SEC; break;
+            case 'l': p->link_delay = strtoull(optarg, NULL, 0); break;
+            case 'b': p->bitrate = strtoul(optarg, NULL, 0); break;
+            case 'o': p->phy_overhead = strtoul(optarg, NULL, 0); break;
+            case 'p': p->per_max = strtod(optarg, NULL); break;
+            case 'D': {
+                char *end;
+                p->dc_period = strtoull(optarg, &end, 0) * 1000;
+                p->dc_wake = (*end == ',') ? strtoull(end + 1, NULL, 0) * 1000
+                                           : 0;
+                break;
+            }
+            case 'R': p->dc_blind = true; break;
+            case 'L': p->lar_range = strtod(optarg, NULL); break;
+            case 'c': p->csv = true; break;
+            case 'H': puts(_csv_header); return 0;
+            default:
+                _usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (p->nodes < 2 || p->degree <= 0 || p->threads == 0 ||
+        p->bitrate == 0 || (p->dc_period && (p->dc_wake == 0 ||
+                                             p->dc_wake > p->dc_period))) {
+        _usage(argv[0]);
+        return 1;
+    }
+    if (p->lar_range > 0 && !IS_USED(MODULE_AODVV2_LAR)) {
+        fprintf(stderr, "-L needs a build with LAR=1\n");
+        return 1;
+    }
+    if (p->threads > p->nodes) {
+        p->threads = p->nodes;
+    }
+
+    int res = sim_topology_build(&sim);
+    if (res == 0) {
+        res = sim_flows_build(&sim);
+    }
+    if (res == 0) {
+        res = sim_run(&sim);
+    }
+    if (res < 0) {
+        fprintf(stderr, "aodvv2_sim: %s\n", strerror(-res));
+        sim_free(&sim);
+        return 1;
+    }
+
+    _report(&sim);
+    sim_free(&sim);
+    return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       AODVv2 discrete-event mesh simulator
+ *
+ * Every simulated router is a full @ref aodvv2_core_t driven by a virtual
+ * clock. Routers are sharded across worker threads which advance in lock
+ * step using a conservative time window equal to the minimum link latency
+ * (the lookahead), so no event generated inside a window can land inside the
+ * same window.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net/aodvv2/core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Simulation time, in microseconds
+ */
+typedef uint64_t sim_time_t;
+
+#define SIM_TIME_NEVER  (UINT64_MAX)  /**< No more events */
+#define SIM_US_PER_SEC  (1000000ULL)  /**< Microseconds per second */
+
+/**
+ * @brief   Simulation parameters
+ */
+typedef struct {
+    unsigned nodes;          /**< Number of routers */
+    double degree;           /**< Target mean number of neighbors */
+    unsigned flows;          /**< Number of route discoveries */
+    unsigned threads;        /**< Worker threads (shards) */
+    uint64_t seed;           /**< RNG seed */
+    sim_time_t duration;     /**< Simulated time */
+    sim_time_t start_window; /**< Discoveries start uniformly in [1 s, this] */
+    sim_time_t link_delay;   /**< Fixed per hop delay (MAC + processing) */
+    unsigned bitrate;        /**< PHY bit rate in bit/s */
+    unsigned phy_overhead;   /**< Bytes added on air to every RFC 5444 packet */
+    double per_max;          /**< Packet error rate at the edge of the range */
+    sim_time_t dc_period;    /**< Duty cycle period, 0 if always on */
+    sim_time_t dc_wake;      /**< Wake window of the duty cycle */
+    bool dc_blind;           /**< Repeat broadcasts once per wake window
+                                  instead of on the neighbor schedules */
+    double lar_range;        /**< Radio range (m) with location-aided
+                                  flooding, 0 if off */
+    bool csv;                /**< Print results as a single CSV line */
+} sim_params_t;
+
+/**
+ * @brief   A route discovery
+ */
+typedef struct {
+    uint32_t src;            /**< Originating router */
+    uint32_t dst;            /**< Target router */
+    sim_time_t start;        /**< Time the RREQ was originated */
+    sim_time_t found;        /**< Time the RREP arrived, or SIM_TIME_NEVER */
+    bool reachable;          /**< Both ends are on the same component */
+} sim_flow_t;
+
+/**
+ * @brief   Event kinds
+ */
+typedef enum {
+    SIM_EV_RX,               /**< A packet arrives at a router */
+    SIM_EV_FLOW_START,       /**< A router starts a route discovery */
+    SIM_EV_SYNC,             /**< A router announces its wake schedule */
+} sim_event_kind_t;
+
+/**
+ * @brief   A scheduled event
+ *
+ * Events are totally ordered by (time, origin, origin_seq), which keeps a
+ * run deterministic for a given seed no matter the number of threads.
+ */
+typedef struct {
+    sim_time_t time;         /**< When the event fires */
+    uint32_t origin;         /**< Router that scheduled the event */
+    uint32_t node;           /**< Router that handles the event */
+    uint64_t origin_seq;     /**< Per origin sequence number */
+    uint32_t arg;            /**< Flow index for SIM_EV_FLOW_START, 1 for a
+                                  unicast SIM_EV_RX */
+    uint16_t kind;           /**< @ref sim_event_kind_t */
+    uint16_t len;            /**< Packet length */
+    uint8_t data[AODVV2_RFC5444_PACKET_SIZE]; /**< Packet */
+} sim_event_t;
+
+/**
+ * @brief   Growable array of events
+ */
+typedef struct {
+    sim_event_t *ev;         /**< Events */
+    size_t len;              /**< Used entries */
+    size_t cap;              /**< Allocated entries */
+} sim_event_vec_t;
+
+/**
+ * @brief   Counters, kept per shard and summed at the end
+ */
+typedef struct {
+    uint64_t events;         /**< Events processed */
+    uint64_t rreq_tx;        /**< RREQ transmissions */
+    uint64_t rrep_tx;        /**< RREP transmissions */
+    uint64_t other_tx;       /**< Other transmissions */
+    uint64_t tx_bytes;       /**< Bytes sent (RFC 5444 payload) */
+    uint64_t airtime_us;     /**< Airtime used, including PHY overhead */
+    uint64_t rx;             /**< Receptions */
+    uint64_t lost;           /**< Receptions lost to the radio model */
+    uint64_t misrouted;      /**< Unicasts to a non-neighbor */
+    uint64_t slept;          /**< Receptions missed, receiver asleep */
+    uint64_t bcast_copies;   /**< Broadcast copies, the first ones included */
+    uint64_t sync_tx;        /**< Schedule announcements (SYNC frames) */
+    uint64_t fib_add;        /**< Routes installed */
+    uint64_t fib_del;        /**< Routes removed */
+} sim_stats_t;
+
+typedef struct sim_shard sim_shard_t;
+
+/**
+ * @brief   A simulated router
+ */
+typedef struct {
+    aodvv2_core_t core;      /**< Protocol instance */
+    sim_shard_t *shard;      /**< Shard owning this router */
+    uint32_t id;             /**< Router index */
+    double x;                /**< Position */
+    double y;                /**< Position */
+    uint32_t *nbrs;          /**< Neighbor indices */
+    float *nbr_dist;         /**< Normalized distance to each neighbor */
+    uint32_t nbrs_numof;     /**< Number of neighbors */
+    uint32_t *flows;         /**< Flows originated here */
+    uint32_t flows_numof;    /**< Number of flows originated here */
+    uint64_t seq;            /**< Next event sequence number */
+    uint64_t rng;            /**< xorshift64* state */
+    sim_time_t now;          /**< Time of the event being handled */
+    sim_time_t dc_phase;     /**< Start of the first wake window */
+    sim_time_t awake_until;  /**< Radio kept on until this time */
+    sim_time_t extra_awake;  /**< Time awake outside of wake windows */
+    sim_time_t tx_time;      /**< Time spent transmitting */
+    uint8_t lrs_peak;        /**< Peak Local Route Set occupancy */
+    uint8_t mcmsg_peak;      /**< Peak Multicast Message Set occupancy */
+} sim_node_t;
+
+/**
+ * @brief   A worker thread and the routers it owns
+ */
+struct sim_shard {
+    struct sim *sim;         /**< Simulation */
+    pthread_t thread;        /**< Worker thread */
+    unsigned idx;            /**< Shard index */
+    uint32_t first;          /**< First router owned */
+    uint32_t last;           /**< One past the last router owned */
+    sim_event_vec_t heap;    /**< Pending local events (binary heap) */
+    sim_event_vec_t *outbox; /**< Events for each other shard */
+    sim_time_t next;         /**< Earliest pending event */
+    sim_stats_t stats;       /**< Counters */
+};
+
+/**
+ * @brief   Simulation
+ */
+typedef struct sim {
+    sim_params_t params;     /**< Parameters */
+    sim_node_t *nodes;       /**< Routers, sorted by x coordinate */
+    sim_shard_t *shards;     /**< Shards */
+    sim_flow_t *flows;       /**< Route discoveries */
+    sim_time_t lookahead;    /**< Conservative window size */
+    pthread_barrier_t barrier; /**< Window barrier */
+    double side;             /**< Side of the deployment area (range = 1) */
+    unsigned components;     /**< Connected components of the topology */
+    double wall_s;           /**< Wall time spent simulating */
+} sim_t;
+
+/**
+ * @brief   Place routers and build the unit-disk neighbor graph
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sim_topology_build(sim_t *sim);
+
+/**
+ * @brief   Pick random discoveries, preferring reachable pairs
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sim_flows_build(sim_t *sim);
+
+/**
+ * @brief   Initialize the routers and shards and run the simulation
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sim_run(sim_t *sim);
+
+/**
+ * @brief   Free all the simulation memory
+ */
+void sim_free(sim_t *sim);
+
+/**
+ * @brief   xorshift64* step
+ */
+static inline uint64_t sim_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief   Uniform double in [0, 1)
+ */
+static inline double sim_rand_unit(uint64_t *state)
+{
+    return (sim_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief   Seed a per router RNG so runs don't depend on the thread count
+ */
+static inline uint64_t sim_rand_seed(uint64_t seed, uint64_t stream)
+{
+    /* splitmix64 */
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/**
+ * @brief   Position of a router on the location-aided flooding grid
+ */
+void sim_node_position(const sim_t *sim, const sim_node_t *node,
+                       aodvv2_position_t *pos);
+
+/**
+ * @brief   Time a router spent with the radio on during the simulation
+ */
+sim_time_t sim_node_awake_time(const sim_t *sim, const sim_node_t *node);
+
+/**
+ * @brief   Link-local address of a router
+ */
+void sim_node_ll_addr(uint32_t id, ipv6_addr_t *addr);
+
+/**
+ * @brief   Client address (the address routes are discovered for)
+ */
+void sim_node_client_addr(uint32_t id, ipv6_addr_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Topology and workload generation
+ *
+ * Routers are placed uniformly on a square whose side is chosen so the
+ * expected number of neighbors inside the unit radio range matches the
+ * requested degree. Neighbors are found with a grid of unit cells.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+typedef struct {
+    double x;
+    double y;
+} _pos_t;
+
+static int _cmp_pos(const void *a, const void *b)
+{
+    const _pos_t *pa = a;
+    const _pos_t *pb = b;
+
+    if (pa->x < pb->x) {
+        return -1;
+    }
+    return pa->x > pb->x;
+}
+
+static uint32_t _find(uint32_t *parent, uint32_t i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static int _add_nbr(sim_node_t *node, uint32_t *cap, uint32_t nbr, float dist)
+{
+    if (node->nbrs_numof == *cap) {
+        uint32_t new_cap = *cap ? *cap * 2 : 8;
+        uint32_t *nbrs = realloc(node->nbrs, new_cap * sizeof(*nbrs));
+        if (nbrs == NULL) {
+            return -ENOMEM;
+        }
+        node->nbrs = nbrs;
+        float *nbr_dist = realloc(node->nbr_dist, new_cap * sizeof(*nbr_dist));
+        if (nbr_dist == NULL) {
+            return -ENOMEM;
+        }
+        node->nbr_dist = nbr_dist;
+        *cap = new_cap;
+    }
+
+    node->nbrs[node->nbrs_numof] = nbr;
+    node->nbr_dist[node->nbrs_numof] = dist;
+    node->nbrs_numof++;
+    return 0;
+}
+
+int sim_topology_build(sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    uint64_t rng = sim_rand_seed(p->seed, UINT32_MAX);
+    int res = -ENOMEM;
+
+    sim->side = sqrt(p->nodes * M_PI / p->degree);
+
+    _pos_t *pos = malloc(p->nodes * sizeof(*pos));
+    if (pos == NULL) {
+        return -ENOMEM;
+    }
+    for (unsigned i = 0; i < p->nodes; i++) {
+        pos[i].x = sim_rand_unit(&rng) * sim->side;
+        pos[i].y = sim_rand_unit(&rng) * sim->side;
+    }
+
+    /* Sorting by x makes the contiguous shards vertical stripes, which keeps
+     * most links inside a shard */
+    qsort(pos, p->nodes, sizeof(*pos), _cmp_pos);
+
+    sim->nodes = calloc(p->nodes, sizeof(*sim->nodes));
+    if (sim->nodes == NULL) {
+        free(pos);
+        return -ENOMEM;
+    }
+    for (unsigned i = 0; i < p->nodes; i++) {
+        sim->nodes[i].id = i;
+        sim->nodes[i].x = pos[i].x;
+        sim->nodes[i].y = pos[i].y;
+    }
+    free(pos);
+
+    /* Bucket routers on unit cells */
+    unsigned cells = (unsigned)ceil(sim->side);
+    if (cells == 0) {
+        cells = 1;
+    }
+    uint32_t *head = malloc((size_t)cells * cells * sizeof(*head));
+    uint32_t *next = malloc(p->nodes * sizeof(*next));
+    uint32_t *caps = calloc(p->nodes, sizeof(*caps));
+    uint32_t *parent = malloc(p->nodes * sizeof(*parent));
+    if (head == NULL || next == NULL || caps == NULL || parent == NULL) {
+        goto out;
+    }
+    memset(head, 0xff, (size_t)cells * cells * sizeof(*head));
+    for (unsigned i = 0; i < p->nodes; i++) {
+        unsigned cx = (unsigned)sim->nodes[i].x;
+        unsigned cy = (unsigned)sim->nodes[i].y;
+        cx = cx < cells ? cx : cells - 1;
+        cy = cy < cells ? cy : cells - 1;
+        next[i] = head[cy * cells + cx];
+        head[cy * cells + cx] = i;
+        parent[i] = i;
+    }
+
+    for (unsigned i = 0; i < p->nodes; i++) {
+        sim_node_t *node = &sim->nodes[i];
+        int cx = (int)node->x;
+        int cy = (int)node->y;
+
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                int x = cx + dx;
+                int y = cy + dy;
+                if (x < 0 || y < 0 || x >= (int)cells || y >= (int)cells) {
+                    continue;
+                }
+                for (uint32_t j = head[y * cells + x]; j != UINT32_MAX;
+                     j = next[j]) {
+                    if (j == i) {
+                        continue;
+                    }
+                    double ddx = node->x - sim->nodes[j].x;
+                    double ddy = node->y - sim->nodes[j].y;
+                    double d = sqrt(ddx * ddx + ddy * ddy);
+                    if (d > 1.0) {
+                        continue;
+                    }
+                    if (_add_nbr(node, &caps[i], j, (float)d) < 0) {
+                        goto out;
+                    }
+                    uint32_t ri = _find(parent, i);
+                    uint32_t rj = _find(parent, j);
+                    if (ri != rj) {
+                        parent[ri] = rj;
+                    }
+                }
+            }
+        }
+    }
+
+    sim->components = 0;
+    for (unsigned i = 0; i < p->nodes; i++) {
+        if (_find(parent, i) == i) {
+            sim->components++;
+        }
+    }
+
+    /* Reuse the union-find roots to tell reachable flows apart */
+    for (unsigned i = 0; i < p->nodes; i++) {
+        sim->nodes[i].seq = _find(parent, i);
+    }
+
+    res = 0;
+
+out:
+    free(head);
+    free(next);
+    free(caps);
+    free(parent);
+    return res;
+}
+
+int sim_flows_build(sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    uint64_t rng = sim_rand_seed(p->seed, (uint64_t)UINT32_MAX + 1);
+
+    sim->flows = calloc(p->flows, sizeof(*sim->flows));
+    if (sim->flows == NULL && p->flows > 0) {
+        return -ENOMEM;
+    }
+
+    for (unsigned f = 0; f < p->flows; f++) {
+        sim_flow_t *flow = &sim->flows[f];
+
+        /* Prefer pairs on the same component, give up after a few tries on
+         * badly partitioned topologies */
+        for (unsigned tries = 0; tries < 32; tries++) {
+            flow->src = sim_rand(&rng) % p->nodes;
+            do {
+                flow->dst = sim_rand(&rng) % p->nodes;
+            } while (p->nodes > 1 && flow->dst == flow->src);
+
+            flow->reachable = sim->nodes[flow->src].seq ==
+                              sim->nodes[flow->dst].seq;
+            if (flow->reachable) {
+                break;
+            }
+        }
+
+        sim_time_t span = p->start_window > SIM_US_PER_SEC
+                        ? p->start_window - SIM_US_PER_SEC : 1;
+        flow->start = SIM_US_PER_SEC + sim_rand(&rng) % span;
+        flow->found = SIM_TIME_NEVER;
+
+        sim_node_t *src = &sim->nodes[flow->src];
+        uint32_t *flows = realloc(src->flows,
+                                  (src->flows_numof + 1) * sizeof(*flows));
+        if (flows == NULL) {
+            return -ENOMEM;
+        }
+        src->flows = flows;
+        src->flows[src->flows_numof++] = f;
+    }
+
+    /* Component ids are no longer needed */
+    for (unsigned i = 0; i < p->nodes; i++) {
+        sim->nodes[i].seq = 0;
+    }
+
+    return 0;
+}
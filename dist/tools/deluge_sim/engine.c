@@ -0,0 +1,570 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Event loop, radio model and platform operations
+ *
+ * Radio model:
+ * - Unit-disk links, each reception is lost with probability `p * d²`.
+ * - Carrier sense, a node only starts sending when it hears nothing. Busy
+ *   medium backoffs are 802.15.4 like, random up to (2^be - 1) slots with be
+ *   from 3 to 5, and the frame is dropped after 5 tries.
+ * - A frame is received only if the receiver heard nothing else, and wasn't
+ *   sending, while it was on the air. Hidden terminals collide.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define BACKOFF_SLOT_US  (320)
+#define BACKOFF_MIN_BE   (3)
+#define BACKOFF_MAX_BE   (5)
+#define BACKOFF_MAX      (5)
+
+typedef enum {
+    EV_TIMER,
+    EV_CSMA,
+    EV_TX_END,
+    EV_PUBLISH,
+    EV_REBOOT,
+    EV_BOOT,
+} _kind_t;
+
+typedef struct {
+    sim_time_t time;
+    uint64_t seq;
+    uint32_t node;
+    uint32_t gen;
+    _kind_t kind;
+} _event_t;
+
+static void _boot(sim_node_t *node);
+
+/* Event heap, ordered by (time, seq) */
+
+static bool _before(const _event_t *a, const _event_t *b)
+{
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static int _push(sim_t *sim, sim_time_t time, _kind_t kind, uint32_t node,
+                 uint32_t gen)
+{
+    if (sim->heap_len == sim->heap_cap) {
+        size_t cap = sim->heap_cap ? sim->heap_cap * 2 : 256;
+        _event_t *heap = realloc(sim->heap, cap * sizeof(*heap));
+        if (heap == NULL) {
+            return -ENOMEM;
+        }
+        sim->heap = heap;
+        sim->heap_cap = cap;
+    }
+
+    _event_t *heap = sim->heap;
+    size_t i = sim->heap_len++;
+    _event_t ev = { .time = time, .seq = sim->seq++, .node = node,
+                    .gen = gen, .kind = kind };
+
+    while (i > 0 && _before(&ev, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = ev;
+    return 0;
+}
+
+static _event_t _pop(sim_t *sim)
+{
+    _event_t *heap = sim->heap;
+    _event_t top = heap[0];
+    _event_t last = heap[--sim->heap_len];
+    size_t i = 0;
+
+    while (2 * i + 1 < sim->heap_len) {
+        size_t c = 2 * i + 1;
+        if (c + 1 < sim->heap_len && _before(&heap[c + 1], &heap[c])) {
+            c++;
+        }
+        if (!_before(&heap[c], &last)) {
+            break;
+        }
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* Digest, FNV-1a is enough to catch a wrong chunk in the simulation */
+static void _digest(const uint8_t *data, size_t len,
+                    uint8_t digest[DELUGE_DIGEST_LEN])
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    memset(digest, 0, DELUGE_DIGEST_LEN);
+    memcpy(digest, &h, sizeof(h));
+}
+
+/* Radio */
+
+static sim_time_t _airtime(const sim_t *sim, size_t len)
+{
+    return ((len + sim->params.phy_overhead) * 8 * SIM_US_PER_SEC) /
+           sim->params.bitrate;
+}
+
+static void _csma_schedule(sim_node_t *node)
+{
+    unsigned be = BACKOFF_MIN_BE + node->backoffs;
+    if (be > BACKOFF_MAX_BE) {
+        be = BACKOFF_MAX_BE;
+    }
+    sim_time_t backoff = (sim_rand(&node->rng) % (1U << be)) * BACKOFF_SLOT_US;
+
+    node->csma = true;
+    _push(node->sim, node->sim->now + backoff, EV_CSMA, node->id, 0);
+}
+
+static void _csma(sim_node_t *node)
+{
+    sim_t *sim = node->sim;
+
+    node->csma = false;
+    if (node->off || node->queue_len == 0) {
+        return;
+    }
+
+    if (node->rx_busy > 0 || node->txing != NULL) {
+        if (++node->backoffs >= BACKOFF_MAX) {
+            sim->stats.csma_drops++;
+            node->queue_head = (node->queue_head + 1) % SIM_TX_QUEUE_LEN;
+            node->queue_len--;
+            node->backoffs = 0;
+            if (node->queue_len == 0) {
+                return;
+            }
+        }
+        _csma_schedule(node);
+        return;
+    }
+
+    sim_frame_t *frame = malloc(sizeof(*frame));
+    if (frame == NULL) {
+        return;
+    }
+    *frame = node->queue[node->queue_head];
+    node->queue_head = (node->queue_head + 1) % SIM_TX_QUEUE_LEN;
+    node->queue_len--;
+    node->backoffs = 0;
+
+    node->txing = frame;
+    /* Half duplex, whatever we were receiving is gone */
+    node->rx_ok = false;
+
+    for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+        sim_node_t *nbr = &sim->nodes[node->nbrs[i]];
+        if (nbr->rx_busy == 0 && nbr->txing == NULL) {
+            nbr->rx_frame = frame;
+            nbr->rx_ok = true;
+        }
+        else if (nbr->rx_frame != NULL && nbr->rx_ok) {
+            sim->stats.collisions++;
+            nbr->rx_ok = false;
+        }
+        nbr->rx_busy++;
+    }
+
+    sim_time_t airtime = _airtime(sim, frame->len);
+    sim->stats.frames++;
+    sim->stats.airtime_us += airtime;
+    _push(sim, sim->now + airtime, EV_TX_END, node->id, 0);
+}
+
+static void _tx_end(sim_node_t *node)
+{
+    sim_t *sim = node->sim;
+    sim_frame_t *frame = node->txing;
+
+    node->txing = NULL;
+
+    for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+        sim_node_t *nbr = &sim->nodes[node->nbrs[i]];
+        nbr->rx_busy--;
+        if (nbr->rx_frame != frame) {
+            continue;
+        }
+        nbr->rx_frame = NULL;
+        if (!nbr->rx_ok || nbr->off) {
+            continue;
+        }
+        double d = nbr->nbr_dist[0];
+        for (uint32_t j = 0; j < nbr->nbrs_numof; j++) {
+            if (nbr->nbrs[j] == node->id) {
+                d = nbr->nbr_dist[j];
+                break;
+            }
+        }
+        if (sim_rand_unit(&nbr->rng) < sim->params.per_max * d * d) {
+            sim->stats.lost++;
+            continue;
+        }
+        sim->stats.rx++;
+        deluge_core_handle(&nbr->core, frame->data, frame->len);
+    }
+
+    free(frame);
+
+    if (node->queue_len > 0 && !node->csma && !node->off) {
+        _csma_schedule(node);
+    }
+}
+
+/* Platform operations */
+
+static uint32_t _op_random(void *ctx)
+{
+    sim_node_t *node = ctx;
+    return sim_rand(&node->rng) >> 32;
+}
+
+static void _op_set_timer(void *ctx, uint32_t ms)
+{
+    sim_node_t *node = ctx;
+    _push(node->sim, node->sim->now + ms * SIM_US_PER_MS, EV_TIMER, node->id,
+          ++node->timer_gen);
+}
+
+static int _op_send(void *ctx, const void *buf, size_t len)
+{
+    sim_node_t *node = ctx;
+
+    if (node->queue_len == SIM_TX_QUEUE_LEN) {
+        node->sim->stats.queue_drops++;
+        return -ENOBUFS;
+    }
+
+    sim_frame_t *frame = &node->queue[(node->queue_head + node->queue_len) %
+                                      SIM_TX_QUEUE_LEN];
+    frame->src = node->id;
+    frame->len = len;
+    memcpy(frame->data, buf, len);
+    node->queue_len++;
+
+    if (!node->csma && node->txing == NULL) {
+        _csma_schedule(node);
+    }
+    return 0;
+}
+
+static int _op_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    sim_node_t *node = ctx;
+
+    if (node->image == NULL || offset + len > node->meta.size) {
+        return -EINVAL;
+    }
+    memcpy(buf, &node->image[offset], len);
+    return 0;
+}
+
+static int _op_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    sim_node_t *node = ctx;
+
+    if (node->image == NULL || offset + len > node->meta.size) {
+        return -EINVAL;
+    }
+    memcpy(&node->image[offset], buf, len);
+    return 0;
+}
+
+static int _op_prepare(void *ctx, const deluge_meta_t *meta)
+{
+    sim_node_t *node = ctx;
+    uint8_t *image = realloc(node->image, meta->size);
+
+    if (image == NULL) {
+        return -ENOMEM;
+    }
+    memset(image, 0xff, meta->size);
+    node->image = image;
+    node->meta = *meta;
+    node->pages = 0;
+    return 0;
+}
+
+static void _op_page_done(void *ctx, uint16_t page)
+{
+    sim_node_t *node = ctx;
+    node->pages = page + 1;
+}
+
+static int _op_verify(void *ctx, const deluge_meta_t *meta)
+{
+    sim_node_t *node = ctx;
+    uint8_t digest[DELUGE_DIGEST_LEN];
+
+    _digest(node->image, meta->size, digest);
+    return memcmp(digest, meta->digest, sizeof(digest)) ? -EBADMSG : 0;
+}
+
+static void _op_complete(void *ctx, const deluge_meta_t *meta)
+{
+    sim_node_t *node = ctx;
+    (void)meta;
+
+    if (node->done == SIM_TIME_NEVER) {
+        node->done = node->sim->now;
+        node->sim->done++;
+    }
+}
+
+static const deluge_ops_t _ops = {
+    .random = _op_random,
+    .set_timer = _op_set_timer,
+    .send = _op_send,
+    .read = _op_read,
+    .write = _op_write,
+    .prepare = _op_prepare,
+    .page_done = _op_page_done,
+    .verify = _op_verify,
+    .complete = _op_complete,
+};
+
+static void _boot(sim_node_t *node)
+{
+    node->off = false;
+    node->timer_gen++;
+    deluge_core_init(&node->core, &_ops, node, node->id,
+                     node->meta.version ? &node->meta : NULL, node->pages);
+}
+
+/* Topology */
+
+static int _add_nbr(sim_node_t *node, uint32_t nbr, float dist)
+{
+    uint32_t *nbrs = realloc(node->nbrs, (node->nbrs_numof + 1) * sizeof(*nbrs));
+    if (nbrs == NULL) {
+        return -ENOMEM;
+    }
+    node->nbrs = nbrs;
+    float *nbr_dist = realloc(node->nbr_dist,
+                              (node->nbrs_numof + 1) * sizeof(*nbr_dist));
+    if (nbr_dist == NULL) {
+        return -ENOMEM;
+    }
+    node->nbr_dist = nbr_dist;
+    node->nbrs[node->nbrs_numof] = nbr;
+    node->nbr_dist[node->nbrs_numof] = dist;
+    node->nbrs_numof++;
+    return 0;
+}
+
+/* Hops from the seed, returns the number of nodes reached */
+static unsigned _bfs(sim_t *sim)
+{
+    const unsigned n = sim->params.nodes;
+    uint32_t *fifo = malloc(n * sizeof(*fifo));
+    unsigned head = 0;
+    unsigned tail = 0;
+
+    if (fifo == NULL) {
+        return 0;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        sim->nodes[i].hops = UINT32_MAX;
+    }
+    sim->nodes[0].hops = 0;
+    sim->diameter = 0;
+    fifo[tail++] = 0;
+    while (head < tail) {
+        sim_node_t *node = &sim->nodes[fifo[head++]];
+        for (uint32_t i = 0; i < node->nbrs_numof; i++) {
+            sim_node_t *nbr = &sim->nodes[node->nbrs[i]];
+            if (nbr->hops == UINT32_MAX) {
+                nbr->hops = node->hops + 1;
+                if (nbr->hops > sim->diameter) {
+                    sim->diameter = nbr->hops;
+                }
+                fifo[tail++] = nbr->id;
+            }
+        }
+    }
+    free(fifo);
+    return tail;
+}
+
+int sim_topology_build(sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    uint64_t rng = sim_rand_seed(p->seed, UINT32_MAX);
+
+    sim->nodes = calloc(p->nodes, sizeof(*sim->nodes));
+    if (sim->nodes == NULL) {
+        return -ENOMEM;
+    }
+
+    /* Expected neighbors: (n - 1) * pi / side^2 */
+    sim->side = sqrt((p->nodes - 1) * M_PI / p->degree);
+
+    /* Redraw until everyone can be reached from the seed */
+    for (unsigned attempt = 0; attempt < 1000; attempt++) {
+        for (unsigned i = 0; i < p->nodes; i++) {
+            sim_node_t *node = &sim->nodes[i];
+            node->nbrs_numof = 0;
+            node->x = sim_rand_unit(&rng) * sim->side;
+            node->y = sim_rand_unit(&rng) * sim->side;
+        }
+        for (unsigned i = 0; i < p->nodes; i++) {
+            for (unsigned j = i + 1; j < p->nodes; j++) {
+                double dx = sim->nodes[i].x - sim->nodes[j].x;
+                double dy = sim->nodes[i].y - sim->nodes[j].y;
+                double d2 = dx * dx + dy * dy;
+                if (d2 < 1.0) {
+                    if (_add_nbr(&sim->nodes[i], j, sqrt(d2)) < 0 ||
+                        _add_nbr(&sim->nodes[j], i, sqrt(d2)) < 0) {
+                        return -ENOMEM;
+                    }
+                }
+            }
+        }
+        for (unsigned i = 0; i < p->nodes; i++) {
+            sim->nodes[i].id = i;
+        }
+        if (_bfs(sim) == p->nodes) {
+            return 0;
+        }
+    }
+
+    return -ENETUNREACH;
+}
+
+int sim_run(sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* The seed's image */
+    uint64_t rng = sim_rand_seed(p->seed, UINT32_MAX - 1);
+    sim->image = malloc(p->image_size);
+    if (sim->image == NULL) {
+        return -ENOMEM;
+    }
+    for (uint32_t i = 0; i < p->image_size; i++) {
+        sim->image[i] = sim_rand(&rng);
+    }
+    sim->meta.version = 1;
+    sim->meta.size = p->image_size;
+    _digest(sim->image, p->image_size, sim->meta.digest);
+
+    for (unsigned i = 0; i < p->nodes; i++) {
+        sim_node_t *node = &sim->nodes[i];
+        node->sim = sim;
+        node->rng = sim_rand_seed(p->seed, i);
+        node->done = SIM_TIME_NEVER;
+        _boot(node);
+    }
+
+    /* Publish once the nodes settled on their longest advertisement
+     * interval, the dissemination starts from the steady state */
+    sim->publish = 2 * CONFIG_DELUGE_ADV_IMAX * SIM_US_PER_MS;
+    _push(sim, sim->publish, EV_PUBLISH, 0, 0);
+
+    for (unsigned i = 0; i < p->reboots; i++) {
+        uint32_t id = 1 + sim_rand(&rng) % (p->nodes - 1);
+        sim_time_t at = sim->publish + SIM_US_PER_SEC +
+                        sim_rand(&rng) % (p->reboot_window - SIM_US_PER_SEC + 1);
+        _push(sim, at, EV_REBOOT, id, 0);
+    }
+
+    while (sim->heap_len > 0 && sim->done < p->nodes) {
+        _event_t ev = _pop(sim);
+        if (ev.time > sim->publish + p->duration) {
+            break;
+        }
+        sim->now = ev.time;
+        sim->stats.events++;
+
+        sim_node_t *node = &sim->nodes[ev.node];
+        switch (ev.kind) {
+            case EV_TIMER:
+                if (!node->off && ev.gen == node->timer_gen) {
+                    deluge_core_timeout(&node->core);
+                }
+                break;
+
+            case EV_CSMA:
+                _csma(node);
+                break;
+
+            case EV_TX_END:
+                _tx_end(node);
+                break;
+
+            case EV_PUBLISH:
+                if (_op_prepare(node, &sim->meta) < 0) {
+                    return -ENOMEM;
+                }
+                memcpy(node->image, sim->image, p->image_size);
+                node->pages = deluge_meta_pages(&sim->meta);
+                node->done = sim->now;
+                sim->done++;
+                deluge_core_publish(&node->core, &sim->meta);
+                break;
+
+            case EV_REBOOT:
+                if (node->off || node->done != SIM_TIME_NEVER) {
+                    break;
+                }
+                sim->stats.reboots++;
+                sim->stats.resumed_pages += node->pages;
+                node->off = true;
+                node->queue_len = 0;
+                node->backoffs = 0;
+                _push(sim, sim->now + p->reboot_off, EV_BOOT, ev.node, 0);
+                break;
+
+            case EV_BOOT:
+                _boot(node);
+                break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sim->wall_s = (end.tv_sec - start.tv_sec) +
+                  (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    return 0;
+}
+
+void sim_free(sim_t *sim)
+{
+    if (sim->nodes) {
+        for (unsigned i = 0; i < sim->params.nodes; i++) {
+            free(sim->nodes[i].nbrs);
+            free(sim->nodes[i].nbr_dist);
+            free(sim->nodes[i].image);
+        }
+    }
+    free(sim->nodes);
+    free(sim->heap);
+    free(sim->image);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Image dissemination simulator command line and reporting
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+static void _usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n NODES     number of nodes (default 50)\n"
+            "  -d DEGREE    mean number of neighbors (default 6)\n"
+            "  -i KIB       image size in KiB (default 32)\n"
+            "  -s SEED      RNG seed (default 1)\n"
+            "  -t SECONDS   give up after this long (default 3600)\n"
+            "  -b BPS       PHY bit rate (default 50000)\n"
+            "  -o BYTES     PHY + lower layer overhead per message "
+            "(default 30)\n"
+            "  -p PER       packet error rate at the range edge (default 0.1)\n"
+            "  -R N,S       reboot N nodes for 2 s, in the first S seconds\n"
+            "  -c           print a single CSV line (see -H)\n"
+            "  -H           print the CSV header and exit\n",
+            prog);
+}
+
+static const char _csv_header[] =
+    "nodes,degree,diameter,image_bytes,pages,done,p50_s,p90_s,max_s,"
+    "adv_tx,req_tx,data_tx,data_tx_per_chunk,data_rx_dup,airtime_share,"
+    "collisions,lost,csma_drops,queue_drops,reboots,resumed_pages,"
+    "verify_fail,events,wall_s";
+
+static int _cmp_time(const void *a, const void *b)
+{
+    sim_time_t ta = *(const sim_time_t *)a;
+    sim_time_t tb = *(const sim_time_t *)b;
+
+    return (ta > tb) - (ta < tb);
+}
+
+static void _report(const sim_t *sim)
+{
+    const sim_params_t *p = &sim->params;
+    deluge_stats_t total = { 0 };
+    double degree = 0;
+    unsigned done = 0;
+    sim_time_t last = sim->publish;
+
+    sim_time_t *lat = malloc(p->nodes * sizeof(*lat));
+    for (unsigned i = 0; i < p->nodes; i++) {
+        const sim_node_t *node = &sim->nodes[i];
+        const deluge_stats_t *s = &node->core.stats;
+        total.adv_tx += s->adv_tx;
+        total.req_tx += s->req_tx;
+        total.data_tx += s->data_tx;
+        total.data_rx += s->data_rx;
+        total.data_dup += s->data_dup;
+        total.verify_fail += s->verify_fail;
+        degree += node->nbrs_numof;
+        /* The seed doesn't count */
+        if (i > 0 && node->done != SIM_TIME_NEVER && lat) {
+            lat[done++] = node->done - sim->publish;
+        }
+        if (node->done != SIM_TIME_NEVER && node->done > last) {
+            last = node->done;
+        }
+    }
+    degree /= p->nodes;
+
+    double p50 = 0, p90 = 0, max = 0;
+    if (done && lat) {
+        qsort(lat, done, sizeof(*lat), _cmp_time);
+        p50 = (double)lat[(done - 1) / 2] / SIM_US_PER_SEC;
+        p90 = (double)lat[((done - 1) * 90) / 100] / SIM_US_PER_SEC;
+        max = (double)lat[done - 1] / SIM_US_PER_SEC;
+    }
+    free(lat);
+
+    unsigned chunks = (p->image_size + CONFIG_DELUGE_CHUNK_SIZE - 1) /
+                      CONFIG_DELUGE_CHUNK_SIZE;
+    /* 1.0 would be every chunk sent once by every node but the last hop */
+    double per_chunk = (double)total.data_tx / chunks;
+    /* Share of the dissemination time the average node spent sending */
+    sim_time_t span = last > sim->publish ? last - sim->publish : 1;
+    double airtime_share = (double)sim->stats.airtime_us /
+                           ((double)span * p->nodes);
+
+    if (p->csv) {
+        printf("%u,%.2f,%" PRIu32 ",%" PRIu32 ",%u,%u,%.2f,%.2f,%.2f,%" PRIu32
+               ",%" PRIu32 ",%" PRIu32 ",%.2f,%" PRIu32 ",%.4f,%" PRIu64
+               ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+               ",%" PRIu32 ",%" PRIu64 ",%.2f\n",
+               p->nodes, degree, sim->diameter, p->image_size,
+               deluge_meta_pages(&sim->meta), done, p50, p90, max,
+               total.adv_tx, total.req_tx, total.data_tx, per_chunk,
+               total.data_dup, airtime_share, sim->stats.collisions,
+               sim->stats.lost, sim->stats.csma_drops, sim->stats.queue_drops,
+               sim->stats.reboots, sim->stats.resumed_pages, total.verify_fail,
+               sim->stats.events, sim->wall_s);
+        return;
+    }
+
+    printf("topology\n");
+    printf("  nodes               %u\n", p->nodes);
+    printf("  mean degree         %.2f\n", degree);
+    printf("  hops from the seed  %" PRIu32 " (max)\n", sim->diameter);
+    printf("image\n");
+    printf("  size                %" PRIu32 " bytes\n", p->image_size);
+    printf("  pages / chunks      %u / %u (%u bytes per chunk)\n",
+           deluge_meta_pages(&sim->meta), chunks, CONFIG_DELUGE_CHUNK_SIZE);
+    printf("completion\n");
+    printf("  nodes done          %u of %u\n", done, p->nodes - 1);
+    printf("  time p50/p90/max    %.1f / %.1f / %.1f s\n", p50, p90, max);
+    printf("  verify failures     %" PRIu32 "\n", total.verify_fail);
+    printf("traffic\n");
+    printf("  ADV / REQ / DATA    %" PRIu32 " / %" PRIu32 " / %" PRIu32 "\n",
+           total.adv_tx, total.req_tx, total.data_tx);
+    printf("  DATA per chunk      %.2f transmissions (%.2f per node)\n",
+           per_chunk, per_chunk / p->nodes);
+    printf("  chunks not needed   %" PRIu32 " receptions\n", total.data_dup);
+    printf("  airtime share       %.2f%%\n", 100.0 * airtime_share);
+    printf("  collisions / lost   %" PRIu64 " / %" PRIu64 "\n",
+           sim->stats.collisions, sim->stats.lost);
+    printf("  dropped, busy/full  %" PRIu64 " / %" PRIu64 "\n",
+           sim->stats.csma_drops, sim->stats.queue_drops);
+    if (p->reboots) {
+        printf("resume\n");
+        printf("  reboots             %" PRIu64 "\n", sim->stats.reboots);
+        printf("  pages kept          %" PRIu64 "\n", sim->stats.resumed_pages);
+    }
+    printf("run\n");
+    printf("  wall                %.2f s\n", sim->wall_s);
+    printf("  events              %" PRIu64 "\n", sim->stats.events);
+}
+
+int main(int argc, char **argv)
+{
+    sim_t sim;
+    memset(&sim, 0, sizeof(sim));
+
+    sim_params_t *p = &sim.params;
+    p->nodes = 50;
+    p->degree = 6;
+    p->seed = 1;
+    p->image_size = 32 * 1024;
+    p->duration = 3600 * SIM_US_PER_SEC;
+    p->bitrate = 50000;
+    p->phy_overhead = 30;
+    p->per_max = 0.1;
+    p->reboot_off = 2 * SIM_US_PER_SEC;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:i:s:t:b:o:p:R:cHh")) != -1) {
+        switch (opt) {
+            case 'n': p->nodes = strtoul(optarg, NULL, 0); break;
+            case 'd': p->degree = strtod(optarg, NULL); break;
+            case 'i': p->image_size = strtod(optarg, NULL) * 1024; break;
+            case 's': p->seed = strtoull(optarg, NULL, 0); break;
+            case 't': p->duration = strtod(optarg, NULL) * SIM_US_PER_SEC; break;
+            case 'b': p->bitrate = strtoul(optarg, NULL, 0); break;
+            case 'o': p->phy_overhead = strtoul(optarg, NULL, 0); break;
+            case 'p': p->per_max = strtod(optarg, NULL); break;
+            case 'R': {
+                char *end;
+                p->reboots = strtoul(optarg, &end, 0);
+                p->reboot_window = (*end == ',')
+                                 ? strtod(end + 1, NULL) * SIM_US_PER_SEC : 0;
+                break;
+            }
+            case 'c': p->csv = true; break;
+            case 'H': puts(_csv_header); return 0;
+            default:
+                _usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (p->nodes < 2 || p->nodes > UINT16_MAX || p->degree <= 0 ||
+        p->bitrate == 0 || p->image_size == 0 ||
+        (p->reboots && p->reboot_window < SIM_US_PER_SEC)) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    int res = sim_topology_build(&sim);
+    if (res == 0) {
+        res = sim_run(&sim);
+    }
+    if (res < 0) {
+        fprintf(stderr, "deluge_sim: %s\n", strerror(-res));
+        sim_free(&sim);
+        return 1;
+    }
+
+    _report(&sim);
+    sim_free(&sim);
+    return 0;
+}
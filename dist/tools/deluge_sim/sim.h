@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @file
+ * @brief       Image dissemination discrete-event simulator
+ *
+ * Every simulated node runs a full @ref deluge_core_t on a virtual clock. The
+ * radio is a shared medium with carrier sense, half duplex transceivers and
+ * collisions, which is what decides how fast a page crosses a dense
+ * neighborhood.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net/deluge/core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Simulation time, in microseconds
+ */
+typedef uint64_t sim_time_t;
+
+#define SIM_TIME_NEVER  (UINT64_MAX)  /**< Never */
+#define SIM_US_PER_SEC  (1000000ULL)  /**< Microseconds per second */
+#define SIM_US_PER_MS   (1000ULL)     /**< Microseconds per millisecond */
+
+/**
+ * @brief   Frames waiting for the medium at each node
+ */
+#define SIM_TX_QUEUE_LEN (8)
+
+/**
+ * @brief   Simulation parameters
+ */
+typedef struct {
+    unsigned nodes;          /**< Number of nodes */
+    double degree;           /**< Target mean number of neighbors */
+    uint64_t seed;           /**< RNG seed */
+    uint32_t image_size;     /**< Image size in bytes */
+    sim_time_t duration;     /**< Give up after this much simulated time */
+    unsigned bitrate;        /**< PHY bit rate in bit/s */
+    unsigned phy_overhead;   /**< Bytes added on air to every message */
+    double per_max;          /**< Packet error rate at the edge of the range */
+    unsigned reboots;        /**< Nodes rebooted during the transfer */
+    sim_time_t reboot_window; /**< Reboots happen in [1 s, this] */
+    sim_time_t reboot_off;   /**< Time a rebooting node stays off */
+    bool csv;                /**< Print results as a single CSV line */
+} sim_params_t;
+
+/**
+ * @brief   A frame on the air or waiting for it
+ */
+typedef struct {
+    uint32_t src;                       /**< Sender */
+    uint16_t len;                       /**< Message length */
+    uint8_t data[DELUGE_MSG_MAX_LEN];   /**< Message */
+} sim_frame_t;
+
+/**
+ * @brief   Counters
+ */
+typedef struct {
+    uint64_t events;         /**< Events processed */
+    uint64_t frames;         /**< Frames sent */
+    uint64_t airtime_us;     /**< Airtime used */
+    uint64_t rx;             /**< Frames received */
+    uint64_t collisions;     /**< Receptions lost to overlapping frames */
+    uint64_t lost;           /**< Receptions lost to the radio model */
+    uint64_t csma_drops;     /**< Frames dropped, medium busy too long */
+    uint64_t queue_drops;    /**< Frames dropped, transmit queue full */
+    uint64_t reboots;        /**< Nodes rebooted */
+    uint64_t resumed_pages;  /**< Pages kept across reboots */
+} sim_stats_t;
+
+/**
+ * @brief   A simulated node
+ */
+typedef struct {
+    deluge_core_t core;      /**< Protocol instance */
+    struct sim *sim;         /**< Simulation */
+    uint32_t id;             /**< Node index */
+    double x;                /**< Position */
+    double y;                /**< Position */
+    uint32_t *nbrs;          /**< Neighbor indices */
+    float *nbr_dist;         /**< Normalized distance to each neighbor */
+    uint32_t nbrs_numof;     /**< Number of neighbors */
+    uint32_t hops;           /**< Hops from the seed */
+    uint64_t rng;            /**< xorshift64* state */
+    uint32_t timer_gen;      /**< Generation of the armed timer */
+    bool off;                /**< Rebooting */
+    /* Storage, survives reboots */
+    uint8_t *image;          /**< Image data */
+    deluge_meta_t meta;      /**< Stored image description */
+    uint16_t pages;          /**< Pages persisted */
+    sim_time_t done;         /**< Time the image was verified */
+    /* Radio */
+    sim_frame_t queue[SIM_TX_QUEUE_LEN]; /**< Transmit queue */
+    unsigned queue_head;     /**< First queued frame */
+    unsigned queue_len;      /**< Queued frames */
+    bool csma;               /**< Waiting for the medium */
+    unsigned backoffs;       /**< Busy medium retries of the head frame */
+    sim_frame_t *txing;      /**< Frame on the air */
+    unsigned rx_busy;        /**< Frames heard on the air */
+    const sim_frame_t *rx_frame; /**< Frame being received */
+    bool rx_ok;              /**< It hasn't collided */
+} sim_node_t;
+
+/**
+ * @brief   Simulation
+ */
+typedef struct sim {
+    sim_params_t params;     /**< Parameters */
+    sim_node_t *nodes;       /**< Nodes, node 0 is the seed */
+    void *heap;              /**< Pending events */
+    size_t heap_len;         /**< Pending events */
+    size_t heap_cap;         /**< Allocated events */
+    uint64_t seq;            /**< Next event sequence number */
+    sim_time_t now;          /**< Current time */
+    sim_time_t publish;      /**< Time the seed published the image */
+    deluge_meta_t meta;      /**< Image published */
+    uint8_t *image;          /**< Image published */
+    double side;             /**< Side of the deployment area (range = 1) */
+    uint32_t diameter;       /**< Hops from the seed to the farthest node */
+    unsigned done;           /**< Nodes with the verified image */
+    sim_stats_t stats;       /**< Counters */
+    double wall_s;           /**< Wall time spent simulating */
+} sim_t;
+
+/**
+ * @brief   Place nodes, connected unit-disk graph
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sim_topology_build(sim_t *sim);
+
+/**
+ * @brief   Run the simulation until every node has the image
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int sim_run(sim_t *sim);
+
+/**
+ * @brief   Free all the simulation memory
+ */
+void sim_free(sim_t *sim);
+
+/**
+ * @brief   xorshift64* step
+ */
+static inline uint64_t sim_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief   Uniform double in [0, 1)
+ */
+static inline double sim_rand_unit(uint64_t *state)
+{
+    return (sim_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief   Seed an RNG stream
+ */
+static inline uint64_t sim_rand_seed(uint64_t seed, uint64_t stream)
+{
+    /* splitmix64 */
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Benchmark the TUN <-> serial bridge over a pty pair, batched and unbatched
+# (one write per frame, byte by byte reads). Needs root to create the TUN
+# interface.
+#
+# To compare with sliptty, run with SLIPTTY=1 and start sliptty on the pty
+# when asked:
+#     sliptty -I bench0 /dev/pts/N
+
+TUN=${TUN:-bench0}
+FRAMES=${FRAMES:-20000}
+SIZE=${SIZE:-64}
+SUDO=${SUDO:-sudo}
+VAINA="cargo run --quiet --release --manifest-path $(dirname "$0")/Cargo.toml --"
+
+cleanup() {
+    ${SUDO} ip tuntap del ${TUN} mode tun
+}
+
+${SUDO} ip tuntap add ${TUN} mode tun user ${USER} || exit 1
+trap "cleanup" INT QUIT TERM EXIT
+${SUDO} ip link set ${TUN} up || exit 1
+${SUDO} ip address add fe80::1/64 dev ${TUN} nodad || exit 1
+
+for mode in "" --unbatched; do
+    echo "== vaina bridge ${mode:-(batched)}"
+    ${VAINA} bridge-bench -I ${TUN} -n ${FRAMES} -s ${SIZE} ${mode}
+done
+
+if [ -n "${SLIPTTY}" ]; then
+    echo "== external bridge"
+    ${VAINA} bridge-bench -I ${TUN} -n ${FRAMES} -s ${SIZE} --external
+fi
@@ -0,0 +1,361 @@
+//! Control-plane benchmark: fire a mix of RCS/NIB operations at a node at a
+//! fixed rate and measure how fast, and whether, they're acknowledged.
+//!
+//! The load is open loop, operations are sent on schedule whether or not the
+//! previous ones were answered, so a saturated node shows up as growing
+//! latency and lost operations instead of a lower send rate. Sequence numbers
+//! are 8 bits, so at most 256 operations can be in flight: when the next one
+//! is still waiting for its ACK the send is skipped and reported.
+
+use std::net::{Ipv6Addr, SocketAddr};
+use std::str::FromStr;
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+use clap::ArgMatches;
+use tokio::net::UdpSocket;
+use tokio::time::{interval, sleep, MissedTickBehavior};
+
+use crate::client::VAINA_PORT;
+use crate::msg::Message;
+use crate::*;
+
+/// VAINA operations
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum Op {
+    RcsAdd,
+    RcsDel,
+    NibAdd,
+    NibDel,
+}
+
+impl FromStr for Op {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Op, String> {
+        match s {
+            "rcs-add" => Ok(Op::RcsAdd),
+            "rcs-del" => Ok(Op::RcsDel),
+            "nib-add" => Ok(Op::NibAdd),
+            "nib-del" => Ok(Op::NibDel),
+            _ => Err(format!("unknown operation {}", s)),
+        }
+    }
+}
+
+/// Operation mix, e.g. `rcs-add:4,rcs-del:4,nib-add:1`
+#[derive(Debug, Clone)]
+pub struct Mix(Vec<(Op, u32)>);
+
+impl FromStr for Mix {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Mix, String> {
+        let mut mix = Vec::new();
+        for part in s.split(',') {
+            let (op, weight) = match part.find(':') {
+                Some(i) => (&part[..i], &part[i + 1..]),
+                None => (part, "1"),
+            };
+            let weight = u32::from_str(weight).map_err(|e| format!("{}: {}", part, e))?;
+            if weight > 0 {
+                mix.push((Op::from_str(op)?, weight));
+            }
+        }
+
+        if mix.is_empty() {
+            return Err("empty operation mix".to_string());
+        }
+
+        Ok(Mix(mix))
+    }
+}
+
+impl Mix {
+    /// Pick an operation, `r` uniformly distributed
+    fn pick(&self, r: u32) -> Op {
+        let total: u32 = self.0.iter().map(|(_, w)| w).sum();
+        let mut r = r % total;
+        for (op, weight) in &self.0 {
+            if r < *weight {
+                return *op;
+            }
+            r -= weight;
+        }
+        unreachable!()
+    }
+}
+
+/// Benchmark parameters
+#[derive(Debug, Clone)]
+pub struct Params {
+    pub target: SocketAddr,
+    /// Operations per second
+    pub rate: u32,
+    pub duration: Duration,
+    pub mix: Mix,
+    /// Distinct addresses the operations are about
+    pub clients: u16,
+    /// Time after which an unanswered operation is counted as lost
+    pub timeout: Duration,
+}
+
+/// Benchmark results
+#[derive(Debug, Default)]
+pub struct Results {
+    pub elapsed: Duration,
+    pub sent: usize,
+    pub acked: usize,
+    pub nacked: usize,
+    pub lost: usize,
+    /// Not sent, 256 operations were in flight
+    pub skipped: usize,
+    /// ACK and NACK latencies, sorted
+    pub latencies: Vec<Duration>,
+}
+
+impl Results {
+    /// Latency percentile, in milliseconds
+    pub fn percentile(&self, p: usize) -> f64 {
+        if self.latencies.is_empty() {
+            return 0.0;
+        }
+        let i = (self.latencies.len() - 1) * p / 100;
+        self.latencies[i].as_secs_f64() * 1000.0
+    }
+
+    pub fn print(&self) {
+        let secs = self.elapsed.as_secs_f64();
+        let answered = self.acked + self.nacked;
+        let pct = |n: usize| {
+            if self.sent == 0 {
+                0.0
+            } else {
+                n as f64 * 100.0 / self.sent as f64
+            }
+        };
+
+        println!(
+            "sent {} ({:.1}/s), skipped {}, answered {} ({:.1}/s) in {:.2} s",
+            self.sent,
+            self.sent as f64 / secs,
+            self.skipped,
+            answered,
+            answered as f64 / secs,
+            secs
+        );
+        println!(
+            "acked {} ({:.1}%), nacked {} ({:.1}%), lost {} ({:.1}%)",
+            self.acked,
+            pct(self.acked),
+            self.nacked,
+            pct(self.nacked),
+            self.lost,
+            pct(self.lost)
+        );
+        println!(
+            "latency: p50 {:.2} ms, p90 {:.2} ms, p99 {:.2} ms, max {:.2} ms",
+            self.percentile(50),
+            self.percentile(90),
+            self.percentile(99),
+            self.percentile(100)
+        );
+    }
+}
+
+#[derive(Default)]
+struct State {
+    /// Send time of the operation using each sequence number
+    pending: Vec<Option<Instant>>,
+    results: Results,
+}
+
+fn message(op: Op, seqno: u8, client: u16) -> Message {
+    let ip = Ipv6Addr::new(0x2001, 0xdb8, 0, 0, 0, 0, 0xbe, client);
+    match op {
+        Op::RcsAdd => Message::RcsAdd { seqno, prefix: 128, ip },
+        Op::RcsDel => Message::RcsDel { seqno, prefix: 128, ip },
+        Op::NibAdd => Message::NibAdd { seqno, prefix: 128, ip },
+        Op::NibDel => Message::NibDel { seqno, prefix: 128, ip },
+    }
+}
+
+async fn receive(sock: Arc<UdpSocket>, state: Arc<Mutex<State>>) {
+    let mut buf = [0u8; 64];
+
+    loop {
+        let len = match sock.recv(&mut buf).await {
+            Ok(len) => len,
+            // e.g. ICMP port unreachable, the operations will time out
+            Err(_) => continue,
+        };
+        let (seqno, acked) = match Message::parse(&buf[..len]) {
+            Some(Message::Ack { seqno }) => (seqno, true),
+            Some(Message::Nack { seqno }) => (seqno, false),
+            _ => continue,
+        };
+
+        let mut state = state.lock().unwrap();
+        // Duplicated or answered after being counted as lost
+        let sent = match state.pending[seqno as usize].take() {
+            Some(sent) => sent,
+            None => continue,
+        };
+        let results = &mut state.results;
+        results.latencies.push(sent.elapsed());
+        if acked {
+            results.acked += 1;
+        } else {
+            results.nacked += 1;
+        }
+    }
+}
+
+/// Run the benchmark
+pub async fn run(params: Params) -> Result<Results, std::io::Error> {
+    let local: SocketAddr = match params.target {
+        SocketAddr::V4(_) => "0.0.0.0:0".parse().unwrap(),
+        SocketAddr::V6(_) => "[::]:0".parse().unwrap(),
+    };
+    let sock = Arc::new(UdpSocket::bind(local).await?);
+    sock.connect(params.target).await?;
+
+    let state = Arc::new(Mutex::new(State {
+        pending: vec![None; 256],
+        ..Default::default()
+    }));
+    let receiver = tokio::spawn(receive(sock.clone(), state.clone()));
+
+    let period = Duration::from_secs(1) / params.rate.max(1).min(1_000_000);
+    let mut ticks = interval(period);
+    // Catch up after a stall instead of lowering the rate
+    ticks.set_missed_tick_behavior(MissedTickBehavior::Burst);
+
+    let start = Instant::now();
+    let mut seqno = 0u8;
+    let mut rng = 0x2545_f491u32;
+    let mut n = 0u32;
+
+    while start.elapsed() < params.duration {
+        ticks.tick().await;
+
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        let op = params.mix.pick(rng);
+        let client = (n % params.clients.max(1) as u32) as u16;
+        n = n.wrapping_add(1);
+
+        {
+            let mut state = state.lock().unwrap();
+            let now = Instant::now();
+            match state.pending[seqno as usize] {
+                Some(sent) if now - sent < params.timeout => {
+                    state.results.skipped += 1;
+                    continue;
+                }
+                Some(_) => state.results.lost += 1,
+                None => (),
+            }
+            state.pending[seqno as usize] = Some(now);
+            state.results.sent += 1;
+        }
+
+        let bytes = message(op, seqno, client).serialize();
+        // A failed send is counted as lost once it times out
+        let _ = sock.send(bytes.as_ref()).await;
+        seqno = seqno.wrapping_add(1);
+    }
+
+    // Give the last operations time to be answered
+    sleep(params.timeout).await;
+    receiver.abort();
+
+    let mut state = state.lock().unwrap();
+    let lost = state.pending.iter().filter(|p| p.is_some()).count();
+    let mut results = std::mem::take(&mut state.results);
+    results.lost += lost;
+    results.elapsed = start.elapsed() - params.timeout;
+    results.latencies.sort();
+
+    Ok(results)
+}
+
+/// Bench sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let ip = value_t!(matches, "IP", std::net::IpAddr).unwrap_or_else(|e| e.exit());
+    let port = value_t!(matches, "port", u16).unwrap_or(VAINA_PORT);
+    let mut target = SocketAddr::new(ip, port);
+    let netif = matches.get_one::<String>("interface");
+    if let (SocketAddr::V6(v6), Some(netif)) = (&mut target, netif) {
+        let scope = crate::client::if_nametoindex(netif)
+            .map_err(|source| Error::VainaSocket { source })?;
+        v6.set_scope_id(scope);
+    }
+
+    let params = Params {
+        target,
+        rate: value_t!(matches, "rate", u32).unwrap_or_else(|e| e.exit()),
+        duration: Duration::from_secs(value_t!(matches, "duration", u64).unwrap_or_else(|e| e.exit())),
+        mix: value_t!(matches, "mix", Mix).unwrap_or_else(|e| e.exit()),
+        clients: value_t!(matches, "clients", u16).unwrap_or_else(|e| e.exit()),
+        timeout: Duration::from_millis(value_t!(matches, "timeout", u64).unwrap_or_else(|e| e.exit())),
+    };
+
+    let runtime = tokio::runtime::Runtime::new().map_err(|source| Error::Runtime { source })?;
+    let results = runtime.block_on(run(params)).map_err(|source| Error::FailedSend { source })?;
+    results.print();
+
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::standin;
+
+    fn params(port: u16, rate: u32) -> Params {
+        Params {
+            target: SocketAddr::new("127.0.0.1".parse().unwrap(), port),
+            rate,
+            duration: Duration::from_millis(500),
+            mix: Mix::from_str("rcs-add:2,rcs-del:2,nib-add,nib-del:0").unwrap(),
+            clients: 8,
+            timeout: Duration::from_millis(100),
+        }
+    }
+
+    #[test]
+    fn mix() {
+        let mix = Mix::from_str("rcs-add:3,nib-del").unwrap();
+        assert_eq!(mix.pick(0), Op::RcsAdd);
+        assert_eq!(mix.pick(2), Op::RcsAdd);
+        assert_eq!(mix.pick(3), Op::NibDel);
+        assert!(Mix::from_str("rcs-add:0").is_err());
+        assert!(Mix::from_str("rcs-mod").is_err());
+    }
+
+    #[tokio::test]
+    async fn clean() {
+        let (ports, _standins) = standin::spawn("127.0.0.1".parse().unwrap(), 1, 0)
+            .await
+            .unwrap();
+
+        let results = run(params(ports[0], 200)).await.unwrap();
+        assert!(results.sent >= 90);
+        assert_eq!(results.acked, results.sent);
+        assert_eq!(results.lost + results.nacked + results.skipped, 0);
+        assert_eq!(results.latencies.len(), results.acked);
+    }
+
+    #[tokio::test]
+    async fn lossy() {
+        let (ports, _standins) = standin::spawn("127.0.0.1".parse().unwrap(), 1, 30)
+            .await
+            .unwrap();
+
+        let results = run(params(ports[0], 400)).await.unwrap();
+        assert_eq!(results.acked + results.lost, results.sent);
+        assert!(results.lost > results.sent / 10 && results.lost < results.sent / 2);
+    }
+}
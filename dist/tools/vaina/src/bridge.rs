@@ -0,0 +1,1079 @@
+//! TUN <-> serial bridge with SLIP framing, a replacement for RIOT's sliptty.
+//!
+//! Frames going to the serial line are coalesced: the writer takes every
+//! packet that's already queued (up to `BATCH_MAX` bytes) and hands them to
+//! the kernel with a single write. The serial line is read in large chunks
+//! that may contain many frames. TUN reads and writes stay one per packet,
+//! that's what the TUN interface offers.
+//!
+//! VAINA messages can go straight to the radio without the kernel: datagrams
+//! received on the local VAINA socket are wrapped in IPv6/UDP and written to
+//! the serial line, and the radio's answers to them are taken out of the
+//! serial stream and sent back to the local client.
+//!
+//! When the node runs the `slipcredit` module, it says how many frames it
+//! can take, and the frames to the serial line wait in the bridge (and then
+//! in the TUN queue of the kernel) instead of being dropped in the node.
+
+use std::fs::{File, OpenOptions};
+use std::io::{self, Read, Write};
+use std::net::{Ipv6Addr, SocketAddr, UdpSocket};
+use std::os::unix::fs::OpenOptionsExt;
+use std::os::unix::io::{AsRawFd, FromRawFd, RawFd};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::mpsc::{sync_channel, Receiver, SyncSender};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use clap::ArgMatches;
+
+use crate::client::{VAINA_MCAST_ADDR, VAINA_PORT};
+use crate::*;
+
+/// SLIP special characters (RFC 1055)
+pub const SLIP_END: u8 = 0xc0;
+pub const SLIP_ESC: u8 = 0xdb;
+pub const SLIP_END_ESC: u8 = 0xdc;
+pub const SLIP_ESC_ESC: u8 = 0xdd;
+
+/// Largest frame accepted from the serial line
+pub const FRAME_MAX: usize = 2048;
+/// Bytes coalesced into a single serial write
+pub const BATCH_MAX: usize = 64 * 1024;
+/// Packets queued for the serial line
+const TX_QUEUE_LEN: usize = 256;
+/// Source port of the VAINA messages sent by the bridge, answers to it are
+/// delivered to the local VAINA socket instead of the kernel
+pub const BRIDGE_VAINA_PORT: u16 = 61337;
+
+/// First byte and length of the node's credit frames (`net/slipcredit.h`)
+pub const CREDIT_START: u8 = 0x0c;
+pub const CREDIT_LEN: usize = 5;
+/// Time without credits after which the frames the node didn't count are
+/// taken as lost, and one frame is sent anyway
+pub const CREDIT_STALL: Duration = Duration::from_secs(1);
+
+/// SLIP-encode `frame` at the end of `out`
+pub fn slip_encode(frame: &[u8], out: &mut Vec<u8>) {
+    out.reserve(frame.len() + 2);
+    for &b in frame {
+        match b {
+            SLIP_END => out.extend_from_slice(&[SLIP_ESC, SLIP_END_ESC]),
+            SLIP_ESC => out.extend_from_slice(&[SLIP_ESC, SLIP_ESC_ESC]),
+            b => out.push(b),
+        }
+    }
+    out.push(SLIP_END);
+}
+
+/// SLIP stream decoder
+pub struct SlipDecoder {
+    frame: Vec<u8>,
+    escaped: bool,
+    overflow: bool,
+}
+
+impl Default for SlipDecoder {
+    fn default() -> Self {
+        SlipDecoder {
+            frame: Vec::with_capacity(FRAME_MAX),
+            escaped: false,
+            overflow: false,
+        }
+    }
+}
+
+impl SlipDecoder {
+    /// Decode `data`, calling `on_frame` for every complete frame
+    ///
+    /// Returns the number of frames dropped, malformed or too long.
+    pub fn feed<F: FnMut(&[u8])>(&mut self, data: &[u8], mut on_frame: F) -> u64 {
+        let mut dropped = 0;
+
+        for &b in data {
+            let b = match (self.escaped, b) {
+                (false, SLIP_END) => {
+                    if self.overflow {
+                        dropped += 1;
+                    } else if !self.frame.is_empty() {
+                        on_frame(&self.frame);
+                    }
+                    self.frame.clear();
+                    self.overflow = false;
+                    continue;
+                }
+                (false, SLIP_ESC) => {
+                    self.escaped = true;
+                    continue;
+                }
+                (false, b) => b,
+                (true, SLIP_END_ESC) => SLIP_END,
+                (true, SLIP_ESC_ESC) => SLIP_ESC,
+                // Invalid escape, the frame is garbage
+                (true, b) => {
+                    self.overflow = true;
+                    b
+                }
+            };
+            self.escaped = false;
+
+            if self.frame.len() < FRAME_MAX {
+                self.frame.push(b);
+            } else {
+                self.overflow = true;
+            }
+        }
+
+        dropped
+    }
+}
+
+/// Flow control state, from the node's credit frames
+#[derive(Debug, Default, Clone, Copy)]
+struct CreditState {
+    /// A credit frame was received, the bridge isn't limited before
+    enabled: bool,
+    /// Frames written to the serial line
+    sent: u16,
+    /// Frames the node had received, and how many more it could take then
+    received: u16,
+    free: u8,
+    window: u8,
+}
+
+impl CreditState {
+    fn available(&self) -> usize {
+        if !self.enabled {
+            return usize::MAX;
+        }
+        let outstanding = usize::from(self.sent.wrapping_sub(self.received));
+        usize::from(self.free).saturating_sub(outstanding)
+    }
+}
+
+/// Host side of the node's flow control
+#[derive(Debug, Default)]
+pub struct Credits {
+    state: Mutex<CreditState>,
+    cond: Condvar,
+}
+
+impl Credits {
+    /// Take a frame from the node, returns false if it isn't a credit frame
+    pub fn update(&self, frame: &[u8]) -> bool {
+        if frame.len() != CREDIT_LEN || frame[0] != CREDIT_START {
+            return false;
+        }
+
+        let mut st = self.state.lock().unwrap();
+        st.enabled = true;
+        st.received = u16::from_be_bytes([frame[1], frame[2]]);
+        st.free = frame[3];
+        st.window = frame[4];
+        // The node restarted, or lost frames on the line: it never has more
+        // than a window of ours
+        if st.sent.wrapping_sub(st.received) > u16::from(st.window) {
+            st.sent = st.received;
+        }
+        self.cond.notify_all();
+
+        true
+    }
+
+    /// Wait until the node can take a frame, returns how many it can take
+    pub fn wait(&self, stall: Duration, stats: &Stats) -> usize {
+        let mut st = self.state.lock().unwrap();
+        if st.available() > 0 {
+            return st.available();
+        }
+
+        Stats::add(&stats.credit_waits, 1);
+        let deadline = Instant::now() + stall;
+        while st.available() == 0 {
+            let now = Instant::now();
+            if now >= deadline {
+                Stats::add(&stats.credit_stalls, 1);
+                st.sent = st.received;
+                return 1;
+            }
+            st = self.cond.wait_timeout(st, deadline - now).unwrap().0;
+        }
+
+        st.available()
+    }
+
+    /// Count `frames` written to the serial line
+    pub fn consume(&self, frames: usize) {
+        let mut st = self.state.lock().unwrap();
+        st.sent = st.sent.wrapping_add(frames as u16);
+    }
+}
+
+/// Bridge counters
+#[derive(Debug, Default)]
+pub struct Stats {
+    /// Frames and bytes (unescaped) written to the serial line
+    pub tx_frames: AtomicU64,
+    pub tx_bytes: AtomicU64,
+    /// write() calls on the serial line
+    pub tx_writes: AtomicU64,
+    /// Frames and bytes (unescaped) read from the serial line
+    pub rx_frames: AtomicU64,
+    pub rx_bytes: AtomicU64,
+    /// read() calls on the serial line
+    pub rx_reads: AtomicU64,
+    /// Malformed or too long frames from the serial line
+    pub rx_dropped: AtomicU64,
+    /// Packets that couldn't be written to the TUN interface
+    pub tun_errors: AtomicU64,
+    /// VAINA messages sent and answers received through the bridge
+    pub vaina_tx: AtomicU64,
+    pub vaina_rx: AtomicU64,
+    /// Credit frames from the node, times the serial writer waited for
+    /// credits, and times it gave up waiting
+    pub credit_frames: AtomicU64,
+    pub credit_waits: AtomicU64,
+    pub credit_stalls: AtomicU64,
+}
+
+impl Stats {
+    fn add(counter: &AtomicU64, n: u64) {
+        counter.fetch_add(n, Ordering::Relaxed);
+    }
+
+    pub fn get(counter: &AtomicU64) -> u64 {
+        counter.load(Ordering::Relaxed)
+    }
+
+    pub fn print(&self) {
+        let per = |a: &AtomicU64, b: &AtomicU64| {
+            let b = Stats::get(b);
+            if b == 0 {
+                0.0
+            } else {
+                Stats::get(a) as f64 / b as f64
+            }
+        };
+
+        println!(
+            "serial tx: {} frames, {} bytes, {} writes ({:.1} frames/write)",
+            Stats::get(&self.tx_frames),
+            Stats::get(&self.tx_bytes),
+            Stats::get(&self.tx_writes),
+            per(&self.tx_frames, &self.tx_writes)
+        );
+        println!(
+            "serial rx: {} frames, {} bytes, {} reads ({:.1} frames/read), {} dropped",
+            Stats::get(&self.rx_frames),
+            Stats::get(&self.rx_bytes),
+            Stats::get(&self.rx_reads),
+            per(&self.rx_frames, &self.rx_reads),
+            Stats::get(&self.rx_dropped)
+        );
+        println!(
+            "tun errors: {}, vaina: {} sent, {} answers",
+            Stats::get(&self.tun_errors),
+            Stats::get(&self.vaina_tx),
+            Stats::get(&self.vaina_rx)
+        );
+        println!(
+            "credits: {} updates, {} waits, {} stalls",
+            Stats::get(&self.credit_frames),
+            Stats::get(&self.credit_waits),
+            Stats::get(&self.credit_stalls)
+        );
+    }
+}
+
+/// Open the TUN interface `name`, it must exist already
+pub fn tun_open(name: &str) -> io::Result<File> {
+    #[repr(C)]
+    struct IfReq {
+        name: [libc::c_char; libc::IFNAMSIZ],
+        flags: libc::c_short,
+        _pad: [u8; 22],
+    }
+    const TUNSETIFF: libc::c_ulong = 0x4004_54ca;
+
+    if name.len() >= libc::IFNAMSIZ {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput, "interface name too long"));
+    }
+
+    let tun = OpenOptions::new().read(true).write(true).open("/dev/net/tun")?;
+    let mut req = IfReq {
+        name: [0; libc::IFNAMSIZ],
+        flags: (libc::IFF_TUN | libc::IFF_NO_PI) as libc::c_short,
+        _pad: [0; 22],
+    };
+    for (dst, src) in req.name.iter_mut().zip(name.bytes()) {
+        *dst = src as libc::c_char;
+    }
+
+    if unsafe { libc::ioctl(tun.as_raw_fd(), TUNSETIFF as _, &mut req) } < 0 {
+        return Err(io::Error::last_os_error());
+    }
+
+    Ok(tun)
+}
+
+fn baudrate(baud: u32) -> io::Result<libc::speed_t> {
+    Ok(match baud {
+        9600 => libc::B9600,
+        19200 => libc::B19200,
+        38400 => libc::B38400,
+        57600 => libc::B57600,
+        115200 => libc::B115200,
+        230400 => libc::B230400,
+        460800 => libc::B460800,
+        500000 => libc::B500000,
+        921600 => libc::B921600,
+        1000000 => libc::B1000000,
+        2000000 => libc::B2000000,
+        _ => return Err(io::Error::new(io::ErrorKind::InvalidInput, "unsupported baudrate")),
+    })
+}
+
+/// Put `fd` in raw mode at `baud`
+pub fn serial_setup(fd: RawFd, baud: u32) -> io::Result<()> {
+    let speed = baudrate(baud)?;
+    unsafe {
+        let mut tio: libc::termios = std::mem::zeroed();
+        if libc::tcgetattr(fd, &mut tio) < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        libc::cfmakeraw(&mut tio);
+        libc::cfsetspeed(&mut tio, speed);
+        tio.c_cc[libc::VMIN] = 1;
+        tio.c_cc[libc::VTIME] = 0;
+        if libc::tcsetattr(fd, libc::TCSANOW, &tio) < 0 {
+            return Err(io::Error::last_os_error());
+        }
+    }
+    Ok(())
+}
+
+/// Open the serial device at `path`
+pub fn serial_open(path: &str, baud: u32) -> io::Result<File> {
+    let serial = OpenOptions::new()
+        .read(true)
+        .write(true)
+        .custom_flags(libc::O_NOCTTY)
+        .open(path)?;
+    serial_setup(serial.as_raw_fd(), baud)?;
+    Ok(serial)
+}
+
+/// Internet checksum of the IPv6 pseudo header plus `udp`
+fn udp6_checksum(src: &Ipv6Addr, dst: &Ipv6Addr, udp: &[u8]) -> u16 {
+    let mut sum: u32 = 0;
+    let mut add = |bytes: &[u8]| {
+        for chunk in bytes.chunks(2) {
+            let word = if chunk.len() == 2 {
+                u16::from_be_bytes([chunk[0], chunk[1]])
+            } else {
+                u16::from_be_bytes([chunk[0], 0])
+            };
+            sum += u32::from(word);
+        }
+    };
+
+    add(&src.octets());
+    add(&dst.octets());
+    add(&(udp.len() as u32).to_be_bytes());
+    add(&[0, 0, 0, 17]);
+    add(udp);
+
+    while sum > 0xffff {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    match !(sum as u16) {
+        // 0 means no checksum, send all ones instead
+        0 => 0xffff,
+        sum => sum,
+    }
+}
+
+/// Build an IPv6/UDP packet
+pub fn udp6_packet(src: &Ipv6Addr, dst: &Ipv6Addr, sport: u16, dport: u16, payload: &[u8]) -> Vec<u8> {
+    let udp_len = 8 + payload.len();
+    let mut pkt = Vec::with_capacity(40 + udp_len);
+
+    pkt.extend_from_slice(&[0x60, 0, 0, 0]);
+    pkt.extend_from_slice(&(udp_len as u16).to_be_bytes());
+    pkt.push(17);
+    pkt.push(if dst.is_multicast() { 1 } else { 64 });
+    pkt.extend_from_slice(&src.octets());
+    pkt.extend_from_slice(&dst.octets());
+
+    pkt.extend_from_slice(&sport.to_be_bytes());
+    pkt.extend_from_slice(&dport.to_be_bytes());
+    pkt.extend_from_slice(&(udp_len as u16).to_be_bytes());
+    pkt.extend_from_slice(&[0, 0]);
+    pkt.extend_from_slice(payload);
+
+    let sum = udp6_checksum(src, dst, &pkt[40..]);
+    pkt[46..48].copy_from_slice(&sum.to_be_bytes());
+
+    pkt
+}
+
+/// Payload of `pkt` if it's a UDP datagram to `dst` port `dport`
+pub fn udp6_payload<'a>(pkt: &'a [u8], dst: &Ipv6Addr, dport: u16) -> Option<&'a [u8]> {
+    if pkt.len() < 48 || pkt[0] >> 4 != 6 || pkt[6] != 17 {
+        return None;
+    }
+    if pkt[24..40] != dst.octets() || pkt[42..44] != dport.to_be_bytes() {
+        return None;
+    }
+
+    let udp_len = u16::from_be_bytes([pkt[44], pkt[45]]) as usize;
+    if udp_len < 8 || 40 + udp_len > pkt.len() {
+        return None;
+    }
+
+    Some(&pkt[48..40 + udp_len])
+}
+
+/// Bridge settings
+#[derive(Debug, Clone)]
+pub struct Config {
+    /// Coalesce frames and read the serial line in large chunks. Otherwise
+    /// do one write per frame and read byte by byte, like sliptty.
+    pub batch: bool,
+    /// Local socket for VAINA messages
+    pub vaina: Option<SocketAddr>,
+    /// Source address of the VAINA messages, the host's on the TUN link
+    pub host: Ipv6Addr,
+    /// Destination of the VAINA messages
+    pub node: Ipv6Addr,
+}
+
+impl Default for Config {
+    fn default() -> Config {
+        Config {
+            batch: true,
+            vaina: None,
+            host: "fe80::1".parse().unwrap(),
+            node: VAINA_MCAST_ADDR.parse().unwrap(),
+        }
+    }
+}
+
+fn serial_writer(
+    mut serial: File,
+    queue: Receiver<Vec<u8>>,
+    batch: bool,
+    credits: Arc<Credits>,
+    stats: Arc<Stats>,
+) {
+    let mut out = Vec::with_capacity(BATCH_MAX + 2 * FRAME_MAX);
+
+    while let Ok(pkt) = queue.recv() {
+        let allowed = credits.wait(CREDIT_STALL, &stats);
+        out.clear();
+        let mut frames: usize = 1;
+        let mut bytes = pkt.len();
+        slip_encode(&pkt, &mut out);
+
+        if batch {
+            while out.len() < BATCH_MAX && frames < allowed {
+                match queue.try_recv() {
+                    Ok(pkt) => {
+                        slip_encode(&pkt, &mut out);
+                        frames += 1;
+                        bytes += pkt.len();
+                    }
+                    Err(_) => break,
+                }
+            }
+        }
+        credits.consume(frames);
+
+        if serial.write_all(&out).is_err() {
+            eprintln!("bridge: serial write failed");
+            return;
+        }
+        Stats::add(&stats.tx_writes, 1);
+        Stats::add(&stats.tx_frames, frames as u64);
+        Stats::add(&stats.tx_bytes, bytes as u64);
+    }
+}
+
+fn serial_reader(
+    mut serial: File,
+    mut tun: File,
+    batch: bool,
+    vaina: Option<(Arc<UdpSocket>, Arc<Mutex<Option<SocketAddr>>>)>,
+    host: Ipv6Addr,
+    credits: Arc<Credits>,
+    stats: Arc<Stats>,
+) {
+    let mut buf = vec![0u8; if batch { BATCH_MAX } else { 1 }];
+    let mut decoder = SlipDecoder::default();
+
+    loop {
+        let len = match serial.read(&mut buf) {
+            Ok(0) | Err(_) => {
+                eprintln!("bridge: serial line closed");
+                return;
+            }
+            Ok(len) => len,
+        };
+        Stats::add(&stats.rx_reads, 1);
+
+        let dropped = decoder.feed(&buf[..len], |frame| {
+            Stats::add(&stats.rx_frames, 1);
+            Stats::add(&stats.rx_bytes, frame.len() as u64);
+
+            if credits.update(frame) {
+                Stats::add(&stats.credit_frames, 1);
+                return;
+            }
+
+            if let Some((sock, client)) = &vaina {
+                if let Some(payload) = udp6_payload(frame, &host, BRIDGE_VAINA_PORT) {
+                    if let Some(client) = *client.lock().unwrap() {
+                        Stats::add(&stats.vaina_rx, 1);
+                        let _ = sock.send_to(payload, client);
+                    }
+                    return;
+                }
+            }
+
+            if tun.write(frame).is_err() {
+                Stats::add(&stats.tun_errors, 1);
+            }
+        });
+        Stats::add(&stats.rx_dropped, dropped);
+    }
+}
+
+fn tun_reader(mut tun: File, queue: SyncSender<Vec<u8>>) {
+    let mut buf = [0u8; FRAME_MAX];
+
+    loop {
+        let len = match tun.read(&mut buf) {
+            Ok(0) => return,
+            Ok(len) => len,
+            Err(e) => {
+                eprintln!("bridge: TUN read failed: {}", e);
+                return;
+            }
+        };
+        if queue.send(buf[..len].to_vec()).is_err() {
+            return;
+        }
+    }
+}
+
+fn vaina_reader(
+    sock: Arc<UdpSocket>,
+    client: Arc<Mutex<Option<SocketAddr>>>,
+    queue: SyncSender<Vec<u8>>,
+    config: Config,
+    stats: Arc<Stats>,
+) {
+    let mut buf = [0u8; 256];
+
+    loop {
+        let (len, from) = match sock.recv_from(&mut buf) {
+            Ok(res) => res,
+            Err(_) => continue,
+        };
+        *client.lock().unwrap() = Some(from);
+
+        let pkt = udp6_packet(&config.host, &config.node, BRIDGE_VAINA_PORT, VAINA_PORT, &buf[..len]);
+        if queue.send(pkt).is_err() {
+            return;
+        }
+        Stats::add(&stats.vaina_tx, 1);
+    }
+}
+
+/// Start bridging `tun` and `serial`, returns the counters
+///
+/// The bridge runs on its own threads until either side is closed.
+pub fn start(tun: File, serial: File, config: Config) -> io::Result<Arc<Stats>> {
+    let stats = Arc::new(Stats::default());
+    let (tx, rx) = sync_channel(TX_QUEUE_LEN);
+
+    let vaina = match config.vaina {
+        Some(addr) => {
+            let sock = Arc::new(UdpSocket::bind(addr)?);
+            let client = Arc::new(Mutex::new(None));
+            let (s, c, q, cfg, st) = (sock.clone(), client.clone(), tx.clone(), config.clone(), stats.clone());
+            thread::spawn(move || vaina_reader(s, c, q, cfg, st));
+            Some((sock, client))
+        }
+        None => None,
+    };
+
+    let serial_rx = serial.try_clone()?;
+    let tun_rx = tun.try_clone()?;
+    let (batch, host) = (config.batch, config.host);
+    let credits = Arc::new(Credits::default());
+
+    let (cr, st) = (credits.clone(), stats.clone());
+    thread::spawn(move || serial_writer(serial, rx, batch, cr, st));
+    let st = stats.clone();
+    thread::spawn(move || serial_reader(serial_rx, tun, batch, vaina, host, credits, st));
+    thread::spawn(move || tun_reader(tun_rx, tx));
+
+    Ok(stats)
+}
+
+/// Bridge sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let netif = value_t!(matches, "interface", String).unwrap_or_else(|e| e.exit());
+    let path = value_t!(matches, "serial", String).unwrap_or_else(|e| e.exit());
+    let baud = value_t!(matches, "baudrate", u32).unwrap_or_else(|e| e.exit());
+    let interval = value_t!(matches, "stats", u64).unwrap_or(0);
+
+    let mut config = Config::default();
+    config.batch = !matches.get_flag("unbatched");
+    if matches.contains_id("vaina") {
+        config.vaina = Some(value_t!(matches, "vaina", SocketAddr).unwrap_or_else(|e| e.exit()));
+    }
+    if matches.contains_id("node") {
+        config.node = value_t!(matches, "node", Ipv6Addr).unwrap_or_else(|e| e.exit());
+    }
+
+    let tun = tun_open(&netif).map_err(|source| Error::Bridge { source })?;
+    let serial = serial_open(&path, baud).map_err(|source| Error::Bridge { source })?;
+    let stats = start(tun, serial, config).map_err(|source| Error::Bridge { source })?;
+
+    loop {
+        if interval == 0 {
+            thread::park();
+            continue;
+        }
+        thread::sleep(Duration::from_secs(interval));
+        stats.print();
+    }
+}
+
+/// Bridge benchmark: push frames through a bridge over a pty pair, in both
+/// directions, and measure the rate
+pub mod bench {
+    use super::*;
+
+    const DISCARD_PORT: u16 = 9;
+
+    pub(super) fn openpty() -> io::Result<(File, File, String)> {
+        let mut master: libc::c_int = 0;
+        let mut slave: libc::c_int = 0;
+        let mut name = [0 as libc::c_char; 64];
+        let res = unsafe {
+            libc::openpty(
+                &mut master,
+                &mut slave,
+                name.as_mut_ptr(),
+                std::ptr::null(),
+                std::ptr::null(),
+            )
+        };
+        if res < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        let name = unsafe { std::ffi::CStr::from_ptr(name.as_ptr()) };
+        serial_setup(master, 115200)?;
+        serial_setup(slave, 115200)?;
+        unsafe {
+            Ok((
+                File::from_raw_fd(master),
+                File::from_raw_fd(slave),
+                name.to_string_lossy().into_owned(),
+            ))
+        }
+    }
+
+    pub(super) fn readable(file: &File, timeout_ms: i32) -> bool {
+        let mut fds = libc::pollfd {
+            fd: file.as_raw_fd(),
+            events: libc::POLLIN,
+            revents: 0,
+        };
+        unsafe { libc::poll(&mut fds, 1, timeout_ms) > 0 }
+    }
+
+    fn ifindex(netif: &str) -> io::Result<u32> {
+        let name = std::ffi::CString::new(netif).unwrap();
+        match unsafe { libc::if_nametoindex(name.as_ptr()) } {
+            0 => Err(io::Error::last_os_error()),
+            index => Ok(index),
+        }
+    }
+
+    /// Datagrams in flight through the TUN interface, below its queue length
+    /// so the kernel doesn't drop them
+    const TUN_WINDOW: usize = 256;
+
+    /// Send `frames` datagrams through the TUN interface, count what
+    /// comes out of the pty
+    fn tun_to_serial(netif: u32, mut master: File, frames: usize, size: usize) -> io::Result<(usize, Duration)> {
+        let sock = UdpSocket::bind("[::]:0")?;
+        let node = SocketAddr::V6(std::net::SocketAddrV6::new("fe80::2".parse().unwrap(), DISCARD_PORT, 0, netif));
+        let payload = vec![0x5au8; size];
+        let received = Arc::new(AtomicUsize::new(0));
+        let progress = received.clone();
+
+        let counter = thread::spawn(move || {
+            let mut buf = vec![0u8; BATCH_MAX];
+            let mut decoder = SlipDecoder::default();
+            let mut count = 0;
+            let mut end = Instant::now();
+
+            // Datagrams may be dropped on the way, give up after a second
+            // without traffic
+            while count < frames && readable(&master, 1000) {
+                let len = match master.read(&mut buf) {
+                    Ok(0) | Err(_) => break,
+                    Ok(len) => len,
+                };
+                decoder.feed(&buf[..len], |frame| {
+                    if udp6_payload_any(frame, DISCARD_PORT).is_some() {
+                        count += 1;
+                        end = Instant::now();
+                    }
+                });
+                progress.store(count, Ordering::Relaxed);
+            }
+            (count, end)
+        });
+
+        let start = Instant::now();
+        for sent in 0..frames {
+            let deadline = Instant::now() + Duration::from_secs(1);
+            while sent - received.load(Ordering::Relaxed) >= TUN_WINDOW && Instant::now() < deadline {
+                thread::yield_now();
+            }
+            while sock.send_to(&payload, node).is_err() {
+                thread::sleep(Duration::from_micros(50));
+            }
+        }
+        let (count, end) = counter.join().unwrap();
+
+        Ok((count, end - start))
+    }
+
+    fn udp6_payload_any(pkt: &[u8], dport: u16) -> Option<&[u8]> {
+        let mut dst = [0u8; 16];
+        if pkt.len() < 40 {
+            return None;
+        }
+        dst.copy_from_slice(&pkt[24..40]);
+        udp6_payload(pkt, &Ipv6Addr::from(dst), dport)
+    }
+
+    /// Write `frames` datagrams to the pty, count what comes out of the
+    /// TUN interface
+    fn serial_to_tun(netif: u32, mut master: File, frames: usize, size: usize) -> io::Result<(usize, Duration)> {
+        let host: Ipv6Addr = "fe80::1".parse().unwrap();
+        let node: Ipv6Addr = "fe80::2".parse().unwrap();
+        let sock = UdpSocket::bind(SocketAddr::V6(std::net::SocketAddrV6::new(host, 0, 0, netif)))?;
+        sock.set_read_timeout(Some(Duration::from_secs(2)))?;
+        let port = sock.local_addr()?.port();
+
+        let pkt = udp6_packet(&node, &host, DISCARD_PORT, port, &vec![0xa5u8; size]);
+        let mut stream = Vec::with_capacity(frames * (pkt.len() + 8));
+        for _ in 0..frames {
+            slip_encode(&pkt, &mut stream);
+        }
+
+        let writer = thread::spawn(move || {
+            let _ = master.write_all(&stream);
+            master
+        });
+
+        let start = Instant::now();
+        let mut end = start;
+        let mut count = 0;
+        let mut buf = [0u8; FRAME_MAX];
+        while count < frames {
+            match sock.recv(&mut buf) {
+                Ok(_) => {
+                    count += 1;
+                    end = Instant::now();
+                }
+                Err(_) => break,
+            }
+        }
+        let _ = writer.join();
+
+        Ok((count, end - start))
+    }
+
+    fn report(what: &str, frames: usize, (count, elapsed): (usize, Duration), size: usize) {
+        let secs = elapsed.as_secs_f64().max(1e-9);
+        println!(
+            "{:<14} {:>7}/{:<7} frames in {:>8.1} ms: {:>9.0} frames/s, {:>7.2} MB/s",
+            what,
+            count,
+            frames,
+            secs * 1000.0,
+            count as f64 / secs,
+            (count * (size + 48)) as f64 / secs / 1e6
+        );
+    }
+
+    /// Run the benchmark on the TUN interface `netif`
+    ///
+    /// With `bridge` set to `None` no bridge is started, the user is asked to
+    /// start one (e.g. `sliptty -I <netif> <pty>`) on the pty instead.
+    pub fn run(netif: &str, frames: usize, size: usize, bridge: Option<Config>) -> io::Result<()> {
+        let index = ifindex(netif)?;
+        let (master, slave, name) = openpty()?;
+
+        let stats = match bridge {
+            Some(config) => Some(start(tun_open(netif)?, slave, config)?),
+            None => {
+                println!("start the bridge on {} and interface {}, then press enter", name, netif);
+                let mut line = String::new();
+                io::stdin().read_line(&mut line)?;
+                drop(slave);
+                None
+            }
+        };
+
+        let master_rx = master.try_clone()?;
+        report("serial -> tun", frames, serial_to_tun(index, master, frames, size)?, size);
+        report("tun -> serial", frames, tun_to_serial(index, master_rx, frames, size)?, size);
+
+        if let Some(stats) = stats {
+            stats.print();
+        }
+
+        Ok(())
+    }
+
+    /// Bridge benchmark sub command
+    pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+        let netif = value_t!(matches, "interface", String).unwrap_or_else(|e| e.exit());
+        let frames = value_t!(matches, "frames", usize).unwrap_or_else(|e| e.exit());
+        let size = value_t!(matches, "size", usize).unwrap_or_else(|e| e.exit());
+
+        let bridge = if matches.get_flag("external") {
+            None
+        } else {
+            let mut config = Config::default();
+            config.batch = !matches.get_flag("unbatched");
+            Some(config)
+        };
+
+        run(&netif, frames, size, bridge).map_err(|source| Error::Bridge { source })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn decode(stream: &[u8]) -> (Vec<Vec<u8>>, u64) {
+        let mut frames = Vec::new();
+        let dropped = SlipDecoder::default().feed(stream, |f| frames.push(f.to_vec()));
+        (frames, dropped)
+    }
+
+    #[test]
+    fn slip() {
+        let a = vec![1, SLIP_END, 2, SLIP_ESC, 3];
+        let b = vec![SLIP_ESC_ESC, SLIP_END_ESC];
+        let mut stream = Vec::new();
+        slip_encode(&a, &mut stream);
+        slip_encode(&b, &mut stream);
+        assert_eq!(stream.iter().filter(|&&b| b == SLIP_END).count(), 2);
+
+        // Split anywhere, the decoder keeps its state
+        let mut frames = Vec::new();
+        let mut decoder = SlipDecoder::default();
+        for chunk in stream.chunks(3) {
+            decoder.feed(chunk, |f| frames.push(f.to_vec()));
+        }
+        assert_eq!(frames, vec![a, b]);
+
+        // Bad escape and oversized frames are dropped, the next one is fine
+        let mut stream = vec![1, SLIP_ESC, 2, SLIP_END];
+        stream.extend(vec![7u8; FRAME_MAX + 1]);
+        stream.push(SLIP_END);
+        slip_encode(&[9], &mut stream);
+        assert_eq!(decode(&stream), (vec![vec![9]], 2));
+    }
+
+    #[test]
+    fn udp6() {
+        let host: Ipv6Addr = "fe80::1".parse().unwrap();
+        let node: Ipv6Addr = "fe80::2".parse().unwrap();
+        let pkt = udp6_packet(&node, &host, VAINA_PORT, BRIDGE_VAINA_PORT, b"vaina");
+
+        assert_eq!(udp6_payload(&pkt, &host, BRIDGE_VAINA_PORT), Some(&b"vaina"[..]));
+        assert_eq!(udp6_payload(&pkt, &node, BRIDGE_VAINA_PORT), None);
+        assert_eq!(udp6_payload(&pkt, &host, VAINA_PORT), None);
+        assert_eq!(udp6_payload(&pkt[..47], &host, BRIDGE_VAINA_PORT), None);
+        // A valid checksum sums up to all ones
+        assert_eq!(udp6_checksum(&node, &host, &pkt[40..]), 0xffff);
+    }
+
+    #[test]
+    fn vaina_mux() {
+        let (mut master, slave, _) = bench::openpty().unwrap();
+        let null = OpenOptions::new().read(true).write(true).open("/dev/null").unwrap();
+        let addr = UdpSocket::bind("127.0.0.1:0").unwrap().local_addr().unwrap();
+        let config = Config {
+            vaina: Some(addr),
+            ..Default::default()
+        };
+        let stats = start(null, slave, config.clone()).unwrap();
+
+        let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+        client.set_read_timeout(Some(Duration::from_secs(2))).unwrap();
+        client.send_to(b"rcs add", addr).unwrap();
+
+        // The message comes out of the serial line as IPv6/UDP
+        let mut buf = [0u8; 512];
+        let len = master.read(&mut buf).unwrap();
+        let (frames, _) = decode(&buf[..len]);
+        assert_eq!(udp6_payload(&frames[0], &config.node, VAINA_PORT), Some(&b"rcs add"[..]));
+
+        // And the answer goes back to the client, not to the kernel
+        let reply = udp6_packet(&"fe80::2".parse().unwrap(), &config.host, VAINA_PORT, BRIDGE_VAINA_PORT, b"ack");
+        let mut stream = Vec::new();
+        slip_encode(&reply, &mut stream);
+        master.write_all(&stream).unwrap();
+
+        let (len, from) = client.recv_from(&mut buf).unwrap();
+        assert_eq!((&buf[..len], from), (&b"ack"[..], addr));
+        assert_eq!(Stats::get(&stats.vaina_rx), 1);
+        assert_eq!(Stats::get(&stats.tun_errors), 0);
+    }
+
+    fn credit_frame(received: u16, free: u8, window: u8) -> Vec<u8> {
+        let mut stream = Vec::new();
+        let [hi, lo] = received.to_be_bytes();
+        slip_encode(&[CREDIT_START, hi, lo, free, window], &mut stream);
+        stream
+    }
+
+    /// Node stand-in on the pty: queues up to `window` frames and forwards
+    /// one every `interval`, like a radio slower than the serial line.
+    /// Returns the frames forwarded and the ones that didn't fit.
+    fn slow_node(mut master: File, window: u8, interval: Duration, frames: usize, credits: bool) -> (usize, usize) {
+        let mut decoder = SlipDecoder::default();
+        let mut buf = [0u8; 4096];
+        let (mut received, mut queued, mut forwarded, mut overflow) = (0u16, 0u8, 0, 0);
+        let mut next = Instant::now() + interval;
+        let mut idle = Instant::now();
+
+        if credits {
+            master.write_all(&credit_frame(0, window, window)).unwrap();
+        }
+
+        while forwarded + overflow < frames && idle.elapsed() < Duration::from_secs(2) {
+            let wait = next.saturating_duration_since(Instant::now());
+            if bench::readable(&master, wait.as_millis() as i32) {
+                let len = master.read(&mut buf).unwrap();
+                decoder.feed(&buf[..len], |_| {
+                    received = received.wrapping_add(1);
+                    if queued < window {
+                        queued += 1;
+                    } else {
+                        overflow += 1;
+                    }
+                });
+                idle = Instant::now();
+            }
+
+            if Instant::now() >= next {
+                next += interval;
+                if queued > 0 {
+                    queued -= 1;
+                    forwarded += 1;
+                    if credits {
+                        master.write_all(&credit_frame(received, window - queued, window)).unwrap();
+                    }
+                }
+            }
+        }
+
+        (forwarded, overflow)
+    }
+
+    /// Burst of VAINA datagrams through a bridge to a slow node
+    fn burst(frames: usize, credits: bool) -> ((usize, usize), Arc<Stats>) {
+        let (master, slave, _) = bench::openpty().unwrap();
+        let null = OpenOptions::new().read(true).write(true).open("/dev/null").unwrap();
+        let addr = UdpSocket::bind("127.0.0.1:0").unwrap().local_addr().unwrap();
+        let config = Config {
+            vaina: Some(addr),
+            ..Default::default()
+        };
+        let stats = start(null, slave, config).unwrap();
+
+        let node = thread::spawn(move || slow_node(master, 4, Duration::from_millis(2), frames, credits));
+        // Limited from the first frame on
+        let deadline = Instant::now() + Duration::from_secs(2);
+        while credits && Stats::get(&stats.credit_frames) == 0 && Instant::now() < deadline {
+            thread::sleep(Duration::from_millis(1));
+        }
+
+        let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+        for i in 0..frames {
+            client.send_to(&[i as u8; 32], addr).unwrap();
+        }
+
+        (node.join().unwrap(), stats)
+    }
+
+    #[test]
+    fn credits() {
+        let ((forwarded, overflow), stats) = burst(64, true);
+        assert_eq!((forwarded, overflow), (64, 0));
+        assert!(Stats::get(&stats.credit_waits) > 0);
+        assert_eq!(Stats::get(&stats.credit_stalls), 0);
+
+        // A node without flow control loses most of the burst
+        let ((forwarded, overflow), stats) = burst(64, false);
+        assert_eq!(forwarded + overflow, 64);
+        assert!(overflow > 0);
+        assert_eq!(Stats::get(&stats.credit_frames), 0);
+    }
+
+    #[test]
+    fn credit_stall() {
+        let (mut master, slave, _) = bench::openpty().unwrap();
+        let null = OpenOptions::new().read(true).write(true).open("/dev/null").unwrap();
+        let addr = UdpSocket::bind("127.0.0.1:0").unwrap().local_addr().unwrap();
+        let config = Config {
+            vaina: Some(addr),
+            ..Default::default()
+        };
+        let stats = start(null, slave, config).unwrap();
+
+        // A node that's full and then never answers
+        master.write_all(&credit_frame(0, 0, 4)).unwrap();
+        while Stats::get(&stats.credit_frames) == 0 {
+            thread::sleep(Duration::from_millis(1));
+        }
+
+        let sent_at = Instant::now();
+        let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+        client.send_to(b"rcs add", addr).unwrap();
+
+        // The frame goes out anyway after CREDIT_STALL
+        let mut buf = [0u8; 512];
+        let len = master.read(&mut buf).unwrap();
+        assert!(sent_at.elapsed() >= CREDIT_STALL);
+        assert_eq!(decode(&buf[..len]).0.len(), 1);
+        assert_eq!(Stats::get(&stats.credit_stalls), 1);
+
+        // And the node's count resynchronizes the bridge
+        let credits = Credits::default();
+        credits.update(&[CREDIT_START, 0, 0, 4, 4]);
+        credits.consume(3);
+        assert_eq!(credits.wait(CREDIT_STALL, &stats), 1);
+        // The node lost count (restarted, frames lost on the line)
+        credits.consume(1);
+        credits.update(&[CREDIT_START, 0xff, 0xf0, 4, 4]);
+        assert_eq!(credits.wait(CREDIT_STALL, &stats), 4);
+    }
+}
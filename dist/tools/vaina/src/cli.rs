@@ -0,0 +1,313 @@
+use clap::{Arg, ArgAction, Command};
+
+/// Command line of `vaina`
+pub fn build() -> Command {
+    Command::new("vaina")
+        .version("0.1.0")
+        .author("Locha Inc <contact@locha.io>")
+        .about("VAINA client")
+        .subcommand(
+            Command::new("nib")
+                .about("Neighbor Information Base")
+                .subcommand_required(true)
+                .subcommand(
+                    Command::new("add")
+                        .about("Add route to NIB")
+                        .arg(
+                            Arg::new("interface")
+                                .help("Network interface (e.g: sl0)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("prefix")
+                                .help("IPv6 prefix in bits (e.g: 128)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("IP")
+                                .help("IPv6 address (e.g: 2001::db8:c0ff:ee)")
+                                .required(true),
+                        ),
+                )
+                .subcommand(
+                    Command::new("sub")
+                        .about("Delete route from NIB")
+                        .arg(
+                            Arg::new("interface")
+                                .help("Network interface (e.g: sl0)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("prefix")
+                                .help("IPv6 prefix in bits (e.g: 128)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("IP")
+                                .help("IPv6 address (e.g: 2001::db8:c0ff:ee)")
+                                .required(true),
+                        ),
+                ),
+        )
+        .subcommand(
+            Command::new("rcs")
+                .about("Router Client Set")
+                .subcommand_required(true)
+                .subcommand(
+                    Command::new("add")
+                        .about("Add client to RCS")
+                        .arg(
+                            Arg::new("interface")
+                                .help("Network interface (e.g: sl0)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("prefix")
+                                .help("IPv6 prefix in bits (e.g: 128)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("IP")
+                                .help("IPv6 address of the client to add")
+                                .required(true),
+                        ),
+                )
+                .subcommand(
+                    Command::new("sub")
+                        .about("Delete a client from the RCS")
+                        .arg(
+                            Arg::new("interface")
+                                .help("Network interface (e.g: sl0)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("prefix")
+                                .help("IPv6 prefix in bits (e.g: 128)")
+                                .required(true),
+                        )
+                        .arg(
+                            Arg::new("IP")
+                                .help("IPv6 address of the client to delete")
+                                .required(true),
+                        ),
+                ),
+        )
+        .subcommand(
+            Command::new("route")
+                .about("Show the route of the node to a destination")
+                .arg(
+                    Arg::new("interface")
+                        .help("Network interface (e.g: sl0)")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("IP")
+                        .help("IPv6 address of the destination")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("timeout")
+                        .help("Milliseconds to wait for the answer")
+                        .long("timeout")
+                        .default_value("1000"),
+                ),
+        )
+        .subcommand(
+            Command::new("position")
+                .about("Set the position of the node, for location-aided route discovery")
+                .arg(
+                    Arg::new("interface")
+                        .help("Network interface (e.g: sl0)")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("X")
+                        .help("Easting in metres, on the grid shared by the deployment")
+                        .required(true)
+                        .allow_hyphen_values(true),
+                )
+                .arg(
+                    Arg::new("Y")
+                        .help("Northing in metres")
+                        .required(true)
+                        .allow_hyphen_values(true),
+                ),
+        )
+        .subcommand(
+            Command::new("fleet")
+                .about("Provision many radios concurrently from a fleet config")
+                .arg(
+                    Arg::new("CONFIG")
+                        .help("Fleet configuration (TOML, see fleet.example.toml)")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("concurrency")
+                        .help("Devices provisioned at the same time")
+                        .short('c')
+                        .long("concurrency"),
+                )
+                .arg(
+                    Arg::new("verbose")
+                        .help("Report every device, not only the failed ones")
+                        .short('v')
+                        .long("verbose")
+                        .action(ArgAction::SetTrue),
+                ),
+        )
+        .subcommand(
+            Command::new("standin")
+                .about("Run firmware stand-ins that ACK VAINA messages, for testing")
+                .arg(
+                    Arg::new("ip")
+                        .help("Address to bind the stand-ins to")
+                        .long("ip")
+                        .default_value("::1"),
+                )
+                .arg(
+                    Arg::new("count")
+                        .help("Number of stand-ins")
+                        .short('n')
+                        .long("count")
+                        .default_value("1"),
+                )
+                .arg(
+                    Arg::new("loss")
+                        .help("Percentage of messages dropped")
+                        .long("loss")
+                        .default_value("0"),
+                ),
+        )
+        .subcommand(
+            Command::new("bench")
+                .about("Measure how many VAINA operations per second a node absorbs")
+                .arg(
+                    Arg::new("IP")
+                        .help("IPv6 address of the node (e.g: a native instance on tap0)")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("interface")
+                        .help("Interface to reach a link-local address through")
+                        .short('i')
+                        .long("interface"),
+                )
+                .arg(
+                    Arg::new("port")
+                        .help("VAINA port")
+                        .long("port"),
+                )
+                .arg(
+                    Arg::new("rate")
+                        .help("Operations per second")
+                        .short('r')
+                        .long("rate")
+                        .default_value("100"),
+                )
+                .arg(
+                    Arg::new("duration")
+                        .help("Seconds to run")
+                        .short('d')
+                        .long("duration")
+                        .default_value("10"),
+                )
+                .arg(
+                    Arg::new("mix")
+                        .help("Operation mix, as op:weight (rcs-add, rcs-del, nib-add, nib-del)")
+                        .short('m')
+                        .long("mix")
+                        .default_value("rcs-add:1,rcs-del:1"),
+                )
+                .arg(
+                    Arg::new("clients")
+                        .help("Distinct addresses the operations are about")
+                        .long("clients")
+                        .default_value("16"),
+                )
+                .arg(
+                    Arg::new("timeout")
+                        .help("Milliseconds after which an operation is counted as lost")
+                        .long("timeout")
+                        .default_value("1000"),
+                ),
+        )
+        .subcommand(
+            Command::new("bridge")
+                .about("Bridge a TUN interface and a serial line with SLIP (replaces sliptty)")
+                .arg(
+                    Arg::new("interface")
+                        .help("TUN interface (e.g: sl0)")
+                        .short('I')
+                        .long("interface")
+                        .default_value("sl0"),
+                )
+                .arg(
+                    Arg::new("serial")
+                        .help("Serial device (e.g: /dev/ttyACM0)")
+                        .required(true),
+                )
+                .arg(
+                    Arg::new("baudrate")
+                        .help("Serial baudrate")
+                        .default_value("115200"),
+                )
+                .arg(
+                    Arg::new("vaina")
+                        .help("Local socket VAINA messages are forwarded from (e.g: [::1]:1337)")
+                        .long("vaina"),
+                )
+                .arg(
+                    Arg::new("node")
+                        .help("Destination of the forwarded VAINA messages")
+                        .long("node"),
+                )
+                .arg(
+                    Arg::new("stats")
+                        .help("Print the counters every this many seconds")
+                        .long("stats"),
+                )
+                .arg(
+                    Arg::new("unbatched")
+                        .help("One write per frame and byte by byte reads, like sliptty")
+                        .long("unbatched")
+                        .action(ArgAction::SetTrue),
+                ),
+        )
+        .subcommand(
+            Command::new("bridge-bench")
+                .about("Benchmark a TUN <-> serial bridge over a pty pair")
+                .arg(
+                    Arg::new("interface")
+                        .help("TUN interface, up and with fe80::1/64 (e.g: bench0)")
+                        .short('I')
+                        .long("interface")
+                        .default_value("sl0"),
+                )
+                .arg(
+                    Arg::new("frames")
+                        .help("Frames sent in each direction")
+                        .short('n')
+                        .long("frames")
+                        .default_value("20000"),
+                )
+                .arg(
+                    Arg::new("size")
+                        .help("UDP payload size")
+                        .short('s')
+                        .long("size")
+                        .default_value("64"),
+                )
+                .arg(
+                    Arg::new("unbatched")
+                        .help("Run the bridge unbatched")
+                        .long("unbatched")
+                        .action(ArgAction::SetTrue),
+                )
+                .arg(
+                    Arg::new("external")
+                        .help("Don't run a bridge, wait for one (e.g: sliptty) to be started on the pty")
+                        .long("external")
+                        .action(ArgAction::SetTrue),
+                ),
+        )
+}
@@ -1,16 +1,10 @@
-use std::ffi::OsString;
-use std::net::{Ipv6Addr, SocketAddr, UdpSocket};
-use std::os::unix::io::FromRawFd;
+use std::ffi::{CString, OsString};
+use std::io;
+use std::net::{Ipv6Addr, SocketAddr, SocketAddrV6, UdpSocket};
+use std::os::unix::ffi::OsStrExt;
+use std::os::unix::io::AsRawFd;
 use std::str::FromStr;
 
-use nix::sys::socket::sockopt::{BindToDevice, Ipv6AddMembership};
-use nix::sys::socket::{
-    bind, setsockopt, socket, AddressFamily, InetAddr, Ipv6Addr as NixIpv6Addr,
-    Ipv6MembershipRequest, SockAddr, SockFlag, SockProtocol, SockType,
-};
-
-use snafu::ResultExt;
-
 use crate::msg::Message;
 use crate::*;
 
@@ -30,27 +24,20 @@ impl VainaClient {
     /// New `VainaClient`
     pub fn new(netif: &OsString) -> Result<VainaClient, Error> {
         let group = Ipv6Addr::from_str(VAINA_MCAST_ADDR).unwrap();
-        let stdaddr = SocketAddr::new(group.clone().into(), VAINA_PORT);
-        let sockaddr = SockAddr::new_inet(InetAddr::from_std(&stdaddr));
-        let fd = socket(
-            AddressFamily::Inet6,
-            SockType::Datagram,
-            SockFlag::empty(),
-            SockProtocol::Udp,
-        )
-        .context(VainaSocket)?;
+        let stdaddr = SocketAddrV6::new(group, VAINA_PORT, 0, 0);
+        let sock = UdpSocket::bind(stdaddr).map_err(|source| Error::VainaSocket { source })?;
 
-        setsockopt(fd, BindToDevice, netif).context(VainaSocket)?;
-        bind(fd, &sockaddr).context(VainaSocket)?;
-
-        let group_req = Ipv6MembershipRequest::new(NixIpv6Addr::from_std(&group));
-        setsockopt(fd, Ipv6AddMembership, &group_req).context(VainaSocket)?;
+        bind_to_device(&sock, netif).map_err(|source| Error::VainaSocket { source })?;
+        let scope = if_nametoindex(&netif.to_string_lossy())
+            .map_err(|source| Error::VainaSocket { source })?;
+        sock.join_multicast_v6(&group, scope)
+            .map_err(|source| Error::VainaSocket { source })?;
 
         Ok(VainaClient {
             seqno: 0u8,
             pending_acks: Vec::new(),
-            sock: unsafe { UdpSocket::from_raw_fd(fd) },
-            group: stdaddr,
+            sock,
+            group: stdaddr.into(),
         })
     }
 
@@ -72,8 +59,35 @@ impl VainaClient {
 
         self.sock
             .send_to(bytes.as_ref(), &self.group)
-            .context(FailedSend)?;
+            .map_err(|source| Error::FailedSend { source })?;
 
         Ok(())
     }
 }
+
+/// Index of the network interface `netif`
+pub fn if_nametoindex(netif: &str) -> io::Result<u32> {
+    let name = CString::new(netif).map_err(|e| io::Error::new(io::ErrorKind::InvalidInput, e))?;
+    match unsafe { libc::if_nametoindex(name.as_ptr()) } {
+        0 => Err(io::Error::last_os_error()),
+        index => Ok(index),
+    }
+}
+
+/// Only send and receive through `netif` (`SO_BINDTODEVICE`)
+fn bind_to_device(sock: &UdpSocket, netif: &OsString) -> io::Result<()> {
+    let name = netif.as_bytes();
+    let res = unsafe {
+        libc::setsockopt(
+            sock.as_raw_fd(),
+            libc::SOL_SOCKET,
+            libc::SO_BINDTODEVICE,
+            name.as_ptr() as *const libc::c_void,
+            name.len() as libc::socklen_t,
+        )
+    };
+    if res < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    Ok(())
+}
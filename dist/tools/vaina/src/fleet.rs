@@ -0,0 +1,461 @@
+//! Fleet mode: provision many radios concurrently from a declarative config.
+//!
+//! Every device gets its own UDP socket and task, the messages of a device
+//! are sent in order and each one waits for its ACK, retrying on timeout.
+//! Devices are provisioned concurrently, up to `concurrency` at a time.
+
+use std::fmt;
+use std::fs;
+use std::net::{IpAddr, Ipv6Addr, SocketAddr, SocketAddrV6};
+use std::str::FromStr;
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use clap::ArgMatches;
+use serde::Deserialize;
+use tokio::net::UdpSocket;
+use tokio::sync::Semaphore;
+use tokio::task::JoinSet;
+use tokio::time::timeout;
+
+use crate::client::VAINA_PORT;
+use crate::msg::Message;
+use crate::*;
+
+/// An IPv6 prefix, written as `2001:db8::/64`
+#[derive(Debug, Clone, Copy, PartialEq, Deserialize)]
+#[serde(try_from = "String")]
+pub struct Prefix {
+    pub ip: Ipv6Addr,
+    pub len: u8,
+}
+
+impl FromStr for Prefix {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Prefix, String> {
+        let (ip, len) = match s.find('/') {
+            Some(i) => (&s[..i], &s[i + 1..]),
+            None => (s, "128"),
+        };
+        let ip = Ipv6Addr::from_str(ip).map_err(|e| format!("{}: {}", s, e))?;
+        let len = u8::from_str(len).map_err(|e| format!("{}: {}", s, e))?;
+        if len > 128 {
+            return Err(format!("{}: prefix longer than 128 bits", s));
+        }
+
+        Ok(Prefix { ip, len })
+    }
+}
+
+impl std::convert::TryFrom<String> for Prefix {
+    type Error = String;
+
+    fn try_from(s: String) -> Result<Prefix, String> {
+        Prefix::from_str(&s)
+    }
+}
+
+/// A radio to provision
+#[derive(Debug, Clone, Deserialize)]
+#[serde(deny_unknown_fields)]
+pub struct Device {
+    /// Name used on the report
+    pub name: String,
+    /// Address of the radio, the port defaults to the VAINA port
+    pub address: String,
+    /// Interface to reach link-local addresses through (e.g: sl0)
+    pub interface: Option<String>,
+    /// Clients to add to the Router Client Set
+    #[serde(default)]
+    pub rcs: Vec<Prefix>,
+    /// Routes to add to the NIB
+    #[serde(default)]
+    pub nib: Vec<Prefix>,
+}
+
+fn default_timeout_ms() -> u64 {
+    500
+}
+
+fn default_retries() -> u32 {
+    3
+}
+
+fn default_concurrency() -> usize {
+    64
+}
+
+/// Fleet configuration file
+#[derive(Debug, Clone, Deserialize)]
+#[serde(deny_unknown_fields)]
+pub struct Config {
+    /// Time to wait for every ACK
+    #[serde(default = "default_timeout_ms")]
+    pub timeout_ms: u64,
+    /// Retransmissions of a message before giving up on the device
+    #[serde(default = "default_retries")]
+    pub retries: u32,
+    /// Devices provisioned at the same time
+    #[serde(default = "default_concurrency")]
+    pub concurrency: usize,
+    #[serde(rename = "device", default)]
+    pub devices: Vec<Device>,
+}
+
+impl Config {
+    pub fn load(path: &str) -> Result<Config, Error> {
+        let path = path.to_string();
+        let text = match fs::read_to_string(&path) {
+            Ok(text) => text,
+            Err(source) => return Err(Error::FleetConfigRead { path, source }),
+        };
+        toml::from_str(&text).map_err(|source| Error::FleetConfigParse { path, source })
+    }
+}
+
+/// Why a device couldn't be provisioned
+#[derive(Debug)]
+pub enum DeviceError {
+    /// The address couldn't be resolved
+    Address(String),
+    /// Socket error
+    Io(std::io::Error),
+    /// No ACK after all the retries
+    Timeout { seqno: u8 },
+    /// The radio refused a message
+    Rejected { seqno: u8 },
+}
+
+impl fmt::Display for DeviceError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            DeviceError::Address(e) => write!(f, "bad address: {}", e),
+            DeviceError::Io(e) => write!(f, "{}", e),
+            DeviceError::Timeout { seqno } => write!(f, "no ACK for message {}", seqno),
+            DeviceError::Rejected { seqno } => write!(f, "message {} NACKed", seqno),
+        }
+    }
+}
+
+impl From<std::io::Error> for DeviceError {
+    fn from(e: std::io::Error) -> DeviceError {
+        DeviceError::Io(e)
+    }
+}
+
+/// Outcome of a device
+#[derive(Debug)]
+pub struct DeviceReport {
+    pub name: String,
+    /// Time since the device's task started
+    pub elapsed: Duration,
+    /// Messages ACKed
+    pub acked: usize,
+    /// Messages sent, retransmissions included
+    pub sent: usize,
+    pub result: Result<(), DeviceError>,
+}
+
+/// Outcome of the fleet, in config order
+#[derive(Debug)]
+pub struct Report {
+    pub elapsed: Duration,
+    pub devices: Vec<DeviceReport>,
+}
+
+impl Report {
+    pub fn failed(&self) -> usize {
+        self.devices.iter().filter(|d| d.result.is_err()).count()
+    }
+
+    /// Print a line per device and a summary
+    pub fn print(&self, verbose: bool) {
+        for dev in &self.devices {
+            if !verbose && dev.result.is_ok() {
+                continue;
+            }
+            let status = match &dev.result {
+                Ok(()) => "ok".to_string(),
+                Err(e) => e.to_string(),
+            };
+            println!(
+                "{:<24} {:>8.1} ms {:>4}/{:<4} {}",
+                dev.name,
+                dev.elapsed.as_secs_f64() * 1000.0,
+                dev.acked,
+                dev.sent,
+                status
+            );
+        }
+
+        let mut times: Vec<Duration> = self.devices.iter().map(|d| d.elapsed).collect();
+        times.sort();
+        let pct = |p: usize| {
+            if times.is_empty() {
+                0.0
+            } else {
+                times[(times.len() - 1) * p / 100].as_secs_f64() * 1000.0
+            }
+        };
+        let acked: usize = self.devices.iter().map(|d| d.acked).sum();
+        let sent: usize = self.devices.iter().map(|d| d.sent).sum();
+
+        println!(
+            "{} devices, {} failed, {} messages ({} retransmitted) in {:.1} ms",
+            self.devices.len(),
+            self.failed(),
+            acked,
+            sent.saturating_sub(acked),
+            self.elapsed.as_secs_f64() * 1000.0
+        );
+        println!(
+            "per device: p50 {:.1} ms, p95 {:.1} ms, max {:.1} ms",
+            pct(50),
+            pct(95),
+            pct(100)
+        );
+    }
+}
+
+fn resolve(dev: &Device) -> Result<SocketAddr, DeviceError> {
+    let addr = match SocketAddr::from_str(&dev.address) {
+        Ok(addr) => addr,
+        Err(_) => IpAddr::from_str(&dev.address)
+            .map(|ip| SocketAddr::new(ip, VAINA_PORT))
+            .map_err(|e| DeviceError::Address(format!("{}: {}", dev.address, e)))?,
+    };
+
+    match (addr, &dev.interface) {
+        (SocketAddr::V6(v6), Some(netif)) => {
+            let scope = crate::client::if_nametoindex(netif.as_str())
+                .map_err(|e| DeviceError::Address(format!("{}: {}", netif, e)))?;
+            Ok(SocketAddr::V6(SocketAddrV6::new(
+                *v6.ip(),
+                v6.port(),
+                v6.flowinfo(),
+                scope,
+            )))
+        }
+        (addr, _) => Ok(addr),
+    }
+}
+
+fn messages(dev: &Device) -> Vec<Message> {
+    let rcs = dev.rcs.iter().map(|p| (true, p));
+    let nib = dev.nib.iter().map(|p| (false, p));
+
+    rcs.chain(nib)
+        .enumerate()
+        .map(|(i, (rcs, p))| {
+            let seqno = i as u8;
+            if rcs {
+                Message::RcsAdd {
+                    seqno,
+                    prefix: p.len,
+                    ip: p.ip,
+                }
+            } else {
+                Message::NibAdd {
+                    seqno,
+                    prefix: p.len,
+                    ip: p.ip,
+                }
+            }
+        })
+        .collect()
+}
+
+/// Wait for the ACK or NACK of `seqno`, ignoring late answers to earlier
+/// messages
+async fn wait_ack(sock: &UdpSocket, seqno: u8) -> Result<bool, std::io::Error> {
+    let mut buf = [0u8; 64];
+    loop {
+        let len = sock.recv(&mut buf).await?;
+        match Message::parse(&buf[..len]) {
+            Some(Message::Ack { seqno: s }) if s == seqno => return Ok(true),
+            Some(Message::Nack { seqno: s }) if s == seqno => return Ok(false),
+            _ => continue,
+        }
+    }
+}
+
+async fn provision(dev: &Device, config: &Config, report: &mut DeviceReport) -> Result<(), DeviceError> {
+    let remote = resolve(dev)?;
+    let local: SocketAddr = match remote {
+        SocketAddr::V4(_) => "0.0.0.0:0".parse().unwrap(),
+        SocketAddr::V6(_) => "[::]:0".parse().unwrap(),
+    };
+
+    let sock = UdpSocket::bind(local).await?;
+    sock.connect(remote).await?;
+
+    let wait = Duration::from_millis(config.timeout_ms);
+    for msg in messages(dev) {
+        let bytes = msg.serialize();
+        let seqno = msg.seqno();
+        let mut attempts = 0;
+
+        loop {
+            sock.send(bytes.as_ref()).await?;
+            report.sent += 1;
+            attempts += 1;
+
+            match timeout(wait, wait_ack(&sock, seqno)).await {
+                Ok(Ok(true)) => break,
+                Ok(Ok(false)) => return Err(DeviceError::Rejected { seqno }),
+                Ok(Err(e)) => return Err(e.into()),
+                Err(_) if attempts > config.retries => {
+                    return Err(DeviceError::Timeout { seqno })
+                }
+                Err(_) => continue,
+            }
+        }
+        report.acked += 1;
+    }
+
+    Ok(())
+}
+
+/// Provision every device on `config`
+pub async fn run(config: Config) -> Report {
+    let config = Arc::new(config);
+    let permits = Arc::new(Semaphore::new(config.concurrency.max(1)));
+    let start = Instant::now();
+    let mut tasks = JoinSet::new();
+
+    for i in 0..config.devices.len() {
+        let config = config.clone();
+        let permits = permits.clone();
+        tasks.spawn(async move {
+            let _permit = permits.acquire().await.unwrap();
+            let dev = &config.devices[i];
+            let mut report = DeviceReport {
+                name: dev.name.clone(),
+                elapsed: Duration::default(),
+                acked: 0,
+                sent: 0,
+                result: Ok(()),
+            };
+            let started = Instant::now();
+            report.result = provision(dev, &config, &mut report).await;
+            report.elapsed = started.elapsed();
+            (i, report)
+        });
+    }
+
+    let mut devices: Vec<Option<DeviceReport>> = config.devices.iter().map(|_| None).collect();
+    while let Some(res) = tasks.join_next().await {
+        let (i, report) = res.expect("device task panicked");
+        devices[i] = Some(report);
+    }
+
+    Report {
+        elapsed: start.elapsed(),
+        devices: devices.into_iter().map(Option::unwrap).collect(),
+    }
+}
+
+/// Fleet sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let path = value_t!(matches, "CONFIG", String).unwrap_or_else(|e| e.exit());
+    let mut config = Config::load(&path)?;
+    if matches.contains_id("concurrency") {
+        config.concurrency = value_t!(matches, "concurrency", usize).unwrap_or_else(|e| e.exit());
+    }
+
+    let runtime = tokio::runtime::Runtime::new().map_err(|source| Error::Runtime { source })?;
+    let report = runtime.block_on(run(config));
+    report.print(matches.get_flag("verbose"));
+
+    if report.failed() > 0 {
+        std::process::exit(1);
+    }
+
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::standin;
+
+    fn fleet(ports: &[u16], entries: usize, retries: u32) -> Config {
+        let devices = ports
+            .iter()
+            .map(|port| Device {
+                name: format!("radio-{}", port),
+                address: format!("127.0.0.1:{}", port),
+                interface: None,
+                rcs: (0..entries)
+                    .map(|i| Prefix::from_str(&format!("2001:db8::{:x}/128", i + 1)).unwrap())
+                    .collect(),
+                nib: vec![Prefix::from_str("2001:db8:1::/64").unwrap()],
+            })
+            .collect();
+
+        Config {
+            timeout_ms: 50,
+            retries,
+            concurrency: 32,
+            devices,
+        }
+    }
+
+    #[test]
+    fn prefix() {
+        let p = Prefix::from_str("2001:db8::/32").unwrap();
+        assert_eq!(p.len, 32);
+        assert_eq!(Prefix::from_str("::1").unwrap().len, 128);
+        assert!(Prefix::from_str("::1/129").is_err());
+        assert!(Prefix::from_str("10.0.0.1/8").is_err());
+    }
+
+    #[test]
+    fn config() {
+        let config: Config = toml::from_str(
+            r#"
+            retries = 5
+
+            [[device]]
+            name = "gw"
+            address = "fe80::1"
+            interface = "lo"
+            rcs = ["2001:db8::1/128"]
+            "#,
+        )
+        .unwrap();
+        assert_eq!(config.retries, 5);
+        assert_eq!(config.timeout_ms, default_timeout_ms());
+        assert_eq!(config.devices[0].rcs[0].len, 128);
+        assert!(config.devices[0].nib.is_empty());
+        assert_eq!(resolve(&config.devices[0]).unwrap().port(), VAINA_PORT);
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+    async fn lossy_fleet() {
+        let (ports, _standins) = standin::spawn("127.0.0.1".parse().unwrap(), 200, 20)
+            .await
+            .unwrap();
+
+        let report = run(fleet(&ports, 4, 10)).await;
+        assert_eq!(report.failed(), 0);
+        assert_eq!(report.devices.len(), 200);
+        assert!(report.devices.iter().all(|d| d.acked == 5));
+        // 20% loss on the way back, some messages must have been retried
+        assert!(report.devices.iter().map(|d| d.sent).sum::<usize>() > 1000);
+    }
+
+    #[tokio::test]
+    async fn unreachable() {
+        // Drops everything
+        let (ports, _standins) = standin::spawn("127.0.0.1".parse().unwrap(), 1, 100)
+            .await
+            .unwrap();
+
+        let report = run(fleet(&ports, 1, 1)).await;
+        assert_eq!(report.failed(), 1);
+        let dev = &report.devices[0];
+        assert_eq!((dev.acked, dev.sent), (0, 2));
+    }
+}
@@ -1,31 +1,70 @@
-#[macro_use]
-extern crate clap;
+use thiserror::Error;
 
-use clap::App;
-use snafu::Snafu;
+/// `clap` 2's `value_t!`: parse the value of an argument, or fail with a
+/// `clap::Error` that can `exit()`
+macro_rules! value_t {
+    ($matches:expr, $name:expr, $t:ty) => {
+        match $matches.get_one::<String>($name) {
+            Some(v) => v.parse::<$t>().map_err(|e| {
+                clap::Error::raw(
+                    clap::error::ErrorKind::ValueValidation,
+                    format!("invalid value '{}' for <{}>: {}\n", v, $name, e),
+                )
+            }),
+            None => Err(clap::Error::raw(
+                clap::error::ErrorKind::MissingRequiredArgument,
+                format!("<{}> is required\n", $name),
+            )),
+        }
+    };
+}
 
+mod bench;
+mod bridge;
+mod cli;
 mod client;
+mod fleet;
 mod msg;
 mod nib;
+mod position;
 mod rcs;
+mod route;
+mod standin;
 
-#[derive(Debug, Snafu)]
+#[derive(Debug, Error)]
 pub enum Error {
-    #[snafu(display("Could not create socket for VAINA: {}", source))]
-    VainaSocket { source: nix::Error },
-    #[snafu(display("Could not send data to VAINA: {}", source))]
+    #[error("Could not create socket for VAINA: {source}")]
+    VainaSocket { source: std::io::Error },
+    #[error("Could not send data to VAINA: {source}")]
     FailedSend { source: std::io::Error },
+    #[error("Could not read {path}: {source}")]
+    FleetConfigRead { path: String, source: std::io::Error },
+    #[error("Invalid fleet configuration {path}: {source}")]
+    FleetConfigParse { path: String, source: toml::de::Error },
+    #[error("Could not start the async runtime: {source}")]
+    Runtime { source: std::io::Error },
+    #[error("Bridge error: {source}")]
+    Bridge { source: std::io::Error },
+    #[error("Could not bind the stand-ins: {source}")]
+    StandinBind { source: std::io::Error },
 }
 
 fn main() {
-    let yaml = load_yaml!("cli.yml");
-    let matches = App::from_yaml(yaml).get_matches();
+    let mut app = cli::build();
+    let matches = app.get_matches_mut();
 
     let result = match matches.subcommand() {
-        ("rcs", Some(rcs_matches)) => rcs::handle_matches(rcs_matches),
-        ("nib", Some(nib_matches)) => nib::handle_matches(nib_matches),
+        Some(("rcs", rcs_matches)) => rcs::handle_matches(rcs_matches),
+        Some(("nib", nib_matches)) => nib::handle_matches(nib_matches),
+        Some(("route", route_matches)) => route::handle_matches(route_matches),
+        Some(("position", position_matches)) => position::handle_matches(position_matches),
+        Some(("bench", bench_matches)) => bench::handle_matches(bench_matches),
+        Some(("bridge", bridge_matches)) => bridge::handle_matches(bridge_matches),
+        Some(("bridge-bench", bench_matches)) => bridge::bench::handle_matches(bench_matches),
+        Some(("fleet", fleet_matches)) => fleet::handle_matches(fleet_matches),
+        Some(("standin", standin_matches)) => standin::handle_matches(standin_matches),
         _ => {
-            println!("{}", matches.usage());
+            println!("{}", app.render_usage());
             Ok(())
         }
     };
@@ -7,6 +7,32 @@ pub const VAINA_MSG_RCS_ADD: u8 = 2;
 pub const VAINA_MSG_RCS_DEL: u8 = 3;
 pub const VAINA_MSG_NIB_ADD: u8 = 4;
 pub const VAINA_MSG_NIB_DEL: u8 = 5;
+pub const VAINA_MSG_ROUTE_GET: u8 = 6;
+pub const VAINA_MSG_ROUTE: u8 = 7;
+pub const VAINA_MSG_POSITION_SET: u8 = 8;
+
+/// The node routes through `Route::next_hop`
+pub const ROUTE_STATUS_VIA: u8 = 0;
+/// The destination is the node or one of its clients
+pub const ROUTE_STATUS_TARGET: u8 = 1;
+
+/// Local Route Set entry of a node
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Route {
+    /// `ROUTE_STATUS_*`, no route otherwise
+    pub status: u8,
+    /// Route state (active, idle, expired, broken, timed)
+    pub state: u8,
+    pub metric_type: u8,
+    pub metric: u8,
+    /// RSSI of the link to the next hop, dBm
+    pub rssi: i8,
+    /// LQI of the link to the next hop, 0 if unknown
+    pub lqi: u8,
+    /// Destination SeqNum
+    pub seqnum: u16,
+    pub next_hop: Ipv6Addr,
+}
 
 /// VAINA message
 pub enum Message {
@@ -54,6 +80,31 @@ pub enum Message {
         /// Entry IPv6 address
         ip: Ipv6Addr,
     },
+    /// Get the route of the node to a destination
+    RouteGet {
+        seqno: u8,
+        /// Destination
+        ip: Ipv6Addr,
+    },
+    /// Route of the node, answer to `RouteGet`
+    Route {
+        seqno: u8,
+        route: Route,
+    },
+    /// Set the position of the node, for location-aided route discovery
+    PositionSet {
+        seqno: u8,
+        /// Easting, metres
+        x: i32,
+        /// Northing, metres
+        y: i32,
+    },
+}
+
+fn ipv6(buf: &[u8]) -> Ipv6Addr {
+    let mut octets = [0u8; 16];
+    octets.copy_from_slice(&buf[..16]);
+    Ipv6Addr::from(octets)
 }
 
 impl Message {
@@ -65,21 +116,82 @@ impl Message {
             Message::RcsDel { seqno, .. } => seqno,
             Message::NibAdd { seqno, .. } => seqno,
             Message::NibDel { seqno, .. } => seqno,
+            Message::RouteGet { seqno, .. } => seqno,
+            Message::Route { seqno, .. } => seqno,
+            Message::PositionSet { seqno, .. } => seqno,
         }
     }
 
     pub fn is_ack(&self) -> bool {
         match *self {
-            Message::Ack { .. } | Message::Nack { .. } => true,
+            Message::Ack { .. } | Message::Nack { .. } | Message::Route { .. } => true,
             _ => false,
         }
     }
 
+    /// Parse a message, `None` if it's malformed or of an unknown type
+    pub fn parse(buf: &[u8]) -> Option<Message> {
+        if buf.len() < 2 {
+            return None;
+        }
+
+        let seqno = buf[1];
+        match buf[0] {
+            VAINA_MSG_ACK => return Some(Message::Ack { seqno }),
+            VAINA_MSG_NACK => return Some(Message::Nack { seqno }),
+            VAINA_MSG_ROUTE_GET if buf.len() >= 2 + 16 => {
+                let ip = ipv6(&buf[2..]);
+                return Some(Message::RouteGet { seqno, ip });
+            }
+            VAINA_MSG_ROUTE if buf.len() >= 10 + 16 => {
+                let route = Route {
+                    status: buf[2],
+                    state: buf[3],
+                    metric_type: buf[4],
+                    metric: buf[5],
+                    rssi: buf[6] as i8,
+                    lqi: buf[7],
+                    seqnum: u16::from_be_bytes([buf[8], buf[9]]),
+                    next_hop: ipv6(&buf[10..]),
+                };
+                return Some(Message::Route { seqno, route });
+            }
+            VAINA_MSG_POSITION_SET if buf.len() >= 2 + 8 => {
+                let x = i32::from_be_bytes([buf[2], buf[3], buf[4], buf[5]]);
+                let y = i32::from_be_bytes([buf[6], buf[7], buf[8], buf[9]]);
+                return Some(Message::PositionSet { seqno, x, y });
+            }
+            _ => (),
+        }
+
+        if buf.len() < 3 + 16 {
+            return None;
+        }
+
+        let prefix = buf[2];
+        let ip = ipv6(&buf[3..]);
+
+        match buf[0] {
+            VAINA_MSG_RCS_ADD => Some(Message::RcsAdd { seqno, prefix, ip }),
+            VAINA_MSG_RCS_DEL => Some(Message::RcsDel { seqno, prefix, ip }),
+            VAINA_MSG_NIB_ADD => Some(Message::NibAdd { seqno, prefix, ip }),
+            VAINA_MSG_NIB_DEL => Some(Message::NibDel { seqno, prefix, ip }),
+            _ => None,
+        }
+    }
+
     pub fn serialize(&self) -> Bytes {
-        let mut buf = BytesMut::with_capacity(25);
+        let mut buf = BytesMut::with_capacity(26);
 
         match *self {
-            Message::Ack { .. } | Message::Nack { .. } => {}
+            Message::Ack { seqno } => {
+                buf.put_u8(VAINA_MSG_ACK);
+                buf.put_u8(seqno);
+            }
+            Message::Nack { seqno } => {
+                buf.put_u8(VAINA_MSG_NACK);
+                buf.put_u8(seqno);
+            }
             Message::RcsAdd { seqno, prefix, ref ip } => {
                 buf.put_u8(VAINA_MSG_RCS_ADD);
                 buf.put_u8(seqno);
@@ -112,6 +224,29 @@ impl Message {
                 buf.put_u8(prefix);
                 buf.put_slice(&ip.octets());
             }
+            Message::RouteGet { seqno, ref ip } => {
+                buf.put_u8(VAINA_MSG_ROUTE_GET);
+                buf.put_u8(seqno);
+                buf.put_slice(&ip.octets());
+            }
+            Message::Route { seqno, ref route } => {
+                buf.put_u8(VAINA_MSG_ROUTE);
+                buf.put_u8(seqno);
+                buf.put_u8(route.status);
+                buf.put_u8(route.state);
+                buf.put_u8(route.metric_type);
+                buf.put_u8(route.metric);
+                buf.put_i8(route.rssi);
+                buf.put_u8(route.lqi);
+                buf.put_u16(route.seqnum);
+                buf.put_slice(&route.next_hop.octets());
+            }
+            Message::PositionSet { seqno, x, y } => {
+                buf.put_u8(VAINA_MSG_POSITION_SET);
+                buf.put_u8(seqno);
+                buf.put_i32(x);
+                buf.put_i32(y);
+            }
         }
 
         buf.freeze()
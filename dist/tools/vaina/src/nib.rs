@@ -1,7 +1,7 @@
 use std::ffi::OsString;
 use std::net::Ipv6Addr;
 
-use clap::{value_t, ArgMatches};
+use clap::ArgMatches;
 
 use crate::client::VainaClient;
 use crate::msg::Message;
@@ -10,9 +10,9 @@ use crate::Error;
 /// Router Client Set sub command
 pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
     match matches.subcommand() {
-        ("add", Some(add_matches)) => add(add_matches)?,
-        ("del", Some(del_matches)) => del(del_matches)?,
-        _ => println!("{}", matches.usage()),
+        Some(("add", add_matches)) => add(add_matches)?,
+        Some(("sub", del_matches)) => del(del_matches)?,
+        _ => unreachable!("subcommand_required"),
     };
 
     Ok(())
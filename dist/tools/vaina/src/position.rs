@@ -0,0 +1,29 @@
+//! Set the position of the node, so its RREQs only flood the routers
+//! between it and the target.
+
+use std::ffi::OsString;
+
+use clap::ArgMatches;
+
+use crate::client::VainaClient;
+use crate::msg::Message;
+use crate::Error;
+
+/// Position sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let x = value_t!(matches, "X", i32).unwrap_or_else(|e| e.exit());
+    let y = value_t!(matches, "Y", i32).unwrap_or_else(|e| e.exit());
+    let interface = value_t!(matches, "interface", String).unwrap_or_else(|e| e.exit());
+    let interface = OsString::from(interface);
+
+    let mut client = VainaClient::new(&interface)?;
+
+    let msg = Message::PositionSet {
+        seqno: client.craft_seqno(),
+        x,
+        y,
+    };
+    client.send_message(&msg)?;
+
+    Ok(())
+}
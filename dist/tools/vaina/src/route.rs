@@ -0,0 +1,75 @@
+//! Ask the node on the SLIP interface for its route to a destination, the
+//! first hop of a `traceroute` from the host.
+
+use std::net::{Ipv6Addr, SocketAddr, SocketAddrV6, UdpSocket};
+use std::str::FromStr;
+use std::time::Duration;
+
+use clap::ArgMatches;
+
+use crate::client::{VAINA_MCAST_ADDR, VAINA_PORT};
+use crate::msg::{Message, Route, ROUTE_STATUS_TARGET, ROUTE_STATUS_VIA};
+use crate::*;
+
+/// Route states, as numbered by the firmware
+const STATES: [&str; 5] = ["active", "idle", "expired", "broken", "timed"];
+
+fn print(ip: &Ipv6Addr, route: &Route) {
+    match route.status {
+        ROUTE_STATUS_TARGET => println!("{} is the node or one of its clients", ip),
+        ROUTE_STATUS_VIA => {
+            let state = STATES.get(route.state as usize).unwrap_or(&"?");
+            print!(
+                "{} via {} metric {} {} seq {}",
+                ip, route.next_hop, route.metric, state, route.seqnum
+            );
+            if route.lqi > 0 {
+                print!(" rssi {} lqi {}", route.rssi, route.lqi);
+            }
+            println!();
+        }
+        _ => println!("no route to {}", ip),
+    }
+}
+
+/// Route sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let ip = value_t!(matches, "IP", Ipv6Addr).unwrap_or_else(|e| e.exit());
+    let interface = value_t!(matches, "interface", String).unwrap_or_else(|e| e.exit());
+    let timeout = value_t!(matches, "timeout", u64).unwrap_or_else(|e| e.exit());
+
+    let scope = crate::client::if_nametoindex(interface.as_str())
+        .map_err(|source| Error::VainaSocket { source })?;
+    let group = Ipv6Addr::from_str(VAINA_MCAST_ADDR).unwrap();
+    let group = SocketAddr::V6(SocketAddrV6::new(group, VAINA_PORT, 0, scope));
+
+    let sock = UdpSocket::bind("[::]:0").map_err(|source| Error::FailedSend { source })?;
+    sock.set_read_timeout(Some(Duration::from_millis(timeout)))
+        .map_err(|source| Error::FailedSend { source })?;
+
+    let seqno = 0;
+    let msg = Message::RouteGet { seqno, ip };
+    sock.send_to(msg.serialize().as_ref(), group).map_err(|source| Error::FailedSend { source })?;
+
+    let mut buf = [0u8; 64];
+    loop {
+        let len = match sock.recv_from(&mut buf) {
+            Ok((len, _)) => len,
+            Err(_) => {
+                println!("No answer from the node");
+                return Ok(());
+            }
+        };
+        match Message::parse(&buf[..len]) {
+            Some(Message::Route { seqno: s, route }) if s == seqno => {
+                print(&ip, &route);
+                return Ok(());
+            }
+            Some(Message::Nack { seqno: s }) if s == seqno => {
+                println!("The node couldn't look up the route");
+                return Ok(());
+            }
+            _ => continue,
+        }
+    }
+}
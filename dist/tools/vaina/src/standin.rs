@@ -0,0 +1,91 @@
+//! Firmware stand-ins: UDP responders that ACK VAINA messages like a radio
+//! would, to exercise the fleet mode on loopback without hardware.
+
+use std::net::{IpAddr, SocketAddr};
+
+use clap::ArgMatches;
+use tokio::net::UdpSocket;
+use tokio::task::JoinSet;
+
+use crate::msg::Message;
+use crate::*;
+
+/// Answer messages on `sock` forever, dropping `loss` percent of them
+async fn serve(sock: UdpSocket, loss: u32, mut seed: u32) {
+    let mut buf = [0u8; 64];
+
+    loop {
+        let (len, remote) = match sock.recv_from(&mut buf).await {
+            Ok(res) => res,
+            Err(_) => continue,
+        };
+
+        // xorshift32, good enough to pick what to drop
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        if seed % 100 < loss {
+            continue;
+        }
+
+        let reply = match Message::parse(&buf[..len]) {
+            Some(Message::RcsAdd { seqno, prefix, .. })
+            | Some(Message::RcsDel { seqno, prefix, .. })
+            | Some(Message::NibAdd { seqno, prefix, .. })
+            | Some(Message::NibDel { seqno, prefix, .. }) => {
+                if prefix > 128 {
+                    Message::Nack { seqno }
+                } else {
+                    Message::Ack { seqno }
+                }
+            }
+            // The firmware ignores what it can't parse
+            _ => continue,
+        };
+
+        let _ = sock.send_to(reply.serialize().as_ref(), remote).await;
+    }
+}
+
+/// Start `count` stand-ins on ephemeral ports of `ip`
+///
+/// Returns their ports, the stand-ins run until the set is dropped.
+pub async fn spawn(
+    ip: IpAddr,
+    count: usize,
+    loss: u32,
+) -> Result<(Vec<u16>, JoinSet<()>), std::io::Error> {
+    let mut ports = Vec::with_capacity(count);
+    let mut tasks = JoinSet::new();
+
+    for i in 0..count {
+        let sock = UdpSocket::bind(SocketAddr::new(ip, 0)).await?;
+        ports.push(sock.local_addr()?.port());
+        tasks.spawn(serve(sock, loss, 0x9e37_79b9 ^ (i as u32 + 1)));
+    }
+
+    Ok((ports, tasks))
+}
+
+/// Stand-in sub command
+pub fn handle_matches(matches: &ArgMatches) -> Result<(), Error> {
+    let ip = value_t!(matches, "ip", IpAddr).unwrap_or_else(|e| e.exit());
+    let count = value_t!(matches, "count", usize).unwrap_or(1);
+    let loss = value_t!(matches, "loss", u32).unwrap_or(0);
+
+    let runtime = tokio::runtime::Runtime::new().map_err(|source| Error::Runtime { source })?;
+    runtime.block_on(async {
+        let (ports, mut tasks) = spawn(ip, count, loss)
+            .await
+            .map_err(|source| Error::StandinBind { source })?;
+        // Fleet config of the stand-ins, to start from
+        for (i, port) in ports.iter().enumerate() {
+            println!("[[device]]");
+            println!("name = \"standin-{}\"", i);
+            println!("address = \"{}\"", SocketAddr::new(ip, *port));
+            println!("rcs = [\"2001:db8::{:x}/128\"]\n", i + 1);
+        }
+        while tasks.join_next().await.is_some() {}
+        Ok(())
+    })
+}
@@ -1,6 +1,9 @@
 #!/bin/sh
 
 SLIPTTY_DIR="$(cd "$(dirname "$0")" && pwd -P)/../../../RIOT/dist/tools/sliptty"
+VAINA_DIR="$(cd "$(dirname "$0")" && pwd -P)"
+# Set BRIDGE=vaina to use `vaina bridge` instead of sliptty
+BRIDGE=${BRIDGE:-sliptty}
 TUN=sl0
 CREATED_IFACE=0
 START_SLIP=1
@@ -36,6 +39,8 @@ create_tun() {
             echo "    ${SUDO} sysctl -w net.ipv6.conf.all.forwarding=0" >&2
             echo "when not desired without this script" >&2
             ${SUDO} sysctl -w net.ipv6.conf.${TUN}.accept_ra=2
+            # Take the mesh host routes the radio advertises (ROUTEADV=1)
+            ${SUDO} sysctl -w net.ipv6.conf.${TUN}.accept_ra_rt_info_max_plen=128
             ${SUDO} ip link set ${TUN} up || exit 1
             ${SUDO} ip address add fe80::1/64 dev ${TUN}
             ${SUDO} ip neigh add fe80::2 dev ${TUN}
@@ -105,4 +110,11 @@ create_tun
 
 START_SLIP=0
 
-[ ${START_SLIP} -eq 0 ] && "${SLIPTTY_DIR}"/sliptty -I "${TUN}" "$@"
+if [ ${START_SLIP} -eq 0 ]; then
+    if [ "${BRIDGE}" = "vaina" ]; then
+        cargo run --release --manifest-path "${VAINA_DIR}"/Cargo.toml -- \
+            bridge -I "${TUN}" --vaina "[::1]:1337" --stats 60 "$@"
+    else
+        "${SLIPTTY_DIR}"/sliptty -I "${TUN}" "$@"
+    fi
+fi
@@ -27,9 +27,33 @@
 #include "shell.h"
 #include "msg.h"
 
+#if IS_USED(MODULE_AIRTIME)
+#include "net/airtime.h"
+#endif
 #include "net/aodvv2.h"
+#if IS_USED(MODULE_DELUGE)
+#include "board.h"
+#include "net/deluge.h"
+#endif
 #include "net/manet.h"
+#include "net/meshconf.h"
+#include "net/nbr.h"
+#if IS_USED(MODULE_ROUTEADV)
+#include "net/routeadv.h"
+#endif
+#if IS_USED(MODULE_DUTYCYCLE)
+#include "net/dutycycle.h"
+#endif
 #include "net/gnrc/ipv6/nib.h"
+#if IS_USED(MODULE_SLIPCREDIT)
+#include "net/slipcredit.h"
+#endif
+#if IS_USED(MODULE_MESHTRACE)
+#include "net/meshtrace.h"
+#endif
+#if IS_USED(MODULE_TIMESYNC)
+#include "net/timesync.h"
+#endif
 #include "net/vaina.h"
 
 #include "shell_extended.h"
@@ -57,6 +81,21 @@ static int _init_slipdev(void);
 #define SLIPDEV_IF    (7)
 /** @} */
 
+/**
+ * @brief   Prefix of the hosts learned as clients on the SLIP interface
+ *
+ * The one `start_network.sh` gives the host side of the SLIP link.
+ *
+ * @{
+ */
+#ifndef SLIPDEV_CLIENT_PREFIX
+#define SLIPDEV_CLIENT_PREFIX     "fc00::"
+#endif
+#ifndef SLIPDEV_CLIENT_PREFIX_LEN
+#define SLIPDEV_CLIENT_PREFIX_LEN (16)
+#endif
+/** @} */
+
 #define MAIN_QUEUE_SIZE     (8)
 static msg_t _main_msg_queue[MAIN_QUEUE_SIZE];
 
@@ -96,6 +135,28 @@ static int _init_ieee802154(void)
      * sort of generic router which peers should connect to. */
     gnrc_ipv6_nib_change_rtr_adv_iface(ieee802154_netif, false);
 
+    /* Track neighbors and apply per neighbor transmit power */
+    if (nbr_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize neighbor table\n");
+        return -1;
+    }
+
+#if IS_USED(MODULE_AIRTIME)
+    /* Attribute the radio airtime to the traffic causing it */
+    if (airtime_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize airtime accounting\n");
+        return -1;
+    }
+#endif
+
+#if IS_USED(MODULE_DUTYCYCLE)
+    /* Sleep the radio while we aren't relaying */
+    if (dutycycle_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize duty cycling\n");
+        return -1;
+    }
+#endif
+
     /* Join LL-MANET-Routers multicast group, this is the IPv6 group where we'll
      * be receiving RFC 5444 UDP packets */
     if (manet_netif_ipv6_group_join(ieee802154_netif) < 0) {
@@ -109,6 +170,36 @@ static int _init_ieee802154(void)
         return -1;
     }
 
+    /* Receive and pass on the mesh-wide configuration */
+    if (meshconf_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize configuration dissemination\n");
+        return -1;
+    }
+
+#if IS_USED(MODULE_MESHTRACE)
+    /* Tell traceroutes how we reach their destination */
+    if (meshtrace_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize mesh traceroute\n");
+        return -1;
+    }
+#endif
+
+#if IS_USED(MODULE_TIMESYNC)
+    /* Keep a mesh-wide time for one-way latency measurements */
+    if (timesync_init(ieee802154_netif) < 0) {
+        printf("Error: Couldn't initialize time synchronization\n");
+        return -1;
+    }
+#endif
+
+#if IS_USED(MODULE_DELUGE) && defined(MTD_0)
+    /* Fetch firmware updates from the neighbors and pass them on */
+    if (deluge_init(ieee802154_netif, MTD_0) < 0) {
+        printf("Error: Couldn't initialize image dissemination\n");
+        return -1;
+    }
+#endif
+
     return 0;
 }
 
@@ -121,7 +212,8 @@ static int _init_slipdev(void)
     }
 
     /* Disable router advertisements on the SLIP interface to not confuse
-     * connected nodes */
+     * connected nodes, routeadv sends its own without becoming their default
+     * router */
     gnrc_ipv6_nib_change_rtr_adv_iface(slipdev_netif, false);
 
     /* Add known fe80::2 local address so a computer/esp32 can know how to
@@ -135,6 +227,34 @@ static int _init_slipdev(void)
         return -1;
     }
 
+#if IS_USED(MODULE_ROUTEADV)
+    /* Tell the host which mesh destinations we have routes to */
+    if (routeadv_init(slipdev_netif) < 0) {
+        printf("Error: Couldn't initialize route advertisement\n");
+        return -1;
+    }
+#endif
+
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+    /* Route for the hosts behind the SLIP link without adding them by hand */
+    ipv6_addr_t pfx;
+    if (ipv6_addr_from_str(&pfx, SLIPDEV_CLIENT_PREFIX) == NULL ||
+        aodvv2_client_learn(slipdev_netif, &pfx,
+                            SLIPDEV_CLIENT_PREFIX_LEN) < 0) {
+        printf("Error: Couldn't learn clients on SLIP\n");
+        return -1;
+    }
+#endif
+
+#if IS_USED(MODULE_SLIPCREDIT)
+    /* Don't take more from the host than the radio forwards */
+    if (slipcredit_init(slipdev_netif,
+                        gnrc_netif_get_by_pid(IEEE802154_IF)) < 0) {
+        printf("Error: Couldn't initialize SLIP flow control\n");
+        return -1;
+    }
+#endif
+
     /* Initialize VAINA config interface */
     if (vaina_init(slipdev_netif) < 0) {
         printf("Error: Couldn't initialize VAINA\n");
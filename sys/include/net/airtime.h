@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_airtime Radio airtime accounting
+ * @ingroup     net
+ * @brief       Radio airtime and energy per traffic class
+ *
+ * Attributes every frame sent or received on the mesh interface to what
+ * caused it, so the cost of the routing protocol can be compared with the
+ * data it carries:
+ *
+ * - AODVv2 control, per message type;
+ * - other control: other RFC 5444 messages (e.g. @ref net_meshconf),
+ *   neighbor discovery and link-local multicast;
+ * - data originated or consumed by the node itself;
+ * - data of the Router Client Set hosts (the VAINA clients behind SLIP);
+ * - data forwarded for other nodes.
+ *
+ * Airtime is derived from the frame length, plus
+ * @ref CONFIG_AIRTIME_FRAME_OVERHEAD bytes of PHY and MAC headers, at
+ * @ref CONFIG_AIRTIME_BITRATE. Energy is airtime times the radio TX or RX
+ * power, @ref CONFIG_AIRTIME_TX_POWER and @ref CONFIG_AIRTIME_RX_POWER. The
+ * `airtime` shell command compares it with the average power the BQ27441
+ * fuel gauge reports, when there's one.
+ *
+ * Frames are read with @ref netif_hook_ipv6_hdr, so 6LoWPAN compressed
+ * frames are classified too. Further fragments of a packet take the class
+ * of its first fragment, if it was one of the last few fragmented packets,
+ * or else are counted as forwarded.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Radio airtime accounting
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_AIRTIME_H
+#define NET_AIRTIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   PHY bit rate of the mesh interface (bit/s)
+ */
+#ifndef CONFIG_AIRTIME_BITRATE
+#define CONFIG_AIRTIME_BITRATE (50000)
+#endif
+
+/**
+ * @brief   PHY and MAC bytes added to every frame
+ *
+ * Preamble, SFD, PHY header, MAC header and FCS.
+ */
+#ifndef CONFIG_AIRTIME_FRAME_OVERHEAD
+#define CONFIG_AIRTIME_FRAME_OVERHEAD (30)
+#endif
+
+/**
+ * @brief   Radio power consumption while sending (mW)
+ */
+#ifndef CONFIG_AIRTIME_TX_POWER
+#define CONFIG_AIRTIME_TX_POWER (80)
+#endif
+
+/**
+ * @brief   Radio power consumption while receiving (mW)
+ */
+#ifndef CONFIG_AIRTIME_RX_POWER
+#define CONFIG_AIRTIME_RX_POWER (30)
+#endif
+
+/**
+ * @brief   Traffic classes
+ */
+typedef enum {
+    AIRTIME_RREQ,       /**< AODVv2 RREQ */
+    AIRTIME_RREP,       /**< AODVv2 RREP */
+    AIRTIME_RERR,       /**< AODVv2 RERR */
+    AIRTIME_RREP_ACK,   /**< AODVv2 RREP_Ack */
+    AIRTIME_CONTROL,    /**< Other control traffic */
+    AIRTIME_LOCAL,      /**< Data from or to the node itself */
+    AIRTIME_CLIENT,     /**< Data from or to a Router Client Set host */
+    AIRTIME_FORWARD,    /**< Data forwarded for other nodes */
+    AIRTIME_CLASS_NUMOF /**< Number of classes */
+} airtime_class_t;
+
+/**
+ * @brief   Counters of one direction of one class
+ */
+typedef struct {
+    uint32_t frames;    /**< Frames */
+    uint32_t bytes;     /**< Bytes, overhead included */
+    uint64_t us;        /**< Airtime (us) */
+} airtime_counter_t;
+
+/**
+ * @brief   Counters
+ */
+typedef struct {
+    airtime_counter_t tx[AIRTIME_CLASS_NUMOF];  /**< Sent, per class */
+    airtime_counter_t rx[AIRTIME_CLASS_NUMOF];  /**< Received, per class */
+    uint64_t elapsed_ms;    /**< Time since the counters were reset */
+} airtime_stats_t;
+
+/**
+ * @brief   Start accounting the frames of @p netif
+ *
+ * Adds a @ref net_netif_hook to @p netif, below @ref net_dutycycle so the
+ * broadcast copies are counted. Only call it once.
+ *
+ * @pre @p netif != NULL
+ *
+ * @return 0 on success.
+ * @return -EALREADY if already initialized.
+ * @return -ENOSPC if @ref netif_hook_add fails.
+ */
+int airtime_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Get a copy of the counters
+ *
+ * @pre @p stats != NULL
+ */
+void airtime_stats(airtime_stats_t *stats);
+
+/**
+ * @brief   Reset the counters
+ */
+void airtime_reset(void);
+
+/**
+ * @brief   Energy (uJ) used by @p counter
+ *
+ * @param[in] counter The counter.
+ * @param[in] tx      true if @p counter counts sent frames.
+ */
+static inline uint64_t airtime_energy_uj(const airtime_counter_t *counter,
+                                         bool tx)
+{
+    /* us * mW = nJ */
+    return counter->us *
+           (tx ? CONFIG_AIRTIME_TX_POWER : CONFIG_AIRTIME_RX_POWER) / 1000;
+}
+
+/**
+ * @brief   Name of @p cls
+ */
+const char *airtime_class_name(airtime_class_t cls);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_AIRTIME_H */
+/** @} */
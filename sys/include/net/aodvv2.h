@@ -15,6 +15,9 @@
  * @file
  * @brief       AODVV2
  *
+ * GNRC binding of the AODVv2 core (see `net/aodvv2/core.h`). All functions on
+ * this header are thread-safe.
+ *
  * @author      Lotte Steenbrink <lotte.steenbrink@fu-berlin.de>
  * @author      Gustavo Grisales <gustavosinbandera1@hotmail.com>
  * @author      Jean Pierre Dudey <jeandudey@hotmail.com>
@@ -24,7 +27,10 @@
 #define NET_AODVV2_AODVV2_H
 
 #include "net/aodvv2/conf.h"
+#include "net/aodvv2/lar.h"
+#include "net/aodvv2/lrs.h"
 #include "net/aodvv2/rfc5444.h"
+#include "net/aodvv2/seqnum.h"
 #include "net/ipv6/addr.h"
 #include "net/gnrc.h"
 
@@ -42,6 +48,64 @@ extern "C" {
  */
 #define AODVV2_MSG_TYPE_SEND_RREP (0x9001)
 
+/**
+ * @brief   IPC message to add a client learned from its traffic
+ */
+#define AODVV2_MSG_TYPE_CLIENT_LEARN (0x9002)
+
+/**
+ * @brief   IPC message to withdraw idle learned clients
+ */
+#define AODVV2_MSG_TYPE_CLIENT_EXPIRE (0x9003)
+
+/**
+ * @brief   IPC message to release the next buffered packet
+ */
+#define AODVV2_MSG_TYPE_BUFFER_PACE (0x9004)
+
+/**
+ * @brief   IPC message to start a route discovery
+ */
+#define AODVV2_MSG_TYPE_FIND_ROUTE (0x9005)
+
+/**
+ * @brief   Time (ms) between two buffered packets released after a route
+ *          discovery
+ *
+ * The RREQ flood and the RREP are still on the air when the route is
+ * found, sending every packet at once collides with them and fills the
+ * queues of the next hops. The first packet goes out right away, the next
+ * ones one at a time with this interval. 0 sends them all at once.
+ */
+#ifndef CONFIG_AODVV2_BUFFER_PACE_MS
+#define CONFIG_AODVV2_BUFFER_PACE_MS (100)
+#endif
+
+/**
+ * @brief   Time (s) without traffic after which a learned client is
+ *          withdrawn
+ */
+#ifndef CONFIG_AODVV2_CLIENT_LEARN_IDLE
+#define CONFIG_AODVV2_CLIENT_LEARN_IDLE (300)
+#endif
+
+/**
+ * @brief   Maximum number of prefixes clients are learned from
+ */
+#ifndef CONFIG_AODVV2_CLIENT_LEARN_PREFIXES
+#define CONFIG_AODVV2_CLIENT_LEARN_PREFIXES (2)
+#endif
+
+/**
+ * @brief   Maximum number of sources of the wired interface waiting for
+ *          the AODVv2 thread
+ *
+ * Sources that don't fit are taken on their next packet.
+ */
+#ifndef CONFIG_AODVV2_CLIENT_LEARN_SEEN
+#define CONFIG_AODVV2_CLIENT_LEARN_SEEN (4)
+#endif
+
 typedef struct {
     aodvv2_message_t pkt; /**< Packet to send */
     ipv6_addr_t next_hop; /**< Next hop */
@@ -84,15 +148,162 @@ int aodvv2_send_rrep(aodvv2_message_t *pkt, ipv6_addr_t *next_hop);
 /**
  * @brief   Initiate a route discovery process to find the given address.
  *
+ * The RREQ is built and sent by the AODVv2 thread, this doesn't wait for
+ * it, so it can be called with the NIB locked.
+ *
  * @pre @p target_addr != NULL && @p orig_addr != NULL
  *
+ * @param[in] orig_addr   Source of the packet that needs a route.
  * @param[in] target_addr The IP address where we want a route to.
  *
- * @return Negative number on failure, otherwise succeed.
+ * @return 0 on success.
+ * @return -ENOMEM no memory for the request.
+ * @return -ENOBUFS the AODVv2 thread queue is full.
  */
 int aodvv2_find_route(const ipv6_addr_t *orig_addr,
                       const ipv6_addr_t *target_addr);
 
+/**
+ * @brief   Add a client to the Router Client Set
+ *
+ * The client is announced to the mesh, see
+ * @ref aodvv2_core_client_announce.
+ *
+ * @pre @p addr != NULL
+ *
+ * @param[in] addr    Client address.
+ * @param[in] pfx_len Client prefix length.
+ * @param[in] cost    Cost of reaching the client.
+ *
+ * @return 0 on success.
+ * @return -ENOSPC the Router Client Set is full.
+ */
+int aodvv2_client_add(const ipv6_addr_t *addr, uint8_t pfx_len, uint8_t cost);
+
+/**
+ * @brief   Delete a client from the Router Client Set
+ *
+ * The client is withdrawn from the mesh with a RERR, see
+ * @ref aodvv2_core_client_withdraw.
+ *
+ * @pre @p addr != NULL
+ *
+ * @param[in] addr    Client address.
+ * @param[in] pfx_len Client prefix length.
+ */
+void aodvv2_client_del(const ipv6_addr_t *addr, uint8_t pfx_len);
+
+/**
+ * @brief   Learn clients from the traffic of @p netif
+ *
+ * Hosts sending packets on @p netif (e.g. the SLIP interface) from an
+ * address in @p pfx are added to the Router Client Set, with a /128 prefix,
+ * and announced like with @ref aodvv2_client_add. They are withdrawn after
+ * @ref CONFIG_AODVV2_CLIENT_LEARN_IDLE seconds without a packet.
+ *
+ * A @ref net_netif_hook on @p netif notes the sources, the AODVv2 thread
+ * adds and refreshes the clients, so the first packets of a new client may
+ * find it isn't a client yet and be dropped. Clients added with
+ * @ref aodvv2_client_add aren't affected.
+ *
+ * Only available with the `aodvv2_client_learn` module.
+ *
+ * @pre (@p netif != NULL) && (@p pfx != NULL)
+ *
+ * @param[in] netif   Interface the clients are connected to, the same on
+ *                    every call.
+ * @param[in] pfx     Prefix of the client addresses.
+ * @param[in] pfx_len Prefix length.
+ *
+ * @return 0 on success.
+ * @return -ENOTCONN if @ref aodvv2_init wasn't called.
+ * @return -EINVAL if @p netif isn't the interface of a previous call.
+ * @return -ENOSPC if there are already
+ *         @ref CONFIG_AODVV2_CLIENT_LEARN_PREFIXES prefixes, or
+ *         @ref netif_hook_add fails.
+ */
+int aodvv2_client_learn(gnrc_netif_t *netif, const ipv6_addr_t *pfx,
+                        uint8_t pfx_len);
+
+/**
+ * @brief   Is @p addr a client of this router?
+ *
+ * Looks at a copy of the Router Client Set, updated on every change, so it
+ * doesn't wait for the AODVv2 thread and can be called on the send and
+ * receive paths of the interfaces.
+ *
+ * @pre @p addr != NULL
+ *
+ * @param[in] addr Address.
+ *
+ * @return true if @p addr is covered by a Router Client Set entry.
+ */
+bool aodvv2_client_is(const ipv6_addr_t *addr);
+
+/**
+ * @brief   Get a copy of the Local Route Set entry towards @p dst
+ *
+ * @pre (@p dst != NULL) && (@p route != NULL)
+ *
+ * @param[in]  dst   Destination address.
+ * @param[out] route The route.
+ *
+ * @return 0 on success.
+ * @return -ENOENT if there's no route to @p dst.
+ */
+int aodvv2_route_get(const ipv6_addr_t *dst, aodvv2_local_route_t *route);
+
+/**
+ * @brief   Get the route replacement counters of the Local Route Set
+ *
+ * @pre @p stats != NULL
+ *
+ * @param[out] stats The counters.
+ */
+void aodvv2_route_stats(aodvv2_lrs_stats_t *stats);
+
+/**
+ * @brief   Set the position of this router
+ *
+ * Restricts the RREQ floods to the routers between the OrigNode and TargNode
+ * routers, see `net/aodvv2/lar.h`. Only available with the `aodvv2_lar`
+ * module.
+ *
+ * @param[in] pos The position, NULL if unknown.
+ */
+void aodvv2_position_set(const aodvv2_position_t *pos);
+
+/**
+ * @brief   Get the position of this router
+ *
+ * Only available with the `aodvv2_lar` module.
+ *
+ * @pre @p pos != NULL
+ *
+ * @param[out] pos The position.
+ *
+ * @return 0 on success.
+ * @return -ENOENT if the position isn't known.
+ */
+int aodvv2_position_get(aodvv2_position_t *pos);
+
+/**
+ * @brief   Print the Router Client Set entries
+ */
+void aodvv2_client_print(void);
+
+/**
+ * @brief   Get the current router SeqNum
+ */
+aodvv2_seqnum_t aodvv2_seqnum_current(void);
+
+/**
+ * @brief   Increment the router SeqNum
+ *
+ * @return The new SeqNum.
+ */
+aodvv2_seqnum_t aodvv2_seqnum_next(void);
+
 /**
  * @brief   Initialize the AODVv2 packer buffering code.
  */
@@ -111,12 +322,23 @@ int aodvv2_buffer_pkt_add(const ipv6_addr_t *dst, gnrc_pktsnip_t *pkt);
 /**
  * @brief   Dispatch buffered packets to `targ_addr`
  *
- * @notes Only call this when a route to `targ_addr` is on the NIB
+ * Packets are released in the order they were buffered, paced by
+ * @ref CONFIG_AODVV2_BUFFER_PACE_MS.
+ *
+ * @notes Only call this when a route to `targ_addr` is on the NIB, from the
+ *        AODVv2 thread
  *
  * @param[in] targ_addr Target address to dispatch packets.
  */
 void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr);
 
+/**
+ * @brief   Release the next dispatched packet
+ *
+ * Called by the AODVv2 thread on @ref AODVV2_MSG_TYPE_BUFFER_PACE.
+ */
+void aodvv2_buffer_pace(void);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
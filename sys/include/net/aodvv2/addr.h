@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       Word-wise IPv6 address helpers
+ *
+ * The Router Client Set, Multicast Message Set and Local Route Set compare
+ * addresses several times per received message. `ipv6_addr_match_prefix`
+ * walks the addresses byte by byte and then bit by bit, and isn't inlined.
+ * These helpers work on the four 32-bit words of an @ref ipv6_addr_t, which
+ * is always word aligned, and find the first differing bit with a single
+ * CLZ instruction on Cortex-M3 and up.
+ *
+ * `tests/test_aodvv2_addr` checks them against the RIOT functions and
+ * measures both.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_AODVV2_ADDR_H
+#define NET_AODVV2_ADDR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "byteorder.h"
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of 32-bit words of an IPv6 address
+ */
+#define AODVV2_ADDR_WORDS   (4)
+
+/**
+ * @brief   Are @p a and @p b the same address?
+ *
+ * Same result as `ipv6_addr_equal`, without branches.
+ *
+ * @pre (@p a != NULL) && (@p b != NULL)
+ */
+static inline bool aodvv2_addr_equal(const ipv6_addr_t *a,
+                                     const ipv6_addr_t *b)
+{
+    return ((a->u32[0].u32 ^ b->u32[0].u32) |
+            (a->u32[1].u32 ^ b->u32[1].u32) |
+            (a->u32[2].u32 ^ b->u32[2].u32) |
+            (a->u32[3].u32 ^ b->u32[3].u32)) == 0;
+}
+
+/**
+ * @brief   Is @p addr the unspecified address (`::`)?
+ *
+ * @pre @p addr != NULL
+ */
+static inline bool aodvv2_addr_is_unspecified(const ipv6_addr_t *addr)
+{
+    return (addr->u32[0].u32 | addr->u32[1].u32 |
+            addr->u32[2].u32 | addr->u32[3].u32) == 0;
+}
+
+/**
+ * @brief   Number of leading bits @p a and @p b have in common
+ *
+ * Same result as `ipv6_addr_match_prefix`.
+ *
+ * @pre (@p a != NULL) && (@p b != NULL)
+ *
+ * @return 0 to 128.
+ */
+static inline uint8_t aodvv2_addr_match_prefix(const ipv6_addr_t *a,
+                                               const ipv6_addr_t *b)
+{
+    for (unsigned i = 0; i < AODVV2_ADDR_WORDS; i++) {
+        uint32_t diff = a->u32[i].u32 ^ b->u32[i].u32;
+
+        if (diff != 0) {
+            return (i * 32) + __builtin_clz(ntohl(diff));
+        }
+    }
+
+    return 128;
+}
+
+/**
+ * @brief   Is @p addr inside @p pfx / @p pfx_len?
+ *
+ * @pre (@p pfx != NULL) && (@p addr != NULL)
+ */
+static inline bool aodvv2_addr_in_prefix(const ipv6_addr_t *pfx,
+                                         uint8_t pfx_len,
+                                         const ipv6_addr_t *addr)
+{
+    return aodvv2_addr_match_prefix(pfx, addr) >= pfx_len;
+}
+
+/**
+ * @brief   Copy the first @p pfx_len bits of @p pfx to @p out, and clear
+ *          the rest
+ *
+ * Unlike `ipv6_addr_init_prefix`, the bits of @p out after the prefix are
+ * always zero, so prefixes stored this way compare with
+ * @ref aodvv2_addr_equal.
+ *
+ * @pre (@p out != NULL) && (@p pfx != NULL)
+ *
+ * @param[out] out     The prefix.
+ * @param[in]  pfx     Address to take the prefix from.
+ * @param[in]  pfx_len Prefix length, values above 128 are taken as 128.
+ */
+static inline void aodvv2_addr_init_prefix(ipv6_addr_t *out,
+                                           const ipv6_addr_t *pfx,
+                                           uint8_t pfx_len)
+{
+    unsigned bits = (pfx_len > 128) ? 128 : pfx_len;
+
+    for (unsigned i = 0; i < AODVV2_ADDR_WORDS; i++) {
+        uint32_t mask;
+
+        if (bits >= 32) {
+            mask = UINT32_MAX;
+            bits -= 32;
+        }
+        else {
+            mask = (bits == 0) ? 0 : htonl(UINT32_MAX << (32 - bits));
+            bits = 0;
+        }
+
+        out->u32[i].u32 = pfx->u32[i].u32 & mask;
+    }
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_AODVV2_ADDR_H */
+/** @} */
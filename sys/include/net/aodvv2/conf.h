@@ -45,6 +45,16 @@
 #define CONFIG_AODVV2_RERR_TIMEOUT (3)
 #endif
 
+/**
+ * @brief   Hop limit of client announcements and RERRs
+ *
+ * Bounds the flood that moves a client from one router to another, see
+ * @ref aodvv2_core_client_announce.
+ */
+#ifndef CONFIG_AODVV2_HANDOVER_HOP_LIMIT
+#define CONFIG_AODVV2_HANDOVER_HOP_LIMIT (16)
+#endif
+
 #ifndef CONFIG_AODVV2_RTEMSG_ENTRY_TIME
 #define CONFIG_AODVV2_RTEMSG_ENTRY_TIME (12)
 #endif
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       Platform independent AODVv2 protocol core
+ *
+ * The core holds all the protocol state (Local Route Set, Router Client Set,
+ * Multicast Message Set, SeqNum and the RFC 5444 reader/writer contexts) of a
+ * single AODVv2 router. It doesn't talk to any network stack or timer API
+ * directly, instead everything that depends on the platform is done through
+ * an @ref aodvv2_ops_t table provided on initialization. This allows to drive
+ * the protocol from GNRC (see `net/aodvv2.h`), from unit tests or from a host
+ * simulator.
+ *
+ * The core isn't thread-safe, the caller is responsible for serializing all
+ * calls made on the same @ref aodvv2_core_t.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_AODVV2_CORE_H
+#define NET_AODVV2_CORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kernel_defines.h"
+#include "net/aodvv2/conf.h"
+#include "net/aodvv2/lar.h"
+#include "net/aodvv2/lrs.h"
+#include "net/aodvv2/mcmsg.h"
+#include "net/aodvv2/rcs.h"
+#include "net/aodvv2/rfc5444.h"
+#include "net/aodvv2/seqnum.h"
+#include "net/ipv6/addr.h"
+
+#include "timex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Lifetime in seconds of the routes installed on the FIB
+ */
+#define AODVV2_ROUTE_LIFETIME \
+    (CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME)
+
+/**
+ * @brief   Platform operations used by the AODVv2 core
+ *
+ * All operations receive the `ctx` pointer given to @ref aodvv2_core_init.
+ */
+typedef struct {
+    /**
+     * @brief   Get the current time
+     *
+     * @param[in]  ctx Platform context.
+     * @param[out] now Current time.
+     */
+    void (*now)(void *ctx, timex_t *now);
+
+    /**
+     * @brief   Send a RFC 5444 packet to the MANET UDP port of @p dst
+     *
+     * @param[in] ctx Platform context.
+     * @param[in] dst Destination address (unicast or multicast).
+     * @param[in] buf Packet data, only valid during the call.
+     * @param[in] len Packet length.
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*send)(void *ctx, const ipv6_addr_t *dst, const void *buf,
+                size_t len);
+
+    /**
+     * @brief   Add a route to the Forwarding Information Base
+     *
+     * @param[in] ctx      Platform context.
+     * @param[in] dst      Route destination.
+     * @param[in] pfx_len  Destination prefix length.
+     * @param[in] next_hop Next hop.
+     * @param[in] lifetime Lifetime of the route in seconds.
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*fib_add)(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len,
+                   const ipv6_addr_t *next_hop, uint32_t lifetime);
+
+    /**
+     * @brief   Delete a route from the Forwarding Information Base
+     *
+     * @param[in] ctx     Platform context.
+     * @param[in] dst     Route destination.
+     * @param[in] pfx_len Destination prefix length.
+     */
+    void (*fib_del)(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len);
+
+    /**
+     * @brief   A route discovery originated by this router completed
+     *
+     * This is the point where packets waiting for a route to @p targ_addr
+     * can be sent.
+     *
+     * @param[in] ctx       Platform context.
+     * @param[in] targ_addr TargNode address.
+     */
+    void (*route_found)(void *ctx, const ipv6_addr_t *targ_addr);
+
+    /**
+     * @brief   Keep the radio on for at least @p ms milliseconds
+     *
+     * Optional, used by duty cycled platforms. Routers taking part in a route
+     * discovery stay awake for RREQ_WAIT_TIME, routers that sent, forwarded
+     * or received a RREP (they're on a route) for as long as the route stays
+     * valid, @ref AODVV2_ROUTE_LIFETIME.
+     *
+     * @param[in] ctx Platform context.
+     * @param[in] ms  Time to stay awake, from now.
+     */
+    void (*stay_awake)(void *ctx, uint32_t ms);
+} aodvv2_ops_t;
+
+/**
+ * @brief   AODVv2 router instance
+ */
+typedef struct aodvv2_core {
+    const aodvv2_ops_t *ops;   /**< Platform operations */
+    void *ctx;                 /**< Platform context */
+    aodvv2_seqnum_t seqnum;    /**< Router SeqNum */
+    ipv6_addr_t addr;          /**< Router address, SeqNoRtr of the client
+                                    announcements */
+    aodvv2_lrs_t lrs;          /**< Local Route Set */
+    aodvv2_rcs_t rcs;          /**< Router Client Set */
+    aodvv2_mcmsg_set_t mcmsg;  /**< Multicast Message Set */
+    aodvv2_reader_t reader;    /**< RFC5444 reader */
+    aodvv2_writer_t writer;    /**< RFC5444 writer */
+#if IS_USED(MODULE_AODVV2_LAR)
+    aodvv2_lar_t lar;          /**< Location-aided flooding state */
+#endif
+} aodvv2_core_t;
+
+/**
+ * @brief   Initialize an AODVv2 router instance
+ *
+ * @pre (@p core != NULL) && (@p ops != NULL)
+ *
+ * @param[out] core The instance.
+ * @param[in]  ops  Platform operations.
+ * @param[in]  ctx  Platform context passed to every operation.
+ */
+void aodvv2_core_init(aodvv2_core_t *core, const aodvv2_ops_t *ops, void *ctx);
+
+/**
+ * @brief   Get the current time from the platform
+ *
+ * @param[in]  core The instance.
+ * @param[out] now  Current time.
+ */
+static inline void aodvv2_core_now(aodvv2_core_t *core, timex_t *now)
+{
+    core->ops->now(core->ctx, now);
+}
+
+/**
+ * @brief   Ask the platform to keep the radio on
+ *
+ * @param[in] core    The instance.
+ * @param[in] seconds Time to stay awake, from now.
+ */
+static inline void aodvv2_core_stay_awake(aodvv2_core_t *core,
+                                          uint32_t seconds)
+{
+    if (core->ops->stay_awake != NULL) {
+        core->ops->stay_awake(core->ctx, seconds * MS_PER_SEC);
+    }
+}
+
+/**
+ * @brief   Handle a received RFC 5444 packet
+ *
+ * @pre (@p core != NULL) && (@p sender != NULL) && (@p buf != NULL)
+ *
+ * @param[in] core   The instance.
+ * @param[in] sender IPv6 address of the neighbor that sent the packet.
+ * @param[in] buf    Packet data.
+ * @param[in] len    Packet length.
+ *
+ * @return 0 on success, negative errno if the packet couldn't be handled.
+ */
+int aodvv2_core_handle_packet(aodvv2_core_t *core, const ipv6_addr_t *sender,
+                              const uint8_t *buf, size_t len);
+
+/**
+ * @brief   Write and send a RREQ
+ *
+ * @pre (@p core != NULL) && (@p msg != NULL) && (@p next_hop != NULL)
+ *
+ * @param[in] core     The instance.
+ * @param[in] msg      RREQ data.
+ * @param[in] next_hop Where to send the RREQ.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_send_rreq(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *next_hop);
+
+/**
+ * @brief   Write and send a RREP
+ *
+ * @pre (@p core != NULL) && (@p msg != NULL) && (@p next_hop != NULL)
+ *
+ * @param[in] core     The instance.
+ * @param[in] msg      RREP data.
+ * @param[in] next_hop Where to send the RREP.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_send_rrep(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *next_hop);
+
+/**
+ * @brief   Write and send a client announcement to the LL-MANET-Routers group
+ *
+ * A client announcement is a RREP without OrigNode, @p msg carries the
+ * client as TargNode. A zero TargNode SeqNum is replaced by ours.
+ *
+ * @pre (@p core != NULL) && (@p msg != NULL)
+ *
+ * @param[in] core The instance.
+ * @param[in] msg  Announcement data.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_send_announcement(aodvv2_core_t *core, aodvv2_message_t *msg);
+
+/**
+ * @brief   Write and send a RERR to the LL-MANET-Routers group
+ *
+ * @pre (@p core != NULL) && (@p msg != NULL)
+ *
+ * @param[in] core The instance.
+ * @param[in] msg  RERR data, the unreachable address is the TargNode.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_send_rerr(aodvv2_core_t *core, aodvv2_message_t *msg);
+
+/**
+ * @brief   Set the address of this router
+ *
+ * @pre (@p core != NULL) && (@p addr != NULL)
+ *
+ * @param[in] core The instance.
+ * @param[in] addr Link-local address the router sends from.
+ */
+void aodvv2_core_set_addr(aodvv2_core_t *core, const ipv6_addr_t *addr);
+
+/**
+ * @brief   Announce a client that just attached to this router
+ *
+ * Floods, at most @ref CONFIG_AODVV2_HANDOVER_HOP_LIMIT hops, a RREP for
+ * the client with a fresh SeqNum and no OrigNode. Routers that hear it
+ * replace the route they have to the client, which may still point to the
+ * router the client came from, so traffic follows a moving client right
+ * away instead of after the route expires.
+ *
+ * The announcement carries the router address set with
+ * @ref aodvv2_core_set_addr as its SeqNoRtr, routers order the announcements
+ * of the same router by SeqNum.
+ *
+ * @pre (@p core != NULL) && (@p addr != NULL)
+ *
+ * @param[in] core    The instance.
+ * @param[in] addr    Client address.
+ * @param[in] pfx_len Client prefix length.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_client_announce(aodvv2_core_t *core, const ipv6_addr_t *addr,
+                                uint8_t pfx_len);
+
+/**
+ * @brief   Withdraw a client that left this router
+ *
+ * Floods, at most @ref CONFIG_AODVV2_HANDOVER_HOP_LIMIT hops, a RERR for
+ * the client. Routers remove their route to it only if it goes through the
+ * router the RERR came from, and only then pass it on, so the RERR follows
+ * the routes towards this router and leaves alone the ones already moved
+ * to the new router of the client.
+ *
+ * @pre (@p core != NULL) && (@p addr != NULL)
+ *
+ * @param[in] core    The instance.
+ * @param[in] addr    Client address.
+ * @param[in] pfx_len Client prefix length.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_client_withdraw(aodvv2_core_t *core, const ipv6_addr_t *addr,
+                                uint8_t pfx_len);
+
+/**
+ * @brief   Prepare a RREQ to start a route discovery
+ *
+ * Fills @p msg with the OrigNode information of the client @p orig_addr
+ * belongs to, increments the SeqNum and records the RREQ on the Multicast
+ * Message Set. With `aodvv2_lar`, our position and the last known one of
+ * the TargNode router are added when known.
+ *
+ * @pre (@p core != NULL) && (@p msg != NULL) && (@p orig_addr != NULL) &&
+ *      (@p target_addr != NULL)
+ *
+ * @param[in]  core        The instance.
+ * @param[out] msg         The RREQ.
+ * @param[in]  orig_addr   Source of the packet that needs a route.
+ * @param[in]  target_addr Address we want a route to.
+ *
+ * @return 0 on success.
+ * @return -EINVAL @p orig_addr isn't a client of this router.
+ */
+int aodvv2_core_rreq_init(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *orig_addr,
+                          const ipv6_addr_t *target_addr);
+
+/**
+ * @brief   Start a route discovery
+ *
+ * Same as @ref aodvv2_core_rreq_init, followed by sending the RREQ to the
+ * LL-MANET-Routers group.
+ *
+ * @pre (@p core != NULL) && (@p orig_addr != NULL) && (@p target_addr != NULL)
+ *
+ * @param[in] core        The instance.
+ * @param[in] orig_addr   Source of the packet that needs a route.
+ * @param[in] target_addr Address we want a route to.
+ *
+ * @return 0 on success, negative errno on failure.
+ */
+int aodvv2_core_find_route(aodvv2_core_t *core, const ipv6_addr_t *orig_addr,
+                           const ipv6_addr_t *target_addr);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_AODVV2_CORE_H */
+/** @} */
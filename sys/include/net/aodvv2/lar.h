@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       Location-aided RREQ flooding
+ *
+ * In the spirit of LAR (Ko and Vaidya, MobiCom 1998), with the `aodvv2_lar`
+ * module:
+ *
+ * - A router that knows its position (e.g. a fixed installation, set once
+ *   from the host) adds it to the RREQs it originates, and to the RREPs it
+ *   sends as TargNode router. It also adds the last known position of the
+ *   TargNode, if any.
+ * - Routers learn the positions of OrigNodes from RREQs and of TargNodes
+ *   from RREPs.
+ * - A RREQ with both positions is only forwarded by routers inside the
+ *   request zone: the rectangle with the OrigNode and TargNode routers on
+ *   opposite corners, grown by @ref CONFIG_AODVV2_LAR_MARGIN on every side.
+ *   The RREQ is still processed, only the rebroadcast is suppressed.
+ * - A position limits one RREQ only. If no RREP brings the position back,
+ *   e.g. the TargNode router moved out of the zone, or the routers in it
+ *   don't connect, the next RREQ for the TargNode floods.
+ *
+ * RREQs without positions, and routers that don't know their own position,
+ * flood as usual. So does a router without the module, which also strips
+ * the positions from the RREQs it forwards.
+ *
+ * Positions are planar coordinates in metres on a grid shared by the
+ * deployment, e.g. UTM easting and northing, so the zone check needs no
+ * trigonometry.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_AODVV2_LAR_H
+#define NET_AODVV2_LAR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/ipv6/addr.h"
+#include "timex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Known positions of other routers' clients
+ */
+#ifndef CONFIG_AODVV2_LAR_ENTRIES
+#define CONFIG_AODVV2_LAR_ENTRIES (8)
+#endif
+
+/**
+ * @brief   Distance (m) the request zone is grown by on every side
+ *
+ * Should be about the radio range, so the routers next to the straight line
+ * between the OrigNode and TargNode routers find a path around obstacles.
+ */
+#ifndef CONFIG_AODVV2_LAR_MARGIN
+#define CONFIG_AODVV2_LAR_MARGIN (1000)
+#endif
+
+/**
+ * @brief   Time (s) after which a learned position isn't used anymore
+ */
+#ifndef CONFIG_AODVV2_LAR_MAX_AGE
+#define CONFIG_AODVV2_LAR_MAX_AGE (3600)
+#endif
+
+/**
+ * @brief   Encoded size of a position, big endian x and y
+ */
+#define AODVV2_LAR_POSITION_LEN (8)
+
+/**
+ * @brief   A router position
+ */
+typedef struct {
+    int32_t x;  /**< Easting (m) */
+    int32_t y;  /**< Northing (m) */
+} aodvv2_position_t;
+
+/**
+ * @brief   Position of a client of another router
+ */
+typedef struct {
+    ipv6_addr_t addr;       /**< Client address */
+    uint8_t pfx_len;        /**< Client prefix length, 0 if unused */
+    aodvv2_position_t pos;  /**< Position of its router */
+    timex_t updated;        /**< When the position was learned */
+    bool limited;           /**< Has a RREQ been limited to its zone since? */
+} aodvv2_lar_entry_t;
+
+/**
+ * @brief   Location-aided flooding state of a router
+ */
+typedef struct {
+    aodvv2_position_t pos;  /**< Our position */
+    bool has_pos;           /**< Is @ref aodvv2_lar_t::pos known? */
+    aodvv2_lar_entry_t entries[CONFIG_AODVV2_LAR_ENTRIES]; /**< Learned */
+} aodvv2_lar_t;
+
+/**
+ * @brief   Initialize the state, no position is known
+ *
+ * @pre @p lar != NULL
+ */
+void aodvv2_lar_init(aodvv2_lar_t *lar);
+
+/**
+ * @brief   Set our position
+ *
+ * @pre @p lar != NULL
+ *
+ * @param[in] lar The state.
+ * @param[in] pos Our position, NULL if unknown.
+ */
+void aodvv2_lar_set_position(aodvv2_lar_t *lar, const aodvv2_position_t *pos);
+
+/**
+ * @brief   Learn the position of the router serving @p addr
+ *
+ * Replaces the entry of @p addr, or else the oldest one.
+ *
+ * @pre (@p lar != NULL) && (@p addr != NULL) && (@p pos != NULL) &&
+ *      (@p now != NULL)
+ *
+ * @param[in] lar     The state.
+ * @param[in] addr    Client address.
+ * @param[in] pfx_len Client prefix length.
+ * @param[in] pos     Position of its router.
+ * @param[in] now     Current time.
+ */
+void aodvv2_lar_learn(aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                      uint8_t pfx_len, const aodvv2_position_t *pos,
+                      const timex_t *now);
+
+/**
+ * @brief   Get the last known position of the router serving @p addr
+ *
+ * @pre (@p lar != NULL) && (@p addr != NULL) && (@p now != NULL) &&
+ *      (@p pos != NULL)
+ *
+ * @param[in]  lar  The state.
+ * @param[in]  addr Client address.
+ * @param[in]  now  Current time.
+ * @param[out] pos  The position.
+ *
+ * @return true if a position newer than @ref CONFIG_AODVV2_LAR_MAX_AGE is
+ *         known.
+ */
+bool aodvv2_lar_lookup(const aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                       const timex_t *now, aodvv2_position_t *pos);
+
+/**
+ * @brief   Get the position to limit a RREQ towards @p addr with
+ *
+ * Same as @ref aodvv2_lar_lookup, but a position is only returned once
+ * after it's learned, so the RREQ sent after a limited one floods.
+ *
+ * @pre (@p lar != NULL) && (@p addr != NULL) && (@p now != NULL) &&
+ *      (@p pos != NULL)
+ *
+ * @param[in]  lar  The state.
+ * @param[in]  addr TargNode address.
+ * @param[in]  now  Current time.
+ * @param[out] pos  The position.
+ *
+ * @return true if the RREQ should carry @p pos.
+ */
+bool aodvv2_lar_rreq_target(aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                            const timex_t *now, aodvv2_position_t *pos);
+
+/**
+ * @brief   Should a RREQ between @p orig and @p targ be forwarded by us?
+ *
+ * @pre (@p lar != NULL) && (@p orig != NULL) && (@p targ != NULL)
+ *
+ * @param[in] lar  The state.
+ * @param[in] orig OrigNode router position.
+ * @param[in] targ TargNode router position.
+ *
+ * @return true if we're inside the request zone, or don't know where we
+ *         are.
+ */
+bool aodvv2_lar_in_zone(const aodvv2_lar_t *lar, const aodvv2_position_t *orig,
+                        const aodvv2_position_t *targ);
+
+/**
+ * @brief   Encode a position
+ *
+ * @param[out] buf @ref AODVV2_LAR_POSITION_LEN bytes.
+ * @param[in]  pos The position.
+ */
+static inline void aodvv2_lar_position_write(uint8_t *buf,
+                                             const aodvv2_position_t *pos)
+{
+    uint32_t x = (uint32_t)pos->x;
+    uint32_t y = (uint32_t)pos->y;
+
+    buf[0] = x >> 24;
+    buf[1] = x >> 16;
+    buf[2] = x >> 8;
+    buf[3] = x;
+    buf[4] = y >> 24;
+    buf[5] = y >> 16;
+    buf[6] = y >> 8;
+    buf[7] = y;
+}
+
+/**
+ * @brief   Decode a position
+ *
+ * @param[in]  buf @ref AODVV2_LAR_POSITION_LEN bytes.
+ * @param[out] pos The position.
+ */
+static inline void aodvv2_lar_position_read(const uint8_t *buf,
+                                            aodvv2_position_t *pos)
+{
+    pos->x = (int32_t)(((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+                       ((uint32_t)buf[2] << 8) | buf[3]);
+    pos->y = (int32_t)(((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) |
+                       ((uint32_t)buf[6] << 8) | buf[7]);
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_AODVV2_LAR_H */
+/** @} */
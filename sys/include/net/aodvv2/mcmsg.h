@@ -23,6 +23,8 @@
 #ifndef NET_AODVV2_MCMSG_H
 #define NET_AODVV2_MCMSG_H
 
+#include <stdbool.h>
+
 #include "net/metric.h"
 #include "net/aodvv2/seqnum.h"
 #include "net/aodvv2/rfc5444.h"
@@ -62,20 +64,44 @@ enum {
     AODVV2_MCMSG_OK = 0           /**< McMsg is new (ok) */
 };
 
+/**
+ * @brief   Multicast Message Set entry storage
+ */
+typedef struct {
+    aodvv2_mcmsg_t data; /**< McMsg data */
+    bool used;           /**< Is this entry used? */
+} aodvv2_mcmsg_entry_t;
+
+/**
+ * @brief   Multicast Message Set
+ */
+typedef struct {
+    aodvv2_mcmsg_entry_t entries[CONFIG_AODVV2_MCMSG_MAX_ENTRIES]; /**< Entries */
+} aodvv2_mcmsg_set_t;
+
 /**
  * @brief   Initialize RREQ table.
+ *
+ * @pre @p set != NULL
+ *
+ * @param[out] set The Multicast Message Set.
  */
-void aodvv2_mcmsg_init(void);
+void aodvv2_mcmsg_init(aodvv2_mcmsg_set_t *set);
 
 /**
  * @brief   Process an RREQ
  *
+ * @pre (@p set != NULL) && (@p msg != NULL) && (@p now != NULL)
+ *
+ * @param[in] set The Multicast Message Set.
  * @param[in] msg RREQ message
+ * @param[in] now Current time.
  *
  * @return AODVV2_MCMSG_OK processing went fine.
  * @return AODVV2_MCMSG_REDUNDANT message is redundant.
  */
-int aodvv2_mcmsg_process(aodvv2_message_t *msg);
+int aodvv2_mcmsg_process(aodvv2_mcmsg_set_t *set, aodvv2_message_t *msg,
+                         const timex_t *now);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -23,6 +23,8 @@
 #ifndef AODVV2_RCS_H
 #define AODVV2_RCS_H
 
+#include <stdbool.h>
+
 #include "net/ipv6/addr.h"
 
 #ifdef __cplusplus
@@ -67,16 +69,36 @@ typedef struct {
     uint8_t cost;
 } aodvv2_rcs_entry_t;
 
+/**
+ * @brief   Router Client Set entry storage
+ */
+typedef struct {
+    aodvv2_rcs_entry_t data; /**< Client data */
+    bool used;               /**< Is this entry used? */
+} aodvv2_rcs_slot_t;
+
+/**
+ * @brief   Router Client Set
+ */
+typedef struct {
+    aodvv2_rcs_slot_t entries[CONFIG_AODVV2_RCS_ENTRIES]; /**< Entries */
+} aodvv2_rcs_t;
+
 /**
  * @brief   Initialize Router Client Set
+ *
+ * @pre @p rcs != NULL
+ *
+ * @param[out] rcs The Router Client Set.
  */
-void aodvv2_rcs_init(void);
+void aodvv2_rcs_init(aodvv2_rcs_t *rcs);
 
 /**
  * @brief   Add a client to the Router Client Set.
  *
- * @pre @p addr != NULL
+ * @pre (@p rcs != NULL) && (@p addr != NULL)
  *
+ * @param[in] rcs           The Router Client Set.
  * @param[in] addr          Client IP address.
  * @param[in] prefix_length Length of the routing prefix associated with the
  * address.
@@ -85,51 +107,56 @@ void aodvv2_rcs_init(void);
  * @return NULL The Set is full.
  * @return aodvv2_rcs_entry_t * Pointer to the entry in the client set.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_add(const ipv6_addr_t *addr,
-                                   const uint8_t prefix_length,
-                                   const uint8_t cost);
+aodvv2_rcs_entry_t *aodvv2_rcs_add(aodvv2_rcs_t *rcs, const ipv6_addr_t *addr,
+                                   uint8_t prefix_length, uint8_t cost);
 
 /**
  * @brief   Delete a client from the Router Client Set
  *
- * @pre @p addr != NULL
+ * @pre (@p rcs != NULL) && (@p addr != NULL)
  *
+ * @param[in] rcs     The Router Client Set.
  * @param[in] addr    IPv6 address of the client to remove.
  * @param[in] pfx_len `addr` prefix length.
  */
-void aodvv2_rcs_del(const ipv6_addr_t *addr, uint8_t pfx_len);
+void aodvv2_rcs_del(aodvv2_rcs_t *rcs, const ipv6_addr_t *addr,
+                    uint8_t pfx_len);
 
 /**
  * @brief   Find a client in the set.
  *
- * @pre @p addr != NULL
+ * @pre (@p rcs != NULL) && (@p addr != NULL)
  *
+ * @param[in] rcs     The Router Client Set.
  * @param[in] addr    The client address to be found.
  * @param[in] pfx_len `addr` prefix length.
  *
  * @return Pointer to entry if found.
  * @return NULL Not found.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_matches(const ipv6_addr_t *addr,
+aodvv2_rcs_entry_t *aodvv2_rcs_matches(aodvv2_rcs_t *rcs,
+                                       const ipv6_addr_t *addr,
                                        uint8_t pfx_len);
 
 /**
  * @brief   Checks if the given IPv6 address matches an entry.
  *
- * @pre @p addr != NULL
+ * @pre (@p rcs != NULL) && (@p addr != NULL)
  *
+ * @param[in] rcs  The Router Client Set.
  * @param[in] addr The IPv6 address.
  *
  * @return NULL if not found, otherwise pointer to RCS entry.
  */
-aodvv2_rcs_entry_t *aodvv2_rcs_is_client(const ipv6_addr_t *addr);
+aodvv2_rcs_entry_t *aodvv2_rcs_is_client(aodvv2_rcs_t *rcs,
+                                         const ipv6_addr_t *addr);
 
 /**
  * @brief   Print RCS entries.
  *
- * @param[in] entry The entry to get printed.
+ * @param[in] rcs The Router Client Set.
  */
-void aodvv2_rcs_print_entries(void);
+void aodvv2_rcs_print_entries(aodvv2_rcs_t *rcs);
 
 #ifdef __cplusplus
 } /* extern "C" */
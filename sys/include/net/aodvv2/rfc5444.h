@@ -23,6 +23,8 @@
 #ifndef NET_AODVV2_RFC5444_H
 #define NET_AODVV2_RFC5444_H
 
+#include "kernel_defines.h"
+#include "net/aodvv2/lar.h"
 #include "net/aodvv2/seqnum.h"
 #include "net/manet.h"
 #include "net/metric.h"
@@ -59,18 +61,72 @@ extern "C" {
 #endif
 
 /**
- * @name    RFC5444 maximum packet size
+ * @name    RFC5444 encoding overheads
+ *
+ * Worst case, without address compression and with every address in its
+ * own address block.
+ * @{
  */
-#ifndef CONFIG_AODVV2_RFC5444_PACKET_SIZE
-#define CONFIG_AODVV2_RFC5444_PACKET_SIZE    (128)
-#endif
+#define AODVV2_RFC5444_PKT_HDR_LEN       (1) /**< Version and flags */
+#define AODVV2_RFC5444_MSG_HDR_LEN       (5) /**< Type, flags, size, hop limit */
+#define AODVV2_RFC5444_TLV_BLOCK_LEN     (2) /**< TLV block length */
+#define AODVV2_RFC5444_ADDR_BLOCK_LEN    (4) /**< Count, flags, head and tail length */
+#define AODVV2_RFC5444_ADDR_LEN          (sizeof(ipv6_addr_t) + 1) /**< Address and prefix length */
+#define AODVV2_RFC5444_ADDR_TLV_LEN      (6) /**< Type, flags, extension, indexes, length */
+#define AODVV2_RFC5444_MSG_TLV_LEN       (3) /**< Type, flags, length */
+/** @} */
 
 /**
- * @name    RFC5444 address TLVs buffer size
+ * @brief   Encoded size of a message with @p addrs addresses and @p tlvs
+ *          address TLVs carrying @p values bytes of values, no message TLVs
  */
-#ifndef CONFIG_AODVV2_RFC5444_ADDR_TLVS_SIZE
-#define CONFIG_AODVV2_RFC5444_ADDR_TLVS_SIZE (1000)
+#define AODVV2_RFC5444_MSG_LEN(addrs, tlvs, values) \
+    (AODVV2_RFC5444_MSG_HDR_LEN + AODVV2_RFC5444_TLV_BLOCK_LEN + \
+     (addrs) * (AODVV2_RFC5444_ADDR_BLOCK_LEN + AODVV2_RFC5444_ADDR_LEN + \
+                AODVV2_RFC5444_TLV_BLOCK_LEN) + \
+     (tlvs) * AODVV2_RFC5444_ADDR_TLV_LEN + (values))
+
+/**
+ * @name    Message layouts
+ *
+ * - RREQ: OrigPrefix with OrigSeqNum and Metric, TargPrefix.
+ * - RREP: OrigPrefix with OrigSeqNum, TargPrefix with TargSeqNum and Metric.
+ * - RERR: the unreachable address.
+ *
+ * With `aodvv2_lar`, RREQs also carry the OrigNode and TargNode router
+ * positions and RREPs the TargNode router position, as message TLVs.
+ * @{
+ */
+#if IS_USED(MODULE_AODVV2_LAR)
+#define AODVV2_RFC5444_POS_TLV_LEN         (AODVV2_RFC5444_MSG_TLV_LEN + AODVV2_LAR_POSITION_LEN)
+#else
+#define AODVV2_RFC5444_POS_TLV_LEN         (0)
 #endif
+#define AODVV2_RFC5444_RREQ_TLV_VALUES_LEN (sizeof(aodvv2_seqnum_t) + 1)
+#define AODVV2_RFC5444_RREQ_LEN            (AODVV2_RFC5444_MSG_LEN(2, 2, AODVV2_RFC5444_RREQ_TLV_VALUES_LEN) + \
+                                            2 * AODVV2_RFC5444_POS_TLV_LEN)
+#define AODVV2_RFC5444_RREP_TLV_VALUES_LEN (2 * sizeof(aodvv2_seqnum_t) + 1)
+#define AODVV2_RFC5444_RREP_LEN            (AODVV2_RFC5444_MSG_LEN(2, 3, AODVV2_RFC5444_RREP_TLV_VALUES_LEN) + \
+                                            AODVV2_RFC5444_POS_TLV_LEN)
+#define AODVV2_RFC5444_RERR_LEN            AODVV2_RFC5444_MSG_LEN(1, 0, 0)
+/** @} */
+
+/**
+ * @brief   Largest message, the RREP, or the RREQ when it carries positions
+ */
+#define AODVV2_RFC5444_MSG_SIZE \
+    ((AODVV2_RFC5444_RREQ_LEN > AODVV2_RFC5444_RREP_LEN) ? \
+     AODVV2_RFC5444_RREQ_LEN : AODVV2_RFC5444_RREP_LEN)
+
+/**
+ * @brief   Largest packet, packets are flushed after every message
+ */
+#define AODVV2_RFC5444_PACKET_SIZE     (AODVV2_RFC5444_PKT_HDR_LEN + AODVV2_RFC5444_MSG_SIZE)
+
+/**
+ * @brief   Address TLV values of the message with the most, the RREP
+ */
+#define AODVV2_RFC5444_ADDR_TLVS_SIZE  AODVV2_RFC5444_RREP_TLV_VALUES_LEN
 
 /**
  * @brief   AODVv2 message types
@@ -92,6 +148,14 @@ typedef enum {
     RFC5444_MSGTLV_METRIC,
 } rfc5444_tlv_type_t;
 
+/**
+ * @brief   Message TLV types, from the experimental range of RFC 5444
+ */
+typedef enum {
+    RFC5444_MSGTLV_ORIGPOS = 224, /**< OrigNode router position */
+    RFC5444_MSGTLV_TARGPOS = 225, /**< TargNode router position */
+} rfc5444_msg_tlv_type_t;
+
 /**
  * @brief   Data about an OrigNode or TargNode.
  */
@@ -113,13 +177,199 @@ typedef struct {
     node_data_t targ_node;        /**< TargNode data */
     ipv6_addr_t seqnortr;         /**< SeqNoRtr */
     timex_t timestamp;            /**< Time at which the message was received */
+#if IS_USED(MODULE_AODVV2_LAR)
+    aodvv2_position_t orig_pos;   /**< OrigNode router position */
+    aodvv2_position_t targ_pos;   /**< TargNode router position, last known
+                                       one on a RREQ */
+    bool has_orig_pos;            /**< Is @ref aodvv2_message_t::orig_pos set? */
+    bool has_targ_pos;            /**< Is @ref aodvv2_message_t::targ_pos set? */
+#endif
 } aodvv2_message_t;
 
+/**
+ * @brief   RFC5444 writer target
+ */
 typedef struct {
     struct rfc5444_writer_target target; /**< RFC5444 writer target */
     ipv6_addr_t target_addr;             /**< Address where the packet will be sent */
 } aodvv2_writer_target_t;
 
+/**
+ * @brief   Number of address TLV slots used by the reader and writer, indexed
+ *          by @ref rfc5444_tlv_type_t.
+ */
+#define AODVV2_RFC5444_ADDR_TLVS_NUMOF (RFC5444_MSGTLV_METRIC + 1)
+
+/**
+ * @brief   Number of message TLV slots used by the reader, the positions
+ */
+#define AODVV2_RFC5444_MSG_TLVS_NUMOF (2)
+
+/**
+ * @brief   AODVv2 RFC5444 reader context
+ */
+typedef struct {
+    struct rfc5444_reader reader;                               /**< RFC5444 reader */
+    struct rfc5444_reader_tlvblock_consumer rreq_consumer;      /**< RREQ message consumer */
+    struct rfc5444_reader_tlvblock_consumer rreq_addr_consumer; /**< RREQ address consumer */
+    struct rfc5444_reader_tlvblock_consumer rrep_consumer;      /**< RREP message consumer */
+    struct rfc5444_reader_tlvblock_consumer rrep_addr_consumer; /**< RREP address consumer */
+    struct rfc5444_reader_tlvblock_consumer rerr_consumer;      /**< RERR message consumer */
+    struct rfc5444_reader_tlvblock_consumer rerr_addr_consumer; /**< RERR address consumer */
+    /**
+     * @brief   RREQ address consumer entries
+     */
+    struct rfc5444_reader_tlvblock_consumer_entry rreq_addr_entries[AODVV2_RFC5444_ADDR_TLVS_NUMOF];
+    /**
+     * @brief   RREP address consumer entries
+     */
+    struct rfc5444_reader_tlvblock_consumer_entry rrep_addr_entries[AODVV2_RFC5444_ADDR_TLVS_NUMOF];
+#if IS_USED(MODULE_AODVV2_LAR)
+    /**
+     * @brief   RREQ message consumer entries
+     */
+    struct rfc5444_reader_tlvblock_consumer_entry rreq_msg_entries[AODVV2_RFC5444_MSG_TLVS_NUMOF];
+    /**
+     * @brief   RREP message consumer entries
+     */
+    struct rfc5444_reader_tlvblock_consumer_entry rrep_msg_entries[AODVV2_RFC5444_MSG_TLVS_NUMOF];
+#endif
+    aodvv2_message_t msg;                                       /**< Message being parsed */
+} aodvv2_reader_t;
+
+/**
+ * @name    Wire templates, with the `aodvv2_template` module
+ *
+ * A RREQ or RREP only differs from the previous one of the same shape in its
+ * addresses, SeqNums, metric, hop limit and positions. The shape is what
+ * the generic writer bases its layout on: message type, which fields are
+ * present, prefix lengths, how many leading and trailing bytes the two
+ * addresses share, and whether the shared trailing bytes are zero.
+ *
+ * The first message of a shape goes through the generic writer. Its output
+ * is parsed into a template: the packet bytes, plus where each field goes.
+ * The next message of the shape also goes through the generic writer, and
+ * the template is only kept if it writes the same packet. After that,
+ * writing a message of the shape is a copy of the template and a few field
+ * copies. No message is written by the generic writer more than once.
+ * @{
+ */
+/**
+ * @brief   Message shapes kept as templates
+ */
+#ifndef CONFIG_AODVV2_TEMPLATE_NUMOF
+#define CONFIG_AODVV2_TEMPLATE_NUMOF (4)
+#endif
+
+/**
+ * @brief   Compare every templated message with the generic writer output
+ *
+ * Every message is sent from the generic writer output, as if it had no
+ * template yet, and a template that doesn't match is dropped. Meant for
+ * testing.
+ */
+#ifndef CONFIG_AODVV2_TEMPLATE_CHECK
+#define CONFIG_AODVV2_TEMPLATE_CHECK (0)
+#endif
+
+/**
+ * @brief   Field copies of a template
+ *
+ * Hop limit, three segments for each of two addresses and three TLV values.
+ * Client announcements have a single address and the originator instead.
+ */
+#define AODVV2_TEMPLATE_OPS_NUMOF  (10)
+
+#define AODVV2_TEMPLATE_HAS_ORIG     (0x01) /**< Has an OrigPrefix */
+#define AODVV2_TEMPLATE_HAS_ORIG_POS (0x02) /**< Has an OrigNode position */
+#define AODVV2_TEMPLATE_HAS_TARG_POS (0x04) /**< Has a TargNode position */
+#define AODVV2_TEMPLATE_HAS_SEQNORTR (0x08) /**< Has a SeqNoRtr originator */
+#define AODVV2_TEMPLATE_ZERO_TAIL    (0x10) /**< Shared trailing bytes are 0 */
+/** @} */
+
+/**
+ * @brief   Shape of a RREQ or RREP
+ */
+typedef struct {
+    uint8_t msg_type;       /**< @ref rfc5444_msg_type_t */
+    uint8_t flags;          /**< `AODVV2_TEMPLATE_HAS_*` */
+    uint8_t orig_pfx_len;   /**< OrigPrefix length */
+    uint8_t targ_pfx_len;   /**< TargPrefix length */
+    uint8_t head;           /**< Leading bytes both addresses share */
+    uint8_t tail;           /**< Trailing bytes both addresses share */
+} aodvv2_template_key_t;
+
+/**
+ * @brief   Copy of a message field into a template
+ */
+typedef struct {
+    uint8_t dst;            /**< Offset in the packet */
+    uint8_t len;            /**< Length */
+    uint16_t src;           /**< Offset in the @ref aodvv2_message_t */
+} aodvv2_template_op_t;
+
+/**
+ * @brief   Wire template of a message shape
+ */
+typedef struct {
+    aodvv2_template_key_t key;  /**< Shape */
+    bool used;                  /**< Is this template used? */
+    bool checked;               /**< Has it matched the generic writer? */
+    uint8_t len;                /**< Packet length */
+    uint8_t ops_numof;          /**< Number of field copies */
+    uint8_t orig_pos;           /**< Offset of the OrigNode position, or 0 */
+    uint8_t targ_pos;           /**< Offset of the TargNode position, or 0 */
+    aodvv2_template_op_t ops[AODVV2_TEMPLATE_OPS_NUMOF]; /**< Field copies */
+    uint8_t data[AODVV2_RFC5444_PACKET_SIZE];            /**< Packet */
+} aodvv2_template_t;
+
+/**
+ * @brief   Wire template counters
+ */
+typedef struct {
+    uint32_t hits;          /**< Messages written from a template */
+    uint32_t learned;       /**< Templates that matched the generic writer */
+    uint32_t rejected;      /**< Shapes that couldn't be templated, or whose
+                                 template didn't match */
+    uint32_t mismatches;    /**< Templates that differed from the generic
+                                 writer, with @ref CONFIG_AODVV2_TEMPLATE_CHECK */
+} aodvv2_template_stats_t;
+
+/**
+ * @brief   Wire templates of a writer
+ */
+typedef struct {
+    aodvv2_template_t entries[CONFIG_AODVV2_TEMPLATE_NUMOF]; /**< Templates */
+    uint8_t next;                   /**< Entry replaced next */
+    aodvv2_template_stats_t stats;  /**< Counters */
+} aodvv2_template_set_t;
+
+/**
+ * @brief   AODVv2 RFC5444 writer context
+ */
+typedef struct {
+    struct rfc5444_writer writer;                                    /**< RFC5444 writer */
+    aodvv2_writer_target_t target;                                   /**< Writer target */
+    struct rfc5444_writer_content_provider rreq_provider;            /**< RREQ content provider */
+    struct rfc5444_writer_content_provider rrep_provider;            /**< RREP content provider */
+    struct rfc5444_writer_content_provider rerr_provider;            /**< RERR content provider */
+    struct rfc5444_writer_tlvtype rreq_addrtlvs[AODVV2_RFC5444_ADDR_TLVS_NUMOF]; /**< RREQ address TLVs */
+    struct rfc5444_writer_tlvtype rrep_addrtlvs[AODVV2_RFC5444_ADDR_TLVS_NUMOF]; /**< RREP address TLVs */
+    const aodvv2_message_t *msg;                                     /**< Message being written,
+                                                                          only set while sending */
+    uint8_t msg_buffer[AODVV2_RFC5444_MSG_SIZE];                     /**< Message buffer */
+    uint8_t addrtlv_buffer[AODVV2_RFC5444_ADDR_TLVS_SIZE];           /**< Address TLVs buffer */
+    uint8_t pkt_buffer[AODVV2_RFC5444_PACKET_SIZE];                  /**< Packet buffer */
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    aodvv2_template_set_t templates;                                 /**< Wire templates */
+    uint8_t tpl_buffer[AODVV2_RFC5444_PACKET_SIZE];                  /**< Templated packet */
+    uint8_t *capture;                                                /**< Where the generic
+                                                                          writer output goes
+                                                                          instead of being sent */
+    size_t capture_len;                                              /**< Captured length */
+#endif
+} aodvv2_writer_t;
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
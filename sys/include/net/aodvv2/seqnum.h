@@ -35,19 +35,31 @@ extern "C" {
 typedef uint16_t aodvv2_seqnum_t;
 
 /**
- * @brief   Initializ SeqNum.
+ * @brief   Initialize SeqNum.
+ *
+ * @pre @p seqnum != NULL
+ *
+ * @param[out] seqnum The SeqNum to initialize.
  */
-void aodvv2_seqnum_init(void);
+void aodvv2_seqnum_init(aodvv2_seqnum_t *seqnum);
 
 /**
  * @brief   Increment the SeqNum.
+ *
+ * @pre @p seqnum != NULL
+ *
+ * @param[inout] seqnum The SeqNum to increment.
  */
-void aodvv2_seqnum_inc(void);
+void aodvv2_seqnum_inc(aodvv2_seqnum_t *seqnum);
 
 /**
  * @brief   Get the SeqNum.
+ *
+ * @pre @p seqnum != NULL
+ *
+ * @param[in] seqnum The SeqNum.
  */
-aodvv2_seqnum_t aodvv2_seqnum_get(void);
+aodvv2_seqnum_t aodvv2_seqnum_get(const aodvv2_seqnum_t *seqnum);
 
 /**
  * @brief   Compare sequence numbers
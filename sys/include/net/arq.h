@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_arq Adaptive MAC retransmissions
+ * @ingroup     net
+ * @brief       Per neighbor MAC retransmission control
+ *
+ * Keeps a filtered per attempt delivery probability `p` for each link, from
+ * the ACK outcome of every unicast frame. For the next frame it picks the
+ * fewest retransmissions that still deliver @ref CONFIG_ARQ_TARGET_PDR
+ * percent of the frames: the lowest `r` with `(1 - p)^(r + 1) <= 1 - target`.
+ *
+ * Links whose `p` falls below @ref CONFIG_ARQ_MIN_PDR don't get more than
+ * @ref CONFIG_ARQ_RETRIES_BAD retransmissions: retrying barely helps there
+ * and the channel time is better spent on other links while routing finds a
+ * better path.
+ *
+ * Channel access failures (CSMA) say nothing about the link and are not fed
+ * to the controller.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Adaptive MAC retransmissions
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_ARQ_H
+#define NET_ARQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Frame delivery ratio to aim for, in percent
+ */
+#ifndef CONFIG_ARQ_TARGET_PDR
+#define CONFIG_ARQ_TARGET_PDR (95)
+#endif
+
+/**
+ * @brief   Per attempt delivery probability (percent) below which
+ *          retransmissions aren't worth it
+ */
+#ifndef CONFIG_ARQ_MIN_PDR
+#define CONFIG_ARQ_MIN_PDR (20)
+#endif
+
+/**
+ * @brief   Retransmissions used on links below @ref CONFIG_ARQ_MIN_PDR
+ */
+#ifndef CONFIG_ARQ_RETRIES_BAD
+#define CONFIG_ARQ_RETRIES_BAD (1)
+#endif
+
+/**
+ * @brief   Maximum number of retransmissions
+ */
+#ifndef CONFIG_ARQ_RETRIES_MAX
+#define CONFIG_ARQ_RETRIES_MAX (7)
+#endif
+
+/**
+ * @brief   Retransmissions used until a link has enough samples
+ */
+#ifndef CONFIG_ARQ_RETRIES_DEFAULT
+#define CONFIG_ARQ_RETRIES_DEFAULT (3)
+#endif
+
+/**
+ * @brief   Delivery probability filter weight, as a power of two shift
+ */
+#ifndef CONFIG_ARQ_EWMA_SHIFT
+#define CONFIG_ARQ_EWMA_SHIFT (4)
+#endif
+
+/**
+ * @brief   Attempts observed before the estimate is used
+ */
+#define ARQ_MIN_SAMPLES (4U)
+
+/**
+ * @brief   Retransmission control state of a link
+ */
+typedef struct {
+    uint16_t pdr;     /**< Per attempt delivery probability (1/65536) */
+    uint8_t samples;  /**< Attempts observed, saturates at 255 */
+    uint8_t retries;  /**< Selected retransmissions */
+} arq_link_t;
+
+/**
+ * @brief   Initialize a link
+ *
+ * @pre @p link != NULL
+ */
+void arq_link_init(arq_link_t *link);
+
+/**
+ * @brief   Feed the outcome of a unicast frame
+ *
+ * @pre @p link != NULL
+ *
+ * @param[in] link      Link.
+ * @param[in] attempts  Transmissions of the frame (1 + retransmissions).
+ * @param[in] acked     The last attempt was acknowledged.
+ */
+void arq_link_update(arq_link_t *link, unsigned attempts, bool acked);
+
+/**
+ * @brief   Select the retransmissions for the next frame on the link
+ *
+ * @pre @p link != NULL
+ *
+ * @return Number of retransmissions.
+ */
+uint8_t arq_link_select(arq_link_t *link);
+
+/**
+ * @brief   Per attempt delivery probability in percent
+ */
+static inline unsigned arq_link_pdr(const arq_link_t *link)
+{
+    return ((uint32_t)link->pdr * 100 + 32768) >> 16;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_ARQ_H */
+/** @} */
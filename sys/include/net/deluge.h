@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_deluge Firmware image dissemination
+ * @ingroup     net
+ * @brief       Spread a firmware image over the mesh, neighbor to neighbor
+ *
+ * Instead of unicasting the image to every node over multi-hop paths, which
+ * costs airtime for every hop of every node, each node fetches it from its
+ * neighbors over local broadcast and passes it on, in the spirit of Deluge
+ * (Hui & Culler, SenSys 2004):
+ *
+ * - The image is split in pages of @ref CONFIG_DELUGE_PAGE_CHUNKS chunks.
+ *   Nodes advertise the image version and how many pages they have, on a
+ *   Trickle schedule (RFC 6206) so a settled neighborhood is almost silent.
+ * - A node hearing a neighbor with more pages requests the next page with a
+ *   bitmap of the chunks it lacks. The neighbor broadcasts them, every node
+ *   missing them stores them, and requests for the same page overheard from
+ *   other nodes are suppressed, so a chunk crosses a link about once.
+ * - Pages complete in order and the progress is persisted, a node that
+ *   reboots resumes from the first incomplete page.
+ * - The complete image is checked against the SHA-256 checksum advertised
+ *   with it before it's marked as ready to install.
+ *
+ * @warning Advertisements aren't authenticated. The checksum only catches
+ *          images corrupted in transfer or storage, any node in range can
+ *          advertise a newer version with a matching checksum and have it
+ *          installed. Check a signature before booting an image received
+ *          this way.
+ *
+ * The protocol itself lives in the platform independent
+ * @ref deluge_core_t, this module binds it to GNRC, xtimer and an MTD
+ * device. The MTD device is laid out as:
+ *
+ * | Sector     | Content                                                  |
+ * |------------|----------------------------------------------------------|
+ * | 0          | header: magic, image description, ready flag and one     |
+ * |            | progress byte per page, cleared when the page completes  |
+ * | 1 onwards  | the image                                                |
+ *
+ * Installing the image (copying it over the running firmware) is left to
+ * the bootloader, which should only take images with the ready flag
+ * cleared.
+ *
+ * The simulator in `dist/tools/deluge_sim` runs the same core on 50 nodes
+ * to measure completion time.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Firmware image dissemination
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_DELUGE_H
+#define NET_DELUGE_H
+
+#include <stdint.h>
+
+#include "mtd.h"
+#include "net/gnrc/netif.h"
+#include "net/deluge/core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   UDP port of the dissemination messages
+ */
+#ifndef CONFIG_DELUGE_PORT
+#define CONFIG_DELUGE_PORT (6270)
+#endif
+
+/**
+ * @brief   Stack size for the dissemination thread
+ */
+#ifndef CONFIG_DELUGE_STACK_SIZE
+#define CONFIG_DELUGE_STACK_SIZE (2048)
+#endif
+
+/**
+ * @brief   Priority for the dissemination thread
+ */
+#ifndef CONFIG_DELUGE_PRIO
+#define CONFIG_DELUGE_PRIO (8)
+#endif
+
+/**
+ * @brief   Message queue size for the dissemination thread
+ */
+#ifndef CONFIG_DELUGE_MSG_QUEUE_SIZE
+#define CONFIG_DELUGE_MSG_QUEUE_SIZE (8)
+#endif
+
+/**
+ * @brief   Initialize image dissemination
+ *
+ * Resumes the transfer stored in @p mtd, if any.
+ *
+ * @pre (@p netif != NULL) && (@p mtd != NULL)
+ *
+ * @param[in] netif Network interface to disseminate on.
+ * @param[in] mtd   Image storage, already initialized.
+ *
+ * @return PID of the dissemination thread.
+ * @return -ENOTSUP if @p mtd is too small.
+ * @return negative errno on failure.
+ */
+int deluge_init(gnrc_netif_t *netif, mtd_dev_t *mtd);
+
+/**
+ * @brief   Disseminate the image already written to the image area
+ *
+ * Computes the checksum of the first @p size bytes of the image area and
+ * advertises them as @p version.
+ *
+ * @param[in] version Image version, newer than the current one.
+ * @param[in] size    Image size in bytes.
+ *
+ * @return 0 on success.
+ * @return -ENOTCONN if @ref deluge_init wasn't called.
+ * @return -EINVAL if @p version isn't newer than the current one.
+ * @return -ENOSPC if @p size doesn't fit in the image area.
+ * @return negative errno on storage errors.
+ */
+int deluge_publish(uint16_t version, uint32_t size);
+
+/**
+ * @brief   Print the transfer state and counters
+ */
+void deluge_print(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_DELUGE_H */
+/** @} */
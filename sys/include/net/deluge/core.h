@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_deluge
+ * @{
+ *
+ * @file
+ * @brief       Platform independent image dissemination core
+ *
+ * Like @ref aodvv2_core_t the core doesn't talk to a network stack, timer or
+ * storage API, everything platform dependent goes through a
+ * @ref deluge_ops_t table, so the same code runs on the radio and in the host
+ * simulator (`dist/tools/deluge_sim`).
+ *
+ * The core isn't thread-safe, the caller is responsible for serializing all
+ * calls made on the same @ref deluge_core_t.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_DELUGE_CORE_H
+#define NET_DELUGE_CORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Chunk size in bytes, the payload of a DATA message
+ */
+#ifndef CONFIG_DELUGE_CHUNK_SIZE
+#define CONFIG_DELUGE_CHUNK_SIZE (64)
+#endif
+
+/**
+ * @brief   Chunks per page, at most 32
+ */
+#ifndef CONFIG_DELUGE_PAGE_CHUNKS
+#define CONFIG_DELUGE_PAGE_CHUNKS (16)
+#endif
+
+/**
+ * @brief   Pages stored ahead of the first incomplete one
+ *
+ * Chunks of the next pages, overheard while neighbors are served, are kept
+ * instead of being requested again later.
+ */
+#ifndef CONFIG_DELUGE_RX_WINDOW
+#define CONFIG_DELUGE_RX_WINDOW (4)
+#endif
+
+/**
+ * @brief   Advertisement Trickle minimum interval in milliseconds
+ */
+#ifndef CONFIG_DELUGE_ADV_IMIN
+#define CONFIG_DELUGE_ADV_IMIN (500)
+#endif
+
+/**
+ * @brief   Advertisement Trickle maximum interval in milliseconds
+ */
+#ifndef CONFIG_DELUGE_ADV_IMAX
+#define CONFIG_DELUGE_ADV_IMAX (60000)
+#endif
+
+/**
+ * @brief   Advertisement Trickle redundancy constant
+ */
+#ifndef CONFIG_DELUGE_ADV_K
+#define CONFIG_DELUGE_ADV_K (1)
+#endif
+
+/**
+ * @brief   Maximum random delay (ms) before the first request for a page
+ */
+#ifndef CONFIG_DELUGE_REQ_BACKOFF
+#define CONFIG_DELUGE_REQ_BACKOFF (100)
+#endif
+
+/**
+ * @brief   Time (ms) without any DATA for the page before requesting again
+ */
+#ifndef CONFIG_DELUGE_RX_TIMEOUT
+#define CONFIG_DELUGE_RX_TIMEOUT (300)
+#endif
+
+/**
+ * @brief   Unanswered requests before going back to listening
+ */
+#ifndef CONFIG_DELUGE_RX_TRIES
+#define CONFIG_DELUGE_RX_TRIES (4)
+#endif
+
+/**
+ * @brief   Time (ms) between two DATA messages of the same sender
+ */
+#ifndef CONFIG_DELUGE_TX_SPACING
+#define CONFIG_DELUGE_TX_SPACING (20)
+#endif
+
+/**
+ * @brief   Image checksum size
+ */
+#define DELUGE_DIGEST_LEN   (32)
+
+/**
+ * @brief   Page size in bytes
+ */
+#define DELUGE_PAGE_SIZE    (CONFIG_DELUGE_CHUNK_SIZE * CONFIG_DELUGE_PAGE_CHUNKS)
+
+/**
+ * @brief   Largest message, a DATA message with a full chunk
+ */
+#define DELUGE_MSG_MAX_LEN  (6 + CONFIG_DELUGE_CHUNK_SIZE)
+
+/**
+ * @brief   Image description
+ *
+ * Version 0 means no image.
+ */
+typedef struct {
+    uint16_t version;                   /**< Image version */
+    uint32_t size;                      /**< Image size in bytes */
+    uint8_t digest[DELUGE_DIGEST_LEN];  /**< Image checksum, checked by
+                                             @ref deluge_ops_t::verify */
+} deluge_meta_t;
+
+/**
+ * @brief   Platform operations used by the core
+ *
+ * All operations receive the `ctx` pointer given to @ref deluge_core_init.
+ * Storage offsets are relative to the start of the image.
+ */
+typedef struct {
+    /**
+     * @brief   Get a random number
+     */
+    uint32_t (*random)(void *ctx);
+
+    /**
+     * @brief   Call @ref deluge_core_timeout in @p ms milliseconds
+     *
+     * Replaces the previous timeout, if any.
+     */
+    void (*set_timer)(void *ctx, uint32_t ms);
+
+    /**
+     * @brief   Broadcast a message to the neighbors
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*send)(void *ctx, const void *buf, size_t len);
+
+    /**
+     * @brief   Read image data
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+
+    /**
+     * @brief   Write image data, every chunk is written once
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+
+    /**
+     * @brief   Start receiving @p meta, discarding the stored image
+     *
+     * @return 0 on success, negative errno on failure.
+     */
+    int (*prepare)(void *ctx, const deluge_meta_t *meta);
+
+    /**
+     * @brief   Page @p page is complete, persist the progress
+     *
+     * Pages complete in order, on restart the core is initialized with the
+     * number of complete pages.
+     */
+    void (*page_done)(void *ctx, uint16_t page);
+
+    /**
+     * @brief   Check the stored image against @p meta
+     *
+     * @return 0 if it matches, negative errno otherwise.
+     */
+    int (*verify)(void *ctx, const deluge_meta_t *meta);
+
+    /**
+     * @brief   The image was received and verified, it can be installed
+     */
+    void (*complete)(void *ctx, const deluge_meta_t *meta);
+} deluge_ops_t;
+
+/**
+ * @brief   What the node is busy with
+ */
+typedef enum {
+    DELUGE_STATE_MAINTAIN,  /**< Advertising, listening for newer images */
+    DELUGE_STATE_RX,        /**< Requesting a page */
+    DELUGE_STATE_TX,        /**< Sending requested chunks of a page */
+} deluge_state_t;
+
+/**
+ * @brief   Counters
+ */
+typedef struct {
+    uint32_t adv_tx;        /**< Advertisements sent */
+    uint32_t req_tx;        /**< Requests sent */
+    uint32_t data_tx;       /**< Chunks sent */
+    uint32_t data_rx;       /**< Chunks stored */
+    uint32_t data_dup;      /**< Chunks received but not needed */
+    uint32_t verify_fail;   /**< Complete images that failed verification */
+} deluge_stats_t;
+
+/**
+ * @brief   Image dissemination instance
+ */
+typedef struct {
+    const deluge_ops_t *ops;    /**< Platform operations */
+    void *ctx;                  /**< Platform context */
+    uint16_t id;                /**< Node identifier, unique among neighbors */
+    deluge_meta_t meta;         /**< Image being disseminated */
+    uint16_t pages;             /**< Pages complete (and advertised) */
+    /**
+     * @brief   Missing chunks of the pages from @ref pages on
+     */
+    uint32_t missing[CONFIG_DELUGE_RX_WINDOW];
+    deluge_state_t state;       /**< Current state */
+    uint32_t tau;               /**< Trickle interval (ms) */
+    uint32_t t;                 /**< Trickle transmission time (ms) */
+    uint8_t c;                  /**< Consistent advertisements heard */
+    bool t_passed;              /**< The timer is running to the end of tau */
+    uint16_t rx_src;            /**< Neighbor pages are requested from */
+    uint16_t rx_src_pages;      /**< Pages it advertised */
+    uint8_t rx_tries;           /**< Requests left */
+    uint16_t tx_page;           /**< Page being sent */
+    uint32_t tx_pending;        /**< Chunks left to send */
+    deluge_stats_t stats;       /**< Counters */
+} deluge_core_t;
+
+/**
+ * @brief   Initialize an instance
+ *
+ * @pre (@p core != NULL) && (@p ops != NULL)
+ *
+ * @param[out] core  The instance.
+ * @param[in]  ops   Platform operations.
+ * @param[in]  ctx   Platform context passed to every operation.
+ * @param[in]  id    Node identifier, unique among neighbors.
+ * @param[in]  meta  Image stored from a previous run, or NULL.
+ * @param[in]  pages Pages of @p meta complete, to resume the transfer.
+ */
+void deluge_core_init(deluge_core_t *core, const deluge_ops_t *ops, void *ctx,
+                      uint16_t id, const deluge_meta_t *meta, uint16_t pages);
+
+/**
+ * @brief   Disseminate the image in storage, described by @p meta
+ *
+ * @p meta should be newer than the current image.
+ */
+void deluge_core_publish(deluge_core_t *core, const deluge_meta_t *meta);
+
+/**
+ * @brief   Handle a message received from a neighbor
+ *
+ * @return 0 on success, -EBADMSG if it isn't a valid message.
+ */
+int deluge_core_handle(deluge_core_t *core, const uint8_t *buf, size_t len);
+
+/**
+ * @brief   The timer set with @ref deluge_ops_t::set_timer expired
+ */
+void deluge_core_timeout(deluge_core_t *core);
+
+/**
+ * @brief   Number of pages of @p meta
+ */
+static inline uint16_t deluge_meta_pages(const deluge_meta_t *meta)
+{
+    return (meta->size + DELUGE_PAGE_SIZE - 1) / DELUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief   Is the whole image of @p core stored?
+ */
+static inline bool deluge_core_done(const deluge_core_t *core)
+{
+    return core->meta.version != 0 &&
+           core->pages == deluge_meta_pages(&core->meta);
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_DELUGE_CORE_H */
+/** @} */
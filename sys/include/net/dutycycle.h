@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_dutycycle Routing aware radio duty cycling
+ * @ingroup     net
+ * @brief       Sleep the mesh radio while the router isn't relaying
+ *
+ * The radio is woken up for @ref CONFIG_DUTYCYCLE_WAKE milliseconds every
+ * @ref CONFIG_DUTYCYCLE_PERIOD milliseconds, on a fixed schedule. Routers stay
+ * awake past the window while they take part in a route discovery or carry a
+ * valid route (see @ref dutycycle_stay_awake), and while they send or
+ * receive unicast traffic. The next window after a hold still starts on the
+ * schedule, so neighbors can rely on it.
+ *
+ * Neighbors' schedules aren't synchronized. Every router announces its own
+ * with a SYNC frame every @ref CONFIG_DUTYCYCLE_SYNC_INTERVAL seconds:
+ *
+ * | Byte | Content                                                     |
+ * |------|-------------------------------------------------------------|
+ * | 0    | @ref DUTYCYCLE_SYNC_DISPATCH                                |
+ * | 1-2  | Time (ms) until the next wake window starts, big endian     |
+ * | 3-4  | Period (ms), big endian                                     |
+ * | 5-6  | Wake window (ms), big endian, equal to the period if the    |
+ * |      | router doesn't sleep                                        |
+ *
+ * A broadcast (RREQ, Trickle, beacons) is sent right away, and then once
+ * more for each group of neighbors whose wake window doesn't cover that
+ * first copy. While the schedule of a neighbor is unknown (no SYNC yet, or
+ * more neighbors than @ref CONFIG_DUTYCYCLE_NBR_NUMOF), broadcasts and the
+ * SYNC frames themselves are sent once per wake window over a full period
+ * instead, which makes sure every sleeping neighbor catches at least one
+ * copy. Duplicates are dropped by the receivers, e.g. by the AODVv2
+ * Multicast Message Set.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Routing aware radio duty cycling
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_DUTYCYCLE_H
+#define NET_DUTYCYCLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Duty cycle period in milliseconds
+ */
+#ifndef CONFIG_DUTYCYCLE_PERIOD
+#define CONFIG_DUTYCYCLE_PERIOD (1000)
+#endif
+
+/**
+ * @brief   Wake window in milliseconds
+ */
+#ifndef CONFIG_DUTYCYCLE_WAKE
+#define CONFIG_DUTYCYCLE_WAKE (100)
+#endif
+
+/**
+ * @brief   Time (ms) to stay awake after sending or receiving unicast traffic
+ */
+#ifndef CONFIG_DUTYCYCLE_DATA_HOLD
+#define CONFIG_DUTYCYCLE_DATA_HOLD (5000)
+#endif
+
+/**
+ * @brief   Broadcasts being repeated at the same time
+ *
+ * When the queue is full, the broadcast with the fewest copies left gives
+ * up its remaining copies to make room, see
+ * @ref dutycycle_stats_t::bcast_dropped.
+ */
+#ifndef CONFIG_DUTYCYCLE_REPEAT_QUEUE_SIZE
+#define CONFIG_DUTYCYCLE_REPEAT_QUEUE_SIZE (8)
+#endif
+
+/**
+ * @brief   Time (s) between two SYNC frames
+ */
+#ifndef CONFIG_DUTYCYCLE_SYNC_INTERVAL
+#define CONFIG_DUTYCYCLE_SYNC_INTERVAL (60)
+#endif
+
+/**
+ * @brief   Neighbors whose schedule is tracked
+ */
+#ifndef CONFIG_DUTYCYCLE_NBR_NUMOF
+#define CONFIG_DUTYCYCLE_NBR_NUMOF (8)
+#endif
+
+/**
+ * @brief   First byte of a SYNC frame
+ *
+ * A "Not a LoWPAN frame" dispatch (RFC 4944, section 5.1), 6LoWPAN never
+ * sees these frames.
+ */
+#define DUTYCYCLE_SYNC_DISPATCH (0x0d)
+
+/**
+ * @brief   Length of a SYNC frame
+ */
+#define DUTYCYCLE_SYNC_LEN (7)
+
+/**
+ * @brief   Copies of a broadcast when the schedule of a neighbor is unknown
+ */
+#define DUTYCYCLE_BCAST_COPIES \
+    ((CONFIG_DUTYCYCLE_PERIOD + CONFIG_DUTYCYCLE_WAKE - 1) / \
+     CONFIG_DUTYCYCLE_WAKE)
+
+/**
+ * @brief   Duty cycling statistics
+ */
+typedef struct {
+    uint64_t awake_ms;       /**< Time the radio has been on */
+    uint64_t total_ms;       /**< Time since @ref dutycycle_init */
+    uint32_t wakeups;        /**< Times the radio was woken up */
+    uint32_t bcast;          /**< Broadcasts sent */
+    uint32_t bcast_copies;   /**< Broadcast copies sent, the first ones
+                                  included */
+    uint32_t bcast_blind;    /**< Broadcasts repeated over a full period,
+                                  a neighbor's schedule was unknown */
+    uint32_t bcast_dropped;  /**< Broadcasts that gave up their remaining
+                                  copies, queue full */
+    uint8_t nbrs;            /**< Neighbors tracked */
+    uint8_t nbrs_known;      /**< Of those, with a known schedule */
+} dutycycle_stats_t;
+
+/**
+ * @brief   Start duty cycling the radio of @p netif
+ *
+ * Adds a @ref net_netif_hook to @p netif. Only call it once.
+ *
+ * @pre @p netif != NULL
+ *
+ * @return 0 on success.
+ * @return -EALREADY if already initialized.
+ * @return -ENOSPC if @ref netif_hook_add fails.
+ */
+int dutycycle_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Turn sleeping on or off
+ *
+ * Broadcasts are still repeated when off, neighbors may be sleeping.
+ */
+void dutycycle_enable(bool enable);
+
+/**
+ * @brief   Is the radio allowed to sleep?
+ */
+bool dutycycle_enabled(void);
+
+/**
+ * @brief   Keep the radio on for at least @p ms milliseconds from now
+ *
+ * Wakes the radio up if it was sleeping.
+ */
+void dutycycle_stay_awake(uint32_t ms);
+
+/**
+ * @brief   Get the duty cycling statistics
+ *
+ * @pre @p stats != NULL
+ */
+void dutycycle_stats(dutycycle_stats_t *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_DUTYCYCLE_H */
+/** @} */
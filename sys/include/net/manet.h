@@ -20,7 +20,12 @@
 #ifndef NET_MANET_H
 #define NET_MANET_H
 
+#include "kernel_defines.h"
+#include "net/ipv6/addr.h"
+
+#if IS_USED(MODULE_GNRC_NETIF)
 #include "net/gnrc/netif.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +67,7 @@ extern "C" {
  */
 extern ipv6_addr_t ipv6_addr_all_manet_routers_link_local;
 
+#if IS_USED(MODULE_GNRC_NETIF) || defined(DOXYGEN)
 /**
  * @brief   Join a network interface to the LL-MANET-Routers multicast group.
  *
@@ -73,6 +79,7 @@ extern ipv6_addr_t ipv6_addr_all_manet_routers_link_local;
  * @return -1 otherwise
  */
 int manet_netif_ipv6_group_join(gnrc_netif_t *netif);
+#endif
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_meshconf Mesh-wide configuration dissemination
+ * @ingroup     net
+ * @brief       Spread a versioned configuration blob over the mesh
+ *
+ * Every router keeps a copy of the configuration, its 16 bit version and a
+ * Fletcher-16 checksum of its content. Version and checksum are advertised to
+ * the LL-MANET-Routers group in an RFC 5444 message scheduled by a Trickle
+ * timer (RFC 6206). Configurations are ordered by version, two routers bumping
+ * the same version concurrently are told apart by the checksum, the higher
+ * one wins:
+ *
+ * - Hearing the configuration we have is consistent, it suppresses our own
+ *   advertisement, so once the mesh agrees a neighborhood sends about one
+ *   message every @ref CONFIG_MESHCONF_IMIN << @ref CONFIG_MESHCONF_IMAX
+ *   milliseconds.
+ * - Hearing an older configuration resets the timer and our next advertisement
+ *   carries the configuration itself.
+ * - Hearing a newer configuration with the content attached replaces ours,
+ *   applies it and resets the timer to pass it on quickly.
+ *
+ * The configuration is a list of entries, one byte key, one byte length and
+ * the value. Modules register a @ref meshconf_handler_t for their key to have
+ * new values applied at runtime, keys nobody handles are still passed on.
+ *
+ * @warning Advertisements aren't authenticated, the checksum only detects
+ *          inconsistent copies. Any neighbor can replace the configuration,
+ *          including keys such as @ref MESHCONF_KEY_DUTYCYCLE, by advertising
+ *          a higher version. Only use this module on a link that is secured
+ *          below IP, or for settings that are safe to be set by anyone.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Mesh-wide configuration dissemination
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_MESHCONF_H
+#define NET_MESHCONF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Maximum configuration size in bytes
+ */
+#ifndef CONFIG_MESHCONF_MAX_LEN
+#define CONFIG_MESHCONF_MAX_LEN (64)
+#endif
+
+/**
+ * @brief   Trickle minimum interval (Imin) in milliseconds
+ */
+#ifndef CONFIG_MESHCONF_IMIN
+#define CONFIG_MESHCONF_IMIN (1000)
+#endif
+
+/**
+ * @brief   Trickle maximum interval as doublings of Imin (Imax)
+ */
+#ifndef CONFIG_MESHCONF_IMAX
+#define CONFIG_MESHCONF_IMAX (8)
+#endif
+
+/**
+ * @brief   Trickle redundancy constant (k)
+ */
+#ifndef CONFIG_MESHCONF_K
+#define CONFIG_MESHCONF_K (1)
+#endif
+
+/**
+ * @brief   Stack size for the dissemination thread
+ */
+#ifndef CONFIG_MESHCONF_STACK_SIZE
+#define CONFIG_MESHCONF_STACK_SIZE (1536)
+#endif
+
+/**
+ * @brief   Priority of the dissemination thread
+ */
+#ifndef CONFIG_MESHCONF_PRIO
+#define CONFIG_MESHCONF_PRIO (7)
+#endif
+
+/**
+ * @brief   Message queue size of the dissemination thread
+ */
+#ifndef CONFIG_MESHCONF_MSG_QUEUE_SIZE
+#define CONFIG_MESHCONF_MSG_QUEUE_SIZE (8)
+#endif
+
+/**
+ * @brief   RFC 5444 message type, from the experimental range
+ */
+#define MESHCONF_MSGTYPE (224)
+
+/**
+ * @brief   Well-known configuration keys
+ */
+typedef enum {
+    MESHCONF_KEY_DUTYCYCLE = 1, /**< Radio duty cycling on (1) or off (0) */
+} meshconf_key_t;
+
+/**
+ * @brief   Configuration entry handler
+ */
+typedef struct meshconf_handler {
+    struct meshconf_handler *next; /**< Next handler */
+    uint8_t key;                   /**< Key handled */
+    /**
+     * @brief   Apply a new value
+     *
+     * Called from the dissemination thread every time a new configuration
+     * containing @p key is adopted, also when the value didn't change.
+     */
+    void (*apply)(void *arg, const uint8_t *value, size_t len);
+    void *arg;                     /**< Argument for @ref apply */
+} meshconf_handler_t;
+
+/**
+ * @brief   Start disseminating the configuration on @p netif
+ *
+ * @pre @p netif != NULL and it joined the LL-MANET-Routers group.
+ *
+ * @return PID of the dissemination thread.
+ * @return < 0 on error.
+ */
+int meshconf_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Register a configuration entry handler
+ *
+ * @pre @p handler != NULL and @p handler->apply != NULL
+ */
+void meshconf_register(meshconf_handler_t *handler);
+
+/**
+ * @brief   Set @p key to @p value and disseminate the new configuration
+ *
+ * Bumps the configuration version, the value is applied locally right away.
+ *
+ * @return 0 on success.
+ * @return -EINVAL if @p len is larger than 255.
+ * @return -ENOSPC if the configuration would grow past
+ *         @ref CONFIG_MESHCONF_MAX_LEN.
+ * @return -EAGAIN if the dissemination thread couldn't be notified, the new
+ *         configuration is stored and goes out with the next advertisement,
+ *         but the local handlers weren't called.
+ */
+int meshconf_update(uint8_t key, const void *value, size_t len);
+
+/**
+ * @brief   Get the value of @p key
+ *
+ * @return Value length.
+ * @return -ENOENT if @p key isn't set.
+ * @return -ENOBUFS if @p size is too small.
+ */
+int meshconf_get(uint8_t key, void *value, size_t size);
+
+/**
+ * @brief   Current configuration version
+ */
+uint16_t meshconf_version(void);
+
+/**
+ * @brief   Print the configuration and the dissemination state
+ */
+void meshconf_print(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_MESHCONF_H */
+/** @} */
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_meshtrace Mesh traceroute
+ * @ingroup     net
+ * @brief       Path, per hop latency and route state towards a destination
+ *
+ * Walks the path a flow takes through the mesh, hop by hop:
+ *
+ * - an ICMPv6 Echo Request is sent to the destination with a hop limit of
+ *   1, 2, 3... The router where it runs out answers with a Time Exceeded
+ *   message, which gives its address and the round trip time to it. The
+ *   destination itself answers with an Echo Reply.
+ * - that router is then asked, on @ref CONFIG_MESHTRACE_PORT, for its Local
+ *   Route Set entry towards the destination: next hop, metric, sequence
+ *   number, route state, and the RSSI and LQI of the link to the next hop.
+ *
+ * Every router of the path has to run this module to answer the queries, and
+ * `gnrc_icmpv6_error` to send the Time Exceeded messages. Hops that don't
+ * answer are reported without a route.
+ *
+ * The route of this router is available with @ref meshtrace_route, VAINA
+ * serves it to the host on the SLIP interface.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Mesh traceroute
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_MESHTRACE_H
+#define NET_MESHTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   UDP port of the route queries
+ */
+#ifndef CONFIG_MESHTRACE_PORT
+#define CONFIG_MESHTRACE_PORT (6272)
+#endif
+
+/**
+ * @brief   Time (ms) to wait for each probe and query
+ */
+#ifndef CONFIG_MESHTRACE_TIMEOUT
+#define CONFIG_MESHTRACE_TIMEOUT (2000)
+#endif
+
+/**
+ * @brief   Default largest number of hops
+ */
+#ifndef CONFIG_MESHTRACE_MAX_HOPS
+#define CONFIG_MESHTRACE_MAX_HOPS (16)
+#endif
+
+/**
+ * @brief   How a router reaches the destination
+ */
+typedef enum {
+    MESHTRACE_ROUTE = 0,    /**< Through the next hop */
+    MESHTRACE_TARGET = 1,   /**< It's the router or one of its clients */
+    MESHTRACE_NO_ROUTE = 2, /**< No route, or no answer */
+} meshtrace_status_t;
+
+/**
+ * @brief   Route of a router towards the destination
+ */
+typedef struct {
+    ipv6_addr_t next_hop;   /**< Next hop, with @ref MESHTRACE_ROUTE */
+    uint16_t seqnum;        /**< Destination SeqNum */
+    uint8_t status;         /**< A @ref meshtrace_status_t */
+    uint8_t state;          /**< Route state, `ROUTE_STATE_*` */
+    uint8_t metric_type;    /**< Metric type */
+    uint8_t metric;         /**< Metric to the destination */
+    int8_t rssi;            /**< RSSI of the link to the next hop, in dBm */
+    uint8_t lqi;            /**< LQI of the link to the next hop, 0 unknown */
+} meshtrace_route_t;
+
+/**
+ * @brief   A hop of the path
+ */
+typedef struct {
+    ipv6_addr_t addr;       /**< Router address */
+    uint32_t rtt;           /**< Round trip time (us) */
+    uint8_t hop;            /**< Distance, 0 for this router */
+    bool answered;          /**< Did the router answer the probe? */
+    meshtrace_route_t route;    /**< Its route to the destination */
+} meshtrace_hop_t;
+
+/**
+ * @brief   Called for each hop of the path
+ *
+ * @param[in] hop The hop.
+ * @param[in] arg Argument given to @ref meshtrace_run.
+ */
+typedef void (*meshtrace_cb_t)(const meshtrace_hop_t *hop, void *arg);
+
+/**
+ * @brief   Initialize the mesh traceroute
+ *
+ * Answers the route queries of other routers, from the
+ * @ref EVENT_PRIO_MEDIUM event thread.
+ *
+ * @pre @p netif != NULL
+ *
+ * @param[in] netif Mesh interface.
+ *
+ * @return 0 on success.
+ * @return negative errno on failure.
+ */
+int meshtrace_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Get the route of this router towards @p dst
+ *
+ * Waits for the AODVv2 client and route tables if they're being updated,
+ * so a client isn't reported without a route, only call it from a thread.
+ *
+ * @pre (@p dst != NULL) && (@p route != NULL)
+ *
+ * @param[in]  dst   Destination.
+ * @param[out] route The route, status @ref MESHTRACE_NO_ROUTE if there's
+ *                   none.
+ */
+void meshtrace_route(const ipv6_addr_t *dst, meshtrace_route_t *route);
+
+/**
+ * @brief   Trace the path towards @p dst
+ *
+ * Blocks the calling thread, which must have a message queue, until @p dst
+ * answers or after @p max_hops hops. @p cb is first called with this router
+ * (hop 0), then for every hop.
+ *
+ * @pre (@p dst != NULL) && (@p cb != NULL)
+ *
+ * @param[in] dst      Destination.
+ * @param[in] max_hops Largest number of hops.
+ * @param[in] cb       Called for each hop.
+ * @param[in] arg      Argument of @p cb.
+ *
+ * @return Number of hops to @p dst.
+ * @return -ETIMEDOUT if @p dst wasn't reached.
+ * @return -EHOSTUNREACH if a router had no route to @p dst.
+ * @return -EBUSY if a trace is already running.
+ * @return -ENOTCONN if @ref meshtrace_init wasn't called.
+ * @return -ENOMEM if a probe couldn't be allocated.
+ */
+int meshtrace_run(const ipv6_addr_t *dst, uint8_t max_hops, meshtrace_cb_t cb,
+                  void *arg);
+
+/**
+ * @brief   Name of a route state
+ *
+ * @param[in] state A `ROUTE_STATE_*`.
+ */
+const char *meshtrace_state_name(uint8_t state);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_MESHTRACE_H */
+/** @} */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_nbr Neighbor link table
+ * @ingroup     net
+ * @brief       Per neighbor link state of the mesh interface
+ *
+ * Keeps link quality information for every neighbor heard on the mesh
+ * interface, keyed by link layer address. The table hooks into the
+ * interface's send and receive paths, and applies per neighbor transmit
+ * settings (see @ref net_tpc and @ref net_arq) to unicast frames.
+ *
+ * The TX status reported by the device (ACKed, no ACK, channel busy) is
+ * credited to the destination of the last unicast frame, which assumes the
+ * device reports it before the next frame is sent.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Neighbor link table
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_NBR_H
+#define NET_NBR_H
+
+#include <stdint.h>
+
+#include "kernel_defines.h"
+#include "net/gnrc/netif.h"
+
+#if IS_USED(MODULE_TPC)
+#include "net/tpc.h"
+#endif
+
+#if IS_USED(MODULE_ARQ)
+#include "net/arq.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of neighbors tracked
+ */
+#ifndef CONFIG_NBR_NUMOF
+#define CONFIG_NBR_NUMOF (16)
+#endif
+
+/**
+ * @brief   Maximum link layer address length
+ */
+#define NBR_L2ADDR_MAX_LEN (8U)
+
+/**
+ * @brief   A neighbor
+ */
+typedef struct {
+    uint8_t l2addr[NBR_L2ADDR_MAX_LEN]; /**< Link layer address */
+    uint8_t l2addr_len;                 /**< Length of l2addr, 0 if unused */
+    uint8_t lqi;                        /**< LQI of the last frame */
+    int16_t rssi;                       /**< RSSI of the last frame */
+    uint32_t last_seen;                 /**< Last frame received (ms) */
+    uint32_t rx_frames;                 /**< Frames received */
+    uint32_t tx_frames;                 /**< Unicast frames sent */
+#if IS_USED(MODULE_TPC) || defined(DOXYGEN)
+    tpc_link_t tpc;                     /**< Transmit power control */
+    uint32_t tpc_updated;               /**< Last full power frame (ms) */
+    int16_t tx_power;                   /**< Power of the last frame sent */
+#endif
+#if IS_USED(MODULE_ARQ) || defined(DOXYGEN)
+    arq_link_t arq;                     /**< Retransmission control */
+    uint32_t tx_acked;                  /**< Unicast frames acknowledged */
+    uint32_t tx_noack;                  /**< Unicast frames not acknowledged */
+    uint32_t tx_busy;                   /**< Frames dropped, channel busy */
+    uint32_t tx_attempts;               /**< Transmissions, retries included */
+    uint16_t arq_changes;               /**< Retransmission setting changes */
+#endif
+} nbr_t;
+
+/**
+ * @brief   Start tracking neighbors on @p netif
+ *
+ * Adds a @ref net_netif_hook to @p netif that updates the table on every
+ * received frame and applies the per neighbor settings before sending.
+ * Only call it once.
+ *
+ * @pre @p netif != NULL
+ *
+ * @return 0 on success.
+ * @return -EALREADY if already initialized.
+ * @return -ENOSPC if @ref netif_hook_add fails.
+ */
+int nbr_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Get a copy of a neighbor
+ *
+ * @pre (@p l2addr != NULL) && (@p nbr != NULL)
+ *
+ * @param[in]  l2addr     Link layer address.
+ * @param[in]  l2addr_len Length of @p l2addr.
+ * @param[out] nbr        Neighbor.
+ *
+ * @return 0 on success.
+ * @return -ENOENT if the neighbor isn't on the table.
+ */
+int nbr_get(const uint8_t *l2addr, size_t l2addr_len, nbr_t *nbr);
+
+/**
+ * @brief   Print the neighbor table
+ */
+void nbr_print(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_NBR_H */
+/** @} */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_netif_hook Network interface hooks
+ * @ingroup     net
+ * @brief       Send, receive and set hooks on a GNRC network interface
+ *
+ * Several modules look at or change the frames of the mesh and SLIP
+ * interfaces on their way between the stack and the device. Instead of each
+ * of them replacing the operations of the interface, they register a hook
+ * here, and the operations of an interface are replaced once, the first
+ * time a hook is added to it.
+ *
+ * Hooks run on the interface thread, ordered by @ref netif_hook_t::prio: a
+ * frame being sent goes through the hooks from the highest priority down to
+ * the device, a received frame from the device up to the highest priority.
+ * Each hook passes the frame on with @ref netif_hook_send,
+ * @ref netif_hook_recv or @ref netif_hook_set, or consumes it. The
+ * priorities of the modules of this firmware are defined below, so their
+ * order is in one place.
+ *
+ * The frames are the ones the interface sends and receives, on a 6LoWPAN
+ * interface they are already compressed, @ref netif_hook_ipv6_hdr reads
+ * their IPv6 header either way.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Network interface hooks
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_NETIF_HOOK_H
+#define NET_NETIF_HOOK_H
+
+#include <stdint.h>
+
+#include "net/gnrc/netapi.h"
+#include "net/gnrc/netif.h"
+#include "net/gnrc/pkt.h"
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Interfaces that can have hooks
+ */
+#ifndef CONFIG_NETIF_HOOK_NETIF_NUMOF
+#define CONFIG_NETIF_HOOK_NETIF_NUMOF (2)
+#endif
+
+/**
+ * @name    Hook priorities
+ *
+ * Lower is closer to the device.
+ * @{
+ */
+/**
+ * @brief   @ref net_timesync, stamps its beacons right before the device
+ *          sends them
+ */
+#define NETIF_HOOK_PRIO_TIMESYNC    (5)
+/**
+ * @brief   @ref net_nbr, applies the per neighbor settings right before the
+ *          device sends
+ */
+#define NETIF_HOOK_PRIO_NBR         (10)
+/**
+ * @brief   @ref net_airtime, counts every frame the device sends, the
+ *          broadcast copies of @ref net_dutycycle included
+ */
+#define NETIF_HOOK_PRIO_AIRTIME     (20)
+/**
+ * @brief   @ref net_dutycycle
+ */
+#define NETIF_HOOK_PRIO_DUTYCYCLE   (30)
+/**
+ * @brief   Client learning of @ref net_aodvv2
+ */
+#define NETIF_HOOK_PRIO_AODVV2      (40)
+/**
+ * @brief   @ref net_slipcredit, sees the frames the stack hands over
+ */
+#define NETIF_HOOK_PRIO_SLIPCREDIT  (50)
+/** @} */
+
+/**
+ * @brief   Hook forward declaration
+ */
+typedef struct netif_hook netif_hook_t;
+
+/**
+ * @brief   Hook on the operations of a network interface
+ *
+ * Callbacks that aren't needed are NULL. The structure must stay valid
+ * while the interface is used.
+ */
+struct netif_hook {
+    netif_hook_t *next;     /**< Next hook towards the device, set by
+                                 @ref netif_hook_add */
+    gnrc_netif_t *netif;    /**< Interface, set by @ref netif_hook_add */
+    /**
+     * @brief   Sends @p pkt, see gnrc_netif_ops_t::send
+     */
+    int (*send)(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+    /**
+     * @brief   Receives a frame, see gnrc_netif_ops_t::recv
+     */
+    gnrc_pktsnip_t *(*recv)(netif_hook_t *hook);
+    /**
+     * @brief   Sets an option, see gnrc_netif_ops_t::set
+     */
+    int (*set)(netif_hook_t *hook, const gnrc_netapi_opt_t *opt);
+    uint8_t prio;           /**< Priority, `NETIF_HOOK_PRIO_*` */
+};
+
+/**
+ * @brief   Add @p hook to @p netif
+ *
+ * @pre (@p netif != NULL) && (@p hook != NULL)
+ *
+ * @param[in] netif The interface.
+ * @param[in] hook  The hook, with its callbacks and priority set.
+ *
+ * @return 0 on success.
+ * @return -ENOSPC if there are already @ref CONFIG_NETIF_HOOK_NETIF_NUMOF
+ *         interfaces with hooks.
+ */
+int netif_hook_add(gnrc_netif_t *netif, netif_hook_t *hook);
+
+/**
+ * @brief   Pass @p pkt to the hook after @p hook, or the interface
+ *
+ * Only call it from the send callback of @p hook.
+ *
+ * @return What gnrc_netif_ops_t::send returns.
+ */
+int netif_hook_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+
+/**
+ * @brief   Receive a frame through the hooks after @p hook
+ *
+ * Only call it from the receive callback of @p hook.
+ *
+ * @return What gnrc_netif_ops_t::recv returns.
+ */
+gnrc_pktsnip_t *netif_hook_recv(netif_hook_t *hook);
+
+/**
+ * @brief   Pass @p opt to the hook after @p hook, or the interface
+ *
+ * Only call it from the set callback of @p hook.
+ *
+ * @return What gnrc_netif_ops_t::set returns.
+ */
+int netif_hook_set(netif_hook_t *hook, const gnrc_netapi_opt_t *opt);
+
+/**
+ * @brief   IPv6 header of a frame
+ */
+typedef struct {
+    ipv6_addr_t src;    /**< Source address */
+    ipv6_addr_t dst;    /**< Destination address */
+    uint16_t src_port;  /**< UDP source port, 0 if not UDP */
+    uint16_t dst_port;  /**< UDP destination port, 0 if not UDP */
+    uint8_t nh;         /**< Next header */
+    uint8_t offset;     /**< Offset of what follows the IPv6 header, and the
+                             UDP one for UDP, netif headers excluded */
+    uint8_t udp_csum;   /**< Offset of the UDP checksum, 0 if not UDP or
+                             elided */
+} netif_hook_ipv6_t;
+
+/**
+ * @brief   Read the IPv6 header of a frame going through @p hook
+ *
+ * Reads uncompressed IPv6 packets, and 6LoWPAN IPHC (RFC 6282) ones with
+ * an uncompressed next header or a compressed UDP header, the first
+ * fragment of a packet included. Elided addresses are derived from the link
+ * layer addresses of the netif header, or of the interface if the netif
+ * header has no source (a frame being sent).
+ *
+ * @pre (@p hook != NULL) && (@p pkt != NULL) && (@p hdr != NULL)
+ *
+ * @param[in] hook  The hook.
+ * @param[in] pkt   The frame.
+ * @param[out] hdr  The header.
+ *
+ * @return 0 on success.
+ * @return -ENOENT if @p pkt doesn't start an IPv6 packet (e.g. a further
+ *         fragment, or a frame of another protocol).
+ * @return -ENOTSUP if its compression isn't supported (e.g. an unknown
+ *         context, a compressed extension header).
+ */
+int netif_hook_ipv6_hdr(const netif_hook_t *hook, const gnrc_pktsnip_t *pkt,
+                        netif_hook_ipv6_t *hdr);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_NETIF_HOOK_H */
+/** @} */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_routeadv Mesh route advertisement
+ * @ingroup     net
+ * @brief       Advertise mesh routes to wired hosts with RA Route
+ *              Information Options
+ *
+ * Sends unsolicited Router Advertisements on the wired (SLIP) interface
+ * carrying one Route Information Option (RFC 4191) per route added with
+ * @ref routeadv_add, so hosts learn the mesh destinations without static
+ * routes or VAINA. The Router Lifetime is 0, the node doesn't become the
+ * host's default router.
+ *
+ * Changes are advertised incrementally, an RA only carries the routes added
+ * or deleted (with a lifetime of 0) since the previous one, and RAs are at
+ * least @ref CONFIG_ROUTEADV_MIN_INTERVAL apart. Every
+ * @ref CONFIG_ROUTEADV_REFRESH_INTERVAL seconds all routes are advertised
+ * again, for hosts that just came up.
+ *
+ * Linux hosts only take routes up to `accept_ra_rt_info_max_plen` long,
+ * which defaults to 0, `dist/tools/vaina/start_network.sh` sets it to 128.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Mesh route advertisement
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_ROUTEADV_H
+#define NET_ROUTEADV_H
+
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of routes advertised
+ */
+#ifndef CONFIG_ROUTEADV_NUMOF
+#define CONFIG_ROUTEADV_NUMOF (16)
+#endif
+
+/**
+ * @brief   Minimum time (ms) between two RAs
+ *
+ * MIN_DELAY_BETWEEN_RAS of RFC 4861.
+ */
+#ifndef CONFIG_ROUTEADV_MIN_INTERVAL
+#define CONFIG_ROUTEADV_MIN_INTERVAL (3000)
+#endif
+
+/**
+ * @brief   Time (s) between two RAs with all the routes
+ */
+#ifndef CONFIG_ROUTEADV_REFRESH_INTERVAL
+#define CONFIG_ROUTEADV_REFRESH_INTERVAL (60)
+#endif
+
+/**
+ * @brief   Start advertising on @p netif
+ *
+ * Routes added before are advertised right away.
+ *
+ * @pre @p netif != NULL
+ *
+ * @param[in] netif Interface of the hosts.
+ *
+ * @return 0 on success.
+ * @return -EALREADY if already initialized.
+ */
+int routeadv_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Add or update a route
+ *
+ * @pre @p pfx != NULL
+ *
+ * @param[in] pfx      Route destination.
+ * @param[in] pfx_len  Destination prefix length.
+ * @param[in] lifetime Lifetime of the route in seconds, 0 for infinite.
+ *
+ * @return 0 on success.
+ * @return -ENOSPC if @ref CONFIG_ROUTEADV_NUMOF routes are advertised.
+ */
+int routeadv_add(const ipv6_addr_t *pfx, uint8_t pfx_len, uint32_t lifetime);
+
+/**
+ * @brief   Delete a route
+ *
+ * The route is advertised once more with a lifetime of 0.
+ *
+ * @pre @p pfx != NULL
+ *
+ * @param[in] pfx     Route destination.
+ * @param[in] pfx_len Destination prefix length.
+ */
+void routeadv_del(const ipv6_addr_t *pfx, uint8_t pfx_len);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_ROUTEADV_H */
+/** @} */
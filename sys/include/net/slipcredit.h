@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_slipcredit SLIP flow control
+ * @ingroup     net
+ * @brief       Credit-based flow control of the host on the SLIP link
+ *
+ * The host can write to the serial line far faster than the radio
+ * forwards, the packets it sends beyond that are dropped in the packet
+ * buffer or the interface queues, and the host transport never learns why.
+ * With this module the node tells the host how many more frames it may
+ * send, so they wait in the host queues instead.
+ *
+ * Up to @ref CONFIG_SLIPCREDIT_WINDOW frames from the host to the mesh can
+ * be in the node at a time. A frame leaves when the mesh interface sends a
+ * packet from the same source, or after @ref CONFIG_SLIPCREDIT_TIMEOUT ms
+ * if it never does (no route, dropped). Frames for the node itself leave
+ * right away. The source is read with @ref netif_hook_ipv6_hdr, so a
+ * packet 6LoWPAN compresses and fragments counts once, when its first
+ * fragment is sent.
+ *
+ * The node sends a credit frame on the SLIP link whenever a frame leaves:
+ *
+ * | Byte | Content                                                     |
+ * |------|-------------------------------------------------------------|
+ * | 0    | @ref SLIPCREDIT_FRAME_START                                 |
+ * | 1-2  | Frames received from the host, big endian, wraps around     |
+ * | 3    | Frames the node can take after those                        |
+ * | 4    | @ref CONFIG_SLIPCREDIT_WINDOW                               |
+ *
+ * The host may send as many frames as byte 3 says, minus the ones it sent
+ * after the count of bytes 1-2. A host that never received a credit frame
+ * isn't limited, so hosts and nodes without flow control still work
+ * together. `vaina bridge` implements the host side.
+ *
+ * @{
+ *
+ * @file
+ * @brief       SLIP flow control
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_SLIPCREDIT_H
+#define NET_SLIPCREDIT_H
+
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Frames from the host to the mesh the node takes at a time
+ */
+#ifndef CONFIG_SLIPCREDIT_WINDOW
+#define CONFIG_SLIPCREDIT_WINDOW (8)
+#endif
+
+/**
+ * @brief   Time (ms) after which a frame that wasn't sent on the mesh
+ *          interface is taken as dropped
+ */
+#ifndef CONFIG_SLIPCREDIT_TIMEOUT
+#define CONFIG_SLIPCREDIT_TIMEOUT (2000)
+#endif
+
+/**
+ * @brief   First byte of a credit frame
+ *
+ * Not an IPv6 packet, nor a `slipdev_stdio` frame (0x0a).
+ */
+#define SLIPCREDIT_FRAME_START (0x0c)
+
+/**
+ * @brief   Length of a credit frame
+ */
+#define SLIPCREDIT_FRAME_LEN (5)
+
+/**
+ * @brief   Counters
+ */
+typedef struct {
+    uint32_t received;  /**< Frames received from the host */
+    uint32_t local;     /**< Of those, for the node itself */
+    uint32_t sent;      /**< Frames sent on the mesh interface */
+    uint32_t expired;   /**< Frames taken as dropped */
+    uint32_t credits;   /**< Credit frames sent */
+    uint8_t in_flight;  /**< Frames in the node now */
+} slipcredit_stats_t;
+
+/**
+ * @brief   Start the flow control of @p slip
+ *
+ * Adds a @ref net_netif_hook to @p slip and @p mesh. Only call it once.
+ *
+ * @param[in] slip The SLIP interface.
+ * @param[in] mesh The interface the host frames are forwarded on.
+ *
+ * @return 0 on success.
+ * @return -EINVAL if an interface is missing.
+ * @return -EALREADY if already initialized.
+ * @return -ENOSPC if @ref netif_hook_add fails.
+ */
+int slipcredit_init(gnrc_netif_t *slip, gnrc_netif_t *mesh);
+
+/**
+ * @brief   Get a copy of the counters
+ *
+ * @pre @p stats != NULL
+ */
+void slipcredit_stats(slipcredit_stats_t *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_SLIPCREDIT_H */
+/** @} */
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_timesync Mesh time synchronization
+ * @ingroup     net
+ * @brief       Flooding time synchronization, for one-way latency
+ *              measurements
+ *
+ * Keeps a mesh-wide time in the spirit of FTSP (Maróti et al., SenSys
+ * 2004):
+ *
+ * - The node with the lowest short address is the root, its clock is the
+ *   global time. A node that doesn't hear from the root for
+ *   @ref CONFIG_TIMESYNC_ROOT_TIMEOUT periods takes over, keeping the global
+ *   time it had estimated.
+ * - Every @ref CONFIG_TIMESYNC_PERIOD seconds the root, and every node
+ *   already synchronized, broadcasts a beacon with its global time to the
+ *   neighbors. Beacons carry a sequence number set by the root so a node
+ *   only takes the first copy of each round.
+ * - Each node fits the last @ref CONFIG_TIMESYNC_ENTRIES (local time,
+ *   global time) pairs with a linear regression, which gives both the
+ *   offset and the drift of its clock, so the error stays bounded between
+ *   beacons. Pairs farther than @ref CONFIG_TIMESYNC_MAX_ERROR from the
+ *   estimate are dropped, a few in a row restart the estimate.
+ *
+ * A beacon is stamped right before the interface sends it, through a
+ * @ref net_netif_hook, so each copy @ref net_dutycycle repeats carries the
+ * time it leaves with and queuing in the stack doesn't count. A received
+ * beacon is stamped when the thread gets it, and channel access isn't
+ * seen by either side, so these still add to the error, a few
+ * milliseconds per hop under load. @ref timesync_info_t::error
+ * reports how far the pairs are from the fitted line.
+ *
+ * The thread also answers one-way latency probes, see
+ * @ref timesync_probe_listen, used by the `udp latency` shell command.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Mesh time synchronization
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_TIMESYNC_H
+#define NET_TIMESYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "net/gnrc/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   UDP port of the beacons
+ */
+#ifndef CONFIG_TIMESYNC_PORT
+#define CONFIG_TIMESYNC_PORT (6271)
+#endif
+
+/**
+ * @brief   Time between two beacons (s)
+ */
+#ifndef CONFIG_TIMESYNC_PERIOD
+#define CONFIG_TIMESYNC_PERIOD (10)
+#endif
+
+/**
+ * @brief   Periods without a beacon of the root before taking over
+ */
+#ifndef CONFIG_TIMESYNC_ROOT_TIMEOUT
+#define CONFIG_TIMESYNC_ROOT_TIMEOUT (5)
+#endif
+
+/**
+ * @brief   Reference pairs kept for the regression
+ */
+#ifndef CONFIG_TIMESYNC_ENTRIES
+#define CONFIG_TIMESYNC_ENTRIES (8)
+#endif
+
+/**
+ * @brief   Pairs needed to be synchronized, and to send beacons
+ */
+#ifndef CONFIG_TIMESYNC_MIN_ENTRIES
+#define CONFIG_TIMESYNC_MIN_ENTRIES (3)
+#endif
+
+/**
+ * @brief   Largest distance (us) of a new pair from the estimate
+ */
+#ifndef CONFIG_TIMESYNC_MAX_ERROR
+#define CONFIG_TIMESYNC_MAX_ERROR (20000)
+#endif
+
+/**
+ * @brief   Stack size for the time synchronization thread
+ */
+#ifndef CONFIG_TIMESYNC_STACK_SIZE
+#define CONFIG_TIMESYNC_STACK_SIZE (1536)
+#endif
+
+/**
+ * @brief   Priority for the time synchronization thread
+ */
+#ifndef CONFIG_TIMESYNC_PRIO
+#define CONFIG_TIMESYNC_PRIO (7)
+#endif
+
+/**
+ * @brief   Message queue size for the time synchronization thread
+ */
+#ifndef CONFIG_TIMESYNC_MSG_QUEUE_SIZE
+#define CONFIG_TIMESYNC_MSG_QUEUE_SIZE (8)
+#endif
+
+/**
+ * @brief   Synchronization state
+ */
+typedef struct {
+    uint16_t id;        /**< Short address of this node */
+    uint16_t root;      /**< Short address of the root */
+    uint16_t seq;       /**< Last beacon round */
+    uint8_t hops;       /**< Hops from the root */
+    uint8_t entries;    /**< Reference pairs */
+    bool synced;        /**< Is the global time known? */
+    int32_t skew_ppb;   /**< Local clock drift (ppb) */
+    uint32_t error;     /**< Largest pair distance from the estimate (us) */
+} timesync_info_t;
+
+/**
+ * @brief   Initialize time synchronization
+ *
+ * @pre @p netif != NULL
+ *
+ * @param[in] netif Mesh interface.
+ *
+ * @return PID of the time synchronization thread.
+ * @return negative errno on failure.
+ */
+int timesync_init(gnrc_netif_t *netif);
+
+/**
+ * @brief   Convert a local time to the global time
+ *
+ * @pre @p global != NULL
+ *
+ * @param[in]  local  Local time, from `xtimer_now_usec64()`.
+ * @param[out] global Global time (us), @p local if not synchronized.
+ *
+ * @return 0 on success.
+ * @return -EAGAIN if not synchronized yet.
+ */
+int timesync_global(uint64_t local, uint64_t *global);
+
+/**
+ * @brief   Get the global time
+ *
+ * @pre @p now != NULL
+ *
+ * @param[out] now Global time (us), the local time if not synchronized.
+ *
+ * @return 0 on success.
+ * @return -EAGAIN if not synchronized yet.
+ */
+int timesync_now(uint64_t *now);
+
+/**
+ * @brief   Get the synchronization state
+ *
+ * @pre @p info != NULL
+ */
+void timesync_info(timesync_info_t *info);
+
+/**
+ * @brief   Answer one-way latency probes on UDP @p port
+ *
+ * A probe starts with the global time it was sent at, as a big endian 64
+ * bit number of microseconds. The latency, source and remaining hop limit
+ * of every probe are printed.
+ *
+ * @param[in] port UDP port, 0 to stop.
+ *
+ * @return 0 on success.
+ * @return -ENOTCONN if @ref timesync_init wasn't called.
+ */
+int timesync_probe_listen(uint16_t port);
+
+/**
+ * @brief   Print the synchronization state
+ */
+void timesync_print(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_TIMESYNC_H */
+/** @} */
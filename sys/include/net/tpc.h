@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @defgroup    net_tpc Transmit Power Control
+ * @ingroup     net
+ * @brief       Per neighbor adaptive transmit power control
+ *
+ * Every router sends broadcasts (RREQs, multicast) at full power, so a
+ * broadcast received from a neighbor measures the path loss of that link:
+ * `path_loss = max_dbm - rssi`. The controller keeps a filtered path loss per
+ * link and picks the lowest power level that still delivers
+ * @ref CONFIG_TPC_TARGET_RSSI plus a margin at the neighbor. Links are
+ * assumed symmetric and every router is assumed to share the same maximum
+ * power.
+ *
+ * This controller doesn't depend on any radio, power is applied to unicast
+ * frames by @ref net_nbr.
+ *
+ * @{
+ *
+ * @file
+ * @brief       Transmit Power Control
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef NET_TPC_H
+#define NET_TPC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Lowest RSSI (in dBm) the neighbor should receive our frames with
+ */
+#ifndef CONFIG_TPC_TARGET_RSSI
+#define CONFIG_TPC_TARGET_RSSI (-95)
+#endif
+
+/**
+ * @brief   Margin (in dB) kept above the target, also used as hysteresis
+ */
+#ifndef CONFIG_TPC_MARGIN
+#define CONFIG_TPC_MARGIN (4)
+#endif
+
+/**
+ * @brief   Path loss filter weight, as a power of two shift
+ *
+ * Every new sample accounts for 1/2^CONFIG_TPC_EWMA_SHIFT of the estimate.
+ */
+#ifndef CONFIG_TPC_EWMA_SHIFT
+#define CONFIG_TPC_EWMA_SHIFT (3)
+#endif
+
+/**
+ * @brief   Time (in seconds) without a full power frame from a neighbor
+ *          after which its frames are sent at full power again
+ */
+#ifndef CONFIG_TPC_TIMEOUT
+#define CONFIG_TPC_TIMEOUT (120)
+#endif
+
+/**
+ * @brief   Path loss is unknown
+ */
+#define TPC_PATH_LOSS_UNKNOWN (INT16_MIN)
+
+/**
+ * @brief   Power control state of a link
+ */
+typedef struct {
+    int16_t path_loss; /**< Filtered path loss in 1/16 dB */
+    uint8_t level;     /**< Selected power level index */
+} tpc_link_t;
+
+/**
+ * @brief   Initialize a link, it will use full power
+ *
+ * @pre @p link != NULL
+ */
+void tpc_link_init(tpc_link_t *link);
+
+/**
+ * @brief   Feed a frame received from the neighbor
+ *
+ * @pre @p link != NULL
+ *
+ * @param[in] link    Link.
+ * @param[in] tx_dbm  Power the neighbor sent the frame with.
+ * @param[in] rssi    RSSI of the frame.
+ */
+void tpc_link_update(tpc_link_t *link, int16_t tx_dbm, int16_t rssi);
+
+/**
+ * @brief   Select the power level for the next frame to the neighbor
+ *
+ * The power is only lowered when the lower level still leaves
+ * @ref CONFIG_TPC_MARGIN above the target, and raised as soon as the current
+ * one falls below the target, which keeps small RSSI variations from
+ * toggling between two levels.
+ *
+ * @pre (@p link != NULL) && (@p levels != NULL) && (@p numof > 0)
+ *
+ * @param[in] link    Link.
+ * @param[in] levels  Available power levels in dBm, from highest to lowest.
+ * @param[in] numof   Number of levels.
+ *
+ * @return Index on @p levels.
+ */
+uint8_t tpc_link_select(tpc_link_t *link, const int16_t *levels,
+                        unsigned numof);
+
+/**
+ * @brief   Filtered path loss in dB
+ *
+ * @return @ref TPC_PATH_LOSS_UNKNOWN if no frame has been received.
+ */
+static inline int16_t tpc_link_path_loss(const tpc_link_t *link)
+{
+    if (link->path_loss == TPC_PATH_LOSS_UNKNOWN) {
+        return TPC_PATH_LOSS_UNKNOWN;
+    }
+    return (link->path_loss + 8) / 16;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NET_TPC_H */
+/** @} */
@@ -22,6 +22,14 @@
 
 #include "net/gnrc.h"
 
+#if IS_USED(MODULE_AODVV2_LAR)
+#include "net/aodvv2/lar.h"
+#endif
+
+#if IS_USED(MODULE_MESHTRACE)
+#include "net/meshtrace.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -52,6 +60,13 @@ enum {
 #endif
     VAINA_MSG_NIB_ADD = 4,  /**< Add entry to NIB */
     VAINA_MSG_NIB_DEL = 5,  /**< Delete entry from NIB */
+#if IS_USED(MODULE_MESHTRACE)
+    VAINA_MSG_ROUTE_GET = 6,    /**< Get the route to a destination */
+    VAINA_MSG_ROUTE = 7,        /**< Answer to VAINA_MSG_ROUTE_GET */
+#endif
+#if IS_USED(MODULE_AODVV2_LAR)
+    VAINA_MSG_POSITION_SET = 8, /**< Set the router position */
+#endif
 };
 
 /**
@@ -86,6 +101,13 @@ typedef struct {
     ipv6_addr_t ip; /**< IP address to delete */
 } vaina_msg_nib_del_t;
 
+/**
+ * @brief   Route get message
+ */
+typedef struct {
+    ipv6_addr_t ip; /**< Destination */
+} vaina_msg_route_get_t;
+
 /**
  * @brief   VAINA message
  */
@@ -97,11 +119,28 @@ typedef struct {
         vaina_msg_rcs_del_t rcs_del; /**< VAINA_MSG_RCS_DEL */
         vaina_msg_nib_add_t nib_add; /**< VAINA_MSG_NIB_ADD */
         vaina_msg_nib_del_t nib_del; /**< VAINA_MSG_NIB_DEL */
+#if IS_USED(MODULE_MESHTRACE)
+        vaina_msg_route_get_t route_get; /**< VAINA_MSG_ROUTE_GET */
+        meshtrace_route_t route; /**< VAINA_MSG_ROUTE */
+#endif
+#if IS_USED(MODULE_AODVV2_LAR)
+        aodvv2_position_t position_set; /**< VAINA_MSG_POSITION_SET */
+#endif
     } payload; /** Payload of the message */
 } vaina_msg_t;
 
 /**
  * @brief   Initialize VAINA server.
+ *
+ * The server gets its own thread, or with the `vaina_event` module it's
+ * served from the @ref EVENT_PRIO_MEDIUM event thread through asynchronous
+ * sock callbacks, which saves a thread stack when that event thread is
+ * already running (e.g. for `dutycycle`).
+ *
+ * @param[in] netif Interface the requests come from.
+ *
+ * @return PID of the server thread, 0 with `vaina_event`.
+ * @return negative number on failure.
  */
 int vaina_init(gnrc_netif_t *netif);
 
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_airtime
+ * @{
+ *
+ * @file
+ * @brief       Radio airtime accounting
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "net/airtime.h"
+#include "net/aodvv2/rfc5444.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/icmpv6.h"
+#include "net/manet.h"
+#include "net/netif_hook.h"
+#include "net/protnum.h"
+
+#if IS_USED(MODULE_AODVV2)
+#include "net/aodvv2.h"
+#endif
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @name    RFC 5444 packet header flags
+ * @{
+ */
+#define PKT_FLAG_SEQNUM (0x08)
+#define PKT_FLAG_TLV    (0x04)
+/** @} */
+
+/**
+ * @name    6LoWPAN fragment headers (RFC 4944)
+ * @{
+ */
+#define FRAG_DISPATCH_MASK  (0xf8)
+#define FRAG_DISPATCH_1     (0xc0)
+#define FRAG_DISPATCH_N     (0xe0)
+#define FRAG_HDR_LEN        (4)
+/** @} */
+
+/**
+ * @brief   Fragmented packets remembered per direction
+ */
+#define AIRTIME_FRAGS_NUMOF (4)
+
+/**
+ * @brief   Class of a fragmented packet, for its further fragments
+ */
+typedef struct {
+    uint16_t tag;           /**< Datagram tag */
+    uint8_t cls;            /**< Class of the first fragment */
+    bool used;              /**< Slot in use */
+} _frag_t;
+
+static mutex_t _lock = MUTEX_INIT;
+
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook);
+
+static gnrc_netif_t *_netif;
+static netif_hook_t _hook = {
+    .send = _send,
+    .recv = _recv,
+    .prio = NETIF_HOOK_PRIO_AIRTIME,
+};
+
+static airtime_stats_t _stats;
+static uint64_t _since;
+
+/* Only used on the interface thread, [0] received, [1] sent */
+static _frag_t _frags[2][AIRTIME_FRAGS_NUMOF];
+static uint8_t _frags_next[2];
+
+static const char *_names[] = {
+    [AIRTIME_RREQ] = "RREQ",
+    [AIRTIME_RREP] = "RREP",
+    [AIRTIME_RERR] = "RERR",
+    [AIRTIME_RREP_ACK] = "RREP_Ack",
+    [AIRTIME_CONTROL] = "control",
+    [AIRTIME_LOCAL] = "local",
+    [AIRTIME_CLIENT] = "client",
+    [AIRTIME_FORWARD] = "forward",
+};
+
+/* Copies len bytes at offset of the packet, netif headers excluded, returns
+ * false if it's shorter */
+static bool _read(const gnrc_pktsnip_t *snip, size_t offset, void *buf,
+                  size_t len)
+{
+    uint8_t *out = buf;
+
+    for (; snip != NULL && len > 0; snip = snip->next) {
+        if (snip->type == GNRC_NETTYPE_NETIF) {
+            continue;
+        }
+        if (offset >= snip->size) {
+            offset -= snip->size;
+            continue;
+        }
+
+        size_t n = snip->size - offset < len ? snip->size - offset : len;
+        memcpy(out, (const uint8_t *)snip->data + offset, n);
+        out += n;
+        len -= n;
+        offset = 0;
+    }
+
+    return len == 0;
+}
+
+static size_t _len(const gnrc_pktsnip_t *snip)
+{
+    size_t len = 0;
+
+    for (; snip != NULL; snip = snip->next) {
+        if (snip->type != GNRC_NETTYPE_NETIF) {
+            len += snip->size;
+        }
+    }
+
+    return len;
+}
+
+static airtime_class_t _rfc5444_class(const gnrc_pktsnip_t *pkt,
+                                      size_t offset)
+{
+    uint8_t flags;
+    if (!_read(pkt, offset, &flags, sizeof(flags)) ||
+        (flags & PKT_FLAG_TLV)) {
+        return AIRTIME_CONTROL;
+    }
+
+    offset += 1 + ((flags & PKT_FLAG_SEQNUM) ? 2 : 0);
+
+    /* The first message tells what the packet is for */
+    uint8_t type;
+    if (!_read(pkt, offset, &type, sizeof(type))) {
+        return AIRTIME_CONTROL;
+    }
+
+    switch (type) {
+        case RFC5444_MSGTYPE_RREQ:
+            return AIRTIME_RREQ;
+        case RFC5444_MSGTYPE_RREP:
+            return AIRTIME_RREP;
+        case RFC5444_MSGTYPE_RERR:
+            return AIRTIME_RERR;
+        case RFC5444_MSGTYPE_RREP_ACK:
+            return AIRTIME_RREP_ACK;
+        default:
+            return AIRTIME_CONTROL;
+    }
+}
+
+static airtime_class_t _classify_ipv6(const gnrc_pktsnip_t *pkt, bool tx)
+{
+    netif_hook_ipv6_t hdr;
+    if (netif_hook_ipv6_hdr(&_hook, pkt, &hdr) < 0) {
+        return AIRTIME_CONTROL;
+    }
+
+    if (hdr.nh == PROTNUM_UDP && hdr.dst_port == UDP_MANET_PORT) {
+        return _rfc5444_class(pkt, hdr.offset);
+    }
+    else if (hdr.nh == PROTNUM_ICMPV6) {
+        uint8_t type;
+        if (_read(pkt, hdr.offset, &type, sizeof(type)) &&
+            type >= ICMPV6_RTR_SOL && type <= ICMPV6_REDIRECT) {
+            return AIRTIME_CONTROL;
+        }
+    }
+
+    if (ipv6_addr_is_link_local(&hdr.dst) ||
+        ipv6_addr_is_multicast(&hdr.dst)) {
+        return AIRTIME_CONTROL;
+    }
+
+    const ipv6_addr_t *addr = tx ? &hdr.src : &hdr.dst;
+    if (gnrc_netif_ipv6_addr_idx(_netif, addr) >= 0) {
+        return AIRTIME_LOCAL;
+    }
+#if IS_USED(MODULE_AODVV2)
+    if (aodvv2_client_is(addr)) {
+        return AIRTIME_CLIENT;
+    }
+#endif
+
+    return AIRTIME_FORWARD;
+}
+
+static airtime_class_t _classify(const gnrc_pktsnip_t *pkt, bool tx)
+{
+    /* Further fragments carry no IPv6 header, they take the class of the
+     * first one */
+    uint8_t frag[FRAG_HDR_LEN];
+    uint8_t dispatch = 0;
+    uint16_t tag = 0;
+    if (_read(pkt, 0, frag, sizeof(frag))) {
+        dispatch = frag[0] & FRAG_DISPATCH_MASK;
+        tag = byteorder_bebuftohs(&frag[2]);
+    }
+
+    _frag_t *frags = _frags[tx];
+    if (dispatch == FRAG_DISPATCH_N) {
+        for (unsigned i = 0; i < AIRTIME_FRAGS_NUMOF; i++) {
+            if (frags[i].used && frags[i].tag == tag) {
+                return frags[i].cls;
+            }
+        }
+        return AIRTIME_FORWARD;
+    }
+
+    airtime_class_t cls = _classify_ipv6(pkt, tx);
+    if (dispatch == FRAG_DISPATCH_1) {
+        _frag_t *slot = &frags[_frags_next[tx]];
+        _frags_next[tx] = (_frags_next[tx] + 1) % AIRTIME_FRAGS_NUMOF;
+        slot->tag = tag;
+        slot->cls = cls;
+        slot->used = true;
+    }
+
+    return cls;
+}
+
+static void _account(airtime_counter_t *counters, const gnrc_pktsnip_t *pkt,
+                     bool tx)
+{
+    airtime_class_t cls = _classify(pkt, tx);
+    uint32_t bytes = _len(pkt) + CONFIG_AIRTIME_FRAME_OVERHEAD;
+
+    mutex_lock(&_lock);
+    counters[cls].frames++;
+    counters[cls].bytes += bytes;
+    counters[cls].us += (uint64_t)bytes * 8 * US_PER_SEC /
+                        CONFIG_AIRTIME_BITRATE;
+    mutex_unlock(&_lock);
+}
+
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    /* The interface releases it */
+    _account(_stats.tx, pkt, true);
+
+    return netif_hook_send(hook, pkt);
+}
+
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook)
+{
+    gnrc_pktsnip_t *pkt = netif_hook_recv(hook);
+    if (pkt != NULL) {
+        _account(_stats.rx, pkt, false);
+    }
+
+    return pkt;
+}
+
+int airtime_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_netif != NULL) {
+        return -EALREADY;
+    }
+
+    airtime_reset();
+
+    /* Used by the hook as soon as it's added */
+    _netif = netif;
+    int res = netif_hook_add(netif, &_hook);
+    if (res < 0) {
+        _netif = NULL;
+    }
+
+    return res;
+}
+
+void airtime_stats(airtime_stats_t *stats)
+{
+    assert(stats != NULL);
+
+    mutex_lock(&_lock);
+    *stats = _stats;
+    stats->elapsed_ms = (xtimer_now_usec64() - _since) / US_PER_MS;
+    mutex_unlock(&_lock);
+}
+
+void airtime_reset(void)
+{
+    mutex_lock(&_lock);
+    memset(&_stats, 0, sizeof(_stats));
+    _since = xtimer_now_usec64();
+    mutex_unlock(&_lock);
+}
+
+const char *airtime_class_name(airtime_class_t cls)
+{
+    assert(cls < AIRTIME_CLASS_NUMOF);
+
+    return _names[cls];
+}
@@ -21,27 +21,39 @@
  * @}
  */
 
+#include <errno.h>
+
 #include "net/aodvv2.h"
-#include "net/aodvv2/rfc5444.h"
-#include "net/aodvv2/lrs.h"
-#include "net/aodvv2/mcmsg.h"
-#include "net/aodvv2/metric.h"
+#include "net/aodvv2/addr.h"
+#include "net/aodvv2/core.h"
 #include "net/aodvv2/rcs.h"
 #include "net/aodvv2/seqnum.h"
 
 #include "net/gnrc/ipv6.h"
+#include "net/gnrc/ipv6/nib/ft.h"
 #include "net/gnrc/udp.h"
 #include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/netif/internal.h"
 
-#include "mutex.h"
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+#include "net/netif_hook.h"
+#endif
 
-#include "aodvv2_reader.h"
-#include "aodvv2_writer.h"
+#if IS_USED(MODULE_DUTYCYCLE)
+#include "net/dutycycle.h"
+#endif
+
+#if IS_USED(MODULE_ROUTEADV)
+#include "net/routeadv.h"
+#endif
+
+#include "mutex.h"
+#include "xtimer.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-#if ENABLE_DEBUG == 1
+#if ENABLE_DEBUG == 1 && IS_USED(MODULE_OONF_RFC5444_PRINT)
 #include "rfc5444/rfc5444_print.h"
 #endif
 
@@ -68,20 +80,202 @@ static gnrc_netreg_entry_t netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX
                                                                KERNEL_PID_UNDEF);
 
 /**
- * @brief   The RFC5444 packet reader context
+ * @brief   AODVv2 router instance, protected by `_lock`
+ */
+static aodvv2_core_t _core;
+static mutex_t _lock;
+
+/**
+ * @brief   Route discovery requested to the AODVv2 thread
+ */
+typedef struct {
+    ipv6_addr_t orig;   /**< Source of the packet that needs a route */
+    ipv6_addr_t target; /**< Address we want a route to */
+} _route_req_t;
+
+/**
+ * @brief   Copy of the Router Client Set, protected by `_clients_lock`
+ *
+ * For @ref aodvv2_client_is, which the interface threads call. They don't
+ * wait for `_lock`, held by the AODVv2 thread while it sends.
  */
-static struct rfc5444_reader _reader;
-static mutex_t _reader_lock;
+static aodvv2_rcs_t _clients;
+static mutex_t _clients_lock = MUTEX_INIT;
 
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
 /**
- * @brief   The RFC5444 packet writer context
+ * @brief   Client learned from its traffic, protected by `_lock`
  */
-static struct rfc5444_writer _writer;
-static aodvv2_writer_target_t _writer_context;
-static uint8_t _writer_msg_buffer[CONFIG_AODVV2_RFC5444_PACKET_SIZE];
-static uint8_t _writer_msg_addrtlvs[CONFIG_AODVV2_RFC5444_ADDR_TLVS_SIZE];
-static uint8_t _writer_pkt_buffer[CONFIG_AODVV2_RFC5444_PACKET_SIZE];
-static mutex_t _writer_lock;
+typedef struct {
+    ipv6_addr_t addr;   /**< Client address */
+    uint32_t last_seen; /**< Last packet from it (s) */
+    bool used;          /**< Slot in use */
+} _learned_t;
+
+/**
+ * @brief   Prefix clients are learned from
+ */
+typedef struct {
+    ipv6_addr_t pfx;    /**< Prefix */
+    uint8_t pfx_len;    /**< Prefix length */
+} _learn_pfx_t;
+
+static _learned_t _learned[CONFIG_AODVV2_RCS_ENTRIES];
+static _learn_pfx_t _learn_pfx[CONFIG_AODVV2_CLIENT_LEARN_PREFIXES];
+static unsigned _learn_pfx_numof;
+
+/**
+ * @brief   Source address seen on the wired interface, protected by
+ *          `_seen_lock`
+ */
+typedef struct {
+    ipv6_addr_t addr;   /**< Source address */
+    uint32_t seen;      /**< Last packet from it (s) */
+    bool pending;       /**< Not taken by the AODVv2 thread yet */
+    bool used;          /**< Slot in use */
+} _seen_t;
+
+/**
+ * @brief   Sources seen on the wired interface, for the AODVv2 thread
+ *
+ * The interface thread only takes `_seen_lock`, never `_lock`, so it
+ * doesn't wait for the AODVv2 thread processing a message.
+ */
+static _seen_t _seen[CONFIG_AODVV2_CLIENT_LEARN_SEEN];
+static bool _seen_posted;
+static mutex_t _seen_lock = MUTEX_INIT;
+
+/**
+ * @brief   Don't try to learn clients before this time (s), set while the
+ *          Router Client Set is full, protected by `_lock`
+ */
+static uint32_t _learn_hold;
+
+static gnrc_pktsnip_t *_wired_recv(netif_hook_t *hook);
+
+static gnrc_netif_t *_wired;
+static netif_hook_t _wired_hook = {
+    .recv = _wired_recv,
+    .prio = NETIF_HOOK_PRIO_AODVV2,
+};
+
+static xtimer_t _learn_timer;
+static msg_t _learn_timer_msg = { .type = AODVV2_MSG_TYPE_CLIENT_EXPIRE };
+
+/**
+ * @brief   Interval (s) of the idle client check
+ */
+#define LEARN_CHECK_INTERVAL ((CONFIG_AODVV2_CLIENT_LEARN_IDLE / 8) + 1)
+#endif
+
+static void _now(void *ctx, timex_t *now)
+{
+    (void)ctx;
+    xtimer_now_timex(now);
+}
+
+static int _send(void *ctx, const ipv6_addr_t *dst, const void *buf,
+                 size_t len)
+{
+    (void)ctx;
+
+    gnrc_pktsnip_t *payload;
+    gnrc_pktsnip_t *udp;
+    gnrc_pktsnip_t *ip;
+
+    /* Generate our pktsnip with our RFC5444 message */
+    payload = gnrc_pktbuf_add(NULL, buf, len, GNRC_NETTYPE_UNDEF);
+    if (payload == NULL) {
+        DEBUG("aodvv2: couldn't allocate payload\n");
+        return -ENOMEM;
+    }
+
+    /* Build UDP packet */
+    uint16_t port = UDP_MANET_PORT;
+    udp = gnrc_udp_hdr_build(payload, port, port);
+    if (udp == NULL) {
+        DEBUG("aodvv2: unable to allocate UDP header\n");
+        gnrc_pktbuf_release(payload);
+        return -ENOMEM;
+    }
+
+    /* Build IPv6 header */
+    ip = gnrc_ipv6_hdr_build(udp, NULL, dst);
+    if (ip == NULL) {
+        DEBUG("aodvv2: unable to allocate IPv6 header\n");
+        gnrc_pktbuf_release(udp);
+        return -ENOMEM;
+    }
+
+    /* Build netif header */
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG("aodvv2: unable to allocate netif header\n");
+        gnrc_pktbuf_release(ip);
+        return -ENOMEM;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    LL_PREPEND(ip, netif_hdr);
+
+    /* Send packet */
+    int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP,
+                                        GNRC_NETREG_DEMUX_CTX_ALL, ip);
+    if (res < 1) {
+        DEBUG("aodvv2: unable to locate UDP thread\n");
+        gnrc_pktbuf_release(ip);
+        return -ENOTCONN;
+    }
+
+    return 0;
+}
+
+static int _fib_add(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len,
+                    const ipv6_addr_t *next_hop, uint32_t lifetime)
+{
+    (void)ctx;
+    int res = gnrc_ipv6_nib_ft_add(dst, pfx_len, next_hop, _netif->pid,
+                                   lifetime);
+#if IS_USED(MODULE_ROUTEADV)
+    if (res == 0) {
+        routeadv_add(dst, pfx_len, lifetime);
+    }
+#endif
+    return res;
+}
+
+static void _fib_del(void *ctx, const ipv6_addr_t *dst, uint8_t pfx_len)
+{
+    (void)ctx;
+    gnrc_ipv6_nib_ft_del(dst, pfx_len);
+#if IS_USED(MODULE_ROUTEADV)
+    routeadv_del(dst, pfx_len);
+#endif
+}
+
+static void _route_found(void *ctx, const ipv6_addr_t *targ_addr)
+{
+    (void)ctx;
+    aodvv2_buffer_dispatch(targ_addr);
+}
+
+#if IS_USED(MODULE_DUTYCYCLE)
+static void _stay_awake(void *ctx, uint32_t ms)
+{
+    (void)ctx;
+    dutycycle_stay_awake(ms);
+}
+#endif
+
+static const aodvv2_ops_t _ops = {
+    .now = _now,
+    .send = _send,
+    .fib_add = _fib_add,
+    .fib_del = _fib_del,
+    .route_found = _route_found,
+#if IS_USED(MODULE_DUTYCYCLE)
+    .stay_awake = _stay_awake,
+#endif
+};
 
 static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
                         const void *ctx)
@@ -97,7 +291,9 @@ static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
                 gnrc_pktsnip_t *pkt = (gnrc_pktsnip_t *)ctx;
                 ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
 
-                if (aodvv2_rcs_is_client(&ipv6_hdr->src) != NULL) {
+                /* Called with the NIB locked, the AODVv2 thread takes
+                 * _lock and then the NIB, so don't take _lock here */
+                if (aodvv2_client_is(&ipv6_hdr->src)) {
                     if (aodvv2_buffer_pkt_add(ctx_addr, pkt) == 0) {
                         DEBUG("aodvv2: finding route\n");
                         aodvv2_find_route(&ipv6_hdr->src, ctx_addr);
@@ -126,137 +322,298 @@ static void _route_info(unsigned type, const ipv6_addr_t *ctx_addr,
     }
 }
 
-static void _send_rreq(aodvv2_message_t *message, ipv6_addr_t *next_hop)
+static void _find_route(_route_req_t *req)
 {
-    assert(message != NULL);
-    assert(next_hop != NULL);
+    mutex_lock(&_lock);
+    int res = aodvv2_core_find_route(&_core, &req->orig, &req->target);
+    mutex_unlock(&_lock);
+    if (res < 0) {
+        DEBUG("aodvv2: couldn't start route discovery (%d)\n", res);
+    }
+}
 
-    /* Make sure no other thread is using the writer right now */
-    mutex_lock(&_writer_lock);
-    _writer_context.target_addr = *next_hop;
+static void _receive(gnrc_pktsnip_t *pkt)
+{
+    assert(pkt != NULL && pkt->data != NULL && pkt->size > 0);
 
-    aodvv2_writer_send_rreq(&_writer, message);
+#if ENABLE_DEBUG == 1 && IS_USED(MODULE_OONF_RFC5444_PRINT)
+    /* On the stack, debug builds keep no static dump buffer */
+    struct autobuf hexbuf = { 0 };
 
-    rfc5444_writer_flush(&_writer, &_writer_context.target, false);
-    mutex_unlock(&_writer_lock);
+    /* Generate hexdump of packet */
+    abuf_hexdump(&hexbuf, "\t", pkt->data, pkt->size);
+    rfc5444_print_direct(&hexbuf, pkt->data, pkt->size);
+
+    /* Print hexdump to console */
+    DEBUG("%s", abuf_getptr(&hexbuf));
+
+    abuf_free(&hexbuf);
+#endif
+
+    /* Find sender address on IPv6 header */
+    ipv6_addr_t sender;
+    ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
+    assert(ipv6_hdr != NULL);
+    memcpy(&sender, &ipv6_hdr->src, sizeof(ipv6_addr_t));
+
+    mutex_lock(&_lock);
+    if (aodvv2_core_handle_packet(&_core, &sender, pkt->data, pkt->size) < 0) {
+        DEBUG("aodvv2: couldn't handle packet!\n");
+    }
+    mutex_unlock(&_lock);
+
+    gnrc_pktbuf_release(pkt);
 }
 
-static void _send_rrep(aodvv2_message_t *message, ipv6_addr_t *next_hop)
+/* Must be called with _lock held, after every Router Client Set change */
+static void _clients_update(void)
 {
-    assert(message != NULL);
-    assert(next_hop != NULL);
+    mutex_lock(&_clients_lock);
+    _clients = _core.rcs;
+    mutex_unlock(&_clients_lock);
+}
 
-    /* Make sure no other thread is using the writer right now */
-    mutex_lock(&_writer_lock);
-    _writer_context.target_addr = *next_hop;
+static int _client_add(const ipv6_addr_t *addr, uint8_t pfx_len,
+                       uint8_t cost)
+{
+    aodvv2_rcs_entry_t *entry = aodvv2_rcs_add(&_core.rcs, addr, pfx_len,
+                                               cost);
+    if (entry == NULL) {
+        return -ENOSPC;
+    }
+    _clients_update();
 
-    aodvv2_writer_send_rrep(&_writer, message);
+    /* The announcement names us as the router issuing its SeqNum */
+    ipv6_addr_t *ll = gnrc_netif_ipv6_addr_best_src(
+        _netif, &ipv6_addr_all_manet_routers_link_local, false);
+    if (ll != NULL) {
+        aodvv2_core_set_addr(&_core, ll);
+    }
+
+    /* The client may come from another router */
+    aodvv2_core_client_announce(&_core, &entry->addr, entry->pfx_len);
 
-    rfc5444_writer_flush(&_writer, &_writer_context.target, false);
-    mutex_unlock(&_writer_lock);
+    return 0;
 }
 
-static void _send_packet(struct rfc5444_writer *writer,
-                         struct rfc5444_writer_target *iface, void *buffer,
-                         size_t length)
+static void _client_del(const ipv6_addr_t *addr, uint8_t pfx_len)
 {
-#ifdef DEVELHELP
-    assert(writer != NULL && iface != NULL && buffer != NULL && length != 0);
-#else
-    (void)writer;
-#endif
+    aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(&_core.rcs, addr, pfx_len);
+    if (entry != NULL) {
+        /* Copy it, deleting clears the entry */
+        ipv6_addr_t client = entry->addr;
+        uint8_t client_pfx_len = entry->pfx_len;
+
+        aodvv2_rcs_del(&_core.rcs, addr, pfx_len);
+        _clients_update();
+        aodvv2_core_client_withdraw(&_core, &client, client_pfx_len);
+    }
+}
 
-#if ENABLE_DEBUG == 1
-    static struct autobuf hexbuf;
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+static uint32_t _learn_now(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_SEC);
+}
 
-    /* Generate hexdump of packet */
-    abuf_hexdump(&hexbuf, "\t", buffer, length);
-    rfc5444_print_direct(&hexbuf, buffer, length);
+static _learned_t *_learned_find(const ipv6_addr_t *addr)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_learned); i++) {
+        if (_learned[i].used && aodvv2_addr_equal(&_learned[i].addr, addr)) {
+            return &_learned[i];
+        }
+    }
 
-    /* Print hexdump to console */
-    DEBUG("%s", abuf_getptr(&hexbuf));
+    return NULL;
+}
 
-    abuf_free(&hexbuf);
-#endif
+static void _learned_forget(const ipv6_addr_t *addr)
+{
+    _learned_t *learned = _learned_find(addr);
+    if (learned != NULL) {
+        learned->used = false;
+    }
+}
 
-    aodvv2_writer_target_t *ctx = container_of(iface, aodvv2_writer_target_t,
-                                               target);
+static bool _learn_allowed(const ipv6_addr_t *addr)
+{
+    if (aodvv2_addr_is_unspecified(addr) || ipv6_addr_is_multicast(addr) ||
+        ipv6_addr_is_link_local(addr)) {
+        return false;
+    }
 
-    gnrc_pktsnip_t *payload;
-    gnrc_pktsnip_t *udp;
-    gnrc_pktsnip_t *ip;
+    for (unsigned i = 0; i < _learn_pfx_numof; i++) {
+        if (aodvv2_addr_in_prefix(&_learn_pfx[i].pfx, _learn_pfx[i].pfx_len,
+                                  addr)) {
+            return true;
+        }
+    }
 
-    /* Generate our pktsnip with our RFC5444 message */
-    payload = gnrc_pktbuf_add(NULL, buffer, length, GNRC_NETTYPE_UNDEF);
-    if (payload == NULL) {
-        DEBUG("aodvv2: couldn't allocate payload\n");
-        return;
+    return false;
+}
+
+static _seen_t *_seen_find(const ipv6_addr_t *addr)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_seen); i++) {
+        if (_seen[i].used && aodvv2_addr_equal(&_seen[i].addr, addr)) {
+            return &_seen[i];
+        }
     }
 
-    /* Build UDP packet */
-    uint16_t port = UDP_MANET_PORT;
-    udp = gnrc_udp_hdr_build(payload, port, port);
-    if (udp == NULL) {
-        DEBUG("aodvv2: unable to allocate UDP header\n");
-        gnrc_pktbuf_release(payload);
-        return;
+    return NULL;
+}
+
+/* Free slot, or the one the AODVv2 thread took the longest ago */
+static _seen_t *_seen_free(void)
+{
+    _seen_t *slot = NULL;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_seen); i++) {
+        _seen_t *entry = &_seen[i];
+        if (!entry->used) {
+            return entry;
+        }
+        if (!entry->pending &&
+            (slot == NULL || (int32_t)(entry->seen - slot->seen) < 0)) {
+            slot = entry;
+        }
     }
 
-    /* Build IPv6 header */
-    ip = gnrc_ipv6_hdr_build(udp, NULL, &ctx->target_addr);
-    if (ip == NULL) {
-        DEBUG("aodvv2: unable to allocate IPv6 header\n");
-        gnrc_pktbuf_release(udp);
-        return;
+    return slot;
+}
+
+/**
+ * @brief   A packet from @p src arrived on the wired interface
+ *
+ * Runs on the wired interface thread, the source is left to the AODVv2
+ * thread, once per second at most.
+ */
+static void _learn_seen(const ipv6_addr_t *src)
+{
+    uint32_t now = _learn_now();
+    bool post = false;
+
+    mutex_lock(&_seen_lock);
+    _seen_t *entry = _seen_find(src);
+    if (entry == NULL) {
+        entry = _seen_free();
+    }
+    else if (entry->seen == now) {
+        entry = NULL;
     }
 
-    /* Build netif header */
-    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
-    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
-    LL_PREPEND(ip, netif_hdr);
+    /* With every slot pending, the source is taken on its next packet */
+    if (entry != NULL) {
+        entry->addr = *src;
+        entry->seen = now;
+        entry->pending = true;
+        entry->used = true;
+        post = !_seen_posted;
+        _seen_posted = true;
+    }
+    mutex_unlock(&_seen_lock);
+
+    if (post) {
+        msg_t msg = { .type = AODVV2_MSG_TYPE_CLIENT_LEARN };
+        if (msg_try_send(&msg, _pid) < 1) {
+            DEBUG_PUTS("aodvv2: couldn't post learned client");
+            mutex_lock(&_seen_lock);
+            _seen_posted = false;
+            mutex_unlock(&_seen_lock);
+        }
+    }
+}
 
-    /* Send packet */
-    int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP,
-                                        GNRC_NETREG_DEMUX_CTX_ALL, ip);
-    if (res < 1) {
-        DEBUG("aodvv2: unable to locate UDP thread\n");
-        gnrc_pktbuf_release(ip);
-        return;
+static gnrc_pktsnip_t *_wired_recv(netif_hook_t *hook)
+{
+    gnrc_pktsnip_t *pkt = netif_hook_recv(hook);
+    if (pkt == NULL) {
+        return NULL;
+    }
+
+    if (pkt->type == GNRC_NETTYPE_IPV6 && pkt->size >= sizeof(ipv6_hdr_t)) {
+        ipv6_hdr_t *hdr = pkt->data;
+        if (ipv6_hdr_is(hdr)) {
+            _learn_seen(&hdr->src);
+        }
     }
+
+    return pkt;
 }
 
-static void _receive(gnrc_pktsnip_t *pkt)
+/* Refreshes the learned clients, and learns the new ones, that sent on the
+ * wired interface */
+static void _learn_clients(void)
 {
-    assert(pkt != NULL && pkt->data != NULL && pkt->size > 0);
+    _seen_t seen[ARRAY_SIZE(_seen)];
+    unsigned numof = 0;
+
+    mutex_lock(&_seen_lock);
+    _seen_posted = false;
+    for (unsigned i = 0; i < ARRAY_SIZE(_seen); i++) {
+        if (_seen[i].pending) {
+            _seen[i].pending = false;
+            seen[numof++] = _seen[i];
+        }
+    }
+    mutex_unlock(&_seen_lock);
 
-#if ENABLE_DEBUG == 1
-    static struct autobuf hexbuf;
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < numof; i++) {
+        const ipv6_addr_t *addr = &seen[i].addr;
 
-    /* Generate hexdump of packet */
-    abuf_hexdump(&hexbuf, "\t", pkt->data, pkt->size);
-    rfc5444_print_direct(&hexbuf, pkt->data, pkt->size);
+        _learned_t *learned = _learned_find(addr);
+        if (learned != NULL) {
+            learned->last_seen = seen[i].seen;
+            continue;
+        }
 
-    /* Print hexdump to console */
-    DEBUG("%s", abuf_getptr(&hexbuf));
+        if (!_learn_allowed(addr) ||
+            (int32_t)(seen[i].seen - _learn_hold) < 0 ||
+            aodvv2_rcs_is_client(&_core.rcs, addr) != NULL) {
+            continue;
+        }
 
-    abuf_free(&hexbuf);
-#endif
+        for (unsigned j = 0; j < ARRAY_SIZE(_learned); j++) {
+            if (!_learned[j].used) {
+                learned = &_learned[j];
+                break;
+            }
+        }
 
-    /* Find sender address on IPv6 header */
-    ipv6_addr_t sender;
-    ipv6_hdr_t *ipv6_hdr = gnrc_ipv6_get_header(pkt);
-    assert(ipv6_hdr != NULL);
-    memcpy(&sender, &ipv6_hdr->src, sizeof(ipv6_addr_t));
+        if (learned == NULL || _client_add(addr, 128, 1) < 0) {
+            DEBUG_PUTS("aodvv2: router client set is full, not learning");
+            _learn_hold = _learn_now() + 1;
+            continue;
+        }
 
-    mutex_lock(&_reader_lock);
-    aodvv2_rfc5444_handle_packet_prepare(&sender);
-    if (rfc5444_reader_handle_packet(&_reader, pkt->data, pkt->size) != RFC5444_OKAY) {
-        DEBUG("aodvv2: couldn't handle packet!\n");
+        learned->addr = *addr;
+        learned->last_seen = seen[i].seen;
+        learned->used = true;
     }
-    mutex_unlock(&_reader_lock);
+    mutex_unlock(&_lock);
+}
 
-    gnrc_pktbuf_release(pkt);
+static void _learn_expire(void)
+{
+    uint32_t now = _learn_now();
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_learned); i++) {
+        _learned_t *learned = &_learned[i];
+        if (learned->used &&
+            now - learned->last_seen >= CONFIG_AODVV2_CLIENT_LEARN_IDLE) {
+            DEBUG_PUTS("aodvv2: learned client is idle, withdrawing it");
+            learned->used = false;
+            _client_del(&learned->addr, 128);
+        }
+    }
+    mutex_unlock(&_lock);
+
+    xtimer_set_msg(&_learn_timer, LEARN_CHECK_INTERVAL * US_PER_SEC,
+                   &_learn_timer_msg, _pid);
 }
+#endif
 
 static void *_event_loop(void *arg)
 {
@@ -282,7 +639,9 @@ static void *_event_loop(void *arg)
                     memcpy(&m, (aodvv2_msg_t *)msg.content.ptr, sizeof(m));
                     free(msg.content.ptr);
 
-                    _send_rreq(&m.pkt, &m.next_hop);
+                    mutex_lock(&_lock);
+                    aodvv2_core_send_rreq(&_core, &m.pkt, &m.next_hop);
+                    mutex_unlock(&_lock);
                 }
                 break;
 
@@ -293,10 +652,40 @@ static void *_event_loop(void *arg)
                     memcpy(&m, (aodvv2_msg_t *)msg.content.ptr, sizeof(m));
                     free(msg.content.ptr);
 
-                    _send_rrep(&m.pkt, &m.next_hop);
+                    mutex_lock(&_lock);
+                    aodvv2_core_send_rrep(&_core, &m.pkt, &m.next_hop);
+                    mutex_unlock(&_lock);
                 }
                 break;
 
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+            case AODVV2_MSG_TYPE_CLIENT_LEARN:
+                DEBUG("AODVV2_MSG_TYPE_CLIENT_LEARN\n");
+                _learn_clients();
+                break;
+
+            case AODVV2_MSG_TYPE_CLIENT_EXPIRE:
+                DEBUG("AODVV2_MSG_TYPE_CLIENT_EXPIRE\n");
+                _learn_expire();
+                break;
+#endif
+
+            case AODVV2_MSG_TYPE_FIND_ROUTE:
+                DEBUG("AODVV2_MSG_TYPE_FIND_ROUTE\n");
+                {
+                    _route_req_t req;
+                    memcpy(&req, (_route_req_t *)msg.content.ptr, sizeof(req));
+                    free(msg.content.ptr);
+
+                    _find_route(&req);
+                }
+                break;
+
+            case AODVV2_MSG_TYPE_BUFFER_PACE:
+                DEBUG("AODVV2_MSG_TYPE_BUFFER_PACE\n");
+                aodvv2_buffer_pace();
+                break;
+
             case GNRC_NETAPI_MSG_TYPE_RCV:
                 DEBUG("GNRC_NETAPI_MSG_TYPE_RCV\n");
                 _receive((gnrc_pktsnip_t *)msg.content.ptr);
@@ -326,8 +715,16 @@ int aodvv2_init(gnrc_netif_t *netif)
         return _pid;
     }
 
-    mutex_init(&_writer_lock);
-    mutex_init(&_reader_lock);
+    mutex_init(&_lock);
+
+    /* Save netif for later reference */
+    _netif = netif;
+
+    /* Initialize AODVv2 internal structures */
+    mutex_lock(&_lock);
+    aodvv2_core_init(&_core, &_ops, NULL);
+    mutex_unlock(&_lock);
+    aodvv2_buffer_init();
 
     /* Start RFC5444 thread */
     _pid = thread_create(_stack, sizeof(_stack), CONFIG_AODVV2_RFC5444_PRIO,
@@ -339,56 +736,10 @@ int aodvv2_init(gnrc_netif_t *netif)
         return _pid;
     }
 
-    /* Save netif for later reference */
-    _netif = netif;
-
-    /* Initialize AODVv2 internal structures */
-    aodvv2_seqnum_init();
-    aodvv2_lrs_init();
-    aodvv2_rcs_init();
-    aodvv2_mcmsg_init();
-    aodvv2_buffer_init();
-
     /* Register netreg */
     gnrc_netreg_entry_init_pid(&netreg, UDP_MANET_PORT, _pid);
     gnrc_netreg_register(GNRC_NETTYPE_UDP, &netreg);
 
-    /* Initialize RFC5444 reader */
-    mutex_lock(&_reader_lock);
-
-    /* Initialize reader */
-    rfc5444_reader_init(&_reader);
-
-    /* Register AODVv2 messages reader */
-    aodvv2_reader_init(&_reader, _netif->pid);
-
-    mutex_unlock(&_reader_lock);
-
-    /* Initialize RFC5444 writer */
-    mutex_lock(&_writer_lock);
-
-    _writer.msg_buffer = _writer_msg_buffer;
-    _writer.msg_size = sizeof(_writer_msg_buffer);
-    _writer.addrtlv_buffer = _writer_msg_addrtlvs;
-    _writer.addrtlv_size = sizeof(_writer_msg_addrtlvs);
-
-    /* Define target for generating rfc5444 packets */
-    _writer_context.target.packet_buffer = _writer_pkt_buffer;
-    _writer_context.target.packet_size = sizeof(_writer_pkt_buffer);
-
-    /* Set function to send binary packet content */
-    _writer_context.target.sendPacket = _send_packet;
-
-    /* Initialize writer */
-    rfc5444_writer_init(&_writer);
-
-    /* Register a target (for sending messages to) in writer */
-    rfc5444_writer_register_target(&_writer, &_writer_context.target);
-
-    aodvv2_writer_init(&_writer);
-
-    mutex_unlock(&_writer_lock);
-
     /* Install route info callback, this is called from the NIB when a route is
      * needed, this is what needs to be used for reactive protocols like AODVv2
      */
@@ -458,35 +809,182 @@ int aodvv2_find_route(const ipv6_addr_t *orig_addr,
 {
     assert(orig_addr != NULL && target_addr != NULL);
 
-    aodvv2_message_t pkt;
+    _route_req_t *req = malloc(sizeof(_route_req_t));
+    if (req == NULL) {
+        DEBUG("aodvv2: out of memory!\n");
+        return -ENOMEM;
+    }
+
+    memcpy(&req->orig, orig_addr, sizeof(ipv6_addr_t));
+    memcpy(&req->target, target_addr, sizeof(ipv6_addr_t));
 
-    /* Set metric information */
-    pkt.msg_hop_limit = aodvv2_metric_max(METRIC_HOP_COUNT);
-    pkt.metric_type = CONFIG_AODVV2_DEFAULT_METRIC;
+    /* Don't block, the IPv6 thread calls this with the NIB locked */
+    msg_t ipc_msg;
+    ipc_msg.content.ptr = req;
+    ipc_msg.type = AODVV2_MSG_TYPE_FIND_ROUTE;
 
-    /* Set OrigNode information */
-    aodvv2_rcs_entry_t *client;
-    if ((client = aodvv2_rcs_is_client(orig_addr)) != NULL) {
-        pkt.orig_node.addr = client->addr;
-        pkt.orig_node.pfx_len = client->pfx_len;
+    if (msg_try_send(&ipc_msg, _pid) < 1) {
+        DEBUG("aodvv2: couldn't request route discovery.\n");
+        free(req);
+        return -ENOBUFS;
     }
-    else {
-        DEBUG_PUTS("aodvv2: not a client");
-        return -1;
+
+    return 0;
+}
+
+int aodvv2_client_add(const ipv6_addr_t *addr, uint8_t pfx_len, uint8_t cost)
+{
+    assert(addr != NULL);
+
+    mutex_lock(&_lock);
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+    /* Configured clients don't expire */
+    _learned_forget(addr);
+#endif
+    int res = _client_add(addr, pfx_len, cost);
+    mutex_unlock(&_lock);
+
+    return res;
+}
+
+void aodvv2_client_del(const ipv6_addr_t *addr, uint8_t pfx_len)
+{
+    assert(addr != NULL);
+
+    mutex_lock(&_lock);
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+    _learned_forget(addr);
+#endif
+    _client_del(addr, pfx_len);
+    mutex_unlock(&_lock);
+}
+
+#if IS_USED(MODULE_AODVV2_CLIENT_LEARN)
+int aodvv2_client_learn(gnrc_netif_t *netif, const ipv6_addr_t *pfx,
+                        uint8_t pfx_len)
+{
+    assert(netif != NULL && pfx != NULL);
+
+    if (_pid == KERNEL_PID_UNDEF) {
+        return -ENOTCONN;
     }
 
-    pkt.orig_node.metric = 0;
-    pkt.orig_node.seqnum = aodvv2_seqnum_get();
-    aodvv2_seqnum_inc();
+    if (_wired != NULL && _wired != netif) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&_lock);
+    if (_learn_pfx_numof >= ARRAY_SIZE(_learn_pfx)) {
+        mutex_unlock(&_lock);
+        return -ENOSPC;
+    }
+    aodvv2_addr_init_prefix(&_learn_pfx[_learn_pfx_numof].pfx, pfx, pfx_len);
+    _learn_pfx[_learn_pfx_numof].pfx_len = pfx_len > 128 ? 128 : pfx_len;
+    _learn_pfx_numof++;
+    mutex_unlock(&_lock);
+
+    if (_wired == NULL) {
+        int res = netif_hook_add(netif, &_wired_hook);
+        if (res < 0) {
+            return res;
+        }
+        _wired = netif;
+
+        xtimer_set_msg(&_learn_timer, LEARN_CHECK_INTERVAL * US_PER_SEC,
+                       &_learn_timer_msg, _pid);
+    }
+
+    return 0;
+}
+#endif
+
+bool aodvv2_client_is(const ipv6_addr_t *addr)
+{
+    assert(addr != NULL);
+
+    mutex_lock(&_clients_lock);
+    bool is_client = aodvv2_rcs_is_client(&_clients, addr) != NULL;
+    mutex_unlock(&_clients_lock);
+
+    return is_client;
+}
+
+int aodvv2_route_get(const ipv6_addr_t *dst, aodvv2_local_route_t *route)
+{
+    assert(dst != NULL && route != NULL);
+
+    timex_t now;
+    int res = -ENOENT;
+
+    mutex_lock(&_lock);
+    aodvv2_core_now(&_core, &now);
+    aodvv2_local_route_t *entry =
+        aodvv2_lrs_get_entry(&_core.lrs, dst, METRIC_HOP_COUNT, &now);
+    if (entry != NULL) {
+        *route = *entry;
+        res = 0;
+    }
+    mutex_unlock(&_lock);
+
+    return res;
+}
+
+void aodvv2_route_stats(aodvv2_lrs_stats_t *stats)
+{
+    assert(stats != NULL);
+
+    mutex_lock(&_lock);
+    *stats = _core.lrs.stats;
+    mutex_unlock(&_lock);
+}
 
-    /* Set TargNode information */
-    pkt.targ_node.addr = *target_addr;
-    pkt.targ_node.pfx_len = 128;
-    pkt.targ_node.metric = 0;
-    pkt.targ_node.seqnum = 0;
+#if IS_USED(MODULE_AODVV2_LAR)
+void aodvv2_position_set(const aodvv2_position_t *pos)
+{
+    mutex_lock(&_lock);
+    aodvv2_lar_set_position(&_core.lar, pos);
+    mutex_unlock(&_lock);
+}
 
-    /* Add RREQ to mcmsg */
-    aodvv2_mcmsg_process(&pkt);
+int aodvv2_position_get(aodvv2_position_t *pos)
+{
+    assert(pos != NULL);
+
+    int res = -ENOENT;
+
+    mutex_lock(&_lock);
+    if (_core.lar.has_pos) {
+        *pos = _core.lar.pos;
+        res = 0;
+    }
+    mutex_unlock(&_lock);
+
+    return res;
+}
+#endif
+
+void aodvv2_client_print(void)
+{
+    mutex_lock(&_lock);
+    aodvv2_rcs_print_entries(&_core.rcs);
+    mutex_unlock(&_lock);
+}
+
+aodvv2_seqnum_t aodvv2_seqnum_current(void)
+{
+    mutex_lock(&_lock);
+    aodvv2_seqnum_t seqnum = aodvv2_seqnum_get(&_core.seqnum);
+    mutex_unlock(&_lock);
+
+    return seqnum;
+}
+
+aodvv2_seqnum_t aodvv2_seqnum_next(void)
+{
+    mutex_lock(&_lock);
+    aodvv2_seqnum_inc(&_core.seqnum);
+    aodvv2_seqnum_t seqnum = aodvv2_seqnum_get(&_core.seqnum);
+    mutex_unlock(&_lock);
 
-    return aodvv2_send_rreq(&pkt, &ipv6_addr_all_manet_routers_link_local);
+    return seqnum;
 }
@@ -20,9 +20,14 @@
 #include <stdbool.h>
 
 #include "net/aodvv2.h"
+#include "net/aodvv2/addr.h"
 #include "net/gnrc/pktbuf.h"
 #include "net/gnrc/ipv6.h"
 
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
@@ -30,17 +35,28 @@
 
 typedef struct {
     bool used;
+    bool ready;     /* Route found, waiting for its turn */
+    uint16_t order; /* Packets are released in this order */
     gnrc_pktsnip_t *pkt;
     ipv6_addr_t dst;
 } buffered_pkt_t;
 
+/* Packets are added from the IPv6 thread, released from the AODVv2 one */
+static mutex_t _lock = MUTEX_INIT;
 static buffered_pkt_t _buffered_pkts[CONFIG_AODVV2_MAX_BUFFERED_PACKETS];
+static uint16_t _order;
+
+/* Only used by the AODVv2 thread */
+static xtimer_t _pace_timer;
+static msg_t _pace_msg = { .type = AODVV2_MSG_TYPE_BUFFER_PACE };
+static bool _pacing;
 
 static void _pkt_del(unsigned i)
 {
     buffered_pkt_t *entry = &_buffered_pkts[i];
     if (entry->used) {
         entry->used = false;
+        entry->ready = false;
         entry->pkt = NULL;
         entry->dst = ipv6_addr_unspecified;
     }
@@ -48,16 +64,21 @@ static void _pkt_del(unsigned i)
 
 void aodvv2_buffer_init(void)
 {
+    mutex_lock(&_lock);
     memset(_buffered_pkts, 0, sizeof(_buffered_pkts));
+    mutex_unlock(&_lock);
 }
 
 int aodvv2_buffer_pkt_add(const ipv6_addr_t *dst, gnrc_pktsnip_t *pkt)
 {
+    mutex_lock(&_lock);
     for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
         buffered_pkt_t *entry = &_buffered_pkts[i];
         /* Find free spot */
         if (!entry->used) {
             entry->used = true;
+            entry->ready = false;
+            entry->order = _order++;
             entry->pkt = pkt;
             memcpy(&entry->dst, dst, sizeof(ipv6_addr_t));
 
@@ -66,31 +87,88 @@ int aodvv2_buffer_pkt_add(const ipv6_addr_t *dst, gnrc_pktsnip_t *pkt)
              * packet) */
             gnrc_pktbuf_hold(entry->pkt, 1);
 
+            mutex_unlock(&_lock);
             return 0;
         }
     }
+    mutex_unlock(&_lock);
 
     /* List of buffered packets is _full_ :/ */
     return -1;
 }
 
-void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr)
+/* Send the oldest packet with a route, returns whether others are left */
+static bool _release_next(void)
 {
-    assert(targ_addr != NULL);
+    buffered_pkt_t *next = NULL;
+    bool more = false;
 
+    mutex_lock(&_lock);
     for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
         buffered_pkt_t *entry = &_buffered_pkts[i];
 
-        if (ipv6_addr_equal(&entry->dst, targ_addr)) {
-            int res = gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6,
-                                                GNRC_NETREG_DEMUX_CTX_ALL,
-                                                entry->pkt);
+        if (!entry->used || !entry->ready) {
+            continue;
+        }
 
-            if (res < 1) {
-                DEBUG("aodvv2: couldn't dispatch packet!\n");
+        if (next == NULL) {
+            next = entry;
+        }
+        else {
+            more = true;
+            if ((int16_t)(entry->order - next->order) < 0) {
+                next = entry;
             }
-            _pkt_del(i);
         }
     }
+
+    gnrc_pktsnip_t *pkt = NULL;
+    if (next != NULL) {
+        pkt = next->pkt;
+        _pkt_del(next - _buffered_pkts);
+    }
+    mutex_unlock(&_lock);
+
+    if (pkt != NULL &&
+        gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6, GNRC_NETREG_DEMUX_CTX_ALL,
+                                  pkt) < 1) {
+        DEBUG("aodvv2: couldn't dispatch packet!\n");
+    }
+
+    return more;
+}
+
+void aodvv2_buffer_pace(void)
+{
+    _pacing = _release_next();
+    if (_pacing) {
+        xtimer_set_msg(&_pace_timer, CONFIG_AODVV2_BUFFER_PACE_MS * US_PER_MS,
+                       &_pace_msg, thread_getpid());
+    }
+}
+
+void aodvv2_buffer_dispatch(const ipv6_addr_t *targ_addr)
+{
+    assert(targ_addr != NULL);
+
+    mutex_lock(&_lock);
+    for (unsigned i = 0; i < ARRAY_SIZE(_buffered_pkts); i++) {
+        buffered_pkt_t *entry = &_buffered_pkts[i];
+
+        if (entry->used && aodvv2_addr_equal(&entry->dst, targ_addr)) {
+            entry->ready = true;
+        }
+    }
+    mutex_unlock(&_lock);
+
+    if (CONFIG_AODVV2_BUFFER_PACE_MS == 0) {
+        while (_release_next()) {}
+        return;
+    }
+
+    /* Otherwise the next packet goes out when the timer fires */
+    if (!_pacing) {
+        aodvv2_buffer_pace();
+    }
 }
 
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       Platform independent AODVv2 protocol core
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "net/aodvv2/core.h"
+#include "net/aodvv2/metric.h"
+#include "net/manet.h"
+
+#include "aodvv2_reader.h"
+#include "aodvv2_writer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+void aodvv2_core_init(aodvv2_core_t *core, const aodvv2_ops_t *ops, void *ctx)
+{
+    assert(core != NULL && ops != NULL);
+    assert(ops->now != NULL && ops->send != NULL && ops->fib_add != NULL &&
+           ops->fib_del != NULL);
+
+    core->ops = ops;
+    core->ctx = ctx;
+    core->addr = ipv6_addr_unspecified;
+
+    aodvv2_seqnum_init(&core->seqnum);
+    aodvv2_lrs_init(&core->lrs);
+    aodvv2_rcs_init(&core->rcs);
+    aodvv2_mcmsg_init(&core->mcmsg);
+    aodvv2_reader_init(&core->reader);
+    aodvv2_writer_init(&core->writer);
+#if IS_USED(MODULE_AODVV2_LAR)
+    aodvv2_lar_init(&core->lar);
+#endif
+}
+
+int aodvv2_core_handle_packet(aodvv2_core_t *core, const ipv6_addr_t *sender,
+                              const uint8_t *buf, size_t len)
+{
+    assert(core != NULL && sender != NULL && buf != NULL);
+
+    aodvv2_rfc5444_handle_packet_prepare(&core->reader, sender);
+    if (rfc5444_reader_handle_packet(&core->reader.reader, buf, len) !=
+        RFC5444_OKAY) {
+        DEBUG_PUTS("aodvv2: couldn't handle packet");
+        return -EBADMSG;
+    }
+
+    return 0;
+}
+
+int aodvv2_core_send_rreq(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *next_hop)
+{
+    assert(core != NULL && msg != NULL && next_hop != NULL);
+
+    /* Wait for the RREP that may come back through us */
+    aodvv2_core_stay_awake(core, CONFIG_AODVV2_RREQ_WAIT_TIME);
+
+    core->writer.target.target_addr = *next_hop;
+    return aodvv2_writer_send_rreq(&core->writer, msg);
+}
+
+int aodvv2_core_send_rrep(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *next_hop)
+{
+    assert(core != NULL && msg != NULL && next_hop != NULL);
+
+    /* We're on the route now, either as TargNode or as a relay, and stay up
+     * for as long as it's valid */
+    aodvv2_core_stay_awake(core, AODVV2_ROUTE_LIFETIME);
+
+    core->writer.target.target_addr = *next_hop;
+    return aodvv2_writer_send_rrep(&core->writer, msg);
+}
+
+int aodvv2_core_send_announcement(aodvv2_core_t *core, aodvv2_message_t *msg)
+{
+    assert(core != NULL && msg != NULL);
+
+    core->writer.target.target_addr = ipv6_addr_all_manet_routers_link_local;
+    return aodvv2_writer_send_rrep(&core->writer, msg);
+}
+
+int aodvv2_core_send_rerr(aodvv2_core_t *core, aodvv2_message_t *msg)
+{
+    assert(core != NULL && msg != NULL);
+
+    core->writer.target.target_addr = ipv6_addr_all_manet_routers_link_local;
+    return aodvv2_writer_send_rerr(&core->writer, msg);
+}
+
+static void _handover_msg_init(aodvv2_message_t *msg, const ipv6_addr_t *addr,
+                               uint8_t pfx_len)
+{
+    memset(msg, 0, sizeof(*msg));
+
+    msg->msg_hop_limit = CONFIG_AODVV2_HANDOVER_HOP_LIMIT;
+    msg->metric_type = CONFIG_AODVV2_DEFAULT_METRIC;
+    msg->targ_node.addr = *addr;
+    msg->targ_node.pfx_len = pfx_len;
+}
+
+void aodvv2_core_set_addr(aodvv2_core_t *core, const ipv6_addr_t *addr)
+{
+    assert(core != NULL && addr != NULL);
+
+    core->addr = *addr;
+}
+
+int aodvv2_core_client_announce(aodvv2_core_t *core, const ipv6_addr_t *addr,
+                                uint8_t pfx_len)
+{
+    assert(core != NULL && addr != NULL);
+
+    aodvv2_message_t msg;
+    _handover_msg_init(&msg, addr, pfx_len);
+    msg.seqnortr = core->addr;
+
+    /* A route learnt before the client moved here is now wrong */
+    timex_t now;
+    aodvv2_core_now(core, &now);
+    aodvv2_local_route_t *rt_entry =
+        aodvv2_lrs_get_entry(&core->lrs, addr, msg.metric_type, &now);
+    if (rt_entry != NULL) {
+        core->ops->fib_del(core->ctx, &rt_entry->addr, rt_entry->pfx_len);
+        aodvv2_lrs_delete_entry(&core->lrs, addr, msg.metric_type, &now);
+    }
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    /* Tell where the client went */
+    msg.targ_pos = core->lar.pos;
+    msg.has_targ_pos = core->lar.has_pos;
+#endif
+
+    DEBUG_PUTS("aodvv2: announcing client");
+    return aodvv2_core_send_announcement(core, &msg);
+}
+
+int aodvv2_core_client_withdraw(aodvv2_core_t *core, const ipv6_addr_t *addr,
+                                uint8_t pfx_len)
+{
+    assert(core != NULL && addr != NULL);
+
+    aodvv2_message_t msg;
+    _handover_msg_init(&msg, addr, pfx_len);
+
+    DEBUG_PUTS("aodvv2: withdrawing client");
+    return aodvv2_core_send_rerr(core, &msg);
+}
+
+int aodvv2_core_rreq_init(aodvv2_core_t *core, aodvv2_message_t *msg,
+                          const ipv6_addr_t *orig_addr,
+                          const ipv6_addr_t *target_addr)
+{
+    assert(core != NULL && msg != NULL && orig_addr != NULL &&
+           target_addr != NULL);
+
+    aodvv2_rcs_entry_t *client = aodvv2_rcs_is_client(&core->rcs, orig_addr);
+    if (client == NULL) {
+        DEBUG_PUTS("aodvv2: not a client");
+        return -EINVAL;
+    }
+
+    memset(msg, 0, sizeof(*msg));
+
+    /* Set metric information */
+    msg->msg_hop_limit = aodvv2_metric_max(METRIC_HOP_COUNT);
+    msg->metric_type = CONFIG_AODVV2_DEFAULT_METRIC;
+
+    /* Set OrigNode information */
+    msg->orig_node.addr = client->addr;
+    msg->orig_node.pfx_len = client->pfx_len;
+    msg->orig_node.metric = 0;
+    msg->orig_node.seqnum = aodvv2_seqnum_get(&core->seqnum);
+    aodvv2_seqnum_inc(&core->seqnum);
+
+    /* Set TargNode information */
+    msg->targ_node.addr = *target_addr;
+    msg->targ_node.pfx_len = 128;
+    msg->targ_node.metric = 0;
+    msg->targ_node.seqnum = 0;
+
+    timex_t now;
+    aodvv2_core_now(core, &now);
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    /* Routers outside the zone between both won't forward the RREQ, if it
+     * doesn't find the TargNode the next one floods */
+    msg->orig_pos = core->lar.pos;
+    msg->has_orig_pos = core->lar.has_pos;
+    msg->has_targ_pos = aodvv2_lar_rreq_target(&core->lar, target_addr, &now,
+                                               &msg->targ_pos);
+#endif
+
+    /* Add RREQ to mcmsg, so we don't process it again when a neighbor
+     * forwards it back to us */
+    msg->timestamp = now;
+    aodvv2_mcmsg_process(&core->mcmsg, msg, &now);
+
+    return 0;
+}
+
+int aodvv2_core_find_route(aodvv2_core_t *core, const ipv6_addr_t *orig_addr,
+                           const ipv6_addr_t *target_addr)
+{
+    aodvv2_message_t msg;
+
+    int res = aodvv2_core_rreq_init(core, &msg, orig_addr, target_addr);
+    if (res < 0) {
+        return res;
+    }
+
+    return aodvv2_core_send_rreq(core, &msg,
+                                 &ipv6_addr_all_manet_routers_link_local);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       Location-aided RREQ flooding
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "kernel_defines.h"
+#include "net/aodvv2/addr.h"
+#include "net/aodvv2/lar.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+void aodvv2_lar_init(aodvv2_lar_t *lar)
+{
+    assert(lar != NULL);
+
+    memset(lar, 0, sizeof(*lar));
+}
+
+void aodvv2_lar_set_position(aodvv2_lar_t *lar, const aodvv2_position_t *pos)
+{
+    assert(lar != NULL);
+
+    if (pos == NULL) {
+        lar->has_pos = false;
+        return;
+    }
+
+    lar->pos = *pos;
+    lar->has_pos = true;
+}
+
+static aodvv2_lar_entry_t *_find(const aodvv2_lar_t *lar,
+                                 const ipv6_addr_t *addr)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(lar->entries); i++) {
+        const aodvv2_lar_entry_t *entry = &lar->entries[i];
+
+        if (entry->pfx_len != 0 &&
+            aodvv2_addr_in_prefix(&entry->addr, entry->pfx_len, addr)) {
+            return (aodvv2_lar_entry_t *)entry;
+        }
+    }
+
+    return NULL;
+}
+
+void aodvv2_lar_learn(aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                      uint8_t pfx_len, const aodvv2_position_t *pos,
+                      const timex_t *now)
+{
+    assert(lar != NULL && addr != NULL && pos != NULL && now != NULL);
+
+    if (pfx_len == 0 || pfx_len > 128) {
+        pfx_len = 128;
+    }
+
+    aodvv2_lar_entry_t *entry = _find(lar, addr);
+    if (entry == NULL) {
+        /* Free entries have a zero timestamp, so they're the oldest */
+        entry = &lar->entries[0];
+        for (unsigned i = 1; i < ARRAY_SIZE(lar->entries); i++) {
+            if (timex_cmp(lar->entries[i].updated, entry->updated) < 0) {
+                entry = &lar->entries[i];
+            }
+        }
+    }
+
+    aodvv2_addr_init_prefix(&entry->addr, addr, pfx_len);
+    entry->pfx_len = pfx_len;
+    entry->pos = *pos;
+    entry->updated = *now;
+    entry->limited = false;
+}
+
+bool aodvv2_lar_lookup(const aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                       const timex_t *now, aodvv2_position_t *pos)
+{
+    assert(lar != NULL && addr != NULL && now != NULL && pos != NULL);
+
+    const aodvv2_lar_entry_t *entry = _find(lar, addr);
+    if (entry == NULL) {
+        return false;
+    }
+
+    if (now->seconds - entry->updated.seconds > CONFIG_AODVV2_LAR_MAX_AGE) {
+        DEBUG_PUTS("aodvv2: position is too old");
+        return false;
+    }
+
+    *pos = entry->pos;
+    return true;
+}
+
+bool aodvv2_lar_rreq_target(aodvv2_lar_t *lar, const ipv6_addr_t *addr,
+                            const timex_t *now, aodvv2_position_t *pos)
+{
+    assert(lar != NULL && addr != NULL && now != NULL && pos != NULL);
+
+    aodvv2_lar_entry_t *entry = _find(lar, addr);
+    if (entry == NULL || entry->limited) {
+        return false;
+    }
+
+    if (!aodvv2_lar_lookup(lar, addr, now, pos)) {
+        return false;
+    }
+
+    /* Until a RREP brings the position again */
+    entry->limited = true;
+    return true;
+}
+
+static bool _within(int32_t v, int32_t a, int32_t b)
+{
+    int64_t lo = (a < b) ? a : b;
+    int64_t hi = (a < b) ? b : a;
+
+    return (int64_t)v >= lo - CONFIG_AODVV2_LAR_MARGIN &&
+           (int64_t)v <= hi + CONFIG_AODVV2_LAR_MARGIN;
+}
+
+bool aodvv2_lar_in_zone(const aodvv2_lar_t *lar, const aodvv2_position_t *orig,
+                        const aodvv2_position_t *targ)
+{
+    assert(lar != NULL && orig != NULL && targ != NULL);
+
+    if (!lar->has_pos) {
+        return true;
+    }
+
+    return _within(lar->pos.x, orig->x, targ->x) &&
+           _within(lar->pos.y, orig->y, targ->y);
+}
@@ -19,101 +19,101 @@
  * @author      Jean Pierre Dudey <jeandudey@hotmail.com>
  */
 
+#include <assert.h>
+#include <inttypes.h>
+
+#include "net/aodvv2/addr.h"
 #include "net/aodvv2/conf.h"
 #include "net/aodvv2/lrs.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-static void _reset_entry_if_stale(uint8_t i);
-
-/**
- * @brief   Container for @ref aodvv2_local_route_t
- *
- * This wraps the Local Route and adds an `used` field to check if the entry is
- * in use on the storage array.
- */
-typedef struct {
-    aodvv2_local_route_t route; /**< Local Route */
-    bool used; /**< Is this entry used? */
-} lrs_entry_t;
-
-/**
- * @brief   Memory for the Routing Entries Set
- */
-static lrs_entry_t routing_table[CONFIG_AODVV2_MAX_ROUTING_ENTRIES];
+static void _reset_entry_if_stale(aodvv2_lrs_entry_t *entry,
+                                  const timex_t *now);
 
-static timex_t null_time;
-static timex_t max_seqnum_lifetime;
-static timex_t active_interval;
-static timex_t max_idletime;
-static timex_t validity_t;
-static timex_t now;
+static const timex_t null_time = { .seconds = 0, .microseconds = 0 };
+static const timex_t max_seqnum_lifetime = {
+    .seconds = CONFIG_AODVV2_MAX_SEQNUM_LIFETIME,
+    .microseconds = 0
+};
+static const timex_t active_interval = {
+    .seconds = CONFIG_AODVV2_ACTIVE_INTERVAL,
+    .microseconds = 0
+};
+static const timex_t validity_t = {
+    .seconds = CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME,
+    .microseconds = 0
+};
 
-void aodvv2_lrs_init(void)
+void aodvv2_lrs_init(aodvv2_lrs_t *lrs)
 {
-    DEBUG("aodvv2_lrs_init()\n");
+    assert(lrs != NULL);
 
-    null_time = timex_set(0, 0);
-    max_seqnum_lifetime = timex_set(CONFIG_AODVV2_MAX_SEQNUM_LIFETIME, 0);
-    active_interval = timex_set(CONFIG_AODVV2_ACTIVE_INTERVAL, 0);
-    max_idletime = timex_set(CONFIG_AODVV2_MAX_IDLETIME, 0);
-    validity_t = timex_set(CONFIG_AODVV2_ACTIVE_INTERVAL +
-                           CONFIG_AODVV2_MAX_IDLETIME, 0);
+    DEBUG("aodvv2_lrs_init()\n");
 
-    memset(&routing_table, 0, sizeof(routing_table));
+    memset(lrs, 0, sizeof(aodvv2_lrs_t));
 }
 
-ipv6_addr_t *aodvv2_lrs_get_next_hop(ipv6_addr_t *dest,
-                                     routing_metric_t metric_type)
+ipv6_addr_t *aodvv2_lrs_get_next_hop(aodvv2_lrs_t *lrs, const ipv6_addr_t *dest,
+                                     routing_metric_t metric_type,
+                                     const timex_t *now)
 {
-    aodvv2_local_route_t *entry = aodvv2_lrs_get_entry(dest, metric_type);
+    aodvv2_local_route_t *entry = aodvv2_lrs_get_entry(lrs, dest, metric_type,
+                                                       now);
     if (!entry) {
         return NULL;
     }
     return (&entry->next_hop);
 }
 
-void aodvv2_lrs_add_entry(aodvv2_local_route_t *entry)
+void aodvv2_lrs_add_entry(aodvv2_lrs_t *lrs, aodvv2_local_route_t *entry,
+                          const timex_t *now)
 {
     /* only add if we don't already know the address */
-    if (aodvv2_lrs_get_entry(&entry->addr, entry->metric_type)) {
+    if (aodvv2_lrs_get_entry(lrs, &entry->addr, entry->metric_type, now)) {
         return;
     }
     /*find free spot in RT and place rt_entry there */
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        if (!routing_table[i].used) {
-            memcpy(&routing_table[i].route, entry, sizeof(aodvv2_local_route_t));
-            routing_table[i].used = true;
+    for (unsigned i = 0; i < ARRAY_SIZE(lrs->entries); i++) {
+        if (!lrs->entries[i].used) {
+            memcpy(&lrs->entries[i].route, entry, sizeof(aodvv2_local_route_t));
+            lrs->entries[i].used = true;
             return;
         }
     }
 }
 
-aodvv2_local_route_t *aodvv2_lrs_get_entry(ipv6_addr_t *addr,
-                                           routing_metric_t metric_type)
+aodvv2_local_route_t *aodvv2_lrs_get_entry(aodvv2_lrs_t *lrs,
+                                           const ipv6_addr_t *addr,
+                                           routing_metric_t metric_type,
+                                           const timex_t *now)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        _reset_entry_if_stale(i);
+    for (unsigned i = 0; i < ARRAY_SIZE(lrs->entries); i++) {
+        aodvv2_lrs_entry_t *entry = &lrs->entries[i];
+        _reset_entry_if_stale(entry, now);
 
-        if (ipv6_addr_equal(&routing_table[i].route.addr, addr) &&
-            routing_table[i].route.metric_type == metric_type) {
-            return &routing_table[i].route;
+        if (entry->used &&
+            aodvv2_addr_equal(&entry->route.addr, addr) &&
+            entry->route.metric_type == metric_type) {
+            return &entry->route;
         }
     }
     return NULL;
 }
 
-void aodvv2_lrs_delete_entry(ipv6_addr_t *addr, routing_metric_t metric_type)
+void aodvv2_lrs_delete_entry(aodvv2_lrs_t *lrs, const ipv6_addr_t *addr,
+                             routing_metric_t metric_type, const timex_t *now)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(routing_table); i++) {
-        _reset_entry_if_stale(i);
-
-        if (routing_table[i].used) {
-            if (ipv6_addr_equal(&routing_table[i].route.addr, addr) &&
-                routing_table[i].route.metric_type == metric_type) {
-                memset(&routing_table[i].route, 0, sizeof(aodvv2_local_route_t));
-                routing_table[i].used = false;
+    for (unsigned i = 0; i < ARRAY_SIZE(lrs->entries); i++) {
+        aodvv2_lrs_entry_t *entry = &lrs->entries[i];
+        _reset_entry_if_stale(entry, now);
+
+        if (entry->used) {
+            if (aodvv2_addr_equal(&entry->route.addr, addr) &&
+                entry->route.metric_type == metric_type) {
+                memset(&entry->route, 0, sizeof(aodvv2_local_route_t));
+                entry->used = false;
                 return;
             }
         }
@@ -122,34 +122,35 @@ void aodvv2_lrs_delete_entry(ipv6_addr_t *addr, routing_metric_t metric_type)
 
 
 /*
- * Check if entry at index i is stale as described in Section 6.3.
+ * Check if entry is stale as described in Section 6.3.
  * and clear the struct it fills if it is
  */
-static void _reset_entry_if_stale(uint8_t i)
+static void _reset_entry_if_stale(aodvv2_lrs_entry_t *entry,
+                                  const timex_t *now)
 {
-    xtimer_now_timex(&now);
     timex_t last_used, expiration_time;
 
-    if (timex_cmp(routing_table[i].route.expiration_time, null_time) == 0) {
+    if (!entry->used ||
+        timex_cmp(entry->route.expiration_time, null_time) == 0) {
         return;
     }
 
-    int state = routing_table[i].route.state;
-    last_used = routing_table[i].route.last_used;
-    expiration_time = routing_table[i].route.expiration_time;
+    int state = entry->route.state;
+    last_used = entry->route.last_used;
+    expiration_time = entry->route.expiration_time;
 
     /* an Active route is considered to remain Active as long as it is used at least once
      * during every ACTIVE_INTERVAL. When a route is no longer Active, it becomes an Idle route. */
 
     /* if the node is younger than the active interval, don't bother */
-    if (timex_cmp(now, active_interval) < 0) {
+    if (timex_cmp(*now, active_interval) < 0) {
         return;
     }
 
     if ((state == ROUTE_STATE_ACTIVE) &&
-        (timex_cmp(timex_sub(now, active_interval), last_used) == 1)) {
-        routing_table[i].route.state = ROUTE_STATE_IDLE;
-        routing_table[i].route.last_used = now; /* mark the time entry was set to Idle */
+        (timex_cmp(timex_sub(*now, active_interval), last_used) == 1)) {
+        entry->route.state = ROUTE_STATE_IDLE;
+        entry->route.last_used = *now; /* mark the time entry was set to Idle */
     }
 
     /* After an idle route remains Idle for MAX_IDLETIME, it becomes an Expired route.
@@ -157,42 +158,107 @@ static void _reset_entry_if_stale(uint8_t i)
     */
 
     /* if the node is younger than the expiration time, don't bother */
-    if (timex_cmp(now, expiration_time) < 0) {
+    if (timex_cmp(*now, expiration_time) < 0) {
         return;
     }
 
     if ((state == ROUTE_STATE_IDLE) &&
-        (timex_cmp(expiration_time, now) < 1)) {
+        (timex_cmp(expiration_time, *now) < 1)) {
         DEBUG("\t expiration_time: %"PRIu32":%"PRIu32" , now: %"PRIu32":%"PRIu32"\n",
               expiration_time.seconds, expiration_time.microseconds,
-              now.seconds, now.microseconds);
-        routing_table[i].route.state = ROUTE_STATE_EXPIRED;
-        routing_table[i].route.last_used = now; /* mark the time entry was set to Expired */
+              now->seconds, now->microseconds);
+        entry->route.state = ROUTE_STATE_EXPIRED;
+        entry->route.last_used = *now; /* mark the time entry was set to Expired */
     }
 
     /* After that time, old sequence number information is considered no longer
      * valuable and the Expired route MUST BE expunged */
-    if (timex_cmp(timex_sub(now, last_used), max_seqnum_lifetime) >= 0) {
-        memset(&routing_table[i].route, 0, sizeof(aodvv2_local_route_t));
+    if (timex_cmp(timex_sub(*now, last_used), max_seqnum_lifetime) >= 0) {
+        memset(&entry->route, 0, sizeof(aodvv2_local_route_t));
+        entry->used = false;
     }
 }
 
-bool aodvv2_lrs_offers_improvement(aodvv2_local_route_t *rt_entry,
-                                   node_data_t *node_data)
+/* Halve the penalty for every half-life since it last decayed */
+static void _decay_penalty(aodvv2_local_route_t *rt_entry, const timex_t *now)
 {
+    uint32_t elapsed = now->seconds - rt_entry->penalty_time.seconds;
+    uint32_t halvings = elapsed / CONFIG_AODVV2_DAMP_HALF_LIFE;
+
+    if (halvings == 0) {
+        return;
+    }
+
+    rt_entry->penalty = (halvings >= 16) ? 0 : (rt_entry->penalty >> halvings);
+    rt_entry->penalty_time.seconds += halvings * CONFIG_AODVV2_DAMP_HALF_LIFE;
+
+    if (rt_entry->damped && rt_entry->penalty < CONFIG_AODVV2_DAMP_REUSE) {
+        DEBUG_PUTS("aodvv2: route is no longer damped");
+        rt_entry->damped = false;
+    }
+}
+
+bool aodvv2_lrs_offers_improvement(aodvv2_lrs_t *lrs,
+                                   aodvv2_local_route_t *rt_entry,
+                                   const aodvv2_local_route_t *candidate,
+                                   const timex_t *now)
+{
+    assert(lrs != NULL && rt_entry != NULL && candidate != NULL &&
+           now != NULL);
+
+    int seqcmp = aodvv2_seqnum_cmp(rt_entry->seqnum, candidate->seqnum);
+    bool usable = rt_entry->state != ROUTE_STATE_BROKEN &&
+                  rt_entry->state != ROUTE_STATE_EXPIRED;
+    bool same_hop = aodvv2_addr_equal(&candidate->next_hop, &rt_entry->next_hop);
+
     /* Check if new info is stale */
-    if (aodvv2_seqnum_cmp(node_data->seqnum, rt_entry->seqnum) < 0) {
+    if (seqcmp < 0) {
         return false;
     }
-    /* Check if new info is more costly */
-    if ((node_data->metric >= rt_entry->metric)
-        && !(rt_entry->state != ROUTE_STATE_BROKEN)) {
-        return false;
+
+    _decay_penalty(rt_entry, now);
+
+    /* The same route information only improves a usable route if it's
+     * cheaper, by enough not to follow every metric fluctuation, and if
+     * the route may change its next hop */
+    if (seqcmp == 0 && usable) {
+        if (candidate->metric >= rt_entry->metric) {
+            return false;
+        }
+
+        if (!same_hop) {
+            if (rt_entry->metric - candidate->metric <
+                CONFIG_AODVV2_LRS_HYSTERESIS) {
+                DEBUG_PUTS("aodvv2: improvement below the hysteresis");
+                lrs->stats.hysteresis++;
+                return false;
+            }
+
+            if (rt_entry->damped) {
+                DEBUG_PUTS("aodvv2: route is damped, keeping next hop");
+                lrs->stats.damped++;
+                return false;
+            }
+        }
     }
-    /* Check if new info repairs a broken route */
-    if (!(rt_entry->state != ROUTE_STATE_BROKEN)) {
-        return false;
+
+    if (same_hop) {
+        lrs->stats.refreshed++;
+        return true;
     }
+
+    lrs->stats.next_hop_changes++;
+    if (CONFIG_AODVV2_DAMP_PENALTY > 0) {
+        uint32_t penalty = rt_entry->penalty + CONFIG_AODVV2_DAMP_PENALTY;
+        rt_entry->penalty = (penalty > CONFIG_AODVV2_DAMP_MAX) ?
+                            CONFIG_AODVV2_DAMP_MAX : penalty;
+        if (!rt_entry->damped &&
+            rt_entry->penalty >= CONFIG_AODVV2_DAMP_SUPPRESS) {
+            DEBUG_PUTS("aodvv2: route is flapping, damping it");
+            rt_entry->damped = true;
+        }
+    }
+
     return true;
 }
 
@@ -218,6 +284,7 @@ void aodvv2_lrs_fill_routing_entry_rrep(aodvv2_message_t *msg,
     rt_entry->addr = msg->targ_node.addr;
     rt_entry->pfx_len = msg->targ_node.pfx_len;
     rt_entry->seqnum = msg->targ_node.seqnum;
+    rt_entry->seqnortr = msg->seqnortr;
     rt_entry->next_hop = msg->sender;
     rt_entry->last_used = msg->timestamp;
     rt_entry->expiration_time = timex_add(msg->timestamp, validity_t);
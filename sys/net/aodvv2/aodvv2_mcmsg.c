@@ -21,32 +21,28 @@
  * @}
  */
 
+#include <assert.h>
+
+#include "net/aodvv2/addr.h"
 #include "net/aodvv2/conf.h"
 #include "net/aodvv2/mcmsg.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-typedef struct {
-    aodvv2_mcmsg_t data; /**< McMsg data */
-    bool used;           /**< Is this entry used? */
-} internal_entry_t;
-
-static internal_entry_t _entries[CONFIG_AODVV2_MCMSG_MAX_ENTRIES];
-static mutex_t _lock = MUTEX_INIT;
-
-static timex_t _max_seqnum_lifetime;
+static const timex_t _max_seqnum_lifetime = {
+    .seconds = CONFIG_AODVV2_MAX_SEQNUM_LIFETIME,
+    .microseconds = 0
+};
 
-static void _reset_entry_if_stale(internal_entry_t *entry)
+static void _reset_entry_if_stale(aodvv2_mcmsg_entry_t *entry,
+                                  const timex_t *now)
 {
     if (!entry->used) {
         return;
     }
 
-    timex_t current_time;
-    xtimer_now_timex(&current_time);
-
-    if (timex_cmp(current_time, entry->data.removal_time) == 1) {
+    if (timex_cmp(*now, entry->data.removal_time) == 1) {
         DEBUG_PUTS("aodvv2: McMsg is stale");
         memset(&entry->data, 0, sizeof(entry->data));
         entry->used = false;
@@ -57,9 +53,9 @@ static inline bool _is_compatible_mcmsg(aodvv2_mcmsg_t *lhs, aodvv2_mcmsg_t *rhs
 {
     /* A RREQ is considered compatible if they both contain the same OrigPrefix,
      * OrigPrefixLength, TargPrefix and MetricType */
-    if (ipv6_addr_equal(&lhs->orig_prefix, &rhs->orig_prefix) &&
+    if (aodvv2_addr_equal(&lhs->orig_prefix, &rhs->orig_prefix) &&
         (lhs->orig_pfx_len == rhs->orig_pfx_len) &&
-        ipv6_addr_equal(&lhs->targ_prefix, &rhs->targ_prefix) &&
+        aodvv2_addr_equal(&lhs->targ_prefix, &rhs->targ_prefix) &&
         (lhs->metric_type == rhs->metric_type)) {
         return true;
     }
@@ -71,9 +67,9 @@ static inline bool _is_compatible(aodvv2_mcmsg_t *entry, aodvv2_message_t *msg)
 {
     /* A RREQ is considered compatible if they both contain the same OrigPrefix,
      * OrigPrefixLength, TargPrefix and MetricType */
-    if (ipv6_addr_equal(&entry->orig_prefix, &msg->orig_node.addr) &&
+    if (aodvv2_addr_equal(&entry->orig_prefix, &msg->orig_node.addr) &&
         (entry->orig_pfx_len == msg->orig_node.pfx_len) &&
-        ipv6_addr_equal(&entry->targ_prefix, &msg->targ_node.addr) &&
+        aodvv2_addr_equal(&entry->targ_prefix, &msg->targ_node.addr) &&
         (entry->metric_type == msg->metric_type)) {
         return true;
     }
@@ -85,26 +81,28 @@ static inline bool _is_comparable(aodvv2_mcmsg_t *entry, aodvv2_message_t *msg)
 {
     /* If both McMsg don't provide a SeqNoRtr address (is unspcified), they only
      * need to be compatible to be comparable */
-    if (ipv6_addr_is_unspecified(&entry->seqnortr) &&
-        ipv6_addr_is_unspecified(&msg->seqnortr)) {
+    if (aodvv2_addr_is_unspecified(&entry->seqnortr) &&
+        aodvv2_addr_is_unspecified(&msg->seqnortr)) {
         return _is_compatible(entry, msg);
     }
 
     /* At least one of the McMsg provided a SeqNoRtr address, so it needs to be
      * checked if they're the same in order for the McMsgs to be comparable */
     if (_is_compatible(entry, msg) &&
-        ipv6_addr_equal(&entry->seqnortr, &msg->seqnortr)) {
+        aodvv2_addr_equal(&entry->seqnortr, &msg->seqnortr)) {
         return true;
     }
 
     return false;
 }
 
-static internal_entry_t *_find_comparable_entry(aodvv2_message_t *msg)
+static aodvv2_mcmsg_entry_t *_find_comparable_entry(aodvv2_mcmsg_set_t *set,
+                                                    aodvv2_message_t *msg,
+                                                    const timex_t *now)
 {
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
-        _reset_entry_if_stale(entry);
+    for (unsigned i = 0; i < ARRAY_SIZE(set->entries); i++) {
+        aodvv2_mcmsg_entry_t *entry = &set->entries[i];
+        _reset_entry_if_stale(entry, now);
 
         if (entry->used) {
             if (_is_comparable(&entry->data, msg)) {
@@ -116,16 +114,24 @@ static internal_entry_t *_find_comparable_entry(aodvv2_message_t *msg)
     return NULL;
 }
 
-static internal_entry_t *_add(aodvv2_message_t *msg)
+static aodvv2_mcmsg_entry_t *_add(aodvv2_mcmsg_set_t *set,
+                                  aodvv2_message_t *msg, const timex_t *now)
 {
+    aodvv2_mcmsg_entry_t *oldest = NULL;
+
     /* Find empty McMsg and fill it */
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned i = 0; i < ARRAY_SIZE(set->entries); i++) {
+        aodvv2_mcmsg_entry_t *entry = &set->entries[i];
 
-        if (!entry->used) {
-            timex_t current_time;
-            xtimer_now_timex(&current_time);
+        if (entry->used) {
+            if (oldest == NULL ||
+                timex_cmp(entry->data.timestamp, oldest->data.timestamp) < 0) {
+                oldest = entry;
+            }
+            continue;
+        }
 
+        if (!entry->used) {
             entry->used = true;
             entry->data.orig_prefix = msg->orig_node.addr;
             entry->data.orig_pfx_len = msg->orig_node.pfx_len;
@@ -134,60 +140,59 @@ static internal_entry_t *_add(aodvv2_message_t *msg)
             entry->data.metric = msg->orig_node.metric;
             entry->data.orig_seqnum = msg->orig_node.seqnum;
 
-            entry->data.timestamp = current_time;
-            entry->data.removal_time = timex_add(current_time, _max_seqnum_lifetime);
+            entry->data.timestamp = *now;
+            entry->data.removal_time = timex_add(*now, _max_seqnum_lifetime);
             return entry;
         }
     }
 
+    /* The set is full. Not recording the RREQ would make us forward every
+     * copy of it, so the least recently updated McMsg is replaced instead */
+    if (oldest != NULL) {
+        DEBUG_PUTS("aodvv2: McMsg set is full, replacing oldest entry");
+        memset(oldest, 0, sizeof(*oldest));
+        return _add(set, msg, now);
+    }
+
     return NULL;
 }
 
-void aodvv2_mcmsg_init(void)
+void aodvv2_mcmsg_init(aodvv2_mcmsg_set_t *set)
 {
-    DEBUG_PUTS("aodvv2: init McMset set");
-    mutex_lock(&_lock);
+    assert(set != NULL);
 
-    _max_seqnum_lifetime = timex_set(CONFIG_AODVV2_MAX_SEQNUM_LIFETIME, 0);
+    DEBUG_PUTS("aodvv2: init McMset set");
 
-    memset(&_entries, 0, sizeof(_entries));
-    mutex_unlock(&_lock);
+    memset(set, 0, sizeof(aodvv2_mcmsg_set_t));
 }
 
-int aodvv2_mcmsg_process(aodvv2_message_t *msg)
+int aodvv2_mcmsg_process(aodvv2_mcmsg_set_t *set, aodvv2_message_t *msg,
+                         const timex_t *now)
 {
-    mutex_lock(&_lock);
+    assert(set != NULL && msg != NULL && now != NULL);
 
-    internal_entry_t *comparable = _find_comparable_entry(msg);
+    aodvv2_mcmsg_entry_t *comparable = _find_comparable_entry(set, msg, now);
     if (comparable == NULL) {
         DEBUG_PUTS("aodvv2: adding new McMsg");
-        if (_add(msg) == NULL) {
-            DEBUG_PUTS("aodvv2: McMsg set is full");
-        }
-        mutex_unlock(&_lock);
+        _add(set, msg, now);
         return AODVV2_MCMSG_OK;
     }
 
     DEBUG_PUTS("aodvv2: comparable McMsg found");
 
     /* There's a comparable entry, update it's timing information */
-    timex_t current_time;
-    xtimer_now_timex(&current_time);
-
-    comparable->data.timestamp = current_time;
-    comparable->data.removal_time = timex_add(current_time, _max_seqnum_lifetime);
+    comparable->data.timestamp = *now;
+    comparable->data.removal_time = timex_add(*now, _max_seqnum_lifetime);
 
     int seqcmp = aodvv2_seqnum_cmp(comparable->data.orig_seqnum, msg->orig_node.seqnum);
     if (seqcmp < 0) {
         DEBUG_PUTS("aodvv2: stored McMsg is newer");
-        mutex_unlock(&_lock);
         return AODVV2_MCMSG_REDUNDANT;
     }
 
     if (seqcmp == 0) {
-        if (comparable->data.metric == msg->orig_node.metric) {
+        if (comparable->data.metric <= msg->orig_node.metric) {
             DEBUG_PUTS("aodvv2: stored McMsg is no worse than received");
-            mutex_unlock(&_lock);
             return AODVV2_MCMSG_REDUNDANT;
         }
     }
@@ -200,25 +205,23 @@ int aodvv2_mcmsg_process(aodvv2_message_t *msg)
     comparable->data.metric = msg->orig_node.metric;
 
     /* Search for compatible entries and compare their metrics */
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned i = 0; i < ARRAY_SIZE(set->entries); i++) {
+        aodvv2_mcmsg_entry_t *entry = &set->entries[i];
         if (entry == comparable) {
             continue;
         }
 
-        _reset_entry_if_stale(entry);
+        _reset_entry_if_stale(entry, now);
 
         if (entry->used && entry != comparable) {
             if (_is_compatible_mcmsg(&comparable->data, &entry->data)) {
                 if (entry->data.metric <= comparable->data.metric) {
                     DEBUG_PUTS("aodvv2: received McMsg is worse than stored");
-                    mutex_unlock(&_lock);
                     return AODVV2_MCMSG_REDUNDANT;
                 }
             }
         }
     }
 
-    mutex_unlock(&_lock);
     return AODVV2_MCMSG_OK;
 }
@@ -21,154 +21,145 @@
  * @}
  */
 
-#include "net/aodvv2/rcs.h"
+#include <assert.h>
+#include <stdio.h>
 
-#include "mutex.h"
+#include "net/aodvv2/addr.h"
+#include "net/aodvv2/rcs.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-/**
- * @brief   Memory for the Client Set entries.
- */
-typedef struct {
-    aodvv2_rcs_entry_t data; /**< Client data */
-    bool used; /**< Is this entry used? */
-} internal_entry_t;
-
-static internal_entry_t _entries[CONFIG_AODVV2_RCS_ENTRIES];
-static mutex_t _lock = MUTEX_INIT;
-
-void aodvv2_rcs_init(void)
+void aodvv2_rcs_init(aodvv2_rcs_t *rcs)
 {
-    mutex_lock(&_lock);
-    memset(_entries, 0, sizeof(_entries));
-    mutex_unlock(&_lock);
+    assert(rcs != NULL);
+
+    memset(rcs, 0, sizeof(aodvv2_rcs_t));
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_add(const ipv6_addr_t *addr, uint8_t pfx_len,
-                                   const uint8_t cost)
+aodvv2_rcs_entry_t *aodvv2_rcs_add(aodvv2_rcs_t *rcs, const ipv6_addr_t *addr,
+                                   uint8_t pfx_len, uint8_t cost)
 {
+    assert(rcs != NULL && addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    const aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(addr, pfx_len);
+    const aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(rcs, addr, pfx_len);
     if (entry != NULL) {
         DEBUG_PUTS("aodvv2: client exists, not adding it");
         return NULL;
     }
 
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned i = 0; i < ARRAY_SIZE(rcs->entries); i++) {
+        aodvv2_rcs_slot_t *slot = &rcs->entries[i];
 
         /* Find free spot to place the new entry. */
-        if (!entry->used) {
-            ipv6_addr_init_prefix(&entry->data.addr, addr, pfx_len);
-            entry->data.pfx_len = pfx_len;
-            entry->data.cost = cost;
+        if (!slot->used) {
+            aodvv2_addr_init_prefix(&slot->data.addr, addr, pfx_len);
+            slot->data.pfx_len = pfx_len;
+            slot->data.cost = cost;
 
-            entry->used = true;
+            slot->used = true;
 
-            mutex_unlock(&_lock);
-            return &entry->data;
+            return &slot->data;
         }
     }
 
     DEBUG_PUTS("aodvv2: router client set is full");
-    mutex_unlock(&_lock);
     return NULL;
 }
 
-void aodvv2_rcs_del(const ipv6_addr_t *addr, uint8_t pfx_len)
+void aodvv2_rcs_del(aodvv2_rcs_t *rcs, const ipv6_addr_t *addr,
+                    uint8_t pfx_len)
 {
+    assert(rcs != NULL && addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(addr, pfx_len);
+    aodvv2_rcs_entry_t *entry = aodvv2_rcs_matches(rcs, addr, pfx_len);
 
     if (!entry) {
         DEBUG_PUTS("aodvv2: client not found\n");
         return;
     }
 
-    mutex_lock(&_lock);
-    internal_entry_t *internal = container_of(entry, internal_entry_t, data);
-    memset(&internal->data, 0, sizeof(aodvv2_rcs_entry_t));
-    internal->used = false;
-    mutex_unlock(&_lock);
+    aodvv2_rcs_slot_t *slot = container_of(entry, aodvv2_rcs_slot_t, data);
+    memset(&slot->data, 0, sizeof(aodvv2_rcs_entry_t));
+    slot->used = false;
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_matches(const ipv6_addr_t *addr,
+aodvv2_rcs_entry_t *aodvv2_rcs_matches(aodvv2_rcs_t *rcs,
+                                       const ipv6_addr_t *addr,
                                        uint8_t pfx_len)
 {
+    assert(rcs != NULL && addr != NULL);
+
     if (pfx_len > 128) {
         pfx_len = 128;
     }
 
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned i = 0; i < ARRAY_SIZE(rcs->entries); i++) {
+        aodvv2_rcs_slot_t *slot = &rcs->entries[i];
 
         /* Skip unused entries */
-        if (!entry->used) {
+        if (!slot->used) {
             continue;
         }
 
         /* Compare addresses by prefix */
-        if ((entry->data.pfx_len == pfx_len) &&
-            (ipv6_addr_match_prefix(&entry->data.addr,
-                                   addr) >= entry->data.pfx_len)) {
-            mutex_unlock(&_lock);
-            return &entry->data;
+        if ((slot->data.pfx_len == pfx_len) &&
+            aodvv2_addr_in_prefix(&slot->data.addr, slot->data.pfx_len,
+                                  addr)) {
+            return &slot->data;
         }
     }
 
     /* No entry matches */
-    mutex_unlock(&_lock);
     return NULL;
 }
 
-aodvv2_rcs_entry_t *aodvv2_rcs_is_client(const ipv6_addr_t *addr)
+aodvv2_rcs_entry_t *aodvv2_rcs_is_client(aodvv2_rcs_t *rcs,
+                                         const ipv6_addr_t *addr)
 {
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    assert(rcs != NULL && addr != NULL);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(rcs->entries); i++) {
+        aodvv2_rcs_slot_t *slot = &rcs->entries[i];
 
         /* Skip unused entries */
-        if (!entry->used) {
+        if (!slot->used) {
             continue;
         }
 
         /* Compare addresses by prefix */
-        if (ipv6_addr_match_prefix(&entry->data.addr,
-                                   addr) >= entry->data.pfx_len) {
-            mutex_unlock(&_lock);
-            return &entry->data;
+        if (aodvv2_addr_in_prefix(&slot->data.addr, slot->data.pfx_len,
+                                  addr)) {
+            return &slot->data;
         }
     }
-    mutex_unlock(&_lock);
     return NULL;
 }
 
-void aodvv2_rcs_print_entries(void)
+void aodvv2_rcs_print_entries(aodvv2_rcs_t *rcs)
 {
+    assert(rcs != NULL);
+
     char buf[IPV6_ADDR_MAX_STR_LEN];
-    mutex_lock(&_lock);
-    for (unsigned i = 0; i < ARRAY_SIZE(_entries); i++) {
-        internal_entry_t *entry = &_entries[i];
+    for (unsigned i = 0; i < ARRAY_SIZE(rcs->entries); i++) {
+        aodvv2_rcs_slot_t *slot = &rcs->entries[i];
 
         /* Skip unused entries */
-        if (!entry->used) {
+        if (!slot->used) {
             continue;
         }
 
         /* prints ipv6/prefix | cost */
         printf("%s/%u | %u\n",
-               ipv6_addr_to_str(buf, &entry->data.addr, sizeof(buf)),
-               entry->data.pfx_len, entry->data.cost);
+               ipv6_addr_to_str(buf, &slot->data.addr, sizeof(buf)),
+               slot->data.pfx_len, slot->data.cost);
     }
-    mutex_unlock(&_lock);
 }
@@ -13,7 +13,7 @@
  * @{
  *
  * @file
- * @brief       RFC5444 RREP
+ * @brief       Message Reader
  *
  * @author      Lotte Steenbrink <lotte.steenbrink@fu-berlin.de>
  * @author      Gustavo Grisales <gustavosinbandera1@hotmail.com>
@@ -21,8 +21,13 @@
  * @}
  */
 
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
 #include "aodvv2_reader.h"
-#include "net/aodvv2.h"
+#include "net/aodvv2/addr.h"
+#include "net/aodvv2/core.h"
 #include "net/aodvv2/lrs.h"
 #include "net/aodvv2/mcmsg.h"
 #include "net/aodvv2/metric.h"
@@ -30,18 +35,12 @@
 #include "net/aodvv2/rfc5444.h"
 #include "net/manet.h"
 
-#include "net/gnrc/ipv6/nib/ft.h"
-
-#include "xtimer.h"
-
 #include "rfc5444_compat.h"
 
+/* Debug output prints addresses with the oonf_common_netaddr_string module */
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-#define AODVV2_ROUTE_LIFETIME \
-    (CONFIG_AODVV2_ACTIVE_INTERVAL + CONFIG_AODVV2_MAX_IDLETIME)
-
 static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
     struct rfc5444_reader_tlvblock_context *cont);
 static enum rfc5444_result _cb_rrep_blocktlv_messagetlvs_okay(
@@ -49,6 +48,13 @@ static enum rfc5444_result _cb_rrep_blocktlv_messagetlvs_okay(
 static enum rfc5444_result _cb_rrep_end_callback(
     struct rfc5444_reader_tlvblock_context *cont, bool dropped);
 
+static enum rfc5444_result _cb_rerr_blocktlv_addresstlvs_okay(
+    struct rfc5444_reader_tlvblock_context *cont);
+static enum rfc5444_result _cb_rerr_blocktlv_messagetlvs_okay(
+    struct rfc5444_reader_tlvblock_context *cont);
+static enum rfc5444_result _cb_rerr_end_callback(
+    struct rfc5444_reader_tlvblock_context *cont, bool dropped);
+
 static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
     struct rfc5444_reader_tlvblock_context *cont);
 static enum rfc5444_result _cb_rreq_blocktlv_messagetlvs_okay(
@@ -60,7 +66,7 @@ static enum rfc5444_result _cb_rreq_end_callback(
  * Message consumer, will be called once for every message of
  * type RFC5444_MSGTYPE_RREP that contains all the mandatory message TLVs
  */
-static struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREP,
     .block_callback = _cb_rrep_blocktlv_messagetlvs_okay,
@@ -71,7 +77,7 @@ static struct rfc5444_reader_tlvblock_consumer _rrep_consumer =
  * Address consumer. Will be called once for every address in a message of
  * type RFC5444_MSGTYPE_RREP.
  */
-static struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREP,
     .addrblock_consumer = true,
@@ -82,7 +88,7 @@ static struct rfc5444_reader_tlvblock_consumer _rrep_address_consumer =
  * Message consumer, will be called once for every message of
  * type RFC5444_MSGTYPE_RREQ that contains all the mandatory message TLVs
  */
-static struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREQ,
     .block_callback = _cb_rreq_blocktlv_messagetlvs_okay,
@@ -93,73 +99,156 @@ static struct rfc5444_reader_tlvblock_consumer _rreq_consumer =
  * Address consumer. Will be called once for every address in a message of
  * type RFC5444_MSGTYPE_RREQ.
  */
-static struct rfc5444_reader_tlvblock_consumer _rreq_address_consumer =
+static const struct rfc5444_reader_tlvblock_consumer _rreq_address_consumer =
 {
     .msg_id = RFC5444_MSGTYPE_RREQ,
     .addrblock_consumer = true,
     .block_callback = _cb_rreq_blocktlv_addresstlvs_okay,
 };
 
+/*
+ * Message consumer, will be called once for every message of
+ * type RFC5444_MSGTYPE_RERR
+ */
+static const struct rfc5444_reader_tlvblock_consumer _rerr_consumer =
+{
+    .msg_id = RFC5444_MSGTYPE_RERR,
+    .block_callback = _cb_rerr_blocktlv_messagetlvs_okay,
+    .end_callback = _cb_rerr_end_callback,
+};
+
+/*
+ * Address consumer. Will be called once for every address in a message of
+ * type RFC5444_MSGTYPE_RERR.
+ */
+static const struct rfc5444_reader_tlvblock_consumer _rerr_address_consumer =
+{
+    .msg_id = RFC5444_MSGTYPE_RERR,
+    .addrblock_consumer = true,
+    .block_callback = _cb_rerr_blocktlv_addresstlvs_okay,
+};
+
 /*
  * Address consumer entries definition
  * TLV types RFC5444_MSGTLV__SEQNUM and RFC5444_MSGTLV_METRIC
  */
-static struct rfc5444_reader_tlvblock_consumer_entry _address_consumer_entries[] =
+static const struct rfc5444_reader_tlvblock_consumer_entry _address_consumer_entries[AODVV2_RFC5444_ADDR_TLVS_NUMOF] =
 {
     [RFC5444_MSGTLV_ORIGSEQNUM] = { .type = RFC5444_MSGTLV_ORIGSEQNUM },
     [RFC5444_MSGTLV_TARGSEQNUM] = { .type = RFC5444_MSGTLV_TARGSEQNUM },
     [RFC5444_MSGTLV_METRIC] = { .type = RFC5444_MSGTLV_METRIC }
 };
 
+#if IS_USED(MODULE_AODVV2_LAR)
+/*
+ * Message consumer entries definition
+ * Router positions, TLV types RFC5444_MSGTLV_ORIGPOS and RFC5444_MSGTLV_TARGPOS
+ */
+enum {
+    _ORIGPOS_ENTRY,
+    _TARGPOS_ENTRY,
+};
+
+static const struct rfc5444_reader_tlvblock_consumer_entry _message_consumer_entries[AODVV2_RFC5444_MSG_TLVS_NUMOF] =
+{
+    [_ORIGPOS_ENTRY] = { .type = RFC5444_MSGTLV_ORIGPOS },
+    [_TARGPOS_ENTRY] = { .type = RFC5444_MSGTLV_TARGPOS },
+};
+#endif
+
+#if IS_USED(MODULE_OONF_COMMON_NETADDR_STRING)
 static struct netaddr_str nbuf;
-static aodvv2_message_t _msg_data;
+#endif
+
+static inline aodvv2_reader_t *_reader(
+    struct rfc5444_reader_tlvblock_context *cont)
+{
+    return container_of(cont->reader, aodvv2_reader_t, reader);
+}
 
-static kernel_pid_t _netif_pid = KERNEL_PID_UNDEF;
+static inline aodvv2_core_t *_core(aodvv2_reader_t *reader)
+{
+    return container_of(reader, aodvv2_core_t, reader);
+}
+
+#if IS_USED(MODULE_AODVV2_LAR)
+static bool _read_position(const struct rfc5444_reader_tlvblock_consumer_entry *entry,
+                           aodvv2_position_t *pos)
+{
+    const struct rfc5444_reader_tlvblock_entry *tlv = entry->tlv;
+
+    if (tlv == NULL || tlv->length != AODVV2_LAR_POSITION_LEN) {
+        return false;
+    }
+
+    aodvv2_lar_position_read(tlv->single_value, pos);
+    return true;
+}
+#endif
 
 static enum rfc5444_result _cb_rrep_blocktlv_messagetlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *reader = _reader(cont);
+
     if (!cont->has_hoplimit) {
         DEBUG_PUTS("aodvv2: missing hop limit");
         return RFC5444_DROP_PACKET;
     }
 
-    _msg_data.msg_hop_limit = cont->hoplimit;
-    if (_msg_data.msg_hop_limit == 0) {
+    reader->msg.msg_hop_limit = cont->hoplimit;
+    if (reader->msg.msg_hop_limit == 0) {
         DEBUG_PUTS("aodvv2: hop limit is 0");
         return RFC5444_DROP_PACKET;
     }
 
-    _msg_data.msg_hop_limit--;
+    reader->msg.msg_hop_limit--;
+
+    /* Client announcements name the router that issued the SeqNum */
+    if (cont->has_origaddr) {
+        uint8_t pfx_len;
+        netaddr_to_ipv6_addr(&cont->orig_addr, &reader->msg.seqnortr,
+                             &pfx_len);
+    }
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    reader->msg.has_targ_pos =
+        _read_position(&reader->rrep_msg_entries[_TARGPOS_ENTRY],
+                       &reader->msg.targ_pos);
+#endif
+
     return RFC5444_OKAY;
 }
 
 static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *reader = _reader(cont);
     struct rfc5444_reader_tlvblock_entry *tlv;
     bool is_targ_node_addr = false;
 
+#if IS_USED(MODULE_OONF_COMMON_NETADDR_STRING)
     DEBUG("aodvv2: %s\n", netaddr_to_string(&nbuf, &cont->addr));
+#endif
 
     /* handle TargNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
+    tlv = reader->rrep_addr_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_TARGSEQNUM: %d\n", *tlv->single_value);
         is_targ_node_addr = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.targ_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &reader->msg.targ_node.addr,
+                             &reader->msg.targ_node.pfx_len);
+        reader->msg.targ_node.seqnum = *tlv->single_value;
     }
 
     /* handle OrigNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
+    tlv = reader->rrep_addr_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_ORIGSEQNUM: %d\n", *tlv->single_value);
         is_targ_node_addr = false;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.orig_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.orig_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &reader->msg.orig_node.addr,
+                             &reader->msg.targ_node.pfx_len);
+        reader->msg.orig_node.seqnum = *tlv->single_value;
     }
 
     if (!tlv && !is_targ_node_addr) {
@@ -167,7 +256,7 @@ static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
         return RFC5444_DROP_PACKET;
     }
 
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_METRIC].tlv;
+    tlv = reader->rrep_addr_entries[RFC5444_MSGTLV_METRIC].tlv;
     if (!tlv && is_targ_node_addr) {
         DEBUG_PUTS("aodvv2: missing or unknown metric TLV!");
         return RFC5444_DROP_PACKET;
@@ -182,8 +271,127 @@ static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
         DEBUG("aodvv2: RFC5444_MSGTLV_METRIC val: %d, exttype: %d\n",
               *tlv->single_value, tlv->type_ext);
 
-        _msg_data.metric_type = tlv->type_ext;
-        _msg_data.orig_node.metric = *tlv->single_value;
+        reader->msg.metric_type = tlv->type_ext;
+        reader->msg.orig_node.metric = *tlv->single_value;
+    }
+
+    return RFC5444_OKAY;
+}
+
+/* Replace a Local Route with a better one. The forwarding entry is only
+ * deleted when the next hop changes, otherwise adding it again refreshes
+ * its lifetime. The damping state stays with the destination. */
+static void _update_route(aodvv2_core_t *core, aodvv2_local_route_t *rt_entry,
+                          const aodvv2_local_route_t *route)
+{
+    if (!aodvv2_addr_equal(&rt_entry->next_hop, &route->next_hop)) {
+        core->ops->fib_del(core->ctx, &rt_entry->addr, rt_entry->pfx_len);
+    }
+
+    bool damped = rt_entry->damped;
+    uint16_t penalty = rt_entry->penalty;
+    timex_t penalty_time = rt_entry->penalty_time;
+
+    *rt_entry = *route;
+    rt_entry->damped = damped;
+    rt_entry->penalty = penalty;
+    rt_entry->penalty_time = penalty_time;
+
+    DEBUG_PUTS("aodvv2: adding route to FIB");
+    if (core->ops->fib_add(core->ctx, &rt_entry->addr, rt_entry->pfx_len,
+                           &rt_entry->next_hop, AODVV2_ROUTE_LIFETIME) < 0) {
+        DEBUG_PUTS("aodvv2: couldn't add route");
+    }
+}
+
+/* A RREP without OrigNode, flooded by the router a client just attached to,
+ * see aodvv2_core_client_announce() */
+static enum rfc5444_result _handle_client_announcement(aodvv2_core_t *core,
+                                                       aodvv2_message_t *msg)
+{
+    if (aodvv2_addr_is_unspecified(&msg->targ_node.addr) ||
+        msg->targ_node.seqnum == 0) {
+        DEBUG_PUTS("aodvv2: missing TargNode Address or SeqNum");
+        return RFC5444_DROP_PACKET;
+    }
+
+    /* Our own announcement coming back, or a client we still serve, which
+     * will be withdrawn as soon as it's deleted from our client set */
+    if (aodvv2_rcs_is_client(&core->rcs, &msg->targ_node.addr) != NULL) {
+        DEBUG_PUTS("aodvv2: announced client is ours");
+        return RFC5444_DROP_PACKET;
+    }
+
+    uint8_t link_cost = aodvv2_metric_link_cost(msg->metric_type);
+    if ((aodvv2_metric_max(msg->metric_type) - link_cost) <=
+        msg->targ_node.metric) {
+        DEBUG_PUTS("aodvv2: metric limit reached");
+        return RFC5444_DROP_PACKET;
+    }
+
+    aodvv2_metric_update(msg->metric_type, &msg->targ_node.metric);
+
+    timex_t now;
+    aodvv2_core_now(core, &now);
+    msg->timestamp = now;
+
+    aodvv2_local_route_t tmp = {0};
+    aodvv2_lrs_fill_routing_entry_rrep(msg, &tmp, link_cost);
+
+    aodvv2_local_route_t *rt_entry =
+        aodvv2_lrs_get_entry(&core->lrs, &msg->targ_node.addr,
+                             msg->metric_type, &now);
+    if (rt_entry != NULL) {
+        bool same_router = !aodvv2_addr_is_unspecified(&tmp.seqnortr) &&
+                           aodvv2_addr_equal(&rt_entry->seqnortr, &tmp.seqnortr);
+        bool known_router = !aodvv2_addr_is_unspecified(&tmp.seqnortr) &&
+                            !aodvv2_addr_is_unspecified(&rt_entry->seqnortr);
+
+        if (same_router) {
+            /* Ordered SeqNums, handled like any other route update */
+            if (!aodvv2_lrs_offers_improvement(&core->lrs, rt_entry, &tmp,
+                                               &now)) {
+                DEBUG_PUTS("aodvv2: announcement offers no improvement");
+                return RFC5444_DROP_PACKET;
+            }
+        }
+        else if (!known_router && rt_entry->seqnum == tmp.seqnum &&
+                 rt_entry->metric <= tmp.metric) {
+            /* Without both SeqNoRtrs the SeqNums can't be ordered, only a
+             * copy of the announcement we have is recognized */
+            DEBUG_PUTS("aodvv2: announcement is redundant");
+            return RFC5444_DROP_PACKET;
+        }
+        /* Otherwise the client moved to another router, whose SeqNums
+         * can't be ordered with those of the previous one */
+
+        DEBUG_PUTS("aodvv2: updating announced client route");
+        _update_route(core, rt_entry, &tmp);
+    }
+    else {
+        aodvv2_lrs_add_entry(&core->lrs, &tmp, &now);
+
+        DEBUG_PUTS("aodvv2: adding announced client route to FIB");
+        if (core->ops->fib_add(core->ctx, &tmp.addr, tmp.pfx_len,
+                               &tmp.next_hop, AODVV2_ROUTE_LIFETIME) < 0) {
+            DEBUG_PUTS("aodvv2: couldn't add route");
+        }
+    }
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    if (msg->has_targ_pos) {
+        aodvv2_lar_learn(&core->lar, &msg->targ_node.addr,
+                         msg->targ_node.pfx_len, &msg->targ_pos, &now);
+    }
+#endif
+
+    /* Packets may be waiting for a route discovery to the client */
+    if (core->ops->route_found) {
+        core->ops->route_found(core->ctx, &msg->targ_node.addr);
+    }
+
+    if (msg->msg_hop_limit > 0) {
+        aodvv2_core_send_announcement(core, msg);
     }
 
     return RFC5444_OKAY;
@@ -192,7 +400,9 @@ static enum rfc5444_result _cb_rrep_blocktlv_addresstlvs_okay(
 static enum rfc5444_result _cb_rrep_end_callback(
         struct rfc5444_reader_tlvblock_context *cont, bool dropped)
 {
-    (void)cont;
+    aodvv2_reader_t *reader = _reader(cont);
+    aodvv2_core_t *core = _core(reader);
+    aodvv2_message_t *msg = &reader->msg;
 
     /* Check if packet contains the required information */
     if (dropped) {
@@ -200,57 +410,71 @@ static enum rfc5444_result _cb_rrep_end_callback(
         return RFC5444_DROP_PACKET;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.orig_node.addr) ||
-        _msg_data.orig_node.seqnum == 0) {
-        DEBUG_PUTS("aodvv2: missing OrigNode Address or SeqNum");
+    if (aodvv2_addr_is_unspecified(&msg->orig_node.addr)) {
+        return _handle_client_announcement(core, msg);
+    }
+
+    if (msg->orig_node.seqnum == 0) {
+        DEBUG_PUTS("aodvv2: missing OrigNode SeqNum");
         return RFC5444_DROP_PACKET;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.targ_node.addr) ||
-        _msg_data.targ_node.seqnum == 0) {
+    if (aodvv2_addr_is_unspecified(&msg->targ_node.addr) ||
+        msg->targ_node.seqnum == 0) {
         DEBUG_PUTS("aodvv2: missing TargNode Address or SeqNum");
         return RFC5444_DROP_PACKET;
     }
 
-    uint8_t link_cost = aodvv2_metric_link_cost(_msg_data.metric_type);
+    uint8_t link_cost = aodvv2_metric_link_cost(msg->metric_type);
 
-    if ((aodvv2_metric_max(_msg_data.metric_type) - link_cost) <=
-        _msg_data.targ_node.metric) {
+    if ((aodvv2_metric_max(msg->metric_type) - link_cost) <=
+        msg->targ_node.metric) {
         DEBUG_PUTS("aodvv2: metric limit reached");
         return RFC5444_DROP_PACKET;
     }
 
-    aodvv2_metric_update(_msg_data.metric_type, &_msg_data.targ_node.metric);
+    aodvv2_metric_update(msg->metric_type, &msg->targ_node.metric);
 
     /* Update packet timestamp */
     timex_t now;
-    xtimer_now_timex(&now);
-    _msg_data.timestamp = now;
+    aodvv2_core_now(core, &now);
+    msg->timestamp = now;
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    if (msg->has_targ_pos) {
+        aodvv2_lar_learn(&core->lar, &msg->targ_node.addr,
+                         msg->targ_node.pfx_len, &msg->targ_pos, &now);
+    }
+#endif
 
     /* for every relevant address (RteMsg.Addr) in the RteMsg, HandlingRtr
     searches its route table to see if there is a route table entry with the
     same MetricType of the RteMsg, matching RteMsg.Addr. */
 
     aodvv2_local_route_t *rt_entry =
-        aodvv2_lrs_get_entry(&_msg_data.targ_node.addr, _msg_data.metric_type);
+        aodvv2_lrs_get_entry(&core->lrs, &msg->targ_node.addr,
+                             msg->metric_type, &now);
 
-    if (!rt_entry || (rt_entry->metric_type != _msg_data.metric_type)) {
+    if (!rt_entry || (rt_entry->metric_type != msg->metric_type)) {
         DEBUG_PUTS("aodvv2: creating new Local Route");
 
         aodvv2_local_route_t tmp = {0};
-        aodvv2_lrs_fill_routing_entry_rrep(&_msg_data, &tmp, link_cost);
-        aodvv2_lrs_add_entry(&tmp);
-
-        /* Add entry to NIB forwarding table */
-        DEBUG_PUTS("aodvv2: adding Local Route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&_msg_data.targ_node.addr,
-                                 _msg_data.targ_node.pfx_len, &_msg_data.sender,
-                                 _netif_pid, AODVV2_ROUTE_LIFETIME) < 0) {
+        aodvv2_lrs_fill_routing_entry_rrep(msg, &tmp, link_cost);
+        aodvv2_lrs_add_entry(&core->lrs, &tmp, &now);
+
+        /* Add entry to the forwarding table */
+        DEBUG_PUTS("aodvv2: adding Local Route to FIB");
+        if (core->ops->fib_add(core->ctx, &msg->targ_node.addr,
+                               msg->targ_node.pfx_len, &msg->sender,
+                               AODVV2_ROUTE_LIFETIME) < 0) {
             DEBUG_PUTS("aodvv2: couldn't add route");
         }
     }
     else {
-        if (!aodvv2_lrs_offers_improvement(rt_entry, &_msg_data.targ_node)) {
+        aodvv2_local_route_t tmp = {0};
+        aodvv2_lrs_fill_routing_entry_rrep(msg, &tmp, link_cost);
+
+        if (!aodvv2_lrs_offers_improvement(&core->lrs, rt_entry, &tmp, &now)) {
             DEBUG_PUTS("aodvv2: RREP offers no improvement over known route");
             return RFC5444_DROP_PACKET;
         }
@@ -258,36 +482,34 @@ static enum rfc5444_result _cb_rrep_end_callback(
         /* The incoming routing information is better than existing routing
          * table information and SHOULD be used to improve the route table. */
         DEBUG_PUTS("aodvv2: updating Routing Table entry");
-        aodvv2_lrs_fill_routing_entry_rrep(&_msg_data, rt_entry, link_cost);
-
-        /* Add entry to nib forwarding table */
-        gnrc_ipv6_nib_ft_del(&rt_entry->addr, rt_entry->pfx_len);
-
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&rt_entry->addr, rt_entry->pfx_len,
-                                 &rt_entry->next_hop, _netif_pid,
-                                 AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
-        }
+        _update_route(core, rt_entry, &tmp);
     }
 
-    if (aodvv2_rcs_is_client(&_msg_data.orig_node.addr) != NULL) {
+    if (aodvv2_rcs_is_client(&core->rcs, &msg->orig_node.addr) != NULL) {
         DEBUG("aodvv2: {%" PRIu32 ":%" PRIu32 "}\n",
               now.seconds, now.microseconds);
         DEBUG("aodvv2: this is my RREP (SeqNum: %d)\n",
-              _msg_data.orig_node.seqnum);
+              msg->orig_node.seqnum);
         DEBUG_PUTS("aodvv2: We are done here, thanks!");
 
+        aodvv2_core_stay_awake(core, AODVV2_ROUTE_LIFETIME);
+
         /* Send buffered packets for this address */
-        aodvv2_buffer_dispatch(&_msg_data.targ_node.addr);
+        if (core->ops->route_found) {
+            core->ops->route_found(core->ctx, &msg->targ_node.addr);
+        }
     }
     else {
         DEBUG_PUTS("aodvv2: not my RREP, passing it on to the next hop.");
 
         ipv6_addr_t *next_hop =
-            aodvv2_lrs_get_next_hop(&_msg_data.orig_node.addr,
-                                    _msg_data.metric_type);
-        aodvv2_send_rrep(&_msg_data, next_hop);
+            aodvv2_lrs_get_next_hop(&core->lrs, &msg->orig_node.addr,
+                                    msg->metric_type, &now);
+        if (next_hop == NULL) {
+            DEBUG_PUTS("aodvv2: no route back to OrigNode");
+            return RFC5444_DROP_PACKET;
+        }
+        aodvv2_core_send_rrep(core, msg, next_hop);
     }
     return RFC5444_OKAY;
 }
@@ -295,17 +517,28 @@ static enum rfc5444_result _cb_rrep_end_callback(
 static enum rfc5444_result _cb_rreq_blocktlv_messagetlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *reader = _reader(cont);
+
     if (!cont->has_hoplimit) {
         DEBUG("aodvv2: missing hop limit\n");
         return RFC5444_DROP_PACKET;
     }
 
-    _msg_data.msg_hop_limit = cont->hoplimit;
-    if (_msg_data.msg_hop_limit == 0) {
+    reader->msg.msg_hop_limit = cont->hoplimit;
+    if (reader->msg.msg_hop_limit == 0) {
         DEBUG("aodvv2: Hoplimit is 0.\n");
         return RFC5444_DROP_PACKET;
     }
-    _msg_data.msg_hop_limit--;
+    reader->msg.msg_hop_limit--;
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    reader->msg.has_orig_pos =
+        _read_position(&reader->rreq_msg_entries[_ORIGPOS_ENTRY],
+                       &reader->msg.orig_pos);
+    reader->msg.has_targ_pos =
+        _read_position(&reader->rreq_msg_entries[_TARGPOS_ENTRY],
+                       &reader->msg.targ_pos);
+#endif
 
     return RFC5444_OKAY;
 }
@@ -313,38 +546,41 @@ static enum rfc5444_result _cb_rreq_blocktlv_messagetlvs_okay(
 static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
         struct rfc5444_reader_tlvblock_context *cont)
 {
+    aodvv2_reader_t *reader = _reader(cont);
     struct rfc5444_reader_tlvblock_entry *tlv;
     bool is_orig_node_addr = false;
     bool is_targ_node = false;
 
+#if IS_USED(MODULE_OONF_COMMON_NETADDR_STRING)
     DEBUG("aodvv2: %s\n", netaddr_to_string(&nbuf, &cont->addr));
+#endif
 
     /* handle OrigNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
+    tlv = reader->rreq_addr_entries[RFC5444_MSGTLV_ORIGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_ORIGSEQNUM: %d\n", *tlv->single_value);
         is_orig_node_addr = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.orig_node.addr,
-                             &_msg_data.orig_node.pfx_len);
-        _msg_data.orig_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &reader->msg.orig_node.addr,
+                             &reader->msg.orig_node.pfx_len);
+        reader->msg.orig_node.seqnum = *tlv->single_value;
     }
 
     /* handle TargNode SeqNum TLV */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
+    tlv = reader->rreq_addr_entries[RFC5444_MSGTLV_TARGSEQNUM].tlv;
     if (tlv) {
         DEBUG("aodvv2: RFC5444_MSGTLV_TARGSEQNUM: %d\n", *tlv->single_value);
 
         is_targ_node = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
-        _msg_data.targ_node.seqnum = *tlv->single_value;
+        netaddr_to_ipv6_addr(&cont->addr, &reader->msg.targ_node.addr,
+                             &reader->msg.targ_node.pfx_len);
+        reader->msg.targ_node.seqnum = *tlv->single_value;
     }
 
     if (!tlv && !is_orig_node_addr) {
         /* assume that tlv missing => targ_node Address */
         is_targ_node = true;
-        netaddr_to_ipv6_addr(&cont->addr, &_msg_data.targ_node.addr,
-                             &_msg_data.targ_node.pfx_len);
+        netaddr_to_ipv6_addr(&cont->addr, &reader->msg.targ_node.addr,
+                             &reader->msg.targ_node.pfx_len);
     }
 
     if (!is_orig_node_addr && !is_targ_node) {
@@ -356,7 +592,7 @@ static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
     /* cppcheck: suppress false positive on non-trivially initialized arrays.
      *           this is a known bug: http://trac.cppcheck.net/ticket/5497 */
     /* cppcheck-suppress arrayIndexOutOfBounds */
-    tlv = _address_consumer_entries[RFC5444_MSGTLV_METRIC].tlv;
+    tlv = reader->rreq_addr_entries[RFC5444_MSGTLV_METRIC].tlv;
     if (!tlv && is_orig_node_addr) {
         DEBUG_PUTS("aodvv2: missing or unknown metric TLV");
         return RFC5444_DROP_PACKET;
@@ -370,8 +606,8 @@ static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
         DEBUG("aodvv2: RFC5444_MSGTLV_METRIC val: %d, exttype: %d\n",
                *tlv->single_value, tlv->type_ext);
 
-        _msg_data.metric_type = tlv->type_ext;
-        _msg_data.orig_node.metric = *tlv->single_value;
+        reader->msg.metric_type = tlv->type_ext;
+        reader->msg.orig_node.metric = *tlv->single_value;
     }
     return RFC5444_OKAY;
 }
@@ -379,8 +615,9 @@ static enum rfc5444_result _cb_rreq_blocktlv_addresstlvs_okay(
 static enum rfc5444_result _cb_rreq_end_callback(
     struct rfc5444_reader_tlvblock_context *cont, bool dropped)
 {
-    (void) cont;
-
+    aodvv2_reader_t *reader = _reader(cont);
+    aodvv2_core_t *core = _core(reader);
+    aodvv2_message_t *msg = &reader->msg;
 
     /* Check if packet contains the required information */
     if (dropped) {
@@ -388,71 +625,82 @@ static enum rfc5444_result _cb_rreq_end_callback(
         return RFC5444_DROP_PACKET;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.orig_node.addr) ||
-        _msg_data.orig_node.seqnum == 0) {
+    if (aodvv2_addr_is_unspecified(&msg->orig_node.addr) ||
+        msg->orig_node.seqnum == 0) {
         DEBUG_PUTS("aodvv2: missing OrigNode Address or SeqNum");
         return RFC5444_DROP_PACKET;
     }
 
-    if (ipv6_addr_is_unspecified(&_msg_data.targ_node.addr)) {
+    if (aodvv2_addr_is_unspecified(&msg->targ_node.addr)) {
         DEBUG_PUTS("aodvv2: missing TargNode Address");
         return RFC5444_DROP_PACKET;
     }
 
-    if (_msg_data.msg_hop_limit == 0) {
+    if (msg->msg_hop_limit == 0) {
         DEBUG_PUTS("aodvv2: hop limit is 0");
         return RFC5444_DROP_PACKET;
     }
 
-    uint8_t link_cost = aodvv2_metric_link_cost(_msg_data.metric_type);
-    if ((aodvv2_metric_max(_msg_data.metric_type) - link_cost) <=
-        _msg_data.orig_node.metric) {
+    uint8_t link_cost = aodvv2_metric_link_cost(msg->metric_type);
+    if ((aodvv2_metric_max(msg->metric_type) - link_cost) <=
+        msg->orig_node.metric) {
         DEBUG_PUTS("aodvv2: metric limit reached");
         return RFC5444_DROP_PACKET;
     }
 
+    /* Update packet timestamp */
+    timex_t now;
+    aodvv2_core_now(core, &now);
+    msg->timestamp = now;
+
     /* The incoming RREQ MUST be checked against previously received information */
-    if (aodvv2_mcmsg_process(&_msg_data) == AODVV2_MCMSG_REDUNDANT) {
+    if (aodvv2_mcmsg_process(&core->mcmsg, msg, &now) ==
+        AODVV2_MCMSG_REDUNDANT) {
         DEBUG_PUTS("aodvv2: packet is redundant");
         return RFC5444_DROP_PACKET;
     }
 
-    aodvv2_metric_update(_msg_data.metric_type, &_msg_data.orig_node.metric);
+    aodvv2_metric_update(msg->metric_type, &msg->orig_node.metric);
 
-    /* Update packet timestamp */
-    timex_t now;
-    xtimer_now_timex(&now);
-    _msg_data.timestamp = now;
+#if IS_USED(MODULE_AODVV2_LAR)
+    if (msg->has_orig_pos) {
+        aodvv2_lar_learn(&core->lar, &msg->orig_node.addr,
+                         msg->orig_node.pfx_len, &msg->orig_pos, &now);
+    }
+#endif
 
     /* For every relevant address (RteMsg.Addr) in the RteMsg, HandlingRtr
      * searches its route table to see if there is a route table entry with the
      * same MetricType of the RteMsg, matching RteMsg.Addr.
      */
     aodvv2_local_route_t *rt_entry =
-        aodvv2_lrs_get_entry(&_msg_data.orig_node.addr,
-                             _msg_data.metric_type);
+        aodvv2_lrs_get_entry(&core->lrs, &msg->orig_node.addr,
+                             msg->metric_type, &now);
 
-    if (!rt_entry || (rt_entry->metric_type != _msg_data.metric_type)) {
+    if (!rt_entry || (rt_entry->metric_type != msg->metric_type)) {
         DEBUG_PUTS("aodvv2: creating new Local Route");
 
         aodvv2_local_route_t tmp = {0};
 
         /* Add this RREQ to LRS */
-        aodvv2_lrs_fill_routing_entry_rreq(&_msg_data, &tmp, link_cost);
-        aodvv2_lrs_add_entry(&tmp);
-
-        /* Add entry to NIB forwarding table */
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&_msg_data.orig_node.addr,
-                                 _msg_data.orig_node.pfx_len, &_msg_data.sender,
-                                 _netif_pid, AODVV2_ROUTE_LIFETIME) < 0) {
+        aodvv2_lrs_fill_routing_entry_rreq(msg, &tmp, link_cost);
+        aodvv2_lrs_add_entry(&core->lrs, &tmp, &now);
+
+        /* Add entry to the forwarding table */
+        DEBUG_PUTS("aodvv2: adding route to FIB");
+        if (core->ops->fib_add(core->ctx, &msg->orig_node.addr,
+                               msg->orig_node.pfx_len, &msg->sender,
+                               AODVV2_ROUTE_LIFETIME) < 0) {
             DEBUG_PUTS("aodvv2: couldn't add route");
         }
     }
     else {
+        aodvv2_local_route_t tmp = {0};
+        aodvv2_lrs_fill_routing_entry_rreq(msg, &tmp, link_cost);
+
         /* If the route is already stored verify if this route offers an
          * improvement in path*/
-        if (!aodvv2_lrs_offers_improvement(rt_entry, &_msg_data.orig_node)) {
+        if (!aodvv2_lrs_offers_improvement(&core->lrs, rt_entry, &tmp, &now)) {
             DEBUG_PUTS("aodvv2: packet offers no improvement over known route");
             return RFC5444_DROP_PACKET;
         }
@@ -460,17 +708,7 @@ static enum rfc5444_result _cb_rreq_end_callback(
         /* The incoming routing information is better than existing routing
          * table information and SHOULD be used to improve the route table. */
         DEBUG_PUTS("aodvv2: updating Local Route");
-        aodvv2_lrs_fill_routing_entry_rreq(&_msg_data, rt_entry, link_cost);
-
-        /* Add entry to nib forwarding table */
-        gnrc_ipv6_nib_ft_del(&rt_entry->addr, rt_entry->pfx_len);
-
-        DEBUG_PUTS("aodvv2: adding route to NIB FT");
-        if (gnrc_ipv6_nib_ft_add(&rt_entry->addr, rt_entry->pfx_len,
-                                 &rt_entry->next_hop, _netif_pid,
-                                 AODVV2_ROUTE_LIFETIME) < 0) {
-            DEBUG_PUTS("aodvv2: couldn't add route");
-        }
+        _update_route(core, rt_entry, &tmp);
     }
 
     /* If TargNode is a client of the router receiving the RREQ, then the
@@ -478,48 +716,189 @@ static enum rfc5444_result _cb_rreq_end_callback(
      * subsequently processing for the RREQ is complete.  Otherwise,
      * processing continues as follows.
      */
-    if (aodvv2_rcs_is_client(&_msg_data.targ_node.addr) != NULL) {
+    if (aodvv2_rcs_is_client(&core->rcs, &msg->targ_node.addr) != NULL) {
         DEBUG_PUTS("aodvv2: TargNode is on client list, sending RREP");
 
-        /* Make sure to start with a clean metric value */
-        _msg_data.targ_node.metric = 0;
+        /* Make sure to start with a clean metric value, and have the
+         * writer issue our SeqNum */
+        msg->targ_node.metric = 0;
+        msg->targ_node.seqnum = 0;
+
+#if IS_USED(MODULE_AODVV2_LAR)
+        /* Replace the last known position with ours */
+        msg->targ_pos = core->lar.pos;
+        msg->has_targ_pos = core->lar.has_pos;
+#endif
 
-        aodvv2_send_rrep(&_msg_data, &_msg_data.sender);
+        aodvv2_core_send_rrep(core, msg, &msg->sender);
     }
     else {
+#if IS_USED(MODULE_AODVV2_LAR)
+        if (msg->has_orig_pos && msg->has_targ_pos &&
+            !aodvv2_lar_in_zone(&core->lar, &msg->orig_pos, &msg->targ_pos)) {
+            DEBUG_PUTS("aodvv2: outside of the request zone, not forwarding RREQ");
+            return RFC5444_OKAY;
+        }
+#endif
+
         DEBUG_PUTS("aodvv2: I'm not TargNode, forwarding RREQ");
-        aodvv2_send_rreq(&_msg_data, &ipv6_addr_all_manet_routers_link_local);
+        aodvv2_core_send_rreq(core, msg,
+                              &ipv6_addr_all_manet_routers_link_local);
+    }
+
+    return RFC5444_OKAY;
+}
+
+static enum rfc5444_result _cb_rerr_blocktlv_messagetlvs_okay(
+        struct rfc5444_reader_tlvblock_context *cont)
+{
+    aodvv2_reader_t *reader = _reader(cont);
+
+    if (!cont->has_hoplimit) {
+        DEBUG_PUTS("aodvv2: missing hop limit");
+        return RFC5444_DROP_PACKET;
     }
 
+    reader->msg.msg_hop_limit = cont->hoplimit;
+    if (reader->msg.msg_hop_limit == 0) {
+        DEBUG_PUTS("aodvv2: hop limit is 0");
+        return RFC5444_DROP_PACKET;
+    }
+
+    reader->msg.msg_hop_limit--;
     return RFC5444_OKAY;
 }
 
-void aodvv2_reader_init(struct rfc5444_reader *reader, kernel_pid_t netif_pid)
+static enum rfc5444_result _cb_rerr_blocktlv_addresstlvs_okay(
+        struct rfc5444_reader_tlvblock_context *cont)
 {
-    assert(reader != NULL && netif_pid != KERNEL_PID_UNDEF);
+    aodvv2_reader_t *reader = _reader(cont);
+
+#if IS_USED(MODULE_OONF_COMMON_NETADDR_STRING)
+    DEBUG("aodvv2: %s\n", netaddr_to_string(&nbuf, &cont->addr));
+#endif
 
-    if (_netif_pid == KERNEL_PID_UNDEF) {
-        _netif_pid = netif_pid;
+    /* We only send one unreachable address per RERR */
+    if (!aodvv2_addr_is_unspecified(&reader->msg.targ_node.addr)) {
+        DEBUG_PUTS("aodvv2: ignoring extra unreachable address");
+        return RFC5444_OKAY;
     }
 
-    rfc5444_reader_add_message_consumer(reader, &_rrep_consumer,
-                                        NULL, 0);
+    netaddr_to_ipv6_addr(&cont->addr, &reader->msg.targ_node.addr,
+                         &reader->msg.targ_node.pfx_len);
 
-    rfc5444_reader_add_message_consumer(reader, &_rrep_address_consumer,
-                                        _address_consumer_entries,
-                                        ARRAY_SIZE(_address_consumer_entries));
+    return RFC5444_OKAY;
+}
 
-    rfc5444_reader_add_message_consumer(reader, &_rreq_consumer,
-                                        NULL, 0);
+static enum rfc5444_result _cb_rerr_end_callback(
+    struct rfc5444_reader_tlvblock_context *cont, bool dropped)
+{
+    aodvv2_reader_t *reader = _reader(cont);
+    aodvv2_core_t *core = _core(reader);
+    aodvv2_message_t *msg = &reader->msg;
 
-    rfc5444_reader_add_message_consumer(reader, &_rreq_address_consumer,
-                                        _address_consumer_entries,
-                                        ARRAY_SIZE(_address_consumer_entries));
+    if (dropped) {
+        DEBUG_PUTS("aodvv2: dropping packet");
+        return RFC5444_DROP_PACKET;
+    }
+
+    if (aodvv2_addr_is_unspecified(&msg->targ_node.addr)) {
+        DEBUG_PUTS("aodvv2: missing unreachable address");
+        return RFC5444_DROP_PACKET;
+    }
+
+    timex_t now;
+    aodvv2_core_now(core, &now);
+    msg->metric_type = CONFIG_AODVV2_DEFAULT_METRIC;
+
+    /* Only routes through the reporting router are broken, a route learnt
+     * from the client announcement of its new router stays */
+    aodvv2_local_route_t *rt_entry =
+        aodvv2_lrs_get_entry(&core->lrs, &msg->targ_node.addr,
+                             msg->metric_type, &now);
+    if (rt_entry == NULL ||
+        !aodvv2_addr_equal(&rt_entry->next_hop, &msg->sender)) {
+        DEBUG_PUTS("aodvv2: no route through the RERR sender");
+        return RFC5444_OKAY;
+    }
+
+    DEBUG_PUTS("aodvv2: removing unreachable route");
+    core->ops->fib_del(core->ctx, &rt_entry->addr, rt_entry->pfx_len);
+    aodvv2_lrs_delete_entry(&core->lrs, &msg->targ_node.addr,
+                            msg->metric_type, &now);
+
+    if (msg->msg_hop_limit > 0) {
+        aodvv2_core_send_rerr(core, msg);
+    }
+
+    return RFC5444_OKAY;
+}
+
+void aodvv2_reader_init(aodvv2_reader_t *reader)
+{
+    assert(reader != NULL);
+
+    reader->rrep_consumer = _rrep_consumer;
+    reader->rrep_addr_consumer = _rrep_address_consumer;
+    reader->rreq_consumer = _rreq_consumer;
+    reader->rreq_addr_consumer = _rreq_address_consumer;
+    reader->rerr_consumer = _rerr_consumer;
+    reader->rerr_addr_consumer = _rerr_address_consumer;
+    memcpy(reader->rrep_addr_entries, _address_consumer_entries,
+           sizeof(reader->rrep_addr_entries));
+    memcpy(reader->rreq_addr_entries, _address_consumer_entries,
+           sizeof(reader->rreq_addr_entries));
+    memset(&reader->msg, 0, sizeof(reader->msg));
+
+    rfc5444_reader_init(&reader->reader);
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    memcpy(reader->rrep_msg_entries, _message_consumer_entries,
+           sizeof(reader->rrep_msg_entries));
+    memcpy(reader->rreq_msg_entries, _message_consumer_entries,
+           sizeof(reader->rreq_msg_entries));
+
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rrep_consumer,
+                                        reader->rrep_msg_entries,
+                                        ARRAY_SIZE(reader->rrep_msg_entries));
+#else
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rrep_consumer, NULL, 0);
+#endif
+
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rrep_addr_consumer,
+                                        reader->rrep_addr_entries,
+                                        ARRAY_SIZE(reader->rrep_addr_entries));
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rreq_consumer,
+                                        reader->rreq_msg_entries,
+                                        ARRAY_SIZE(reader->rreq_msg_entries));
+#else
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rreq_consumer, NULL, 0);
+#endif
+
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rreq_addr_consumer,
+                                        reader->rreq_addr_entries,
+                                        ARRAY_SIZE(reader->rreq_addr_entries));
+
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rerr_consumer, NULL, 0);
+
+    rfc5444_reader_add_message_consumer(&reader->reader,
+                                        &reader->rerr_addr_consumer, NULL, 0);
 }
 
-void aodvv2_rfc5444_handle_packet_prepare(ipv6_addr_t *sender)
+void aodvv2_rfc5444_handle_packet_prepare(aodvv2_reader_t *reader,
+                                          const ipv6_addr_t *sender)
 {
-    assert(sender != NULL);
+    assert(reader != NULL && sender != NULL);
 
-    _msg_data.sender = *sender;
+    memset(&reader->msg, 0, sizeof(reader->msg));
+    reader->msg.sender = *sender;
 }
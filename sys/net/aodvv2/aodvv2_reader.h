@@ -13,7 +13,7 @@
  * @{
  *
  * @file
- * @brief       AODVVv2 Message Writer
+ * @brief       AODVVv2 Message Reader
  *
  * @author      Lotte Steenbrink <lotte.steenbrink@fu-berlin.de>
  * @author      Gustavo Grisales <gustavosinbandera1@hotmail.com>
@@ -30,20 +30,24 @@ extern "C" {
 #endif
 
 /**
- * @brief   Register AODVv2 message reader
+ * @brief   Initialize the RFC5444 reader and register AODVv2 message consumers
+ *
+ * @pre @p reader != NULL and @p reader is part of an @ref aodvv2_core_t
  *
  * @param[in] reader Pointer to the reader context.
  */
-void aodvv2_reader_init(struct rfc5444_reader *reader, kernel_pid_t netif_pid);
+void aodvv2_reader_init(aodvv2_reader_t *reader);
 
 /**
  * @brief   Sets the sender address
  *
  * @notes MUST be called before starting to parse the packet.
  *
+ * @param[in] reader Pointer to the reader context.
  * @param[in] sender The address of the sender.
  */
-void aodvv2_rfc5444_handle_packet_prepare(ipv6_addr_t *sender);
+void aodvv2_rfc5444_handle_packet_prepare(aodvv2_reader_t *reader,
+                                          const ipv6_addr_t *sender);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -23,24 +23,32 @@
 
 #include "net/aodvv2/seqnum.h"
 
-#include <stdatomic.h>
+#include <assert.h>
+#include <stddef.h>
 
-static atomic_uint_fast32_t seqnum;
-
-void aodvv2_seqnum_init(void)
+void aodvv2_seqnum_init(aodvv2_seqnum_t *seqnum)
 {
+    assert(seqnum != NULL);
+
     /* Initialize to 1 */
-    atomic_init(&seqnum, 1);
+    *seqnum = 1;
 }
 
-void aodvv2_seqnum_inc(void)
+void aodvv2_seqnum_inc(aodvv2_seqnum_t *seqnum)
 {
-    if (atomic_fetch_add(&seqnum, 1) >= 65535) {
-        atomic_store(&seqnum, 1);
+    assert(seqnum != NULL);
+
+    if (*seqnum >= 65535) {
+        *seqnum = 1;
+    }
+    else {
+        (*seqnum)++;
     }
 }
 
-aodvv2_seqnum_t aodvv2_seqnum_get(void)
+aodvv2_seqnum_t aodvv2_seqnum_get(const aodvv2_seqnum_t *seqnum)
 {
-    return atomic_load(&seqnum);
+    assert(seqnum != NULL);
+
+    return *seqnum;
 }
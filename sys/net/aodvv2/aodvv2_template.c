@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       RREQ and RREP wire templates
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "kernel_defines.h"
+#include "net/aodvv2/addr.h"
+
+#include "aodvv2_template.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+static_assert(AODVV2_RFC5444_PACKET_SIZE <= UINT8_MAX,
+              "template offsets don't fit AODVV2_RFC5444_PACKET_SIZE");
+
+#define _ORIG_ADDR  offsetof(aodvv2_message_t, orig_node.addr)
+#define _TARG_ADDR  offsetof(aodvv2_message_t, targ_node.addr)
+#define _SEQNORTR   offsetof(aodvv2_message_t, seqnortr)
+
+/**
+ * @brief   A TLV of the generic writer output
+ */
+typedef struct {
+    uint8_t type;       /**< Type */
+    uint8_t start;      /**< First address index */
+    uint8_t stop;       /**< Last address index */
+    size_t value;       /**< Offset of the value */
+    size_t value_len;   /**< Length of the value */
+} _tlv_t;
+
+static uint8_t _pfx_len(uint8_t pfx_len)
+{
+    /* As the writer encodes it */
+    return (pfx_len == 0 || pfx_len > 128) ? 128 : pfx_len;
+}
+
+static bool _has_orig(uint8_t msg_type, const aodvv2_message_t *msg)
+{
+    /* Client announcements are RREPs without OrigPrefix */
+    return msg_type == RFC5444_MSGTYPE_RREQ ||
+           !aodvv2_addr_is_unspecified(&msg->orig_node.addr);
+}
+
+static uint8_t _trailing_zeros(const ipv6_addr_t *addr)
+{
+    uint8_t n = 0;
+
+    while (n < sizeof(addr->u8) && addr->u8[sizeof(addr->u8) - 1 - n] == 0) {
+        n++;
+    }
+
+    return n;
+}
+
+static uint8_t _common_tail(const ipv6_addr_t *a, const ipv6_addr_t *b)
+{
+    uint8_t n = 0;
+
+    while (n < sizeof(a->u8) &&
+           a->u8[sizeof(a->u8) - 1 - n] == b->u8[sizeof(b->u8) - 1 - n]) {
+        n++;
+    }
+
+    return n;
+}
+
+static uint16_t _be16(const uint8_t *buf)
+{
+    return ((uint16_t)buf[0] << 8) | buf[1];
+}
+
+void aodvv2_template_key(aodvv2_template_key_t *key, uint8_t msg_type,
+                         const aodvv2_message_t *msg)
+{
+    assert(key != NULL && msg != NULL);
+
+    memset(key, 0, sizeof(*key));
+    key->msg_type = msg_type;
+    key->targ_pfx_len = _pfx_len(msg->targ_node.pfx_len);
+
+    /* A lone address is written whole, two share their head and tail, the
+     * tail is left out if it's zero */
+    if (_has_orig(msg_type, msg)) {
+        key->flags |= AODVV2_TEMPLATE_HAS_ORIG;
+        key->orig_pfx_len = _pfx_len(msg->orig_node.pfx_len);
+        key->head = aodvv2_addr_match_prefix(&msg->orig_node.addr,
+                                             &msg->targ_node.addr) / 8;
+        key->tail = _common_tail(&msg->orig_node.addr, &msg->targ_node.addr);
+        if (key->tail > 0 &&
+            _trailing_zeros(&msg->orig_node.addr) >= key->tail) {
+            key->flags |= AODVV2_TEMPLATE_ZERO_TAIL;
+        }
+    }
+    else if (!aodvv2_addr_is_unspecified(&msg->seqnortr)) {
+        key->flags |= AODVV2_TEMPLATE_HAS_SEQNORTR;
+    }
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    /* A RREP only carries the TargNode position */
+    if (msg_type == RFC5444_MSGTYPE_RREQ && msg->has_orig_pos) {
+        key->flags |= AODVV2_TEMPLATE_HAS_ORIG_POS;
+    }
+    if (msg->has_targ_pos) {
+        key->flags |= AODVV2_TEMPLATE_HAS_TARG_POS;
+    }
+#endif
+}
+
+aodvv2_template_t *aodvv2_template_find(aodvv2_template_set_t *set,
+                                        const aodvv2_template_key_t *key)
+{
+    assert(set != NULL && key != NULL);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(set->entries); i++) {
+        aodvv2_template_t *tpl = &set->entries[i];
+
+        if (tpl->used && memcmp(&tpl->key, key, sizeof(*key)) == 0) {
+            return tpl;
+        }
+    }
+
+    return NULL;
+}
+
+static int _add_op(aodvv2_template_t *tpl, size_t dst, size_t len, size_t src)
+{
+    if (len == 0) {
+        return 0;
+    }
+
+    if (tpl->ops_numof == ARRAY_SIZE(tpl->ops)) {
+        return -ENOSPC;
+    }
+
+    aodvv2_template_op_t *op = &tpl->ops[tpl->ops_numof++];
+    op->dst = dst;
+    op->len = len;
+    op->src = src;
+
+    return 0;
+}
+
+static int _read_tlv(const uint8_t *pkt, size_t end, size_t *pos, _tlv_t *tlv)
+{
+    size_t p = *pos;
+
+    if (p + 2 > end) {
+        return -EBADMSG;
+    }
+    tlv->type = pkt[p++];
+    uint8_t flags = pkt[p++];
+
+    /* The AODVv2 TLVs have a fixed type extension */
+    if (flags & RFC5444_TLV_FLAG_TYPEEXT) {
+        p++;
+    }
+
+    tlv->start = 0;
+    tlv->stop = UINT8_MAX;
+    if (flags & RFC5444_TLV_FLAG_SINGLE_IDX) {
+        if (p + 1 > end) {
+            return -EBADMSG;
+        }
+        tlv->start = pkt[p];
+        tlv->stop = pkt[p];
+        p++;
+    }
+    else if (flags & RFC5444_TLV_FLAG_MULTI_IDX) {
+        if (p + 2 > end) {
+            return -EBADMSG;
+        }
+        tlv->start = pkt[p];
+        tlv->stop = pkt[p + 1];
+        p += 2;
+    }
+
+    tlv->value_len = 0;
+    if (flags & RFC5444_TLV_FLAG_VALUE) {
+        if (flags & RFC5444_TLV_FLAG_EXTVALUE) {
+            if (p + 2 > end) {
+                return -EBADMSG;
+            }
+            tlv->value_len = _be16(&pkt[p]);
+            p += 2;
+        }
+        else {
+            if (p + 1 > end) {
+                return -EBADMSG;
+            }
+            tlv->value_len = pkt[p++];
+        }
+    }
+
+    /* One value per address, we only write single address TLVs */
+    if (flags & RFC5444_TLV_FLAG_MULTIVALUE) {
+        return -ENOTSUP;
+    }
+
+    tlv->value = p;
+    p += tlv->value_len;
+    if (p > end) {
+        return -EBADMSG;
+    }
+
+    *pos = p;
+    return 0;
+}
+
+static int _parse_msg_tlvs(aodvv2_template_t *tpl, const uint8_t *pkt,
+                           size_t end, size_t p)
+{
+    while (p < end) {
+        _tlv_t tlv;
+        int res = _read_tlv(pkt, end, &p, &tlv);
+        if (res < 0) {
+            return res;
+        }
+
+        if (!IS_USED(MODULE_AODVV2_LAR) ||
+            tlv.value_len != AODVV2_LAR_POSITION_LEN) {
+            return -ENOTSUP;
+        }
+
+        if (tlv.type == RFC5444_MSGTLV_ORIGPOS) {
+            tpl->orig_pos = tlv.value;
+        }
+        else if (tlv.type == RFC5444_MSGTLV_TARGPOS) {
+            tpl->targ_pos = tlv.value;
+        }
+        else {
+            return -ENOTSUP;
+        }
+    }
+
+    return 0;
+}
+
+/* Offset in the message of the address found in the packet */
+static int _addr_src(const aodvv2_message_t *msg, bool has_orig,
+                     const ipv6_addr_t *addr)
+{
+    bool orig = has_orig && aodvv2_addr_equal(addr, &msg->orig_node.addr);
+    bool targ = aodvv2_addr_equal(addr, &msg->targ_node.addr);
+
+    if (orig == targ) {
+        return -ENOTSUP;
+    }
+
+    return orig ? _ORIG_ADDR : _TARG_ADDR;
+}
+
+static int _parse_addr_tlvs(aodvv2_template_t *tpl, const uint8_t *pkt,
+                            size_t end, size_t p, const int *srcs,
+                            uint8_t num)
+{
+    while (p < end) {
+        _tlv_t tlv;
+        int res = _read_tlv(pkt, end, &p, &tlv);
+        if (res < 0) {
+            return res;
+        }
+
+        /* Flags only, nothing to fill */
+        if (tlv.value_len == 0) {
+            continue;
+        }
+
+        if (tlv.stop == UINT8_MAX) {
+            tlv.stop = num - 1;
+        }
+        if (tlv.start != tlv.stop || tlv.start >= num) {
+            return -ENOTSUP;
+        }
+
+        size_t src;
+        switch (tlv.type) {
+            case RFC5444_MSGTLV_ORIGSEQNUM:
+                src = offsetof(aodvv2_message_t, orig_node.seqnum);
+                break;
+
+            case RFC5444_MSGTLV_TARGSEQNUM:
+                src = offsetof(aodvv2_message_t, targ_node.seqnum);
+                break;
+
+            case RFC5444_MSGTLV_METRIC:
+                src = (srcs[tlv.start] == _ORIG_ADDR) ?
+                      offsetof(aodvv2_message_t, orig_node.metric) :
+                      offsetof(aodvv2_message_t, targ_node.metric);
+                break;
+
+            default:
+                return -ENOTSUP;
+        }
+
+        /* The writer copies the values from memory, so does the template */
+        if ((tlv.type == RFC5444_MSGTLV_METRIC && tlv.value_len != 1) ||
+            (tlv.type != RFC5444_MSGTLV_METRIC &&
+             tlv.value_len != sizeof(aodvv2_seqnum_t))) {
+            return -ENOTSUP;
+        }
+
+        res = _add_op(tpl, tlv.value, tlv.value_len, src);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return 0;
+}
+
+static int _parse_addr_block(aodvv2_template_t *tpl,
+                             const aodvv2_message_t *msg, bool has_orig,
+                             const uint8_t *pkt, size_t len, size_t *pos)
+{
+    size_t p = *pos;
+    size_t head = 0, head_off = 0;
+    size_t tail = 0, tail_off = 0;
+    int res;
+
+    if (p + 2 > len) {
+        return -EBADMSG;
+    }
+    uint8_t num = pkt[p++];
+    uint8_t flags = pkt[p++];
+    if (num == 0 || num > 2) {
+        return -ENOTSUP;
+    }
+
+    if (flags & RFC5444_ADDR_FLAG_HEAD) {
+        if (p + 1 > len) {
+            return -EBADMSG;
+        }
+        head = pkt[p++];
+        head_off = p;
+        p += head;
+    }
+    if (flags & (RFC5444_ADDR_FLAG_FULLTAIL | RFC5444_ADDR_FLAG_ZEROTAIL)) {
+        if (p + 1 > len) {
+            return -EBADMSG;
+        }
+        tail = pkt[p++];
+        if (flags & RFC5444_ADDR_FLAG_FULLTAIL) {
+            tail_off = p;
+            p += tail;
+        }
+    }
+    if (head + tail > sizeof(ipv6_addr_t)) {
+        return -EBADMSG;
+    }
+
+    size_t mid = sizeof(ipv6_addr_t) - head - tail;
+    size_t mid_off = p;
+    p += num * mid;
+
+    /* Prefix lengths are part of the shape */
+    if (flags & RFC5444_ADDR_FLAG_SINGLEPLEN) {
+        p += 1;
+    }
+    else if (flags & RFC5444_ADDR_FLAG_MULTIPLEN) {
+        p += num;
+    }
+    if (p + 2 > len) {
+        return -EBADMSG;
+    }
+
+    /* Find out which address of the message each one is */
+    int srcs[2];
+    for (unsigned i = 0; i < num; i++) {
+        ipv6_addr_t addr = IPV6_ADDR_UNSPECIFIED;
+
+        memcpy(addr.u8, &pkt[head_off], head);
+        memcpy(&addr.u8[head], &pkt[mid_off + i * mid], mid);
+        if (tail_off != 0) {
+            memcpy(&addr.u8[sizeof(addr.u8) - tail], &pkt[tail_off], tail);
+        }
+
+        srcs[i] = _addr_src(msg, has_orig, &addr);
+        if (srcs[i] < 0) {
+            return srcs[i];
+        }
+
+        res = _add_op(tpl, mid_off + i * mid, mid, srcs[i] + head);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    /* The head and full tail are the same for every address of the block */
+    res = _add_op(tpl, head_off, head, srcs[0]);
+    if (res == 0 && tail_off != 0) {
+        res = _add_op(tpl, tail_off, tail,
+                      srcs[0] + sizeof(ipv6_addr_t) - tail);
+    }
+    if (res < 0) {
+        return res;
+    }
+
+    size_t end = p + 2 + _be16(&pkt[p]);
+    if (end > len) {
+        return -EBADMSG;
+    }
+
+    res = _parse_addr_tlvs(tpl, pkt, end, p + 2, srcs, num);
+    if (res < 0) {
+        return res;
+    }
+
+    *pos = end;
+    return 0;
+}
+
+static int _parse(aodvv2_template_t *tpl, const aodvv2_template_key_t *key,
+                  const aodvv2_message_t *msg, const uint8_t *pkt, size_t len)
+{
+    bool has_orig = key->flags & AODVV2_TEMPLATE_HAS_ORIG;
+    size_t p = 0;
+    int res;
+
+    /* Packet header without sequence number nor TLVs, then the message
+     * header: type, flags and address length, size */
+    if (len < 5 || pkt[p++] != 0 || pkt[p++] != key->msg_type) {
+        return -ENOTSUP;
+    }
+
+    uint8_t flags = pkt[p++];
+    bool has_seqnortr = key->flags & AODVV2_TEMPLATE_HAS_SEQNORTR;
+    if ((flags & RFC5444_MSG_FLAG_ADDRLENMASK) != sizeof(ipv6_addr_t) - 1 ||
+        (flags & (RFC5444_MSG_FLAG_HOPCOUNT | RFC5444_MSG_FLAG_SEQNO)) ||
+        !(flags & RFC5444_MSG_FLAG_ORIGINATOR) != !has_seqnortr) {
+        return -ENOTSUP;
+    }
+
+    /* One message per packet */
+    if (1 + (size_t)_be16(&pkt[p]) != len) {
+        return -ENOTSUP;
+    }
+    p += 2;
+
+    if (flags & RFC5444_MSG_FLAG_ORIGINATOR) {
+        if (p + sizeof(ipv6_addr_t) > len) {
+            return -EBADMSG;
+        }
+        res = _add_op(tpl, p, sizeof(ipv6_addr_t), _SEQNORTR);
+        if (res < 0) {
+            return res;
+        }
+        p += sizeof(ipv6_addr_t);
+    }
+
+    if (flags & RFC5444_MSG_FLAG_HOPLIMIT) {
+        res = _add_op(tpl, p, 1, offsetof(aodvv2_message_t, msg_hop_limit));
+        if (res < 0) {
+            return res;
+        }
+        p++;
+    }
+
+    if (p + 2 > len) {
+        return -EBADMSG;
+    }
+    size_t end = p + 2 + _be16(&pkt[p]);
+    if (end > len) {
+        return -EBADMSG;
+    }
+
+    res = _parse_msg_tlvs(tpl, pkt, end, p + 2);
+    if (res < 0) {
+        return res;
+    }
+
+    p = end;
+    while (p < len) {
+        res = _parse_addr_block(tpl, msg, has_orig, pkt, len, &p);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    return 0;
+}
+
+aodvv2_template_t *aodvv2_template_learn(aodvv2_template_set_t *set,
+                                         const aodvv2_template_key_t *key,
+                                         const aodvv2_message_t *msg,
+                                         const uint8_t *pkt, size_t len)
+{
+    assert(set != NULL && key != NULL && msg != NULL && pkt != NULL);
+
+    aodvv2_template_t *tpl = &set->entries[set->next];
+    set->next = (set->next + 1) % ARRAY_SIZE(set->entries);
+
+    memset(tpl, 0, sizeof(*tpl));
+    if (len > sizeof(tpl->data)) {
+        return NULL;
+    }
+
+    int res = _parse(tpl, key, msg, pkt, len);
+    if (res < 0) {
+        DEBUG("aodvv2: can't make a template of this layout (%d)\n", res);
+        memset(tpl, 0, sizeof(*tpl));
+        return NULL;
+    }
+
+    tpl->key = *key;
+    tpl->len = len;
+    memcpy(tpl->data, pkt, len);
+    tpl->used = true;
+
+    return tpl;
+}
+
+void aodvv2_template_drop(aodvv2_template_t *tpl)
+{
+    assert(tpl != NULL);
+
+    memset(tpl, 0, sizeof(*tpl));
+}
+
+size_t aodvv2_template_fill(const aodvv2_template_t *tpl,
+                            const aodvv2_message_t *msg, uint8_t *buf)
+{
+    assert(tpl != NULL && msg != NULL && buf != NULL);
+
+    const uint8_t *src = (const uint8_t *)msg;
+
+    memcpy(buf, tpl->data, tpl->len);
+    for (unsigned i = 0; i < tpl->ops_numof; i++) {
+        const aodvv2_template_op_t *op = &tpl->ops[i];
+        memcpy(&buf[op->dst], &src[op->src], op->len);
+    }
+
+#if IS_USED(MODULE_AODVV2_LAR)
+    if (tpl->orig_pos != 0) {
+        aodvv2_lar_position_write(&buf[tpl->orig_pos], &msg->orig_pos);
+    }
+    if (tpl->targ_pos != 0) {
+        aodvv2_lar_position_write(&buf[tpl->targ_pos], &msg->targ_pos);
+    }
+#endif
+
+    return tpl->len;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_aodvv2
+ * @{
+ *
+ * @file
+ * @brief       RREQ and RREP wire templates
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef AODVV2_TEMPLATE_H
+#define AODVV2_TEMPLATE_H
+
+#include "net/aodvv2/rfc5444.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Get the shape of a message
+ *
+ * @pre (@p key != NULL) && (@p msg != NULL)
+ *
+ * @param[out] key      The shape.
+ * @param[in]  msg_type @ref RFC5444_MSGTYPE_RREQ or @ref RFC5444_MSGTYPE_RREP.
+ * @param[in]  msg      The message.
+ */
+void aodvv2_template_key(aodvv2_template_key_t *key, uint8_t msg_type,
+                         const aodvv2_message_t *msg);
+
+/**
+ * @brief   Find the template of a shape
+ *
+ * @pre (@p set != NULL) && (@p key != NULL)
+ *
+ * @return The template, NULL if the shape has none.
+ */
+aodvv2_template_t *aodvv2_template_find(aodvv2_template_set_t *set,
+                                        const aodvv2_template_key_t *key);
+
+/**
+ * @brief   Make a template from the generic writer output
+ *
+ * Takes the next entry of @p set, the oldest one.
+ *
+ * @pre (@p set != NULL) && (@p key != NULL) && (@p msg != NULL) &&
+ *      (@p pkt != NULL)
+ *
+ * @param[in] set The templates.
+ * @param[in] key Shape of @p msg.
+ * @param[in] msg The message.
+ * @param[in] pkt The packet the generic writer made of @p msg.
+ * @param[in] len Length of @p pkt.
+ *
+ * @return The template, not checked yet.
+ * @return NULL if @p pkt has a layout templates don't support.
+ */
+aodvv2_template_t *aodvv2_template_learn(aodvv2_template_set_t *set,
+                                         const aodvv2_template_key_t *key,
+                                         const aodvv2_message_t *msg,
+                                         const uint8_t *pkt, size_t len);
+
+/**
+ * @brief   Forget a template
+ *
+ * @pre @p tpl != NULL
+ */
+void aodvv2_template_drop(aodvv2_template_t *tpl);
+
+/**
+ * @brief   Write a message with a template
+ *
+ * @pre (@p tpl != NULL) && (@p msg != NULL) && (@p buf != NULL) and the
+ *      shape of @p msg is the one of @p tpl.
+ *
+ * @param[in]  tpl The template.
+ * @param[in]  msg The message, with its TargNode SeqNum set on a RREP.
+ * @param[out] buf @ref AODVV2_RFC5444_PACKET_SIZE bytes.
+ *
+ * @return Packet length.
+ */
+size_t aodvv2_template_fill(const aodvv2_template_t *tpl,
+                            const aodvv2_message_t *msg, uint8_t *buf);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* AODVV2_TEMPLATE_H */
+/** @} */
@@ -13,7 +13,7 @@
  * @{
  *
  * @file
- * @brief       RFC5444 RREQ
+ * @brief       Message Writer
  *
  * @author      Lotte Steenbrink <lotte.steenbrink@fu-berlin.de>
  * @author      Gustavo Grisales <gustavosinbandera1@hotmail.com>
@@ -21,30 +21,63 @@
  * @}
  */
 
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
 #include "aodvv2_writer.h"
+#include "net/aodvv2/addr.h"
+#include "net/aodvv2/core.h"
 #include "net/aodvv2/metric.h"
 
 #include "rfc5444_compat.h"
 
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+#include "aodvv2_template.h"
+#endif
+
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
+#if ENABLE_DEBUG == 1 && IS_USED(MODULE_OONF_RFC5444_PRINT)
+#include "rfc5444/rfc5444_print.h"
+#endif
+
+static_assert(AODVV2_RFC5444_RREQ_LEN <= AODVV2_RFC5444_MSG_SIZE &&
+              AODVV2_RFC5444_RREP_LEN <= AODVV2_RFC5444_MSG_SIZE &&
+              AODVV2_RFC5444_RERR_LEN <= AODVV2_RFC5444_MSG_SIZE,
+              "AODVV2_RFC5444_MSG_SIZE doesn't fit every message");
+static_assert(AODVV2_RFC5444_MSG_SIZE <= RFC5444_MSG_BUFFER_SIZE,
+              "RFC5444_MSG_BUFFER_SIZE is too small for AODVv2 messages");
+
 static int _cb_add_message_header(struct rfc5444_writer *wr, struct rfc5444_writer_message *message);
 static void _cb_rreq_add_addresses(struct rfc5444_writer *wr);
 static void _cb_rrep_add_addresses(struct rfc5444_writer *wr);
+static void _cb_rerr_add_addresses(struct rfc5444_writer *wr);
+#if IS_USED(MODULE_AODVV2_LAR)
+static void _cb_rreq_add_message_tlvs(struct rfc5444_writer *wr);
+static void _cb_rrep_add_message_tlvs(struct rfc5444_writer *wr);
+#endif
+
+static void _cb_send_packet(struct rfc5444_writer *wr,
+                            struct rfc5444_writer_target *iface, void *buffer,
+                            size_t length);
 
 /*
  * message content provider that will add message TLVs,
  * addresses and address block TLVs to all messages of type RREQ.
  */
-static struct rfc5444_writer_content_provider _rreq_message_content_provider =
+static const struct rfc5444_writer_content_provider _rreq_message_content_provider =
 {
     .msg_type = RFC5444_MSGTYPE_RREQ,
+#if IS_USED(MODULE_AODVV2_LAR)
+    .addMessageTLVs = _cb_rreq_add_message_tlvs,
+#endif
     .addAddresses = _cb_rreq_add_addresses,
 };
 
 /* declaration of all address TLVs added to the RREQ message */
-static struct rfc5444_writer_tlvtype _rreq_addrtlvs[] =
+static const struct rfc5444_writer_tlvtype _rreq_addrtlvs[AODVV2_RFC5444_ADDR_TLVS_NUMOF] =
 {
     [RFC5444_MSGTLV_ORIGSEQNUM] = { .type = RFC5444_MSGTLV_ORIGSEQNUM },
     [RFC5444_MSGTLV_METRIC] = {
@@ -57,14 +90,17 @@ static struct rfc5444_writer_tlvtype _rreq_addrtlvs[] =
  * message content provider that will add message TLVs,
  * addresses and address block TLVs to all messages of type RREQ.
  */
-static struct rfc5444_writer_content_provider _rrep_message_content_provider =
+static const struct rfc5444_writer_content_provider _rrep_message_content_provider =
 {
     .msg_type = RFC5444_MSGTYPE_RREP,
+#if IS_USED(MODULE_AODVV2_LAR)
+    .addMessageTLVs = _cb_rrep_add_message_tlvs,
+#endif
     .addAddresses = _cb_rrep_add_addresses,
 };
 
 /* declaration of all address TLVs added to the RREP message */
-static struct rfc5444_writer_tlvtype _rrep_addrtlvs[] =
+static const struct rfc5444_writer_tlvtype _rrep_addrtlvs[AODVV2_RFC5444_ADDR_TLVS_NUMOF] =
 {
     [RFC5444_MSGTLV_ORIGSEQNUM] = { .type = RFC5444_MSGTLV_ORIGSEQNUM},
     [RFC5444_MSGTLV_TARGSEQNUM] = { .type = RFC5444_MSGTLV_TARGSEQNUM},
@@ -74,155 +110,475 @@ static struct rfc5444_writer_tlvtype _rrep_addrtlvs[] =
     },
 };
 
-static struct rfc5444_writer_message *_rreq_msg;
-static struct rfc5444_writer_message *_rrep_msg;
+/*
+ * message content provider that will add the unreachable address to all
+ * messages of type RERR.
+ */
+static const struct rfc5444_writer_content_provider _rerr_message_content_provider =
+{
+    .msg_type = RFC5444_MSGTYPE_RERR,
+    .addAddresses = _cb_rerr_add_addresses,
+};
 
-static aodvv2_message_t _msg;
+static inline aodvv2_writer_t *_writer(struct rfc5444_writer *wr)
+{
+    return container_of(wr, aodvv2_writer_t, writer);
+}
+
+static inline aodvv2_core_t *_core(aodvv2_writer_t *writer)
+{
+    return container_of(writer, aodvv2_core_t, writer);
+}
 
 static int _cb_add_message_header(struct rfc5444_writer *wr, struct rfc5444_writer_message *message)
 {
-    /* no originator, no hopcount, has msg_hop_limit, no seqno */
-    rfc5444_writer_set_msg_header(wr, message, false, false, true, false);
-    rfc5444_writer_set_msg_hoplimit(wr, message, _msg.msg_hop_limit);
+    aodvv2_writer_t *writer = _writer(wr);
+    const aodvv2_message_t *msg = writer->msg;
+
+    /* Client announcements name the router that issued the SeqNum as
+     * originator */
+    bool has_seqnortr = message->type == RFC5444_MSGTYPE_RREP &&
+                        aodvv2_addr_is_unspecified(&msg->orig_node.addr) &&
+                        !aodvv2_addr_is_unspecified(&msg->seqnortr);
+
+    /* has originator for announcements, no hopcount, has msg_hop_limit,
+     * no seqno */
+    rfc5444_writer_set_msg_header(wr, message, has_seqnortr, false, true, false);
+    if (has_seqnortr) {
+        rfc5444_writer_set_msg_originator(wr, message, &msg->seqnortr);
+    }
+    rfc5444_writer_set_msg_hoplimit(wr, message, msg->msg_hop_limit);
 
     return 0;
 }
 
+#if IS_USED(MODULE_AODVV2_LAR)
+static void _add_position(struct rfc5444_writer *wr, uint8_t type,
+                          const aodvv2_position_t *pos)
+{
+    uint8_t buf[AODVV2_LAR_POSITION_LEN];
+
+    aodvv2_lar_position_write(buf, pos);
+    if (rfc5444_writer_add_messagetlv(wr, type, 0, buf, sizeof(buf)) !=
+        RFC5444_OKAY) {
+        DEBUG_PUTS("aodvv2: couldn't add position TLV");
+    }
+}
+
+static void _cb_rreq_add_message_tlvs(struct rfc5444_writer *wr)
+{
+    const aodvv2_message_t *msg = _writer(wr)->msg;
+
+    /* The zone needs both ends, one alone is still useful to learn */
+    if (msg->has_orig_pos) {
+        _add_position(wr, RFC5444_MSGTLV_ORIGPOS, &msg->orig_pos);
+    }
+    if (msg->has_targ_pos) {
+        _add_position(wr, RFC5444_MSGTLV_TARGPOS, &msg->targ_pos);
+    }
+}
+
+static void _cb_rrep_add_message_tlvs(struct rfc5444_writer *wr)
+{
+    const aodvv2_message_t *msg = _writer(wr)->msg;
+
+    if (msg->has_targ_pos) {
+        _add_position(wr, RFC5444_MSGTLV_TARGPOS, &msg->targ_pos);
+    }
+}
+#endif
+
 static void _cb_rreq_add_addresses(struct rfc5444_writer *wr)
 {
+    aodvv2_writer_t *writer = _writer(wr);
+    const aodvv2_message_t *msg = writer->msg;
     struct rfc5444_writer_address *orig_prefix;
     struct netaddr tmp;
     uint8_t pfx_len;
 
     /* Add OrigPrefix address */
-    pfx_len = _msg.orig_node.pfx_len;
+    pfx_len = msg->orig_node.pfx_len;
     if (pfx_len == 0 || pfx_len > 128) {
         pfx_len = 128;
     }
-    ipv6_addr_to_netaddr(&_msg.orig_node.addr, pfx_len, &tmp);
-    orig_prefix = rfc5444_writer_add_address(wr, _rreq_message_content_provider.creator, &tmp, true);
+    ipv6_addr_to_netaddr(&msg->orig_node.addr, pfx_len, &tmp);
+    orig_prefix = rfc5444_writer_add_address(wr, writer->rreq_provider.creator, &tmp, true);
     assert(orig_prefix != NULL);
 
     /* Add TargPrefix address */
-    pfx_len = _msg.targ_node.pfx_len;
+    pfx_len = msg->targ_node.pfx_len;
     if (pfx_len == 0 || pfx_len > 128) {
         pfx_len = 128;
     }
-    ipv6_addr_to_netaddr(&_msg.targ_node.addr, pfx_len, &tmp);
-    rfc5444_writer_add_address(wr, _rreq_message_content_provider.creator, &tmp, true);
+    ipv6_addr_to_netaddr(&msg->targ_node.addr, pfx_len, &tmp);
+    rfc5444_writer_add_address(wr, writer->rreq_provider.creator, &tmp, true);
 
     /* Add SeqNum TLV and metric TLV to OrigPrefix */
-    rfc5444_writer_add_addrtlv(wr, orig_prefix, &_rreq_addrtlvs[RFC5444_MSGTLV_ORIGSEQNUM],
-                               &_msg.orig_node.seqnum, sizeof(_msg.orig_node.seqnum),
+    rfc5444_writer_add_addrtlv(wr, orig_prefix, &writer->rreq_addrtlvs[RFC5444_MSGTLV_ORIGSEQNUM],
+                               &msg->orig_node.seqnum, sizeof(msg->orig_node.seqnum),
                                false);
 
-    rfc5444_writer_add_addrtlv(wr, orig_prefix, &_rreq_addrtlvs[RFC5444_MSGTLV_METRIC],
-                               &_msg.orig_node.metric, sizeof(_msg.orig_node.metric),
+    rfc5444_writer_add_addrtlv(wr, orig_prefix, &writer->rreq_addrtlvs[RFC5444_MSGTLV_METRIC],
+                               &msg->orig_node.metric, sizeof(msg->orig_node.metric),
                                false);
 }
 
 static void _cb_rrep_add_addresses(struct rfc5444_writer *wr)
 {
+    aodvv2_writer_t *writer = _writer(wr);
+    aodvv2_core_t *core = _core(writer);
+    const aodvv2_message_t *msg = writer->msg;
     struct rfc5444_writer_address *orig_prefix;
     struct rfc5444_writer_address *targ_prefix;
     struct netaddr tmp;
     uint8_t pfx_len;
 
-    uint16_t orig_node_seqnum = _msg.orig_node.seqnum;
-    uint16_t targ_node_seqnum = aodvv2_seqnum_get();
-    aodvv2_seqnum_inc();
-    uint8_t targ_node_hopct = _msg.targ_node.metric;
+    uint16_t orig_node_seqnum = msg->orig_node.seqnum;
+    uint16_t targ_node_seqnum = msg->targ_node.seqnum;
+    uint8_t targ_node_hopct = msg->targ_node.metric;
 
-    /* Add OrigPrefix address */
-    pfx_len = _msg.orig_node.pfx_len;
-    if (pfx_len == 0 || pfx_len > 128) {
-        pfx_len = 128;
+    /* The TargNode router issues the SeqNum, relays pass it on unchanged */
+    if (targ_node_seqnum == 0) {
+        targ_node_seqnum = aodvv2_seqnum_get(&core->seqnum);
+        aodvv2_seqnum_inc(&core->seqnum);
+    }
+
+    /* Add OrigPrefix address, client announcements have none */
+    orig_prefix = NULL;
+    if (!aodvv2_addr_is_unspecified(&msg->orig_node.addr)) {
+        pfx_len = msg->orig_node.pfx_len;
+        if (pfx_len == 0 || pfx_len > 128) {
+            pfx_len = 128;
+        }
+        ipv6_addr_to_netaddr(&msg->orig_node.addr, pfx_len, &tmp);
+        orig_prefix = rfc5444_writer_add_address(wr, writer->rrep_provider.creator, &tmp, true);
+        assert(orig_prefix != NULL);
     }
-    ipv6_addr_to_netaddr(&_msg.orig_node.addr, pfx_len, &tmp);
-    orig_prefix = rfc5444_writer_add_address(wr, _rrep_message_content_provider.creator, &tmp, true);
-    assert(orig_prefix != NULL);
 
     /* Add TargPrefix address */
-    pfx_len = _msg.targ_node.pfx_len;
+    pfx_len = msg->targ_node.pfx_len;
     if (pfx_len == 0 || pfx_len > 128) {
         pfx_len = 128;
     }
-    ipv6_addr_to_netaddr(&_msg.targ_node.addr, pfx_len, &tmp);
-    targ_prefix = rfc5444_writer_add_address(wr, _rrep_message_content_provider.creator, &tmp, true);
-    assert(orig_prefix != NULL);
+    ipv6_addr_to_netaddr(&msg->targ_node.addr, pfx_len, &tmp);
+    targ_prefix = rfc5444_writer_add_address(wr, writer->rrep_provider.creator, &tmp, true);
+    assert(targ_prefix != NULL);
 
     /* Add ORIGSEQNUM TLV to OrigPrefix */
-    rfc5444_writer_add_addrtlv(wr, orig_prefix, &_rrep_addrtlvs[RFC5444_MSGTLV_ORIGSEQNUM], &orig_node_seqnum,
-                               sizeof(orig_node_seqnum), false);
+    if (orig_prefix != NULL) {
+        rfc5444_writer_add_addrtlv(wr, orig_prefix, &writer->rrep_addrtlvs[RFC5444_MSGTLV_ORIGSEQNUM], &orig_node_seqnum,
+                                   sizeof(orig_node_seqnum), false);
+    }
 
     /* Add ORIGSEQNUM and METRIC TLV to TargPrefix */
-    rfc5444_writer_add_addrtlv(wr, targ_prefix, &_rrep_addrtlvs[RFC5444_MSGTLV_TARGSEQNUM], &targ_node_seqnum,
+    rfc5444_writer_add_addrtlv(wr, targ_prefix, &writer->rrep_addrtlvs[RFC5444_MSGTLV_TARGSEQNUM], &targ_node_seqnum,
                                sizeof(targ_node_seqnum), false);
 
-    rfc5444_writer_add_addrtlv(wr, targ_prefix, &_rrep_addrtlvs[RFC5444_MSGTLV_METRIC], &targ_node_hopct,
+    rfc5444_writer_add_addrtlv(wr, targ_prefix, &writer->rrep_addrtlvs[RFC5444_MSGTLV_METRIC], &targ_node_hopct,
                                sizeof(targ_node_hopct), false);
 }
 
-void aodvv2_writer_init(struct rfc5444_writer *wr)
+static void _cb_rerr_add_addresses(struct rfc5444_writer *wr)
+{
+    aodvv2_writer_t *writer = _writer(wr);
+    const aodvv2_message_t *msg = writer->msg;
+    struct netaddr tmp;
+    uint8_t pfx_len;
+
+    /* Add the unreachable address, carried as TargNode */
+    pfx_len = msg->targ_node.pfx_len;
+    if (pfx_len == 0 || pfx_len > 128) {
+        pfx_len = 128;
+    }
+    ipv6_addr_to_netaddr(&msg->targ_node.addr, pfx_len, &tmp);
+    rfc5444_writer_add_address(wr, writer->rerr_provider.creator, &tmp, true);
+}
+
+static void _cb_send_packet(struct rfc5444_writer *wr,
+                            struct rfc5444_writer_target *iface, void *buffer,
+                            size_t length)
+{
+    assert(wr != NULL && iface != NULL && buffer != NULL && length != 0);
+
+#if ENABLE_DEBUG == 1 && IS_USED(MODULE_OONF_RFC5444_PRINT)
+    struct autobuf hexbuf = { 0 };
+
+    /* Generate hexdump of packet */
+    abuf_hexdump(&hexbuf, "\t", buffer, length);
+    rfc5444_print_direct(&hexbuf, buffer, length);
+
+    /* Print hexdump to console */
+    DEBUG("%s", abuf_getptr(&hexbuf));
+
+    abuf_free(&hexbuf);
+#endif
+
+    aodvv2_writer_t *writer = _writer(wr);
+    aodvv2_core_t *core = _core(writer);
+    aodvv2_writer_target_t *target = container_of(iface, aodvv2_writer_target_t,
+                                                  target);
+
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    /* Generic writer output for a template, not sent */
+    if (writer->capture != NULL) {
+        memcpy(writer->capture, buffer, length);
+        writer->capture_len = length;
+        return;
+    }
+#endif
+
+    if (core->ops->send(core->ctx, &target->target_addr, buffer, length) < 0) {
+        DEBUG_PUTS("aodvv2: couldn't send packet");
+    }
+}
+
+void aodvv2_writer_init(aodvv2_writer_t *wr)
 {
     assert(wr != NULL);
+    struct rfc5444_writer_message *rreq_msg;
+    struct rfc5444_writer_message *rrep_msg;
+    struct rfc5444_writer_message *rerr_msg;
     int res;
 
-    res = rfc5444_writer_register_msgcontentprovider(wr, &_rreq_message_content_provider, _rreq_addrtlvs,
-                                                     ARRAY_SIZE(_rreq_addrtlvs));
+    memset(wr, 0, sizeof(*wr));
+
+    wr->rreq_provider = _rreq_message_content_provider;
+    wr->rrep_provider = _rrep_message_content_provider;
+    wr->rerr_provider = _rerr_message_content_provider;
+    memcpy(wr->rreq_addrtlvs, _rreq_addrtlvs, sizeof(wr->rreq_addrtlvs));
+    memcpy(wr->rrep_addrtlvs, _rrep_addrtlvs, sizeof(wr->rrep_addrtlvs));
+
+    wr->writer.msg_buffer = wr->msg_buffer;
+    wr->writer.msg_size = sizeof(wr->msg_buffer);
+    wr->writer.addrtlv_buffer = wr->addrtlv_buffer;
+    wr->writer.addrtlv_size = sizeof(wr->addrtlv_buffer);
+
+    /* Define target for generating rfc5444 packets */
+    wr->target.target.packet_buffer = wr->pkt_buffer;
+    wr->target.target.packet_size = sizeof(wr->pkt_buffer);
+    wr->target.target.sendPacket = _cb_send_packet;
+
+    rfc5444_writer_init(&wr->writer);
+
+    /* Register a target (for sending messages to) in writer */
+    rfc5444_writer_register_target(&wr->writer, &wr->target.target);
+
+    res = rfc5444_writer_register_msgcontentprovider(&wr->writer, &wr->rreq_provider,
+                                                     wr->rreq_addrtlvs,
+                                                     ARRAY_SIZE(wr->rreq_addrtlvs));
     if (res < 0) {
         DEBUG("rfc5444_writer: couldn't register RREQ message provider\n");
         return;
     }
 
-    res = rfc5444_writer_register_msgcontentprovider(wr, &_rrep_message_content_provider, _rrep_addrtlvs,
-                                                     ARRAY_SIZE(_rrep_addrtlvs));
+    res = rfc5444_writer_register_msgcontentprovider(&wr->writer, &wr->rrep_provider,
+                                                     wr->rrep_addrtlvs,
+                                                     ARRAY_SIZE(wr->rrep_addrtlvs));
     if (res < 0) {
-        DEBUG("rfc5444_writer: couldn't register RREQ message provider\n");
+        DEBUG("rfc5444_writer: couldn't register RREP message provider\n");
         return;
     }
 
-    _rreq_msg = rfc5444_writer_register_message(wr, RFC5444_MSGTYPE_RREQ, false);
-    if (_rreq_msg == NULL) {
+    res = rfc5444_writer_register_msgcontentprovider(&wr->writer, &wr->rerr_provider,
+                                                     NULL, 0);
+    if (res < 0) {
+        DEBUG("rfc5444_writer: couldn't register RERR message provider\n");
+        return;
+    }
+
+    rreq_msg = rfc5444_writer_register_message(&wr->writer, RFC5444_MSGTYPE_RREQ, false);
+    if (rreq_msg == NULL) {
         DEBUG("rfc5444_writer: couldn't register RREQ message\n");
         return;
     }
 
-    _rrep_msg = rfc5444_writer_register_message(wr, RFC5444_MSGTYPE_RREP, false);
-    if (_rrep_msg == NULL) {
+    rrep_msg = rfc5444_writer_register_message(&wr->writer, RFC5444_MSGTYPE_RREP, false);
+    if (rrep_msg == NULL) {
         DEBUG("rfc5444_writer: couldn't register RREP message\n");
         return;
     }
 
-    _rreq_msg->addMessageHeader = _cb_add_message_header;
-    _rrep_msg->addMessageHeader = _cb_add_message_header;
+    rerr_msg = rfc5444_writer_register_message(&wr->writer, RFC5444_MSGTYPE_RERR, false);
+    if (rerr_msg == NULL) {
+        DEBUG("rfc5444_writer: couldn't register RERR message\n");
+        return;
+    }
+
+    rreq_msg->addMessageHeader = _cb_add_message_header;
+    rrep_msg->addMessageHeader = _cb_add_message_header;
+    rerr_msg->addMessageHeader = _cb_add_message_header;
+}
+
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+/* Run the generic writer, store the packet in buf instead of sending it */
+static int _write_generic(aodvv2_writer_t *wr, uint8_t msg_type,
+                          const aodvv2_message_t *msg, uint8_t *buf)
+{
+    wr->msg = msg;
+    wr->capture = buf;
+    wr->capture_len = 0;
+
+    int res = rfc5444_writer_create_message_alltarget(&wr->writer, msg_type,
+                                                      RFC5444_MAX_ADDRLEN);
+    if (res == RFC5444_OKAY) {
+        rfc5444_writer_flush(&wr->writer, &wr->target.target, false);
+    }
+
+    wr->msg = NULL;
+    wr->capture = NULL;
+
+    if (res != RFC5444_OKAY || wr->capture_len == 0) {
+        return -EIO;
+    }
+
+    return wr->capture_len;
+}
+
+/* Does tpl write the packet the generic writer wrote for msg? */
+static void _check(aodvv2_template_set_t *set, aodvv2_template_t *tpl,
+                   const aodvv2_message_t *msg, const uint8_t *ref,
+                   size_t len)
+{
+    uint8_t out[AODVV2_RFC5444_PACKET_SIZE];
+
+    if (aodvv2_template_fill(tpl, msg, out) == len &&
+        memcmp(out, ref, len) == 0) {
+        if (tpl->checked) {
+            set->stats.hits++;
+        }
+        else {
+            tpl->checked = true;
+            set->stats.learned++;
+        }
+        return;
+    }
+
+    if (tpl->checked) {
+        DEBUG_PUTS("aodvv2: template differs from the generic writer");
+        set->stats.mismatches++;
+    }
+    else {
+        set->stats.rejected++;
+    }
+    aodvv2_template_drop(tpl);
 }
 
-int aodvv2_writer_send_rreq(struct rfc5444_writer *wr, aodvv2_message_t *message)
+static int _send_templated(aodvv2_writer_t *wr, uint8_t msg_type,
+                           const aodvv2_message_t *msg)
 {
-    memcpy(&_msg, message, sizeof(aodvv2_message_t));
+    aodvv2_template_set_t *set = &wr->templates;
+    aodvv2_core_t *core = _core(wr);
+    aodvv2_template_key_t key;
+    int len;
+
+    aodvv2_template_key(&key, msg_type, msg);
+
+    aodvv2_template_t *tpl = aodvv2_template_find(set, &key);
+    if (tpl != NULL && tpl->checked && !CONFIG_AODVV2_TEMPLATE_CHECK) {
+        len = aodvv2_template_fill(tpl, msg, wr->tpl_buffer);
+        set->stats.hits++;
+    }
+    else {
+        /* The generic writer output is sent, templates are learned from it
+         * and checked against it */
+        len = _write_generic(wr, msg_type, msg, wr->tpl_buffer);
+        if (len < 0) {
+            DEBUG_PUTS("aodvv2: message not created");
+            return len;
+        }
+
+        if (tpl != NULL) {
+            _check(set, tpl, msg, wr->tpl_buffer, len);
+        }
+        else if (aodvv2_template_learn(set, &key, msg, wr->tpl_buffer,
+                                       len) == NULL) {
+            set->stats.rejected++;
+        }
+    }
 
-    if (rfc5444_writer_create_message_alltarget(wr, RFC5444_MSGTYPE_RREQ,
+    int res = core->ops->send(core->ctx, &wr->target.target_addr,
+                              wr->tpl_buffer, len);
+    if (res < 0) {
+        DEBUG_PUTS("aodvv2: couldn't send packet");
+        return res;
+    }
+
+    return 0;
+}
+#endif
+
+int aodvv2_writer_send_rreq(aodvv2_writer_t *wr, aodvv2_message_t *message)
+{
+    assert(wr != NULL && message != NULL);
+
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    return _send_templated(wr, RFC5444_MSGTYPE_RREQ, message);
+#else
+    /* The callbacks read the caller's message, no copy is kept */
+    wr->msg = message;
+
+    if (rfc5444_writer_create_message_alltarget(&wr->writer, RFC5444_MSGTYPE_RREQ,
                                                 RFC5444_MAX_ADDRLEN) != RFC5444_OKAY) {
         DEBUG_PUTS("aodvv2: RREQ message not created");
+        wr->msg = NULL;
         return -EIO;
     }
+    wr->msg = NULL;
 
+    rfc5444_writer_flush(&wr->writer, &wr->target.target, false);
     return 0;
+#endif
 }
 
-int aodvv2_writer_send_rrep(struct rfc5444_writer *wr, aodvv2_message_t *message)
+int aodvv2_writer_send_rrep(aodvv2_writer_t *wr, aodvv2_message_t *message)
 {
-    memcpy(&_msg, message, sizeof(aodvv2_message_t));
+    assert(wr != NULL && message != NULL);
+
+#if IS_USED(MODULE_AODVV2_TEMPLATE)
+    /* Issue the TargNode SeqNum here, the template only copies it */
+    aodvv2_message_t msg = *message;
+    if (msg.targ_node.seqnum == 0) {
+        aodvv2_core_t *core = _core(wr);
+        msg.targ_node.seqnum = aodvv2_seqnum_get(&core->seqnum);
+        aodvv2_seqnum_inc(&core->seqnum);
+    }
+
+    return _send_templated(wr, RFC5444_MSGTYPE_RREP, &msg);
+#else
+    /* The callbacks read the caller's message, no copy is kept */
+    wr->msg = message;
 
     /* TODO(jeandudey): should we use alltarget for RREP? AFAIK we should have
      * multiple targets to specific destinations (with the specified network
      * interface), not to _all targets_ (all nodes we know of) */
-    if (rfc5444_writer_create_message_alltarget(wr, RFC5444_MSGTYPE_RREP,
+    if (rfc5444_writer_create_message_alltarget(&wr->writer, RFC5444_MSGTYPE_RREP,
                                                 RFC5444_MAX_ADDRLEN) != RFC5444_OKAY) {
         DEBUG_PUTS("aodvv2: RREP message not created");
+        wr->msg = NULL;
+        return -EIO;
+    }
+    wr->msg = NULL;
+
+    rfc5444_writer_flush(&wr->writer, &wr->target.target, false);
+    return 0;
+#endif
+}
+
+int aodvv2_writer_send_rerr(aodvv2_writer_t *wr, aodvv2_message_t *message)
+{
+    assert(wr != NULL && message != NULL);
+
+    /* The callbacks read the caller's message, no copy is kept */
+    wr->msg = message;
+
+    if (rfc5444_writer_create_message_alltarget(&wr->writer, RFC5444_MSGTYPE_RERR,
+                                                RFC5444_MAX_ADDRLEN) != RFC5444_OKAY) {
+        DEBUG_PUTS("aodvv2: RERR message not created");
+        wr->msg = NULL;
         return -EIO;
     }
+    wr->msg = NULL;
 
+    rfc5444_writer_flush(&wr->writer, &wr->target.target, false);
     return 0;
 }
@@ -30,35 +30,58 @@ extern "C" {
 #endif
 
 /**
- * @brief   Register AODVv2 message writer
+ * @brief   Initialize the RFC5444 writer and register AODVv2 messages
  *
- * @param[in] wr      The RFC 5444 writer.
+ * @pre @p wr != NULL and @p wr is part of an @ref aodvv2_core_t
+ *
+ * @param[in] wr      The AODVv2 writer context.
  */
-void aodvv2_writer_init(struct rfc5444_writer *wr);
+void aodvv2_writer_init(aodvv2_writer_t *wr);
 
 /**
- * @brief   Write a RREQ
+ * @brief   Write a RREQ and flush it to the current target address
+ *
+ * The packet is handed to @ref aodvv2_ops_t::send of the core @p wr belongs
+ * to, with @ref aodvv2_writer_target_t::target_addr as destination.
  *
  * @pre (@p wr != NULL) && (@p message != NULL)
  *
- * @param[in] wr      The RFC 5444 writer.
+ * @param[in] wr      The AODVv2 writer context.
  * @param[in] message The RREQ message data.
  *
  * @return 0 on success, otherwise 0< on failure.
  */
-int aodvv2_writer_send_rreq(struct rfc5444_writer *wr, aodvv2_message_t *message);
+int aodvv2_writer_send_rreq(aodvv2_writer_t *wr, aodvv2_message_t *message);
 
 /**
- * @brief   Write a RREP
+ * @brief   Write a RREP and flush it to the current target address
+ *
+ * The packet is handed to @ref aodvv2_ops_t::send of the core @p wr belongs
+ * to, with @ref aodvv2_writer_target_t::target_addr as destination.
  *
  * @pre (@p wr != NULL) && (@p message != NULL)
  *
- * @param[in] wr      The RFC 5444 writer.
+ * @param[in] wr      The AODVv2 writer context.
  * @param[in] message The RREP message data.
  *
  * @return 0 on success, otherwise 0< on failure.
  */
-int aodvv2_writer_send_rrep(struct rfc5444_writer *wr, aodvv2_message_t *message);
+int aodvv2_writer_send_rrep(aodvv2_writer_t *wr, aodvv2_message_t *message);
+
+/**
+ * @brief   Write a RERR and flush it to the current target address
+ *
+ * The unreachable address is @ref aodvv2_message_t::targ_node, one per
+ * message.
+ *
+ * @pre (@p wr != NULL) && (@p message != NULL)
+ *
+ * @param[in] wr      The AODVv2 writer context.
+ * @param[in] message The RERR message data.
+ *
+ * @return 0 on success, otherwise 0< on failure.
+ */
+int aodvv2_writer_send_rerr(aodvv2_writer_t *wr, aodvv2_message_t *message);
 
 #ifdef __cplusplus
 } /* extern "C" */
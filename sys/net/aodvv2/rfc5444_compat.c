@@ -25,6 +25,8 @@
 
 #include <assert.h>
 
+#include "net/aodvv2/addr.h"
+
 void ipv6_addr_to_netaddr(const ipv6_addr_t *src, uint8_t pfx_len,
                           struct netaddr *dst)
 {
@@ -65,5 +67,5 @@ void netaddr_to_ipv6_addr(struct netaddr *src, ipv6_addr_t *dst,
     ipv6_addr_t pfx;
     memcpy(&pfx, src->_addr, sizeof(ipv6_addr_t));
 
-    ipv6_addr_init_prefix(dst, &pfx, *pfx_len);
+    aodvv2_addr_init_prefix(dst, &pfx, *pfx_len);
 }
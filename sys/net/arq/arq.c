@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_arq
+ * @{
+ *
+ * @file
+ * @brief       Adaptive MAC retransmissions
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "net/arq.h"
+
+#define ARQ_ONE (65536UL)
+
+void arq_link_init(arq_link_t *link)
+{
+    assert(link != NULL);
+
+    link->pdr = 0;
+    link->samples = 0;
+    link->retries = CONFIG_ARQ_RETRIES_DEFAULT;
+}
+
+static void _sample(arq_link_t *link, bool success)
+{
+    int32_t pdr = link->pdr;
+    int32_t sample = success ? (int32_t)(ARQ_ONE - 1) : 0;
+
+    if (link->samples == 0) {
+        pdr = sample;
+    }
+    else {
+        pdr += (sample - pdr) / (1 << CONFIG_ARQ_EWMA_SHIFT);
+    }
+
+    link->pdr = pdr;
+    if (link->samples < UINT8_MAX) {
+        link->samples++;
+    }
+}
+
+void arq_link_update(arq_link_t *link, unsigned attempts, bool acked)
+{
+    assert(link != NULL);
+
+    /* Every attempt but the last one failed */
+    for (unsigned i = 1; i < attempts; i++) {
+        _sample(link, false);
+    }
+    if (attempts > 0) {
+        _sample(link, acked);
+    }
+}
+
+uint8_t arq_link_select(arq_link_t *link)
+{
+    assert(link != NULL);
+
+    if (link->samples < ARQ_MIN_SAMPLES) {
+        link->retries = CONFIG_ARQ_RETRIES_DEFAULT;
+        return link->retries;
+    }
+
+    if (link->pdr < (CONFIG_ARQ_MIN_PDR * ARQ_ONE) / 100) {
+        link->retries = CONFIG_ARQ_RETRIES_BAD;
+        return link->retries;
+    }
+
+    /* Probability that every attempt so far failed, stop once it's below
+     * what the target allows */
+    const uint32_t allowed = ((100 - CONFIG_ARQ_TARGET_PDR) * ARQ_ONE) / 100;
+    const uint32_t fail = ARQ_ONE - link->pdr;
+    uint32_t all_failed = fail;
+    uint8_t retries = 0;
+
+    while (all_failed > allowed && retries < CONFIG_ARQ_RETRIES_MAX) {
+        all_failed = (all_failed * fail) >> 16;
+        retries++;
+    }
+
+    link->retries = retries;
+    return retries;
+}
@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_deluge
+ * @{
+ *
+ * @file
+ * @brief       Firmware image dissemination, GNRC and MTD binding
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "net/deluge.h"
+#include "net/manet.h"
+
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/udp.h"
+
+#include "byteorder.h"
+#include "hashes/sha256.h"
+#include "mutex.h"
+#include "random.h"
+#include "xtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   Timer set by the core expired
+ */
+#define DELUGE_MSG_TYPE_TIMER (0x9200)
+
+/**
+ * @brief   Header sector magic, "DLG1"
+ */
+#define HDR_MAGIC (0x444c4731)
+
+/**
+ * @brief   Value of a progress byte or the ready flag once set
+ *
+ * Erased flash reads 0xff, these are only ever cleared so they can be
+ * written in place without erasing the header sector.
+ */
+#define HDR_SET (0x00)
+
+/**
+ * @brief   Header sector layout, followed by one progress byte per page
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;                     /**< @ref HDR_MAGIC */
+    uint16_t version;                   /**< Image version */
+    uint32_t size;                      /**< Image size in bytes */
+    uint8_t digest[DELUGE_DIGEST_LEN];  /**< SHA-256 of the image */
+    uint8_t ready;                      /**< @ref HDR_SET once verified */
+} _hdr_t;
+
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static char _stack[CONFIG_DELUGE_STACK_SIZE];
+static gnrc_netif_t *_netif;
+static gnrc_netreg_entry_t _netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
+                                                                KERNEL_PID_UNDEF);
+static mtd_dev_t *_mtd;
+static uint32_t _sector_size;
+
+/**
+ * @brief   Core and timer, protected by `_lock`
+ */
+static deluge_core_t _core;
+static mutex_t _lock = MUTEX_INIT;
+static xtimer_t _timer;
+static msg_t _timer_msg;
+static uint32_t _timer_gen;
+
+/* RFC 1982 serial number arithmetic, versions wrap around */
+static inline bool _newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+static inline uint32_t _image_capacity(void)
+{
+    return (_mtd->sector_count - 1) * _sector_size;
+}
+
+static inline uint32_t _progress_capacity(void)
+{
+    return _sector_size - sizeof(_hdr_t);
+}
+
+static bool _fits(uint32_t size)
+{
+    deluge_meta_t meta = { .size = size };
+
+    return size <= _image_capacity() &&
+           deluge_meta_pages(&meta) <= _progress_capacity();
+}
+
+static uint32_t _sectors(uint32_t size)
+{
+    return (size + _sector_size - 1) / _sector_size;
+}
+
+/* Erase the header sector and write the header for meta, pages is the number
+ * of progress bytes to clear right away */
+static int _hdr_write(const deluge_meta_t *meta, uint16_t pages, bool ready)
+{
+    _hdr_t hdr = {
+        .magic = HDR_MAGIC,
+        .version = meta->version,
+        .size = meta->size,
+        .ready = ready ? HDR_SET : 0xff,
+    };
+    memcpy(hdr.digest, meta->digest, sizeof(hdr.digest));
+
+    int res = mtd_erase(_mtd, 0, _sector_size);
+    if (res < 0) {
+        return res;
+    }
+
+    uint8_t zeros[32];
+    memset(zeros, HDR_SET, sizeof(zeros));
+    for (uint16_t i = 0; i < pages; i += sizeof(zeros)) {
+        size_t len = pages - i < sizeof(zeros) ? pages - i : sizeof(zeros);
+        res = mtd_write(_mtd, zeros, sizeof(hdr) + i, len);
+        if (res < 0) {
+            return res;
+        }
+    }
+
+    /* The magic goes last, a header cut short by a reset isn't valid */
+    res = mtd_write(_mtd, &hdr, 0, sizeof(hdr));
+    return res < 0 ? res : 0;
+}
+
+static int _sha256(uint32_t size, uint8_t *digest)
+{
+    sha256_context_t ctx;
+    uint8_t buf[CONFIG_DELUGE_CHUNK_SIZE];
+
+    sha256_init(&ctx);
+    for (uint32_t offset = 0; offset < size; offset += sizeof(buf)) {
+        size_t len = size - offset < sizeof(buf) ? size - offset : sizeof(buf);
+        int res = mtd_read(_mtd, buf, _sector_size + offset, len);
+        if (res < 0) {
+            return res;
+        }
+        sha256_update(&ctx, buf, len);
+    }
+    sha256_final(&ctx, digest);
+
+    return 0;
+}
+
+static uint32_t _op_random(void *ctx)
+{
+    (void)ctx;
+
+    return random_uint32();
+}
+
+static void _op_set_timer(void *ctx, uint32_t ms)
+{
+    (void)ctx;
+
+    /* A message already queued by the previous timer is stale, the
+     * generation tells them apart */
+    xtimer_remove(&_timer);
+    _timer_msg.type = DELUGE_MSG_TYPE_TIMER;
+    _timer_msg.content.value = ++_timer_gen;
+    xtimer_set_msg(&_timer, ms * US_PER_MS, &_timer_msg, _pid);
+}
+
+static int _op_send(void *ctx, const void *buf, size_t len)
+{
+    (void)ctx;
+    gnrc_pktsnip_t *payload;
+    gnrc_pktsnip_t *udp;
+    gnrc_pktsnip_t *ip;
+
+    payload = gnrc_pktbuf_add(NULL, buf, len, GNRC_NETTYPE_UNDEF);
+    if (payload == NULL) {
+        DEBUG_PUTS("deluge: couldn't allocate payload");
+        return -ENOMEM;
+    }
+
+    uint16_t port = CONFIG_DELUGE_PORT;
+    udp = gnrc_udp_hdr_build(payload, port, port);
+    if (udp == NULL) {
+        DEBUG_PUTS("deluge: unable to allocate UDP header");
+        gnrc_pktbuf_release(payload);
+        return -ENOMEM;
+    }
+
+    ip = gnrc_ipv6_hdr_build(udp, NULL, &ipv6_addr_all_manet_routers_link_local);
+    if (ip == NULL) {
+        DEBUG_PUTS("deluge: unable to allocate IPv6 header");
+        gnrc_pktbuf_release(udp);
+        return -ENOMEM;
+    }
+
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG_PUTS("deluge: unable to allocate netif header");
+        gnrc_pktbuf_release(ip);
+        return -ENOMEM;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    LL_PREPEND(ip, netif_hdr);
+
+    if (gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP, GNRC_NETREG_DEMUX_CTX_ALL,
+                                  ip) < 1) {
+        DEBUG_PUTS("deluge: unable to locate UDP thread");
+        gnrc_pktbuf_release(ip);
+        return -ENOTCONN;
+    }
+
+    return 0;
+}
+
+static int _op_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    (void)ctx;
+
+    int res = mtd_read(_mtd, buf, _sector_size + offset, len);
+    return res < 0 ? res : 0;
+}
+
+static int _op_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    (void)ctx;
+
+    int res = mtd_write(_mtd, buf, _sector_size + offset, len);
+    return res < 0 ? res : 0;
+}
+
+static int _op_prepare(void *ctx, const deluge_meta_t *meta)
+{
+    (void)ctx;
+
+    if (!_fits(meta->size)) {
+        DEBUG("deluge: image of %lu bytes doesn't fit\n",
+              (unsigned long)meta->size);
+        return -ENOSPC;
+    }
+
+    int res = mtd_erase(_mtd, _sector_size,
+                        _sectors(meta->size) * _sector_size);
+    if (res < 0) {
+        return res;
+    }
+
+    return _hdr_write(meta, 0, false);
+}
+
+static void _op_page_done(void *ctx, uint16_t page)
+{
+    (void)ctx;
+    uint8_t set = HDR_SET;
+
+    if (mtd_write(_mtd, &set, sizeof(_hdr_t) + page, sizeof(set)) < 0) {
+        DEBUG_PUTS("deluge: couldn't persist progress");
+    }
+}
+
+static int _op_verify(void *ctx, const deluge_meta_t *meta)
+{
+    (void)ctx;
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+
+    int res = _sha256(meta->size, digest);
+    if (res < 0) {
+        return res;
+    }
+
+    return memcmp(digest, meta->digest, sizeof(digest)) == 0 ? 0 : -EBADMSG;
+}
+
+static void _op_complete(void *ctx, const deluge_meta_t *meta)
+{
+    (void)ctx;
+    uint8_t set = HDR_SET;
+
+    if (mtd_write(_mtd, &set, offsetof(_hdr_t, ready), sizeof(set)) < 0) {
+        DEBUG_PUTS("deluge: couldn't mark image as ready");
+        return;
+    }
+
+    printf("deluge: image version %u (%lu bytes) ready to install\n",
+           meta->version, (unsigned long)meta->size);
+}
+
+static const deluge_ops_t _ops = {
+    .random = _op_random,
+    .set_timer = _op_set_timer,
+    .send = _op_send,
+    .read = _op_read,
+    .write = _op_write,
+    .prepare = _op_prepare,
+    .page_done = _op_page_done,
+    .verify = _op_verify,
+    .complete = _op_complete,
+};
+
+/* Read the stored image, returns the number of complete pages */
+static uint16_t _restore(deluge_meta_t *meta)
+{
+    _hdr_t hdr;
+
+    memset(meta, 0, sizeof(*meta));
+    if (mtd_read(_mtd, &hdr, 0, sizeof(hdr)) < 0 || hdr.magic != HDR_MAGIC ||
+        hdr.version == 0 || !_fits(hdr.size)) {
+        return 0;
+    }
+
+    meta->version = hdr.version;
+    meta->size = hdr.size;
+    memcpy(meta->digest, hdr.digest, sizeof(meta->digest));
+
+    /* Pages complete in order, count up to the first one that isn't */
+    uint16_t total = deluge_meta_pages(meta);
+    uint16_t pages = 0;
+    uint8_t progress[32];
+    while (pages < total) {
+        size_t len = total - pages < sizeof(progress) ? total - pages
+                                                      : sizeof(progress);
+        if (mtd_read(_mtd, progress, sizeof(hdr) + pages, len) < 0) {
+            break;
+        }
+        size_t i = 0;
+        while (i < len && progress[i] == HDR_SET) {
+            i++;
+        }
+        pages += i;
+        if (i < len) {
+            break;
+        }
+    }
+
+    /* Reset between the last page and the verification */
+    if (pages == total && hdr.ready != HDR_SET) {
+        if (_op_verify(NULL, meta) == 0) {
+            _op_complete(NULL, meta);
+        }
+        else if (_op_prepare(NULL, meta) == 0) {
+            pages = 0;
+        }
+        else {
+            memset(meta, 0, sizeof(*meta));
+            pages = 0;
+        }
+    }
+
+    /* Chunks stored ahead of the first incomplete page are received again,
+     * rewriting the same bytes is harmless on NOR flash */
+    return pages;
+}
+
+static uint16_t _node_id(void)
+{
+    network_uint16_t addr;
+
+    /* The short address is unique among neighbors */
+    if (gnrc_netapi_get(_netif->pid, NETOPT_ADDRESS, 0, &addr,
+                        sizeof(addr)) == sizeof(addr)) {
+        return byteorder_ntohs(addr);
+    }
+
+    return random_uint32();
+}
+
+static void _receive(gnrc_pktsnip_t *pkt)
+{
+    assert(pkt != NULL && pkt->data != NULL);
+
+    mutex_lock(&_lock);
+    if (deluge_core_handle(&_core, pkt->data, pkt->size) < 0) {
+        DEBUG_PUTS("deluge: invalid message");
+    }
+    mutex_unlock(&_lock);
+
+    gnrc_pktbuf_release(pkt);
+}
+
+static void *_event_loop(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+    msg_t reply;
+    msg_t msg_queue[CONFIG_DELUGE_MSG_QUEUE_SIZE];
+
+    msg_init_queue(msg_queue, CONFIG_DELUGE_MSG_QUEUE_SIZE);
+
+    reply.content.value = (uint32_t)(-ENOTSUP);
+    reply.type = GNRC_NETAPI_MSG_TYPE_ACK;
+
+    while (1) {
+        msg_receive(&msg);
+
+        switch (msg.type) {
+            case DELUGE_MSG_TYPE_TIMER:
+                mutex_lock(&_lock);
+                if (msg.content.value == _timer_gen) {
+                    deluge_core_timeout(&_core);
+                }
+                mutex_unlock(&_lock);
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_RCV:
+                _receive(msg.content.ptr);
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_GET:
+            case GNRC_NETAPI_MSG_TYPE_SET:
+                msg_reply(&msg, &reply);
+                break;
+
+            default:
+                DEBUG_PUTS("deluge: received unidentified message");
+                break;
+        }
+    }
+
+    /* Never reached */
+    return NULL;
+}
+
+int deluge_init(gnrc_netif_t *netif, mtd_dev_t *mtd)
+{
+    assert(netif != NULL && mtd != NULL);
+
+    if (_pid != KERNEL_PID_UNDEF) {
+        return _pid;
+    }
+
+    _sector_size = mtd->pages_per_sector * mtd->page_size;
+    if (mtd->sector_count < 2 || _sector_size <= sizeof(_hdr_t)) {
+        return -ENOTSUP;
+    }
+
+    _netif = netif;
+    _mtd = mtd;
+
+    /* Hold the core until it's initialized, the thread needs to exist
+     * before as the core arms its timer right away */
+    mutex_lock(&_lock);
+
+    _pid = thread_create(_stack, sizeof(_stack), CONFIG_DELUGE_PRIO,
+                         THREAD_CREATE_STACKTEST, _event_loop, NULL,
+                         "deluge");
+    if (_pid < 0) {
+        mutex_unlock(&_lock);
+        return _pid;
+    }
+
+    deluge_meta_t meta;
+    uint16_t pages = _restore(&meta);
+    if (meta.version != 0) {
+        printf("deluge: resuming version %u, %u of %u pages\n", meta.version,
+               pages, deluge_meta_pages(&meta));
+    }
+    deluge_core_init(&_core, &_ops, NULL, _node_id(), &meta, pages);
+
+    mutex_unlock(&_lock);
+
+    gnrc_netreg_entry_init_pid(&_netreg, CONFIG_DELUGE_PORT, _pid);
+    gnrc_netreg_register(GNRC_NETTYPE_UDP, &_netreg);
+
+    return _pid;
+}
+
+int deluge_publish(uint16_t version, uint32_t size)
+{
+    if (_pid == KERNEL_PID_UNDEF) {
+        return -ENOTCONN;
+    }
+
+    if (size == 0 || !_fits(size)) {
+        return -ENOSPC;
+    }
+
+    mutex_lock(&_lock);
+
+    if (!_newer(version, _core.meta.version)) {
+        mutex_unlock(&_lock);
+        return -EINVAL;
+    }
+
+    deluge_meta_t meta = {
+        .version = version,
+        .size = size,
+    };
+    int res = _sha256(size, meta.digest);
+    if (res == 0) {
+        res = _hdr_write(&meta, deluge_meta_pages(&meta), true);
+    }
+    if (res == 0) {
+        deluge_core_publish(&_core, &meta);
+    }
+
+    mutex_unlock(&_lock);
+
+    return res;
+}
+
+void deluge_print(void)
+{
+    if (_pid == KERNEL_PID_UNDEF) {
+        puts("not initialized");
+        return;
+    }
+
+    mutex_lock(&_lock);
+
+    static const char *states[] = { "maintain", "receive", "send" };
+    const deluge_stats_t *s = &_core.stats;
+
+    printf("node %04x, %s\n", _core.id, states[_core.state]);
+    if (_core.meta.version == 0) {
+        puts("no image");
+    }
+    else {
+        printf("version %u, %lu bytes, %u of %u pages%s\n",
+               _core.meta.version, (unsigned long)_core.meta.size,
+               _core.pages, deluge_meta_pages(&_core.meta),
+               deluge_core_done(&_core) ? ", complete" : "");
+    }
+    printf("image area %lu bytes\n", (unsigned long)_image_capacity());
+    printf("adv tx %lu, req tx %lu, data tx %lu, data rx %lu (%lu not needed), "
+           "verify failures %lu\n",
+           (unsigned long)s->adv_tx, (unsigned long)s->req_tx,
+           (unsigned long)s->data_tx, (unsigned long)s->data_rx,
+           (unsigned long)s->data_dup, (unsigned long)s->verify_fail);
+
+    mutex_unlock(&_lock);
+}
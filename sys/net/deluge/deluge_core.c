@@ -0,0 +1,577 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_deluge
+ * @{
+ *
+ * @file
+ * @brief       Platform independent image dissemination core
+ *
+ * Messages, integers in network byte order:
+ *
+ * - ADV:  type, id (2), version (2), size (4), pages (2), digest (32)
+ * - REQ:  type, target id (2), version (2), page (2), missing chunks (4)
+ * - DATA: type, version (2), page (2), chunk (1), payload
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "net/deluge/core.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+#if CONFIG_DELUGE_PAGE_CHUNKS > 32
+#error "CONFIG_DELUGE_PAGE_CHUNKS must be at most 32"
+#endif
+
+/**
+ * @brief   Message types
+ */
+enum {
+    DELUGE_MSG_ADV = 1,
+    DELUGE_MSG_REQ = 2,
+    DELUGE_MSG_DATA = 3,
+};
+
+#define ADV_LEN         (11 + DELUGE_DIGEST_LEN)
+#define REQ_LEN         (11)
+#define DATA_HDR_LEN    (6)
+
+static inline void _put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static inline void _put32(uint8_t *p, uint32_t v)
+{
+    _put16(p, v >> 16);
+    _put16(p + 2, v);
+}
+
+static inline uint16_t _get16(const uint8_t *p)
+{
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t _get32(const uint8_t *p)
+{
+    return ((uint32_t)_get16(p) << 16) | _get16(p + 2);
+}
+
+/* RFC 1982 serial number arithmetic, versions wrap around */
+static inline bool _newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+static inline uint32_t _rand(deluge_core_t *core, uint32_t max)
+{
+    return max ? core->ops->random(core->ctx) % max : 0;
+}
+
+static inline void _set_timer(deluge_core_t *core, uint32_t ms)
+{
+    core->ops->set_timer(core->ctx, ms);
+}
+
+static uint32_t _page_mask(const deluge_core_t *core, uint16_t page)
+{
+    uint32_t left = core->meta.size - (uint32_t)page * DELUGE_PAGE_SIZE;
+    uint32_t chunks = (left + CONFIG_DELUGE_CHUNK_SIZE - 1) /
+                      CONFIG_DELUGE_CHUNK_SIZE;
+
+    if (chunks > CONFIG_DELUGE_PAGE_CHUNKS) {
+        chunks = CONFIG_DELUGE_PAGE_CHUNKS;
+    }
+    if (chunks >= 32) {
+        return UINT32_MAX;
+    }
+    return (1UL << chunks) - 1;
+}
+
+static inline uint32_t _offset(uint16_t page, uint8_t chunk)
+{
+    return (uint32_t)page * DELUGE_PAGE_SIZE +
+           (uint32_t)chunk * CONFIG_DELUGE_CHUNK_SIZE;
+}
+
+static size_t _chunk_len(const deluge_core_t *core, uint16_t page,
+                         uint8_t chunk)
+{
+    uint32_t left = core->meta.size - _offset(page, chunk);
+    return left < CONFIG_DELUGE_CHUNK_SIZE ? left : CONFIG_DELUGE_CHUNK_SIZE;
+}
+
+static uint32_t _window_mask(const deluge_core_t *core, unsigned i)
+{
+    uint32_t page = (uint32_t)core->pages + i;
+
+    if (core->meta.version == 0 || page >= deluge_meta_pages(&core->meta)) {
+        return 0;
+    }
+    return _page_mask(core, page);
+}
+
+static void _window_init(deluge_core_t *core)
+{
+    for (unsigned i = 0; i < CONFIG_DELUGE_RX_WINDOW; i++) {
+        core->missing[i] = _window_mask(core, i);
+    }
+}
+
+/* Trickle (RFC 6206) for the advertisements, time t is picked in the second
+ * half of the interval */
+static void _send_adv(deluge_core_t *core);
+
+static void _trickle_interval(deluge_core_t *core)
+{
+    core->c = 0;
+    core->t_passed = false;
+    core->t = core->tau / 2 + _rand(core, core->tau / 2);
+    _set_timer(core, core->t);
+}
+
+static void _maintain(deluge_core_t *core, bool reset)
+{
+    core->state = DELUGE_STATE_MAINTAIN;
+    core->rx_src_pages = 0;
+    if (reset) {
+        core->tau = CONFIG_DELUGE_ADV_IMIN;
+    }
+    _trickle_interval(core);
+}
+
+static void _inconsistent(deluge_core_t *core)
+{
+    if (core->state == DELUGE_STATE_MAINTAIN) {
+        if (core->tau > CONFIG_DELUGE_ADV_IMIN) {
+            _maintain(core, true);
+        }
+    }
+    else {
+        /* No Trickle while busy, answer right away so a neighbor that is
+         * behind doesn't wait for us to finish, and advertise quickly once
+         * we're done */
+        if (core->state == DELUGE_STATE_RX) {
+            _send_adv(core);
+        }
+        core->tau = CONFIG_DELUGE_ADV_IMIN;
+    }
+}
+
+static void _send_adv(deluge_core_t *core)
+{
+    uint8_t buf[ADV_LEN];
+
+    buf[0] = DELUGE_MSG_ADV;
+    _put16(&buf[1], core->id);
+    _put16(&buf[3], core->meta.version);
+    _put32(&buf[5], core->meta.size);
+    _put16(&buf[9], core->pages);
+    memcpy(&buf[11], core->meta.digest, DELUGE_DIGEST_LEN);
+
+    if (core->ops->send(core->ctx, buf, sizeof(buf)) == 0) {
+        core->stats.adv_tx++;
+    }
+}
+
+static void _send_req(deluge_core_t *core)
+{
+    uint8_t buf[REQ_LEN];
+
+    buf[0] = DELUGE_MSG_REQ;
+    _put16(&buf[1], core->rx_src);
+    _put16(&buf[3], core->meta.version);
+    _put16(&buf[5], core->pages);
+    _put32(&buf[7], core->missing[0]);
+
+    DEBUG("deluge: %u requesting page %u from %u\n", core->id, core->pages,
+          core->rx_src);
+    if (core->ops->send(core->ctx, buf, sizeof(buf)) == 0) {
+        core->stats.req_tx++;
+    }
+}
+
+static void _send_data(deluge_core_t *core, uint16_t page, uint8_t chunk)
+{
+    uint8_t buf[DELUGE_MSG_MAX_LEN];
+    size_t len = _chunk_len(core, page, chunk);
+
+    buf[0] = DELUGE_MSG_DATA;
+    _put16(&buf[1], core->meta.version);
+    _put16(&buf[3], page);
+    buf[5] = chunk;
+
+    if (core->ops->read(core->ctx, _offset(page, chunk), &buf[DATA_HDR_LEN],
+                        len) < 0) {
+        DEBUG_PUTS("deluge: couldn't read chunk");
+        return;
+    }
+    if (core->ops->send(core->ctx, buf, DATA_HDR_LEN + len) == 0) {
+        core->stats.data_tx++;
+    }
+}
+
+/* Start receiving meta, the current image is kept if the storage can't be
+ * prepared */
+static int _adopt(deluge_core_t *core, const deluge_meta_t *meta)
+{
+    DEBUG("deluge: %u receiving version %u, %lu bytes\n", core->id,
+          meta->version, (unsigned long)meta->size);
+
+    int res = core->ops->prepare(core->ctx, meta);
+    if (res < 0) {
+        DEBUG_PUTS("deluge: couldn't prepare storage");
+        return res;
+    }
+
+    core->meta = *meta;
+    core->pages = 0;
+    _window_init(core);
+
+    return 0;
+}
+
+static void _page_complete(deluge_core_t *core)
+{
+    core->ops->page_done(core->ctx, core->pages);
+    core->pages++;
+
+    for (unsigned i = 1; i < CONFIG_DELUGE_RX_WINDOW; i++) {
+        core->missing[i - 1] = core->missing[i];
+    }
+    core->missing[CONFIG_DELUGE_RX_WINDOW - 1] =
+        _window_mask(core, CONFIG_DELUGE_RX_WINDOW - 1);
+
+    if (deluge_core_done(core)) {
+        if (core->ops->verify(core->ctx, &core->meta) < 0) {
+            /* Start over, the neighbors will send it again */
+            DEBUG_PUTS("deluge: image verification failed");
+            core->stats.verify_fail++;
+            deluge_meta_t meta = core->meta;
+            if (_adopt(core, &meta) < 0) {
+                /* Don't offer the broken image, the next advertisement of
+                 * this version tries again */
+                memset(&core->meta, 0, sizeof(core->meta));
+                core->pages = 0;
+                _window_init(core);
+                _maintain(core, true);
+            }
+            return;
+        }
+        core->ops->complete(core->ctx, &core->meta);
+    }
+}
+
+static inline bool _in_window(const deluge_core_t *core, uint16_t page)
+{
+    return page >= core->pages &&
+           page - core->pages < CONFIG_DELUGE_RX_WINDOW;
+}
+
+/* Store a chunk, returns true if it completed a page */
+static bool _store(deluge_core_t *core, uint16_t version, uint16_t page,
+                   uint8_t chunk, const uint8_t *data, size_t len)
+{
+    unsigned i = page - core->pages;
+
+    if (version != core->meta.version || !_in_window(core, page) ||
+        chunk >= 32 || !(core->missing[i] & (1UL << chunk))) {
+        core->stats.data_dup++;
+        return false;
+    }
+
+    if (len != _chunk_len(core, page, chunk)) {
+        return false;
+    }
+
+    if (core->ops->write(core->ctx, _offset(page, chunk), data, len) < 0) {
+        DEBUG_PUTS("deluge: couldn't write chunk");
+        return false;
+    }
+
+    core->missing[i] &= ~(1UL << chunk);
+    core->stats.data_rx++;
+
+    if (core->missing[0] != 0) {
+        return false;
+    }
+
+    /* The following pages may be complete already, a failed verification
+     * starts over at page 0 which is never complete, or drops the image */
+    do {
+        _page_complete(core);
+    } while (core->meta.version != 0 && !deluge_core_done(core) &&
+             core->missing[0] == 0);
+    _send_adv(core);
+
+    return true;
+}
+
+static void _rx_start(deluge_core_t *core, uint16_t src, uint16_t src_pages)
+{
+    core->state = DELUGE_STATE_RX;
+    core->rx_src = src;
+    core->rx_src_pages = src_pages;
+    core->rx_tries = CONFIG_DELUGE_RX_TRIES;
+    /* Let a neighbor needing the same page ask first */
+    _set_timer(core, 1 + _rand(core, CONFIG_DELUGE_REQ_BACKOFF));
+}
+
+/* Done sending, go back to receiving if somebody has more pages */
+static void _tx_done(deluge_core_t *core)
+{
+    if (!deluge_core_done(core) && core->pages < core->rx_src_pages) {
+        _rx_start(core, core->rx_src, core->rx_src_pages);
+    }
+    else {
+        _maintain(core, false);
+    }
+}
+
+static void _handle_adv(deluge_core_t *core, const uint8_t *buf)
+{
+    uint16_t id = _get16(&buf[1]);
+    uint16_t version = _get16(&buf[3]);
+    uint32_t size = _get32(&buf[5]);
+    uint16_t pages = _get16(&buf[9]);
+
+    if (_newer(version, core->meta.version) && size > 0) {
+        deluge_meta_t meta = { .version = version, .size = size };
+        memcpy(meta.digest, &buf[11], DELUGE_DIGEST_LEN);
+        if (_adopt(core, &meta) < 0) {
+            /* Stay on our version, without receiving anything into the
+             * storage we couldn't prepare */
+            if (core->state == DELUGE_STATE_RX) {
+                _maintain(core, false);
+            }
+        }
+        else if (pages > 0) {
+            _rx_start(core, id, pages);
+        }
+        else {
+            _maintain(core, true);
+        }
+    }
+    else if (version == core->meta.version) {
+        if (pages > core->pages) {
+            if (core->state == DELUGE_STATE_MAINTAIN) {
+                _rx_start(core, id, pages);
+            }
+            else if (core->state == DELUGE_STATE_TX &&
+                     pages > core->rx_src_pages) {
+                /* Ask once the requested chunks are out */
+                core->rx_src = id;
+                core->rx_src_pages = pages;
+            }
+        }
+        else if (pages < core->pages) {
+            _inconsistent(core);
+        }
+        else if (core->state == DELUGE_STATE_MAINTAIN) {
+            core->c++;
+        }
+    }
+    else {
+        _inconsistent(core);
+    }
+}
+
+static void _handle_req(deluge_core_t *core, const uint8_t *buf)
+{
+    uint16_t target = _get16(&buf[1]);
+    uint16_t version = _get16(&buf[3]);
+    uint16_t page = _get16(&buf[5]);
+    uint32_t missing = _get32(&buf[7]);
+
+    if (version != core->meta.version) {
+        if (_newer(core->meta.version, version)) {
+            _inconsistent(core);
+        }
+        return;
+    }
+
+    if (target == core->id && page < core->pages) {
+        missing &= _page_mask(core, page);
+        /* Serving the pages we have comes first, it's what lets a page move
+         * on while we're still receiving the next ones */
+        if (core->state != DELUGE_STATE_TX && missing) {
+            core->state = DELUGE_STATE_TX;
+            core->tx_page = page;
+            core->tx_pending = missing;
+            _set_timer(core, 1);
+        }
+        else if (core->state == DELUGE_STATE_TX && page == core->tx_page) {
+            core->tx_pending |= missing;
+        }
+    }
+    else if (core->state == DELUGE_STATE_RX && _in_window(core, page)) {
+        /* Somebody asked for the page we need, its DATA reaches us too */
+        _set_timer(core, CONFIG_DELUGE_RX_TIMEOUT);
+    }
+}
+
+static void _handle_data(deluge_core_t *core, const uint8_t *buf, size_t len)
+{
+    uint16_t version = _get16(&buf[1]);
+    uint16_t page = _get16(&buf[3]);
+    uint8_t chunk = buf[5];
+
+    /* Somebody else sent it already */
+    if (core->state == DELUGE_STATE_TX && version == core->meta.version &&
+        page == core->tx_page && chunk < 32) {
+        core->tx_pending &= ~(1UL << chunk);
+    }
+
+    bool relevant = version == core->meta.version && _in_window(core, page);
+    bool completed = _store(core, version, page, chunk, &buf[DATA_HDR_LEN],
+                            len - DATA_HDR_LEN);
+
+    if (core->state == DELUGE_STATE_RX) {
+        if (completed) {
+            if (!deluge_core_done(core) && core->pages < core->rx_src_pages) {
+                core->rx_tries = CONFIG_DELUGE_RX_TRIES;
+                _set_timer(core, 1 + _rand(core, CONFIG_DELUGE_REQ_BACKOFF));
+            }
+            else {
+                _maintain(core, true);
+            }
+        }
+        else if (relevant) {
+            core->rx_tries = CONFIG_DELUGE_RX_TRIES;
+            _set_timer(core, CONFIG_DELUGE_RX_TIMEOUT);
+        }
+    }
+    else if (completed) {
+        /* Overheard the rest of a page, tell the neighbors */
+        _inconsistent(core);
+    }
+}
+
+void deluge_core_init(deluge_core_t *core, const deluge_ops_t *ops, void *ctx,
+                      uint16_t id, const deluge_meta_t *meta, uint16_t pages)
+{
+    assert(core != NULL && ops != NULL);
+
+    memset(core, 0, sizeof(*core));
+    core->ops = ops;
+    core->ctx = ctx;
+    core->id = id;
+    if (meta != NULL && meta->version != 0) {
+        core->meta = *meta;
+        core->pages = pages;
+    }
+    _window_init(core);
+    _maintain(core, true);
+}
+
+void deluge_core_publish(deluge_core_t *core, const deluge_meta_t *meta)
+{
+    assert(core != NULL && meta != NULL && meta->version != 0);
+
+    core->meta = *meta;
+    core->pages = deluge_meta_pages(meta);
+    _window_init(core);
+    _maintain(core, true);
+}
+
+int deluge_core_handle(deluge_core_t *core, const uint8_t *buf, size_t len)
+{
+    assert(core != NULL && buf != NULL);
+
+    if (len < 1) {
+        return -EBADMSG;
+    }
+
+    switch (buf[0]) {
+        case DELUGE_MSG_ADV:
+            if (len != ADV_LEN) {
+                return -EBADMSG;
+            }
+            _handle_adv(core, buf);
+            break;
+
+        case DELUGE_MSG_REQ:
+            if (len != REQ_LEN) {
+                return -EBADMSG;
+            }
+            _handle_req(core, buf);
+            break;
+
+        case DELUGE_MSG_DATA:
+            if (len <= DATA_HDR_LEN || len > DELUGE_MSG_MAX_LEN) {
+                return -EBADMSG;
+            }
+            _handle_data(core, buf, len);
+            break;
+
+        default:
+            return -EBADMSG;
+    }
+
+    return 0;
+}
+
+void deluge_core_timeout(deluge_core_t *core)
+{
+    assert(core != NULL);
+
+    switch (core->state) {
+        case DELUGE_STATE_MAINTAIN:
+            if (!core->t_passed) {
+                if (core->c < CONFIG_DELUGE_ADV_K) {
+                    _send_adv(core);
+                }
+                core->t_passed = true;
+                _set_timer(core, core->tau - core->t);
+            }
+            else {
+                core->tau *= 2;
+                if (core->tau > CONFIG_DELUGE_ADV_IMAX) {
+                    core->tau = CONFIG_DELUGE_ADV_IMAX;
+                }
+                _trickle_interval(core);
+            }
+            break;
+
+        case DELUGE_STATE_RX:
+            if (core->rx_tries == 0 || deluge_core_done(core)) {
+                /* Listen for somebody else to ask */
+                _maintain(core, true);
+                break;
+            }
+            core->rx_tries--;
+            _send_req(core);
+            _set_timer(core, CONFIG_DELUGE_RX_TIMEOUT);
+            break;
+
+        case DELUGE_STATE_TX:
+            if (core->tx_pending == 0) {
+                _tx_done(core);
+                break;
+            }
+            uint8_t chunk = __builtin_ctzl(core->tx_pending);
+            core->tx_pending &= ~(1UL << chunk);
+            _send_data(core, core->tx_page, chunk);
+            if (core->tx_pending) {
+                _set_timer(core, CONFIG_DELUGE_TX_SPACING);
+            }
+            else {
+                _tx_done(core);
+            }
+            break;
+    }
+}
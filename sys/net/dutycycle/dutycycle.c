@@ -0,0 +1,758 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_dutycycle
+ * @{
+ *
+ * @file
+ * @brief       Routing aware radio duty cycling
+ *
+ * The schedule runs on the medium priority event thread. Radio state changes
+ * are sent to the interface thread with a private netapi context, so a sleep
+ * request that raced with a frame being sent (which wakes the radio from the
+ * interface thread) is discarded there.
+ *
+ * Wake windows start at `_epoch + k * CONFIG_DUTYCYCLE_PERIOD`. Neighbor
+ * schedules are kept as the local time of one of their window starts, so
+ * the wake windows of a neighbor are `start + k * period`.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "event/thread.h"
+#include "event/timeout.h"
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "byteorder.h"
+#include "net/dutycycle.h"
+#include "net/gnrc/netapi.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/pktbuf.h"
+#include "net/netif_hook.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   netapi context of our own NETOPT_STATE requests
+ */
+#define DUTYCYCLE_NETAPI_CONTEXT (0xdc)
+
+#define DUTYCYCLE_FLAGS_NOT_UNICAST \
+    (GNRC_NETIF_HDR_FLAGS_BROADCAST | GNRC_NETIF_HDR_FLAGS_MULTICAST)
+
+/**
+ * @brief   Largest link layer address of a neighbor
+ */
+#define DUTYCYCLE_L2ADDR_MAX_LEN (8)
+
+/**
+ * @brief   Time (ms) after which a neighbor that wasn't heard is forgotten,
+ *          and a schedule that wasn't announced again is unknown
+ */
+#define DUTYCYCLE_NBR_TIMEOUT (3 * CONFIG_DUTYCYCLE_SYNC_INTERVAL * MS_PER_SEC)
+
+/**
+ * @brief   Further copies of a broadcast, at most
+ */
+#define DUTYCYCLE_REPEAT_MAX \
+    ((DUTYCYCLE_BCAST_COPIES - 1) > CONFIG_DUTYCYCLE_NBR_NUMOF ? \
+     (DUTYCYCLE_BCAST_COPIES - 1) : CONFIG_DUTYCYCLE_NBR_NUMOF)
+
+static_assert(CONFIG_DUTYCYCLE_PERIOD <= UINT16_MAX,
+              "CONFIG_DUTYCYCLE_PERIOD doesn't fit a SYNC frame");
+static_assert(CONFIG_DUTYCYCLE_WAKE > 0 &&
+              CONFIG_DUTYCYCLE_WAKE <= CONFIG_DUTYCYCLE_PERIOD,
+              "CONFIG_DUTYCYCLE_WAKE must be in (0, CONFIG_DUTYCYCLE_PERIOD]");
+
+/**
+ * @brief   A broadcast being repeated
+ */
+typedef struct {
+    gnrc_pktsnip_t *pkt;                /**< Packet, NULL if unused */
+    uint32_t first;                     /**< Time of the first copy (ms) */
+    uint16_t at[DUTYCYCLE_REPEAT_MAX];  /**< Time of the further copies,
+                                             from the first one (ms) */
+    uint8_t copies;                     /**< Further copies */
+    uint8_t sent;                       /**< Further copies sent */
+    uint8_t inflight;                   /**< Copies not through _send() yet */
+} _repeat_t;
+
+/**
+ * @brief   A neighbor and its wake schedule
+ */
+typedef struct {
+    uint8_t l2addr[DUTYCYCLE_L2ADDR_MAX_LEN]; /**< Link layer address */
+    uint8_t l2addr_len;                 /**< Address length, 0 if unused */
+    bool known;                         /**< Schedule announced */
+    uint16_t period;                    /**< Period (ms) */
+    uint16_t wake;                      /**< Wake window (ms) */
+    uint32_t start;                     /**< Start of one of its windows */
+    uint32_t synced;                    /**< Last SYNC frame */
+    uint32_t seen;                      /**< Last frame */
+} _nbr_t;
+
+static void _tick(event_t *event);
+static void _repeat(event_t *event);
+static void _sync(event_t *event);
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook);
+static int _set(netif_hook_t *hook, const gnrc_netapi_opt_t *opt);
+
+static mutex_t _lock = MUTEX_INIT;
+
+static gnrc_netif_t *_netif;
+static netif_hook_t _hook = {
+    .send = _send,
+    .recv = _recv,
+    .set = _set,
+    .prio = NETIF_HOOK_PRIO_DUTYCYCLE,
+};
+
+static event_t _tick_event = { .handler = _tick };
+static event_timeout_t _tick_timeout;
+static event_t _repeat_event = { .handler = _repeat };
+static event_timeout_t _repeat_timeout;
+static event_t _sync_event = { .handler = _sync };
+static event_timeout_t _sync_timeout;
+
+static _repeat_t _repeats[CONFIG_DUTYCYCLE_REPEAT_QUEUE_SIZE];
+static _nbr_t _nbrs[CONFIG_DUTYCYCLE_NBR_NUMOF];
+
+static bool _enabled;
+static bool _asleep;
+static uint32_t _awake_until;
+static uint32_t _epoch;
+/* A neighbor didn't fit in _nbrs, its schedule is unknown */
+static uint32_t _untracked;
+static bool _untracked_valid;
+
+static uint32_t _last;
+static dutycycle_stats_t _stats;
+
+static uint32_t _now_ms(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+/* Time from now until t, 0 if t already passed */
+static uint32_t _until(uint32_t now, uint32_t t)
+{
+    int32_t diff = (int32_t)(t - now);
+    return diff > 0 ? (uint32_t)diff : 0;
+}
+
+/* Must be called with _lock held, before changing _asleep */
+static void _account(uint32_t now)
+{
+    if (!_asleep) {
+        _stats.awake_ms += now - _last;
+    }
+    _stats.total_ms += now - _last;
+    _last = now;
+}
+
+/* Time since the start of the current period of the schedule */
+static uint32_t _into_period(uint32_t now)
+{
+    return (now - _epoch) % CONFIG_DUTYCYCLE_PERIOD;
+}
+
+/* Must be called with _lock held */
+static void _wake_locked(uint32_t now)
+{
+    _account(now);
+    _asleep = false;
+    _stats.wakeups++;
+}
+
+static void _radio_state(netopt_state_t state)
+{
+    gnrc_netapi_set(_netif->pid, NETOPT_STATE, DUTYCYCLE_NETAPI_CONTEXT,
+                    &state, sizeof(state));
+}
+
+static void _tick(event_t *event)
+{
+    (void)event;
+
+    uint32_t now = _now_ms();
+    uint32_t next;
+    int state = -1;
+
+    mutex_lock(&_lock);
+    if (!_enabled) {
+        if (_asleep) {
+            _wake_locked(now);
+            state = NETOPT_STATE_IDLE;
+        }
+        mutex_unlock(&_lock);
+        if (state >= 0) {
+            _radio_state(state);
+        }
+        return;
+    }
+
+    /* Up for the rest of the wake window, or of the hold */
+    uint32_t into = _into_period(now);
+    next = into < CONFIG_DUTYCYCLE_WAKE ? CONFIG_DUTYCYCLE_WAKE - into : 0;
+    uint32_t hold = _until(now, _awake_until);
+    if (hold > next) {
+        next = hold;
+    }
+
+    if (next > 0) {
+        if (_asleep) {
+            DEBUG_PUTS("dutycycle: waking up");
+            _wake_locked(now);
+            state = NETOPT_STATE_IDLE;
+        }
+    }
+    else {
+        /* Back on the schedule, whatever kept us up */
+        if (!_asleep) {
+            DEBUG_PUTS("dutycycle: sleeping");
+            _account(now);
+            _asleep = true;
+            state = NETOPT_STATE_SLEEP;
+        }
+        next = CONFIG_DUTYCYCLE_PERIOD - into;
+    }
+    mutex_unlock(&_lock);
+
+    if (state >= 0) {
+        _radio_state(state);
+    }
+    event_timeout_set(&_tick_timeout, next * US_PER_MS);
+}
+
+static void _repeat(event_t *event)
+{
+    (void)event;
+
+    uint32_t now = _now_ms();
+    uint32_t next = UINT32_MAX;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_repeats); i++) {
+        gnrc_pktsnip_t *pkt = NULL;
+
+        mutex_lock(&_lock);
+        _repeat_t *repeat = &_repeats[i];
+        if (repeat->pkt != NULL && repeat->sent < repeat->copies &&
+            _until(now, repeat->first + repeat->at[repeat->sent]) == 0) {
+            pkt = repeat->pkt;
+            /* The last copy takes the queue's reference, the slot is freed
+             * once every copy went through _send() */
+            if (++repeat->sent < repeat->copies) {
+                gnrc_pktbuf_hold(pkt, 1);
+            }
+            repeat->inflight++;
+            _stats.bcast_copies++;
+        }
+        if (repeat->pkt != NULL && repeat->sent < repeat->copies) {
+            uint32_t left = _until(now, repeat->first + repeat->at[repeat->sent]);
+            next = left < next ? left : next;
+        }
+        mutex_unlock(&_lock);
+
+        if (pkt != NULL && gnrc_netapi_send(_netif->pid, pkt) < 1) {
+            DEBUG_PUTS("dutycycle: couldn't send broadcast copy");
+            mutex_lock(&_lock);
+            if (repeat->pkt == pkt && --repeat->inflight == 0 &&
+                repeat->sent == repeat->copies) {
+                repeat->pkt = NULL;
+            }
+            mutex_unlock(&_lock);
+            gnrc_pktbuf_release(pkt);
+        }
+    }
+
+    if (next != UINT32_MAX) {
+        event_timeout_set(&_repeat_timeout, next * US_PER_MS);
+    }
+}
+
+/* Must be called with _lock held */
+static _repeat_t *_repeat_find(gnrc_pktsnip_t *pkt)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_repeats); i++) {
+        if (_repeats[i].pkt == pkt) {
+            return &_repeats[i];
+        }
+    }
+    return NULL;
+}
+
+/* Must be called with _lock held, l2addr_len 0 finds an unused entry */
+static _nbr_t *_nbr_find(const uint8_t *l2addr, uint8_t l2addr_len)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        if (_nbrs[i].l2addr_len == l2addr_len &&
+            (l2addr_len == 0 ||
+             memcmp(_nbrs[i].l2addr, l2addr, l2addr_len) == 0)) {
+            return &_nbrs[i];
+        }
+    }
+    return NULL;
+}
+
+/* Forgets the neighbors that weren't heard for a while, must be called with
+ * _lock held */
+static void _nbr_expire(uint32_t now)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        _nbr_t *nbr = &_nbrs[i];
+        if (nbr->l2addr_len == 0) {
+            continue;
+        }
+        if (now - nbr->seen >= DUTYCYCLE_NBR_TIMEOUT) {
+            nbr->l2addr_len = 0;
+        }
+        else if (nbr->known && now - nbr->synced >= DUTYCYCLE_NBR_TIMEOUT) {
+            nbr->known = false;
+        }
+    }
+    if (_untracked_valid && now - _untracked >= DUTYCYCLE_NBR_TIMEOUT) {
+        _untracked_valid = false;
+    }
+}
+
+/* Must be called with _lock held */
+static _nbr_t *_nbr_seen(const uint8_t *l2addr, uint8_t l2addr_len,
+                         uint32_t now)
+{
+    if (l2addr_len == 0 || l2addr_len > DUTYCYCLE_L2ADDR_MAX_LEN) {
+        return NULL;
+    }
+
+    _nbr_expire(now);
+
+    _nbr_t *nbr = _nbr_find(l2addr, l2addr_len);
+    if (nbr == NULL) {
+        nbr = _nbr_find(NULL, 0);
+        if (nbr == NULL) {
+            DEBUG_PUTS("dutycycle: neighbor table full");
+            _untracked = now;
+            _untracked_valid = true;
+            return NULL;
+        }
+        memset(nbr, 0, sizeof(*nbr));
+        memcpy(nbr->l2addr, l2addr, l2addr_len);
+        nbr->l2addr_len = l2addr_len;
+    }
+    nbr->seen = now;
+
+    return nbr;
+}
+
+/* Delay from now until a copy lands well inside the next wake window of
+ * nbr, 0 if a copy sent now does. A quarter of the window is kept on both
+ * sides for the schedule error. */
+static uint32_t _nbr_delay(const _nbr_t *nbr, uint32_t now)
+{
+    if (nbr->wake >= nbr->period) {
+        /* Always on */
+        return 0;
+    }
+
+    uint32_t guard = nbr->wake / 4;
+    uint32_t into = (now - nbr->start) % nbr->period;
+
+    if (into >= guard && into + guard < nbr->wake) {
+        return 0;
+    }
+
+    return (nbr->period - into + guard) % nbr->period;
+}
+
+/* Plans the further copies of a broadcast for the known neighbor schedules,
+ * one per group of neighbors whose windows are within a quarter window of
+ * each other. Returns false if a schedule is unknown. Must be called with
+ * _lock held. */
+static bool _repeat_plan(_repeat_t *repeat, uint32_t now)
+{
+    uint32_t delays[CONFIG_DUTYCYCLE_NBR_NUMOF];
+    unsigned numof = 0;
+
+    _nbr_expire(now);
+    if (_untracked_valid) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        const _nbr_t *nbr = &_nbrs[i];
+        if (nbr->l2addr_len == 0) {
+            continue;
+        }
+        if (!nbr->known) {
+            return false;
+        }
+
+        uint32_t delay = _nbr_delay(nbr, now);
+        if (delay == 0) {
+            continue;
+        }
+
+        /* Insertion sort, there are only a few */
+        unsigned j = numof++;
+        while (j > 0 && delays[j - 1] > delay) {
+            delays[j] = delays[j - 1];
+            j--;
+        }
+        delays[j] = delay;
+    }
+
+    repeat->copies = 0;
+    for (unsigned i = 0; i < numof;) {
+        /* Latest window start of the group, every window of the group is
+         * still open then */
+        uint32_t limit = delays[i] + CONFIG_DUTYCYCLE_WAKE / 4;
+        uint32_t at = delays[i];
+        while (i < numof && delays[i] <= limit) {
+            at = delays[i++];
+        }
+        repeat->at[repeat->copies++] = at;
+    }
+
+    return repeat->copies < DUTYCYCLE_BCAST_COPIES;
+}
+
+/* One copy per window over a full period, must be called with _lock held */
+static void _repeat_blind(_repeat_t *repeat)
+{
+    repeat->copies = DUTYCYCLE_BCAST_COPIES - 1;
+    for (unsigned i = 0; i < repeat->copies; i++) {
+        repeat->at[i] = (i + 1) * CONFIG_DUTYCYCLE_WAKE;
+    }
+}
+
+/* Must be called with _lock held, returns the time the copies take */
+static uint32_t _repeat_add(gnrc_pktsnip_t *pkt, uint32_t now, bool sync)
+{
+    _repeat_t plan = { .pkt = pkt, .first = now };
+
+    _stats.bcast++;
+    _stats.bcast_copies++;
+
+    /* SYNC frames are for the neighbors we don't know yet */
+    if (sync || !_repeat_plan(&plan, now)) {
+        _repeat_blind(&plan);
+        _stats.bcast_blind++;
+    }
+
+    if (plan.copies == 0) {
+        return 0;
+    }
+
+    /* Make room with the broadcast that has the fewest copies left, its
+     * neighbors most likely caught one already */
+    _repeat_t *slot = NULL;
+    for (unsigned i = 0; i < ARRAY_SIZE(_repeats); i++) {
+        _repeat_t *repeat = &_repeats[i];
+        if (repeat->pkt == NULL) {
+            slot = repeat;
+            break;
+        }
+        /* A copy on its way to _send() would be taken for a new broadcast */
+        if (repeat->sent < repeat->copies && repeat->inflight == 0 &&
+            (slot == NULL || repeat->copies - repeat->sent <
+                             slot->copies - slot->sent)) {
+            slot = repeat;
+        }
+    }
+
+    if (slot == NULL) {
+        /* Every queued broadcast has a copy on its way */
+        DEBUG_PUTS("dutycycle: repeat queue full");
+        _stats.bcast_dropped++;
+        return 0;
+    }
+
+    if (slot->pkt != NULL) {
+        DEBUG_PUTS("dutycycle: repeat queue full, dropping the oldest copies");
+        _stats.bcast_dropped++;
+        /* The queue's reference */
+        gnrc_pktbuf_release(slot->pkt);
+    }
+
+    gnrc_pktbuf_hold(pkt, 1);
+    *slot = plan;
+    event_post(EVENT_PRIO_MEDIUM, &_repeat_event);
+
+    return plan.at[plan.copies - 1];
+}
+
+static bool _is_sync(const gnrc_pktsnip_t *pkt)
+{
+    return pkt != NULL && pkt->size == DUTYCYCLE_SYNC_LEN &&
+           ((const uint8_t *)pkt->data)[0] == DUTYCYCLE_SYNC_DISPATCH;
+}
+
+/* Fills a SYNC frame for this very copy, must be called with _lock held */
+static void _sync_fill(uint8_t *frame, uint32_t now)
+{
+    uint16_t wake = _enabled ? CONFIG_DUTYCYCLE_WAKE : CONFIG_DUTYCYCLE_PERIOD;
+
+    frame[0] = DUTYCYCLE_SYNC_DISPATCH;
+    byteorder_htobebufs(&frame[1],
+                        CONFIG_DUTYCYCLE_PERIOD - _into_period(now));
+    byteorder_htobebufs(&frame[3], CONFIG_DUTYCYCLE_PERIOD);
+    byteorder_htobebufs(&frame[5], wake);
+}
+
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    assert(pkt->type == GNRC_NETTYPE_NETIF);
+
+    gnrc_netif_t *netif = hook->netif;
+    gnrc_netif_hdr_t *hdr = pkt->data;
+    uint32_t now = _now_ms();
+    uint32_t hold = CONFIG_DUTYCYCLE_DATA_HOLD;
+    bool sync = _is_sync(pkt->next);
+
+    mutex_lock(&_lock);
+    if (sync) {
+        _sync_fill(pkt->next->data, now);
+    }
+
+    if (hdr->flags & DUTYCYCLE_FLAGS_NOT_UNICAST) {
+        _repeat_t *repeat = _repeat_find(pkt);
+        if (repeat == NULL) {
+            /* Stay up to send the copies */
+            hold = _repeat_add(pkt, now, sync);
+        }
+        else {
+            if (--repeat->inflight == 0 && repeat->sent == repeat->copies) {
+                repeat->pkt = NULL;
+            }
+            hold = 0;
+        }
+    }
+
+    if (_until(now, _awake_until) < hold) {
+        _awake_until = now + hold;
+    }
+
+    if (_asleep) {
+        /* Already on the interface thread, no need to go through netapi */
+        netopt_state_t state = NETOPT_STATE_IDLE;
+        netif->dev->driver->set(netif->dev, NETOPT_STATE, &state,
+                                sizeof(state));
+        _wake_locked(now);
+        event_post(EVENT_PRIO_MEDIUM, &_tick_event);
+    }
+    mutex_unlock(&_lock);
+
+    return netif_hook_send(hook, pkt);
+}
+
+/* Takes the schedule of a SYNC frame */
+static void _sync_recv(_nbr_t *nbr, const uint8_t *frame, uint32_t now)
+{
+    uint16_t next = byteorder_bebuftohs(&frame[1]);
+    uint16_t period = byteorder_bebuftohs(&frame[3]);
+    uint16_t wake = byteorder_bebuftohs(&frame[5]);
+
+    if (period == 0 || wake == 0 || wake > period || next > period) {
+        DEBUG_PUTS("dutycycle: bad SYNC frame");
+        return;
+    }
+
+    nbr->known = true;
+    nbr->period = period;
+    nbr->wake = wake;
+    nbr->start = now + next;
+    nbr->synced = now;
+}
+
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook)
+{
+    gnrc_pktsnip_t *pkt = netif_hook_recv(hook);
+    if (pkt == NULL) {
+        return NULL;
+    }
+
+    gnrc_pktsnip_t *snip = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_NETIF);
+    if (snip == NULL) {
+        return pkt;
+    }
+
+    gnrc_netif_hdr_t *hdr = snip->data;
+    bool sync = _is_sync(pkt);
+    uint32_t now = _now_ms();
+
+    mutex_lock(&_lock);
+    _nbr_t *nbr = _nbr_seen(gnrc_netif_hdr_get_src_addr(hdr),
+                            hdr->src_l2addr_len, now);
+    if (nbr != NULL && sync) {
+        _sync_recv(nbr, pkt->data, now);
+    }
+    mutex_unlock(&_lock);
+
+    if (sync) {
+        /* Not for 6LoWPAN */
+        gnrc_pktbuf_release(pkt);
+        return NULL;
+    }
+
+    if (!(hdr->flags & DUTYCYCLE_FLAGS_NOT_UNICAST)) {
+        dutycycle_stay_awake(CONFIG_DUTYCYCLE_DATA_HOLD);
+    }
+
+    return pkt;
+}
+
+static void _sync(event_t *event)
+{
+    (void)event;
+
+    gnrc_pktsnip_t *pkt = gnrc_pktbuf_add(NULL, NULL, DUTYCYCLE_SYNC_LEN,
+                                          GNRC_NETTYPE_UNDEF);
+    if (pkt == NULL) {
+        DEBUG_PUTS("dutycycle: no space for a SYNC frame");
+    }
+    else {
+        /* Filled when it's sent */
+        memset(pkt->data, 0, DUTYCYCLE_SYNC_LEN);
+        ((uint8_t *)pkt->data)[0] = DUTYCYCLE_SYNC_DISPATCH;
+
+        gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+        if (netif_hdr == NULL) {
+            DEBUG_PUTS("dutycycle: no space for a SYNC frame");
+            gnrc_pktbuf_release(pkt);
+        }
+        else {
+            ((gnrc_netif_hdr_t *)netif_hdr->data)->flags |=
+                GNRC_NETIF_HDR_FLAGS_BROADCAST;
+            netif_hdr->next = pkt;
+            if (gnrc_netapi_send(_netif->pid, netif_hdr) < 1) {
+                DEBUG_PUTS("dutycycle: couldn't send a SYNC frame");
+                gnrc_pktbuf_release(netif_hdr);
+            }
+        }
+    }
+
+    event_timeout_set(&_sync_timeout,
+                      CONFIG_DUTYCYCLE_SYNC_INTERVAL * US_PER_SEC);
+}
+
+static int _set(netif_hook_t *hook, const gnrc_netapi_opt_t *opt)
+{
+    if (opt->opt != NETOPT_STATE || opt->context != DUTYCYCLE_NETAPI_CONTEXT) {
+        return netif_hook_set(hook, opt);
+    }
+
+    gnrc_netif_t *netif = hook->netif;
+
+    netopt_state_t state = *(const netopt_state_t *)opt->data;
+
+    mutex_lock(&_lock);
+    /* A frame was sent since the schedule decided to sleep */
+    bool stale = (state == NETOPT_STATE_SLEEP) && !_asleep;
+    mutex_unlock(&_lock);
+
+    if (stale) {
+        return -EBUSY;
+    }
+
+    return netif->dev->driver->set(netif->dev, NETOPT_STATE, &state,
+                                   sizeof(state));
+}
+
+int dutycycle_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_netif != NULL) {
+        return -EALREADY;
+    }
+
+    int res = netif_hook_add(netif, &_hook);
+    if (res < 0) {
+        return res;
+    }
+    _netif = netif;
+
+    event_timeout_init(&_tick_timeout, EVENT_PRIO_MEDIUM, &_tick_event);
+    event_timeout_init(&_repeat_timeout, EVENT_PRIO_MEDIUM, &_repeat_event);
+    event_timeout_init(&_sync_timeout, EVENT_PRIO_MEDIUM, &_sync_event);
+
+    mutex_lock(&_lock);
+    _last = _now_ms();
+    _epoch = _last;
+    _enabled = true;
+    mutex_unlock(&_lock);
+
+    event_post(EVENT_PRIO_MEDIUM, &_tick_event);
+    event_post(EVENT_PRIO_MEDIUM, &_sync_event);
+
+    return 0;
+}
+
+void dutycycle_enable(bool enable)
+{
+    mutex_lock(&_lock);
+    _enabled = enable;
+    mutex_unlock(&_lock);
+
+    if (_netif != NULL) {
+        event_post(EVENT_PRIO_MEDIUM, &_tick_event);
+    }
+}
+
+bool dutycycle_enabled(void)
+{
+    mutex_lock(&_lock);
+    bool enabled = _enabled;
+    mutex_unlock(&_lock);
+
+    return enabled;
+}
+
+void dutycycle_stay_awake(uint32_t ms)
+{
+    uint32_t now = _now_ms();
+
+    mutex_lock(&_lock);
+    if (_until(now, _awake_until) < ms) {
+        _awake_until = now + ms;
+    }
+    bool asleep = _asleep;
+    mutex_unlock(&_lock);
+
+    if (asleep && _netif != NULL) {
+        event_post(EVENT_PRIO_MEDIUM, &_tick_event);
+    }
+}
+
+void dutycycle_stats(dutycycle_stats_t *stats)
+{
+    assert(stats != NULL);
+
+    mutex_lock(&_lock);
+    if (_netif != NULL) {
+        uint32_t now = _now_ms();
+        _account(now);
+        _nbr_expire(now);
+    }
+    *stats = _stats;
+    stats->nbrs = 0;
+    stats->nbrs_known = 0;
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        stats->nbrs += _nbrs[i].l2addr_len != 0;
+        stats->nbrs_known += _nbrs[i].l2addr_len != 0 && _nbrs[i].known;
+    }
+    mutex_unlock(&_lock);
+}
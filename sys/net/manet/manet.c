@@ -18,11 +18,14 @@
  * @}
  */
 
+#include <assert.h>
+
 #include "net/manet.h"
 
 ipv6_addr_t ipv6_addr_all_manet_routers_link_local =
     IPV6_ADDR_ALL_MANET_ROUTERS_LINK_LOCAL;
 
+#if IS_USED(MODULE_GNRC_NETIF)
 int manet_netif_ipv6_group_join(gnrc_netif_t *netif)
 {
     assert(netif != NULL);
@@ -37,3 +40,4 @@ int manet_netif_ipv6_group_join(gnrc_netif_t *netif)
 
     return 0;
 }
+#endif
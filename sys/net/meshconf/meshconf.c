@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_meshconf
+ * @{
+ *
+ * @file
+ * @brief       Mesh-wide configuration dissemination
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "net/meshconf.h"
+#include "net/manet.h"
+
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/udp.h"
+
+#if IS_USED(MODULE_DUTYCYCLE)
+#include "net/dutycycle.h"
+#endif
+
+#include "byteorder.h"
+#include "checksum/fletcher16.h"
+#include "mutex.h"
+#include "rfc5444/rfc5444_reader.h"
+#include "rfc5444/rfc5444_writer.h"
+#include "trickle.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   Trickle timer expired
+ */
+#define MESHCONF_MSG_TYPE_TRICKLE (0x9100)
+
+/**
+ * @brief   The configuration was changed locally
+ */
+#define MESHCONF_MSG_TYPE_UPDATE  (0x9101)
+
+/**
+ * @brief   Message TLVs
+ */
+enum {
+    MESHCONF_TLV_VERSION,
+    MESHCONF_TLV_DATA,
+    MESHCONF_TLV_CHECKSUM,
+    MESHCONF_TLV_NUMOF,
+};
+
+/**
+ * @brief   Entry header size, key and length
+ */
+#define ENTRY_HDR_LEN (2)
+
+/**
+ * @brief   Packet buffer size, fits a message with the whole configuration
+ */
+#define PACKET_SIZE (CONFIG_MESHCONF_MAX_LEN + 32)
+
+static_assert(PACKET_SIZE <= RFC5444_MSG_BUFFER_SIZE,
+              "RFC5444_MSG_BUFFER_SIZE is too small for configuration messages");
+
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static char _stack[CONFIG_MESHCONF_STACK_SIZE];
+static gnrc_netif_t *_netif;
+static gnrc_netreg_entry_t _netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
+                                                                KERNEL_PID_UNDEF);
+
+/**
+ * @brief   Configuration, protected by `_lock`
+ */
+static struct {
+    uint16_t version;
+    uint16_t checksum;
+    uint8_t len;
+    uint8_t data[CONFIG_MESHCONF_MAX_LEN];
+    /* Attach the configuration to the next advertisement */
+    bool send_data;
+    uint32_t tx;
+    uint32_t tx_data;
+    uint32_t rx;
+} _conf;
+static mutex_t _lock = MUTEX_INIT;
+static meshconf_handler_t *_handlers;
+
+static trickle_t _trickle;
+
+/* RFC 5444, only used from the dissemination thread */
+static struct rfc5444_reader _reader;
+static struct rfc5444_writer _writer;
+static struct rfc5444_writer_target _target;
+static uint8_t _msg_buffer[PACKET_SIZE];
+/* Messages carry no addresses, the writer just wants a buffer */
+static uint8_t _addrtlv_buffer[1];
+static uint8_t _pkt_buffer[PACKET_SIZE];
+
+/* Snapshot of what's being written */
+static network_uint16_t _tx_version;
+static network_uint16_t _tx_checksum;
+static uint8_t _tx_data[CONFIG_MESHCONF_MAX_LEN];
+static uint8_t _tx_len;
+
+static int _cb_add_message_header(struct rfc5444_writer *wr,
+                                  struct rfc5444_writer_message *message);
+static void _cb_add_message_tlvs(struct rfc5444_writer *wr);
+static void _cb_send_packet(struct rfc5444_writer *wr,
+                            struct rfc5444_writer_target *iface, void *buffer,
+                            size_t length);
+static enum rfc5444_result _cb_message(
+    struct rfc5444_reader_tlvblock_context *cont);
+
+static struct rfc5444_writer_content_provider _provider = {
+    .msg_type = MESHCONF_MSGTYPE,
+    .addMessageTLVs = _cb_add_message_tlvs,
+};
+
+static struct rfc5444_reader_tlvblock_consumer _consumer = {
+    .msg_id = MESHCONF_MSGTYPE,
+    .block_callback = _cb_message,
+};
+
+static struct rfc5444_reader_tlvblock_consumer_entry _entries[MESHCONF_TLV_NUMOF] = {
+    [MESHCONF_TLV_VERSION] = {
+        .type = MESHCONF_TLV_VERSION,
+        .mandatory = true,
+        .min_length = sizeof(network_uint16_t),
+        .max_length = sizeof(network_uint16_t),
+        .match_length = true,
+    },
+    [MESHCONF_TLV_DATA] = {
+        .type = MESHCONF_TLV_DATA,
+        .max_length = CONFIG_MESHCONF_MAX_LEN,
+        .match_length = true,
+    },
+    [MESHCONF_TLV_CHECKSUM] = {
+        .type = MESHCONF_TLV_CHECKSUM,
+        .mandatory = true,
+        .min_length = sizeof(network_uint16_t),
+        .max_length = sizeof(network_uint16_t),
+        .match_length = true,
+    },
+};
+
+/* RFC 1982 serial number arithmetic, versions wrap around. Two routers can
+ * bump the same version at once, then the configuration with the higher
+ * checksum wins everywhere */
+static inline int _cmp(uint16_t version_a, uint16_t checksum_a,
+                       uint16_t version_b, uint16_t checksum_b)
+{
+    if (version_a != version_b) {
+        return (int16_t)(version_a - version_b) > 0 ? 1 : -1;
+    }
+    if (checksum_a != checksum_b) {
+        return checksum_a > checksum_b ? 1 : -1;
+    }
+    return 0;
+}
+
+static inline uint16_t _checksum(const uint8_t *data, size_t len)
+{
+    return fletcher16(data, len);
+}
+
+static bool _valid(const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        if (len - i < ENTRY_HDR_LEN || len - i - ENTRY_HDR_LEN < data[i + 1]) {
+            return false;
+        }
+        i += ENTRY_HDR_LEN + data[i + 1];
+    }
+
+    return true;
+}
+
+/* Offset of the entry for key in data, or -1 */
+static int _find(const uint8_t *data, size_t len, uint8_t key)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        if (data[i] == key) {
+            return i;
+        }
+        i += ENTRY_HDR_LEN + data[i + 1];
+    }
+
+    return -1;
+}
+
+static void _apply(const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        for (meshconf_handler_t *h = _handlers; h != NULL; h = h->next) {
+            if (h->key == data[i]) {
+                h->apply(h->arg, &data[i + ENTRY_HDR_LEN], data[i + 1]);
+            }
+        }
+        i += ENTRY_HDR_LEN + data[i + 1];
+    }
+}
+
+/* Apply the current configuration, outside of the lock as handlers may take
+ * their time or call back into us */
+static void _apply_current(void)
+{
+    uint8_t data[CONFIG_MESHCONF_MAX_LEN];
+    uint8_t len;
+
+    mutex_lock(&_lock);
+    len = _conf.len;
+    memcpy(data, _conf.data, len);
+    mutex_unlock(&_lock);
+
+    _apply(data, len);
+}
+
+static int _send(const void *buf, size_t len)
+{
+    gnrc_pktsnip_t *payload;
+    gnrc_pktsnip_t *udp;
+    gnrc_pktsnip_t *ip;
+
+    payload = gnrc_pktbuf_add(NULL, buf, len, GNRC_NETTYPE_UNDEF);
+    if (payload == NULL) {
+        DEBUG_PUTS("meshconf: couldn't allocate payload");
+        return -ENOMEM;
+    }
+
+    uint16_t port = UDP_MANET_PORT;
+    udp = gnrc_udp_hdr_build(payload, port, port);
+    if (udp == NULL) {
+        DEBUG_PUTS("meshconf: unable to allocate UDP header");
+        gnrc_pktbuf_release(payload);
+        return -ENOMEM;
+    }
+
+    ip = gnrc_ipv6_hdr_build(udp, NULL, &ipv6_addr_all_manet_routers_link_local);
+    if (ip == NULL) {
+        DEBUG_PUTS("meshconf: unable to allocate IPv6 header");
+        gnrc_pktbuf_release(udp);
+        return -ENOMEM;
+    }
+
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG_PUTS("meshconf: unable to allocate netif header");
+        gnrc_pktbuf_release(ip);
+        return -ENOMEM;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    LL_PREPEND(ip, netif_hdr);
+
+    if (gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP, GNRC_NETREG_DEMUX_CTX_ALL,
+                                  ip) < 1) {
+        DEBUG_PUTS("meshconf: unable to locate UDP thread");
+        gnrc_pktbuf_release(ip);
+        return -ENOTCONN;
+    }
+
+    return 0;
+}
+
+static int _cb_add_message_header(struct rfc5444_writer *wr,
+                                  struct rfc5444_writer_message *message)
+{
+    /* no originator, no hopcount, no hoplimit, no seqno, the message isn't
+     * forwarded, every router advertises its own copy */
+    rfc5444_writer_set_msg_header(wr, message, false, false, false, false);
+
+    return 0;
+}
+
+static void _cb_add_message_tlvs(struct rfc5444_writer *wr)
+{
+    rfc5444_writer_add_messagetlv(wr, MESHCONF_TLV_VERSION, 0, &_tx_version,
+                                  sizeof(_tx_version));
+    rfc5444_writer_add_messagetlv(wr, MESHCONF_TLV_CHECKSUM, 0, &_tx_checksum,
+                                  sizeof(_tx_checksum));
+    if (_tx_len > 0) {
+        rfc5444_writer_add_messagetlv(wr, MESHCONF_TLV_DATA, 0, _tx_data,
+                                      _tx_len);
+    }
+}
+
+static void _cb_send_packet(struct rfc5444_writer *wr,
+                            struct rfc5444_writer_target *iface, void *buffer,
+                            size_t length)
+{
+    (void)wr;
+    (void)iface;
+
+    if (_send(buffer, length) < 0) {
+        DEBUG_PUTS("meshconf: couldn't send packet");
+    }
+}
+
+static void _advertise(void *arg)
+{
+    (void)arg;
+
+    mutex_lock(&_lock);
+    _tx_version = byteorder_htons(_conf.version);
+    _tx_checksum = byteorder_htons(_conf.checksum);
+    _tx_len = 0;
+    if (_conf.send_data) {
+        _tx_len = _conf.len;
+        memcpy(_tx_data, _conf.data, _tx_len);
+        _conf.send_data = false;
+        _conf.tx_data++;
+    }
+    _conf.tx++;
+    mutex_unlock(&_lock);
+
+    DEBUG("meshconf: advertising version %u (%u bytes)\n",
+          byteorder_ntohs(_tx_version), _tx_len);
+
+    if (rfc5444_writer_create_message_alltarget(&_writer, MESHCONF_MSGTYPE,
+                                                RFC5444_MAX_ADDRLEN) != RFC5444_OKAY) {
+        DEBUG_PUTS("meshconf: message not created");
+        return;
+    }
+    rfc5444_writer_flush(&_writer, &_target, false);
+}
+
+static enum rfc5444_result _cb_message(
+    struct rfc5444_reader_tlvblock_context *cont)
+{
+    (void)cont;
+
+    struct rfc5444_reader_tlvblock_entry *version_tlv = _entries[MESHCONF_TLV_VERSION].tlv;
+    struct rfc5444_reader_tlvblock_entry *checksum_tlv = _entries[MESHCONF_TLV_CHECKSUM].tlv;
+    struct rfc5444_reader_tlvblock_entry *data_tlv = _entries[MESHCONF_TLV_DATA].tlv;
+    network_uint16_t tmp;
+    bool adopted = false;
+    bool reset = false;
+
+    memcpy(&tmp, version_tlv->single_value, sizeof(tmp));
+    uint16_t version = byteorder_ntohs(tmp);
+    memcpy(&tmp, checksum_tlv->single_value, sizeof(tmp));
+    uint16_t checksum = byteorder_ntohs(tmp);
+
+    mutex_lock(&_lock);
+    _conf.rx++;
+    int cmp = _cmp(version, checksum, _conf.version, _conf.checksum);
+    if (cmp == 0) {
+        /* Consistent */
+        trickle_increment_counter(&_trickle);
+    }
+    else if (cmp > 0) {
+        /* Without the data we can only reset, the older version we now
+         * advertise makes the neighbor send it */
+        if (data_tlv != NULL && _valid(data_tlv->single_value, data_tlv->length) &&
+            _checksum(data_tlv->single_value, data_tlv->length) == checksum) {
+            DEBUG("meshconf: adopting version %u (checksum %04x)\n", version,
+                  checksum);
+            _conf.version = version;
+            _conf.checksum = checksum;
+            _conf.len = data_tlv->length;
+            memcpy(_conf.data, data_tlv->single_value, data_tlv->length);
+            /* Pass it on, our neighbors are likely to have the old one */
+            _conf.send_data = true;
+            adopted = true;
+        }
+        reset = true;
+    }
+    else {
+        /* The neighbor is behind */
+        _conf.send_data = true;
+        reset = true;
+    }
+    mutex_unlock(&_lock);
+
+    if (reset) {
+        trickle_reset_timer(&_trickle);
+    }
+    if (adopted) {
+        _apply_current();
+    }
+
+    return RFC5444_OKAY;
+}
+
+static void _receive(gnrc_pktsnip_t *pkt)
+{
+    assert(pkt != NULL && pkt->data != NULL && pkt->size > 0);
+
+    if (rfc5444_reader_handle_packet(&_reader, pkt->data, pkt->size) != RFC5444_OKAY) {
+        DEBUG_PUTS("meshconf: couldn't handle packet");
+    }
+
+    gnrc_pktbuf_release(pkt);
+}
+
+static void _rfc5444_init(void)
+{
+    struct rfc5444_writer_message *msg;
+
+    rfc5444_reader_init(&_reader);
+    rfc5444_reader_add_message_consumer(&_reader, &_consumer, _entries,
+                                        ARRAY_SIZE(_entries));
+
+    _writer.msg_buffer = _msg_buffer;
+    _writer.msg_size = sizeof(_msg_buffer);
+    _writer.addrtlv_buffer = _addrtlv_buffer;
+    _writer.addrtlv_size = sizeof(_addrtlv_buffer);
+
+    _target.packet_buffer = _pkt_buffer;
+    _target.packet_size = sizeof(_pkt_buffer);
+    _target.sendPacket = _cb_send_packet;
+
+    rfc5444_writer_init(&_writer);
+    rfc5444_writer_register_target(&_writer, &_target);
+
+    if (rfc5444_writer_register_msgcontentprovider(&_writer, &_provider,
+                                                   NULL, 0) < 0) {
+        DEBUG_PUTS("meshconf: couldn't register message provider");
+        return;
+    }
+
+    msg = rfc5444_writer_register_message(&_writer, MESHCONF_MSGTYPE, false);
+    if (msg == NULL) {
+        DEBUG_PUTS("meshconf: couldn't register message");
+        return;
+    }
+    msg->addMessageHeader = _cb_add_message_header;
+}
+
+static void *_event_loop(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+    msg_t reply;
+    msg_t msg_queue[CONFIG_MESHCONF_MSG_QUEUE_SIZE];
+
+    msg_init_queue(msg_queue, CONFIG_MESHCONF_MSG_QUEUE_SIZE);
+
+    reply.content.value = (uint32_t)(-ENOTSUP);
+    reply.type = GNRC_NETAPI_MSG_TYPE_ACK;
+
+    _rfc5444_init();
+
+    _trickle.callback.func = _advertise;
+    _trickle.callback.args = NULL;
+    trickle_start(thread_getpid(), &_trickle, MESHCONF_MSG_TYPE_TRICKLE,
+                  CONFIG_MESHCONF_IMIN, CONFIG_MESHCONF_IMAX, CONFIG_MESHCONF_K);
+
+    while (1) {
+        msg_receive(&msg);
+
+        switch (msg.type) {
+            case MESHCONF_MSG_TYPE_TRICKLE:
+                trickle_callback(&_trickle);
+                break;
+
+            case MESHCONF_MSG_TYPE_UPDATE:
+                _apply_current();
+                trickle_reset_timer(&_trickle);
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_RCV:
+                _receive(msg.content.ptr);
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_GET:
+            case GNRC_NETAPI_MSG_TYPE_SET:
+                msg_reply(&msg, &reply);
+                break;
+
+            default:
+                DEBUG_PUTS("meshconf: received unidentified message");
+                break;
+        }
+    }
+
+    /* Never reached */
+    return NULL;
+}
+
+#if IS_USED(MODULE_DUTYCYCLE)
+static void _dutycycle_apply(void *arg, const uint8_t *value, size_t len)
+{
+    (void)arg;
+
+    if (len == 1) {
+        dutycycle_enable(value[0] != 0);
+    }
+}
+
+static meshconf_handler_t _dutycycle_handler = {
+    .key = MESHCONF_KEY_DUTYCYCLE,
+    .apply = _dutycycle_apply,
+};
+#endif
+
+int meshconf_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_pid != KERNEL_PID_UNDEF) {
+        return _pid;
+    }
+
+    _netif = netif;
+
+#if IS_USED(MODULE_DUTYCYCLE)
+    meshconf_register(&_dutycycle_handler);
+#endif
+
+    _pid = thread_create(_stack, sizeof(_stack), CONFIG_MESHCONF_PRIO,
+                         THREAD_CREATE_STACKTEST, _event_loop, NULL,
+                         "meshconf");
+    if (_pid < 0) {
+        return _pid;
+    }
+
+    /* AODVv2 listens on the same port, GNRC hands a copy to each of us and
+     * the RFC 5444 readers only consume their own message types */
+    gnrc_netreg_entry_init_pid(&_netreg, UDP_MANET_PORT, _pid);
+    gnrc_netreg_register(GNRC_NETTYPE_UDP, &_netreg);
+
+    return _pid;
+}
+
+void meshconf_register(meshconf_handler_t *handler)
+{
+    assert(handler != NULL && handler->apply != NULL);
+
+    mutex_lock(&_lock);
+    handler->next = _handlers;
+    _handlers = handler;
+    mutex_unlock(&_lock);
+}
+
+int meshconf_update(uint8_t key, const void *value, size_t len)
+{
+    assert(value != NULL || len == 0);
+
+    if (len > UINT8_MAX) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&_lock);
+
+    uint8_t data[CONFIG_MESHCONF_MAX_LEN];
+    size_t data_len = 0;
+    int i = _find(_conf.data, _conf.len, key);
+
+    /* Rebuild without the old entry, then append the new one */
+    if (i < 0) {
+        memcpy(data, _conf.data, _conf.len);
+        data_len = _conf.len;
+    }
+    else {
+        size_t old = ENTRY_HDR_LEN + _conf.data[i + 1];
+        memcpy(data, _conf.data, i);
+        memcpy(&data[i], &_conf.data[i + old], _conf.len - i - old);
+        data_len = _conf.len - old;
+    }
+
+    if (data_len + ENTRY_HDR_LEN + len > CONFIG_MESHCONF_MAX_LEN) {
+        mutex_unlock(&_lock);
+        return -ENOSPC;
+    }
+
+    data[data_len++] = key;
+    data[data_len++] = len;
+    memcpy(&data[data_len], value, len);
+    data_len += len;
+
+    memcpy(_conf.data, data, data_len);
+    _conf.len = data_len;
+    _conf.checksum = _checksum(data, data_len);
+    _conf.version++;
+    _conf.send_data = true;
+
+    mutex_unlock(&_lock);
+
+    if (_pid != KERNEL_PID_UNDEF) {
+        msg_t msg = { .type = MESHCONF_MSG_TYPE_UPDATE };
+        if (msg_try_send(&msg, _pid) < 1) {
+            DEBUG_PUTS("meshconf: couldn't notify thread");
+            return -EAGAIN;
+        }
+    }
+
+    return 0;
+}
+
+int meshconf_get(uint8_t key, void *value, size_t size)
+{
+    int res;
+
+    mutex_lock(&_lock);
+    int i = _find(_conf.data, _conf.len, key);
+    if (i < 0) {
+        res = -ENOENT;
+    }
+    else if (_conf.data[i + 1] > size) {
+        res = -ENOBUFS;
+    }
+    else {
+        res = _conf.data[i + 1];
+        memcpy(value, &_conf.data[i + ENTRY_HDR_LEN], res);
+    }
+    mutex_unlock(&_lock);
+
+    return res;
+}
+
+uint16_t meshconf_version(void)
+{
+    mutex_lock(&_lock);
+    uint16_t version = _conf.version;
+    mutex_unlock(&_lock);
+
+    return version;
+}
+
+void meshconf_print(void)
+{
+    mutex_lock(&_lock);
+
+    printf("version %u, checksum %04x, %u of %u bytes\n", _conf.version,
+           _conf.checksum, _conf.len, CONFIG_MESHCONF_MAX_LEN);
+    for (size_t i = 0; i < _conf.len; i += ENTRY_HDR_LEN + _conf.data[i + 1]) {
+        printf("  key %3u:", _conf.data[i]);
+        for (unsigned j = 0; j < _conf.data[i + 1]; j++) {
+            printf(" %02x", _conf.data[i + ENTRY_HDR_LEN + j]);
+        }
+        puts("");
+    }
+    printf("trickle: I %lu ms, advertisements %lu (%lu with data), "
+           "received %lu\n", (unsigned long)_trickle.I,
+           (unsigned long)_conf.tx, (unsigned long)_conf.tx_data,
+           (unsigned long)_conf.rx);
+
+    mutex_unlock(&_lock);
+}
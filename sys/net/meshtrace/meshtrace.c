@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_meshtrace
+ * @{
+ *
+ * @file
+ * @brief       Mesh traceroute
+ *
+ * Queries are answered from the medium priority event thread, traces run on
+ * the thread calling @ref meshtrace_run.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "event/thread.h"
+#include "kernel_defines.h"
+#include "mutex.h"
+#include "random.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "net/meshtrace.h"
+#include "net/aodvv2.h"
+#include "net/aodvv2/lrs.h"
+#include "net/gnrc/icmpv6/echo.h"
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/netreg.h"
+#include "net/gnrc/pktbuf.h"
+#include "net/icmpv6.h"
+#include "net/l2util.h"
+#include "net/nbr.h"
+#include "net/protnum.h"
+#include "net/sock/async/event.h"
+#include "net/sock/udp.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @name    Message types
+ * @{
+ */
+#define MSG_QUERY   (0)
+#define MSG_REPLY   (1)
+/** @} */
+
+/**
+ * @brief   Route query
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;           /**< MSG_QUERY */
+    uint8_t reserved;       /**< Sent as 0 */
+    network_uint16_t id;    /**< Query identifier */
+    ipv6_addr_t dst;        /**< Destination */
+} _query_t;
+
+/**
+ * @brief   Route query reply
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;           /**< MSG_REPLY */
+    uint8_t status;         /**< A meshtrace_status_t */
+    network_uint16_t id;    /**< Identifier of the query */
+    uint8_t state;          /**< Route state */
+    uint8_t metric_type;    /**< Metric type */
+    uint8_t metric;         /**< Metric */
+    int8_t rssi;            /**< RSSI of the link to the next hop */
+    network_uint16_t seqnum;    /**< Destination SeqNum */
+    uint8_t lqi;            /**< LQI of the link to the next hop */
+    uint8_t reserved;       /**< Sent as 0 */
+    ipv6_addr_t next_hop;   /**< Next hop */
+} _reply_t;
+
+static gnrc_netif_t *_netif;
+static sock_udp_t _sock;
+
+/**
+ * @brief   Held while a trace runs
+ */
+static mutex_t _running = MUTEX_INIT;
+
+/**
+ * @brief   Identifier of the running trace
+ */
+static uint16_t _id;
+
+static const char *_states[] = {
+    [ROUTE_STATE_ACTIVE] = "active",
+    [ROUTE_STATE_IDLE] = "idle",
+    [ROUTE_STATE_EXPIRED] = "expired",
+    [ROUTE_STATE_BROKEN] = "broken",
+    [ROUTE_STATE_TIMED] = "timed",
+};
+
+#if IS_USED(MODULE_NBR)
+static void _link_quality(meshtrace_route_t *route)
+{
+    eui64_t iid;
+    uint8_t l2addr[NBR_L2ADDR_MAX_LEN];
+    nbr_t nbr;
+
+    /* Next hops are link-local addresses derived from the l2 address */
+    memcpy(&iid, &route->next_hop.u64[1], sizeof(iid));
+    int len = l2util_ipv6_iid_to_addr(_netif->device_type, &iid, l2addr);
+    if (len <= 0 || nbr_get(l2addr, len, &nbr) < 0) {
+        return;
+    }
+
+    route->lqi = nbr.lqi;
+    route->rssi = nbr.rssi < INT8_MIN ? INT8_MIN
+                : nbr.rssi > INT8_MAX ? INT8_MAX : nbr.rssi;
+}
+#endif
+
+void meshtrace_route(const ipv6_addr_t *dst, meshtrace_route_t *route)
+{
+    assert(dst != NULL && route != NULL);
+
+    memset(route, 0, sizeof(*route));
+    route->status = MESHTRACE_NO_ROUTE;
+
+    /* Blocks on the client snapshot rather than giving up when it's being
+     * updated, a client must not show up as MESHTRACE_NO_ROUTE */
+    if ((_netif != NULL && gnrc_netif_ipv6_addr_idx(_netif, dst) >= 0) ||
+        aodvv2_client_is(dst)) {
+        route->status = MESHTRACE_TARGET;
+        return;
+    }
+
+    aodvv2_local_route_t entry;
+    if (aodvv2_route_get(dst, &entry) < 0) {
+        return;
+    }
+
+    route->status = MESHTRACE_ROUTE;
+    route->next_hop = entry.next_hop;
+    route->seqnum = entry.seqnum;
+    route->state = entry.state;
+    route->metric_type = entry.metric_type;
+    route->metric = entry.metric;
+#if IS_USED(MODULE_NBR)
+    if (_netif != NULL) {
+        _link_quality(route);
+    }
+#endif
+}
+
+static void _answer(const _query_t *query, const sock_udp_ep_t *remote)
+{
+    meshtrace_route_t route;
+    meshtrace_route(&query->dst, &route);
+
+    _reply_t reply = {
+        .type = MSG_REPLY,
+        .status = route.status,
+        .id = query->id,
+        .state = route.state,
+        .metric_type = route.metric_type,
+        .metric = route.metric,
+        .rssi = route.rssi,
+        .seqnum = byteorder_htons(route.seqnum),
+        .lqi = route.lqi,
+        .next_hop = route.next_hop,
+    };
+
+    if (sock_udp_send(&_sock, &reply, sizeof(reply), remote) < 0) {
+        DEBUG_PUTS("meshtrace: couldn't send reply");
+    }
+}
+
+static void _sock_cb(sock_udp_t *sock, sock_async_flags_t flags, void *arg)
+{
+    (void)arg;
+
+    if (!(flags & SOCK_ASYNC_MSG_RECV)) {
+        return;
+    }
+
+    while (true) {
+        sock_udp_ep_t remote;
+        void *data = NULL;
+        void *ctx = NULL;
+
+        int received = sock_udp_recv_buf(sock, &data, &ctx, 0, &remote);
+        if (received < 0) {
+            break;
+        }
+
+        if (received >= (int)sizeof(_query_t) &&
+            ((const _query_t *)data)->type == MSG_QUERY) {
+            _query_t query;
+            memcpy(&query, data, sizeof(query));
+            _answer(&query, &remote);
+        }
+
+        if (ctx != NULL) {
+            sock_udp_recv_buf(sock, &data, &ctx, 0, NULL);
+        }
+    }
+}
+
+int meshtrace_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_netif != NULL) {
+        return -EALREADY;
+    }
+
+    sock_udp_ep_t local = SOCK_IPV6_EP_ANY;
+    local.port = CONFIG_MESHTRACE_PORT;
+    int res = sock_udp_create(&_sock, &local, NULL, 0);
+    if (res < 0) {
+        DEBUG_PUTS("meshtrace: couldn't create UDP socket");
+        return res;
+    }
+    sock_udp_event_init(&_sock, EVENT_PRIO_MEDIUM, _sock_cb, NULL);
+
+    _netif = netif;
+
+    return 0;
+}
+
+static int _probe(const ipv6_addr_t *dst, uint8_t hl, uint16_t seq)
+{
+    gnrc_pktsnip_t *pkt;
+    gnrc_pktsnip_t *ip;
+
+    pkt = gnrc_icmpv6_echo_build(ICMPV6_ECHO_REQ, _id, seq, NULL, 0);
+    if (pkt == NULL) {
+        DEBUG_PUTS("meshtrace: couldn't allocate probe");
+        return -ENOMEM;
+    }
+
+    ip = gnrc_ipv6_hdr_build(pkt, NULL, dst);
+    if (ip == NULL) {
+        DEBUG_PUTS("meshtrace: unable to allocate IPv6 header");
+        gnrc_pktbuf_release(pkt);
+        return -ENOMEM;
+    }
+    ((ipv6_hdr_t *)ip->data)->hl = hl;
+
+    if (gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6, GNRC_NETREG_DEMUX_CTX_ALL,
+                                  ip) < 1) {
+        DEBUG_PUTS("meshtrace: unable to locate IPv6 thread");
+        gnrc_pktbuf_release(ip);
+        return -ENOTCONN;
+    }
+
+    return 0;
+}
+
+/* Checks that pkt answers probe seq, releases it. Returns the status of its
+ * source, or -EINVAL */
+static int _match(gnrc_pktsnip_t *pkt, uint16_t seq, ipv6_addr_t *src)
+{
+    gnrc_pktsnip_t *ip = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_IPV6);
+    gnrc_pktsnip_t *icmpv6 = gnrc_pktsnip_search_type(pkt,
+                                                      GNRC_NETTYPE_ICMPV6);
+    const icmpv6_echo_t *echo = NULL;
+    int res = -EINVAL;
+
+    if (ip == NULL || icmpv6 == NULL ||
+        icmpv6->size < sizeof(icmpv6_echo_t)) {
+        goto out;
+    }
+
+    const icmpv6_hdr_t *hdr = icmpv6->data;
+    if (hdr->type == ICMPV6_ECHO_REP) {
+        echo = icmpv6->data;
+        res = MESHTRACE_TARGET;
+    }
+    else if (hdr->type == ICMPV6_TIME_EXC || hdr->type == ICMPV6_DST_UNR) {
+        /* Errors carry the start of the probe */
+        if (icmpv6->size < sizeof(icmpv6_error_time_exc_t) +
+                           sizeof(ipv6_hdr_t) + sizeof(icmpv6_echo_t)) {
+            goto out;
+        }
+        const ipv6_hdr_t *probe = (const ipv6_hdr_t *)
+            ((const uint8_t *)icmpv6->data + sizeof(icmpv6_error_time_exc_t));
+        if (probe->nh != PROTNUM_ICMPV6) {
+            goto out;
+        }
+        echo = (const icmpv6_echo_t *)(probe + 1);
+        if (echo->type != ICMPV6_ECHO_REQ) {
+            goto out;
+        }
+        res = hdr->type == ICMPV6_TIME_EXC ? MESHTRACE_ROUTE
+                                           : MESHTRACE_NO_ROUTE;
+    }
+
+    if (echo == NULL || byteorder_ntohs(echo->id) != _id ||
+        byteorder_ntohs(echo->seq) != seq) {
+        res = -EINVAL;
+        goto out;
+    }
+
+    *src = ((const ipv6_hdr_t *)ip->data)->src;
+
+out:
+    gnrc_pktbuf_release(pkt);
+    return res;
+}
+
+/* Waits for the answer to probe seq, sent at start. Returns its status */
+static int _wait(uint16_t seq, uint32_t start, ipv6_addr_t *src)
+{
+    const uint32_t timeout = CONFIG_MESHTRACE_TIMEOUT * US_PER_MS;
+
+    while (true) {
+        uint32_t elapsed = xtimer_now_usec() - start;
+        msg_t msg;
+
+        if (elapsed >= timeout ||
+            xtimer_msg_receive_timeout(&msg, timeout - elapsed) < 0) {
+            return -ETIMEDOUT;
+        }
+        if (msg.type != GNRC_NETAPI_MSG_TYPE_RCV) {
+            continue;
+        }
+
+        int res = _match(msg.content.ptr, seq, src);
+        if (res >= 0) {
+            return res;
+        }
+    }
+}
+
+static void _query(const ipv6_addr_t *addr, const ipv6_addr_t *dst,
+                   meshtrace_route_t *route)
+{
+    const uint32_t timeout = CONFIG_MESHTRACE_TIMEOUT * US_PER_MS;
+
+    memset(route, 0, sizeof(*route));
+    route->status = MESHTRACE_NO_ROUTE;
+
+    sock_udp_t sock;
+    sock_udp_ep_t local = SOCK_IPV6_EP_ANY;
+    sock_udp_ep_t remote = SOCK_IPV6_EP_ANY;
+    memcpy(remote.addr.ipv6, addr, sizeof(remote.addr.ipv6));
+    remote.port = CONFIG_MESHTRACE_PORT;
+
+    if (sock_udp_create(&sock, &local, NULL, 0) < 0) {
+        DEBUG_PUTS("meshtrace: couldn't create UDP socket");
+        return;
+    }
+
+    _query_t query = {
+        .type = MSG_QUERY,
+        .id = byteorder_htons(_id),
+        .dst = *dst,
+    };
+    uint32_t start = xtimer_now_usec();
+    if (sock_udp_send(&sock, &query, sizeof(query), &remote) < 0) {
+        DEBUG_PUTS("meshtrace: couldn't send query");
+        goto out;
+    }
+
+    while (true) {
+        uint32_t elapsed = xtimer_now_usec() - start;
+        _reply_t reply;
+
+        if (elapsed >= timeout) {
+            break;
+        }
+        ssize_t res = sock_udp_recv(&sock, &reply, sizeof(reply),
+                                    timeout - elapsed, NULL);
+        if (res == -ETIMEDOUT) {
+            break;
+        }
+        if (res != sizeof(reply) || reply.type != MSG_REPLY ||
+            byteorder_ntohs(reply.id) != _id) {
+            continue;
+        }
+
+        route->status = reply.status;
+        route->state = reply.state;
+        route->metric_type = reply.metric_type;
+        route->metric = reply.metric;
+        route->rssi = reply.rssi;
+        route->seqnum = byteorder_ntohs(reply.seqnum);
+        route->lqi = reply.lqi;
+        route->next_hop = reply.next_hop;
+        break;
+    }
+
+out:
+    sock_udp_close(&sock);
+}
+
+int meshtrace_run(const ipv6_addr_t *dst, uint8_t max_hops, meshtrace_cb_t cb,
+                  void *arg)
+{
+    assert(dst != NULL && cb != NULL);
+
+    if (_netif == NULL) {
+        return -ENOTCONN;
+    }
+    if (!mutex_trylock(&_running)) {
+        return -EBUSY;
+    }
+    _id = random_uint32();
+
+    meshtrace_hop_t hop = { .answered = true };
+    ipv6_addr_t *src = gnrc_netif_ipv6_addr_best_src(_netif, dst, false);
+    if (src != NULL) {
+        hop.addr = *src;
+    }
+    meshtrace_route(dst, &hop.route);
+    cb(&hop, arg);
+
+    gnrc_netreg_entry_t echo_rep =
+        GNRC_NETREG_ENTRY_INIT_PID(ICMPV6_ECHO_REP, thread_getpid());
+    gnrc_netreg_entry_t time_exc =
+        GNRC_NETREG_ENTRY_INIT_PID(ICMPV6_TIME_EXC, thread_getpid());
+    gnrc_netreg_entry_t dst_unr =
+        GNRC_NETREG_ENTRY_INIT_PID(ICMPV6_DST_UNR, thread_getpid());
+    gnrc_netreg_register(GNRC_NETTYPE_ICMPV6, &echo_rep);
+    gnrc_netreg_register(GNRC_NETTYPE_ICMPV6, &time_exc);
+    gnrc_netreg_register(GNRC_NETTYPE_ICMPV6, &dst_unr);
+
+    int res = -ETIMEDOUT;
+    for (uint8_t hl = 1; hl <= max_hops && hl != 0; hl++) {
+        memset(&hop, 0, sizeof(hop));
+        hop.hop = hl;
+        hop.route.status = MESHTRACE_NO_ROUTE;
+
+        uint32_t start = xtimer_now_usec();
+        int err = _probe(dst, hl, hl);
+        if (err < 0) {
+            res = err;
+            break;
+        }
+
+        int status = _wait(hl, start, &hop.addr);
+        if (status >= 0) {
+            hop.rtt = xtimer_now_usec() - start;
+            hop.answered = true;
+            _query(&hop.addr, dst, &hop.route);
+        }
+        cb(&hop, arg);
+
+        if (status == MESHTRACE_TARGET) {
+            res = hl;
+            break;
+        }
+        if (status == MESHTRACE_NO_ROUTE) {
+            res = -EHOSTUNREACH;
+            break;
+        }
+    }
+
+    gnrc_netreg_unregister(GNRC_NETTYPE_ICMPV6, &echo_rep);
+    gnrc_netreg_unregister(GNRC_NETTYPE_ICMPV6, &time_exc);
+    gnrc_netreg_unregister(GNRC_NETTYPE_ICMPV6, &dst_unr);
+
+    /* Answers that arrived after their probe timed out */
+    msg_t msg;
+    while (msg_try_receive(&msg) == 1) {
+        if (msg.type == GNRC_NETAPI_MSG_TYPE_RCV) {
+            gnrc_pktbuf_release(msg.content.ptr);
+        }
+    }
+
+    mutex_unlock(&_running);
+
+    return res;
+}
+
+const char *meshtrace_state_name(uint8_t state)
+{
+    if (state >= ARRAY_SIZE(_states) || _states[state] == NULL) {
+        return "?";
+    }
+
+    return _states[state];
+}
@@ -0,0 +1,474 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_nbr
+ * @{
+ *
+ * @file
+ * @brief       Neighbor link table
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "net/gnrc/netif/hdr.h"
+#include "net/nbr.h"
+#include "net/netif_hook.h"
+
+#if IS_USED(MODULE_CC26X2_CC13X2_RF)
+#include "rf_conf.h"
+#endif
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+#if IS_USED(MODULE_CC26X2_CC13X2_RF)
+#define NBR_TX_POWER_LEVELS_NUMOF CC26X2_CC13X2_PA_TABLE_NUMOF
+#else
+#define NBR_TX_POWER_LEVELS_NUMOF (1)
+#endif
+
+#define NBR_FLAGS_NOT_UNICAST \
+    (GNRC_NETIF_HDR_FLAGS_BROADCAST | GNRC_NETIF_HDR_FLAGS_MULTICAST)
+
+static mutex_t _lock = MUTEX_INIT;
+static nbr_t _nbrs[CONFIG_NBR_NUMOF];
+
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook);
+
+static gnrc_netif_t *_netif;
+static netif_hook_t _hook = {
+    .send = _send,
+    .recv = _recv,
+    .prio = NETIF_HOOK_PRIO_NBR,
+};
+
+#if IS_USED(MODULE_TPC)
+/**
+ * @brief   Available power levels, from highest to lowest
+ */
+static int16_t _levels[NBR_TX_POWER_LEVELS_NUMOF];
+
+/**
+ * @brief   Power currently configured on the device
+ */
+static int16_t _tx_power;
+#endif
+
+#if IS_USED(MODULE_ARQ)
+static netdev_event_cb_t _event_cb;
+
+/**
+ * @brief   Retransmissions currently configured on the device
+ */
+static uint8_t _retries;
+
+/**
+ * @brief   Destination of the frame waiting for its TX status
+ */
+static uint8_t _pending[NBR_L2ADDR_MAX_LEN];
+static uint8_t _pending_len;
+#endif
+
+static uint32_t _now_ms(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+static nbr_t *_find(const uint8_t *l2addr, size_t l2addr_len)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        nbr_t *nbr = &_nbrs[i];
+        if (nbr->l2addr_len == l2addr_len &&
+            memcmp(nbr->l2addr, l2addr, l2addr_len) == 0) {
+            return nbr;
+        }
+    }
+
+    return NULL;
+}
+
+static nbr_t *_add(const uint8_t *l2addr, size_t l2addr_len, uint32_t now)
+{
+    nbr_t *nbr = _find(l2addr, l2addr_len);
+    if (nbr != NULL) {
+        return nbr;
+    }
+
+    /* Use a free entry, or replace the neighbor we haven't heard of in the
+     * longest time */
+    nbr = &_nbrs[0];
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        if (_nbrs[i].l2addr_len == 0) {
+            nbr = &_nbrs[i];
+            break;
+        }
+        if ((now - _nbrs[i].last_seen) > (now - nbr->last_seen)) {
+            nbr = &_nbrs[i];
+        }
+    }
+
+    DEBUG("nbr: adding neighbor (%u)\n", (unsigned)(nbr - _nbrs));
+
+    memset(nbr, 0, sizeof(*nbr));
+    memcpy(nbr->l2addr, l2addr, l2addr_len);
+    nbr->l2addr_len = l2addr_len;
+#if IS_USED(MODULE_TPC)
+    tpc_link_init(&nbr->tpc);
+    nbr->tx_power = _levels[0];
+#endif
+#if IS_USED(MODULE_ARQ)
+    arq_link_init(&nbr->arq);
+#endif
+
+    return nbr;
+}
+
+#if IS_USED(MODULE_TPC)
+static void _tx_power_levels_init(gnrc_netif_t *netif)
+{
+#if IS_USED(MODULE_CC26X2_CC13X2_RF)
+    (void)netif;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_levels); i++) {
+        int16_t dbm = cc26x2_cc13x2_rf_patable[i].dbm;
+
+        /* Keep them sorted from highest to lowest */
+        unsigned j = i;
+        for (; j > 0 && _levels[j - 1] < dbm; j--) {
+            _levels[j] = _levels[j - 1];
+        }
+        _levels[j] = dbm;
+    }
+#else
+    /* Without a known PA table only the current power is used */
+    if (netif->dev->driver->get(netif->dev, NETOPT_TX_POWER, &_levels[0],
+                                sizeof(_levels[0])) < 0) {
+        _levels[0] = 0;
+    }
+#endif
+
+    _tx_power = _levels[0];
+    netif->dev->driver->set(netif->dev, NETOPT_TX_POWER, &_tx_power,
+                            sizeof(_tx_power));
+}
+
+static void _tx_power_set(gnrc_netif_t *netif, int16_t power)
+{
+    if (power == _tx_power) {
+        return;
+    }
+
+    if (netif->dev->driver->set(netif->dev, NETOPT_TX_POWER, &power,
+                                sizeof(power)) < 0) {
+        DEBUG("nbr: couldn't set TX power to %d dBm\n", power);
+        return;
+    }
+
+    _tx_power = power;
+}
+#endif
+
+#if IS_USED(MODULE_ARQ)
+static void _retries_set(gnrc_netif_t *netif, uint8_t retries)
+{
+    if (retries == _retries) {
+        return;
+    }
+
+    if (netif->dev->driver->set(netif->dev, NETOPT_RETRANS, &retries,
+                                sizeof(retries)) < 0) {
+        DEBUG("nbr: couldn't set retransmissions to %u\n", retries);
+        return;
+    }
+
+    _retries = retries;
+}
+
+static void _tx_status(netdev_t *dev, netdev_event_t event)
+{
+    mutex_lock(&_lock);
+    nbr_t *nbr = _pending_len ? _find(_pending, _pending_len) : NULL;
+    _pending_len = 0;
+    if (nbr == NULL) {
+        mutex_unlock(&_lock);
+        return;
+    }
+
+    unsigned attempts = _retries + 1;
+    bool acked = false;
+
+    switch (event) {
+        case NETDEV_EVENT_TX_COMPLETE: {
+            uint8_t retries;
+            /* Not every device knows how many retransmissions it took */
+            if (dev->driver->get(dev, NETOPT_TX_RETRIES_NEEDED, &retries,
+                                 sizeof(retries)) < 0) {
+                retries = 0;
+            }
+            attempts = retries + 1;
+            acked = true;
+            nbr->tx_acked++;
+            break;
+        }
+        case NETDEV_EVENT_TX_NOACK:
+            nbr->tx_noack++;
+            break;
+        default:
+            /* The frame never made it to the air, that's no news about the
+             * link */
+            nbr->tx_busy++;
+            mutex_unlock(&_lock);
+            return;
+    }
+
+    nbr->tx_attempts += attempts;
+    arq_link_update(&nbr->arq, attempts, acked);
+    mutex_unlock(&_lock);
+}
+
+static void _event(netdev_t *dev, netdev_event_t event)
+{
+    /* NETDEV_EVENT_ISR comes from interrupt context, pass it on untouched */
+    switch (event) {
+        case NETDEV_EVENT_TX_COMPLETE:
+        case NETDEV_EVENT_TX_NOACK:
+        case NETDEV_EVENT_TX_MEDIUM_BUSY:
+            _tx_status(dev, event);
+            break;
+        default:
+            break;
+    }
+
+    _event_cb(dev, event);
+}
+#endif
+
+static int _send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    assert(pkt->type == GNRC_NETTYPE_NETIF);
+
+    gnrc_netif_hdr_t *hdr = pkt->data;
+#if IS_USED(MODULE_TPC)
+    /* Broadcasts always go at full power, they reach every neighbor and
+     * let them measure the path loss */
+    int16_t power = _levels[0];
+#endif
+#if IS_USED(MODULE_ARQ)
+    /* Broadcasts aren't acknowledged, retransmissions don't matter */
+    uint8_t retries = _retries;
+#endif
+
+    if (!(hdr->flags & NBR_FLAGS_NOT_UNICAST) && hdr->dst_l2addr_len > 0) {
+        mutex_lock(&_lock);
+        nbr_t *nbr = _find(gnrc_netif_hdr_get_dst_addr(hdr),
+                           hdr->dst_l2addr_len);
+        if (nbr != NULL) {
+            nbr->tx_frames++;
+#if IS_USED(MODULE_TPC)
+            uint32_t age = _now_ms() - nbr->tpc_updated;
+            if (age > (CONFIG_TPC_TIMEOUT * MS_PER_SEC)) {
+                tpc_link_init(&nbr->tpc);
+            }
+
+            uint8_t level = tpc_link_select(&nbr->tpc, _levels,
+                                            ARRAY_SIZE(_levels));
+            power = _levels[level];
+            nbr->tx_power = power;
+#endif
+#if IS_USED(MODULE_ARQ)
+            uint8_t prev = nbr->arq.retries;
+            retries = arq_link_select(&nbr->arq);
+            if (retries != prev) {
+                DEBUG("nbr: retransmissions %u -> %u (pdr %u%%)\n", prev,
+                      retries, arq_link_pdr(&nbr->arq));
+                nbr->arq_changes++;
+            }
+            memcpy(_pending, nbr->l2addr, nbr->l2addr_len);
+            _pending_len = nbr->l2addr_len;
+#endif
+        }
+#if IS_USED(MODULE_ARQ)
+        else {
+            retries = CONFIG_ARQ_RETRIES_DEFAULT;
+            _pending_len = 0;
+        }
+#endif
+        mutex_unlock(&_lock);
+    }
+#if IS_USED(MODULE_ARQ)
+    else {
+        mutex_lock(&_lock);
+        _pending_len = 0;
+        mutex_unlock(&_lock);
+    }
+#endif
+
+#if IS_USED(MODULE_TPC)
+    _tx_power_set(hook->netif, power);
+#endif
+#if IS_USED(MODULE_ARQ)
+    _retries_set(hook->netif, retries);
+#endif
+
+    return netif_hook_send(hook, pkt);
+}
+
+static gnrc_pktsnip_t *_recv(netif_hook_t *hook)
+{
+    gnrc_pktsnip_t *pkt = netif_hook_recv(hook);
+    if (pkt == NULL) {
+        return NULL;
+    }
+
+    gnrc_pktsnip_t *snip = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_NETIF);
+    if (snip == NULL) {
+        return pkt;
+    }
+
+    gnrc_netif_hdr_t *hdr = snip->data;
+    if (hdr->src_l2addr_len == 0 || hdr->src_l2addr_len > NBR_L2ADDR_MAX_LEN) {
+        return pkt;
+    }
+
+    uint32_t now = _now_ms();
+
+    mutex_lock(&_lock);
+    nbr_t *nbr = _add(gnrc_netif_hdr_get_src_addr(hdr), hdr->src_l2addr_len,
+                      now);
+    nbr->rssi = hdr->rssi;
+    nbr->lqi = hdr->lqi;
+    nbr->last_seen = now;
+    nbr->rx_frames++;
+#if IS_USED(MODULE_TPC)
+    if (hdr->flags & NBR_FLAGS_NOT_UNICAST) {
+        tpc_link_update(&nbr->tpc, _levels[0], hdr->rssi);
+        nbr->tpc_updated = now;
+    }
+#endif
+    mutex_unlock(&_lock);
+
+    return pkt;
+}
+
+int nbr_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_netif != NULL) {
+        return -EALREADY;
+    }
+
+    gnrc_netif_acquire(netif);
+
+#if IS_USED(MODULE_TPC)
+    _tx_power_levels_init(netif);
+#endif
+
+#if IS_USED(MODULE_ARQ)
+    _retries = CONFIG_ARQ_RETRIES_DEFAULT;
+    netif->dev->driver->set(netif->dev, NETOPT_RETRANS, &_retries,
+                            sizeof(_retries));
+    _event_cb = netif->dev->event_callback;
+    netif->dev->event_callback = _event;
+#endif
+
+    gnrc_netif_release(netif);
+
+    int res = netif_hook_add(netif, &_hook);
+    if (res < 0) {
+        return res;
+    }
+    _netif = netif;
+
+    return 0;
+}
+
+int nbr_get(const uint8_t *l2addr, size_t l2addr_len, nbr_t *nbr)
+{
+    assert(l2addr != NULL && nbr != NULL);
+
+    int res = -ENOENT;
+
+    mutex_lock(&_lock);
+    nbr_t *entry = _find(l2addr, l2addr_len);
+    if (entry != NULL && l2addr_len > 0) {
+        *nbr = *entry;
+        res = 0;
+    }
+    mutex_unlock(&_lock);
+
+    return res;
+}
+
+void nbr_print(void)
+{
+    char l2addr_str[3 * NBR_L2ADDR_MAX_LEN];
+    uint32_t now = _now_ms();
+
+    printf("%-24s %5s %4s %7s %8s %8s", "l2addr", "rssi", "lqi", "age",
+           "rx", "tx");
+#if IS_USED(MODULE_TPC)
+    printf(" %5s %5s", "loss", "power");
+#endif
+#if IS_USED(MODULE_ARQ)
+    printf(" %4s %4s %8s %8s %8s %8s %5s", "pdr", "retx", "acked", "noack",
+           "busy", "attempts", "chg");
+#endif
+    puts("");
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_nbrs); i++) {
+        nbr_t nbr;
+
+        mutex_lock(&_lock);
+        nbr = _nbrs[i];
+        mutex_unlock(&_lock);
+
+        if (nbr.l2addr_len == 0) {
+            continue;
+        }
+
+        printf("%-24s %5d %4u %6" PRIu32 "s %8" PRIu32 " %8" PRIu32,
+               gnrc_netif_addr_to_str(nbr.l2addr, nbr.l2addr_len, l2addr_str),
+               nbr.rssi, nbr.lqi, (now - nbr.last_seen) / MS_PER_SEC,
+               nbr.rx_frames, nbr.tx_frames);
+#if IS_USED(MODULE_TPC)
+        int16_t loss = tpc_link_path_loss(&nbr.tpc);
+        if (loss == TPC_PATH_LOSS_UNKNOWN) {
+            printf(" %5s", "-");
+        }
+        else {
+            printf(" %5d", loss);
+        }
+        printf(" %5d", nbr.tx_power);
+#endif
+#if IS_USED(MODULE_ARQ)
+        if (nbr.arq.samples < ARQ_MIN_SAMPLES) {
+            printf(" %4s", "-");
+        }
+        else {
+            printf(" %3u%%", arq_link_pdr(&nbr.arq));
+        }
+        printf(" %4u %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32
+               " %5u", nbr.arq.retries, nbr.tx_acked, nbr.tx_noack,
+               nbr.tx_busy, nbr.tx_attempts, nbr.arq_changes);
+#endif
+        puts("");
+    }
+}
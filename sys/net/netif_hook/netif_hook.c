@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_netif_hook
+ * @{
+ *
+ * @file
+ * @brief       Network interface hooks
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+
+#include "net/netif_hook.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   Interface with hooks
+ */
+typedef struct {
+    gnrc_netif_t *netif;            /**< Interface, NULL if unused */
+    const gnrc_netif_ops_t *ops;    /**< Operations of the interface */
+    gnrc_netif_ops_t hooked;        /**< Operations going through hooks */
+    netif_hook_t *hooks;            /**< Hooks, highest priority first */
+} _netif_t;
+
+static _netif_t _netifs[CONFIG_NETIF_HOOK_NETIF_NUMOF];
+
+/* Only the interface thread and netif_hook_add(), with the interface
+ * acquired, use an entry after it's set */
+static _netif_t *_find(const gnrc_netif_t *netif)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_netifs); i++) {
+        if (_netifs[i].netif == netif) {
+            return &_netifs[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int _send_from(_netif_t *entry, netif_hook_t *hook,
+                      gnrc_pktsnip_t *pkt)
+{
+    for (; hook != NULL; hook = hook->next) {
+        if (hook->send != NULL) {
+            return hook->send(hook, pkt);
+        }
+    }
+
+    return entry->ops->send(entry->netif, pkt);
+}
+
+static gnrc_pktsnip_t *_recv_from(_netif_t *entry, netif_hook_t *hook)
+{
+    for (; hook != NULL; hook = hook->next) {
+        if (hook->recv != NULL) {
+            return hook->recv(hook);
+        }
+    }
+
+    return entry->ops->recv(entry->netif);
+}
+
+static int _set_from(_netif_t *entry, netif_hook_t *hook,
+                     const gnrc_netapi_opt_t *opt)
+{
+    for (; hook != NULL; hook = hook->next) {
+        if (hook->set != NULL) {
+            return hook->set(hook, opt);
+        }
+    }
+
+    return entry->ops->set(entry->netif, opt);
+}
+
+static int _send(gnrc_netif_t *netif, gnrc_pktsnip_t *pkt)
+{
+    _netif_t *entry = _find(netif);
+
+    return _send_from(entry, entry->hooks, pkt);
+}
+
+static gnrc_pktsnip_t *_recv(gnrc_netif_t *netif)
+{
+    _netif_t *entry = _find(netif);
+
+    return _recv_from(entry, entry->hooks);
+}
+
+static int _set(gnrc_netif_t *netif, const gnrc_netapi_opt_t *opt)
+{
+    _netif_t *entry = _find(netif);
+
+    return _set_from(entry, entry->hooks, opt);
+}
+
+int netif_hook_add(gnrc_netif_t *netif, netif_hook_t *hook)
+{
+    assert(netif != NULL && hook != NULL);
+
+    int res = 0;
+
+    gnrc_netif_acquire(netif);
+    _netif_t *entry = _find(netif);
+    if (entry == NULL) {
+        entry = _find(NULL);
+        if (entry == NULL) {
+            DEBUG_PUTS("netif_hook: no room for another interface");
+            res = -ENOSPC;
+            goto out;
+        }
+
+        entry->netif = netif;
+        entry->ops = netif->ops;
+        entry->hooked = *netif->ops;
+        entry->hooked.send = _send;
+        entry->hooked.recv = _recv;
+        entry->hooked.set = _set;
+        entry->hooks = NULL;
+        netif->ops = &entry->hooked;
+    }
+
+    hook->netif = netif;
+
+    /* Equal priorities keep the order they were added in */
+    netif_hook_t **pos = &entry->hooks;
+    while (*pos != NULL && (*pos)->prio >= hook->prio) {
+        pos = &(*pos)->next;
+    }
+    hook->next = *pos;
+    *pos = hook;
+
+out:
+    gnrc_netif_release(netif);
+
+    return res;
+}
+
+int netif_hook_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    assert(hook != NULL);
+
+    return _send_from(_find(hook->netif), hook->next, pkt);
+}
+
+gnrc_pktsnip_t *netif_hook_recv(netif_hook_t *hook)
+{
+    assert(hook != NULL);
+
+    return _recv_from(_find(hook->netif), hook->next);
+}
+
+int netif_hook_set(netif_hook_t *hook, const gnrc_netapi_opt_t *opt)
+{
+    assert(hook != NULL);
+
+    return _set_from(_find(hook->netif), hook->next, opt);
+}
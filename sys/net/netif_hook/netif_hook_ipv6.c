@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_netif_hook
+ * @{
+ *
+ * @file
+ * @brief       IPv6 header of the frames going through a hook
+ *
+ * Only reads the frame, unlike the 6LoWPAN decompression of GNRC, which
+ * replaces the compressed header of a received packet.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/ipv6/hdr.h"
+#include "net/l2util.h"
+#include "net/netif_hook.h"
+#include "net/protnum.h"
+#include "net/udp.h"
+
+#if IS_USED(MODULE_GNRC_SIXLOWPAN_CTX)
+#include "net/gnrc/sixlowpan/ctx.h"
+#endif
+
+/**
+ * @name    6LoWPAN dispatches (RFC 4944, RFC 6282)
+ * @{
+ */
+#define DISPATCH_IPV6       (0x41)
+#define DISPATCH_IPHC_MASK  (0xe0)
+#define DISPATCH_IPHC       (0x60)
+#define DISPATCH_FRAG_MASK  (0xf8)
+#define DISPATCH_FRAG1      (0xc0)
+#define FRAG1_HDR_LEN       (4)
+/** @} */
+
+/**
+ * @name    IPHC header fields (RFC 6282)
+ * @{
+ */
+#define IPHC1_TF            (0x18)
+#define IPHC1_NH            (0x04)
+#define IPHC1_HLIM          (0x03)
+#define IPHC2_CID           (0x80)
+#define IPHC2_SAC           (0x40)
+#define IPHC2_SAM           (0x30)
+#define IPHC2_M             (0x08)
+#define IPHC2_DAC           (0x04)
+#define IPHC2_DAM           (0x03)
+#define NHC_UDP_MASK        (0xf8)
+#define NHC_UDP             (0xf0)
+#define NHC_UDP_C           (0x04)
+#define NHC_UDP_P           (0x03)
+/** @} */
+
+/**
+ * @brief   Longest header read, a first fragment of an uncompressed UDP
+ *          packet
+ */
+#define HDR_MAX_LEN \
+    (FRAG1_HDR_LEN + 1 + sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t))
+
+/**
+ * @brief   Frame being read
+ */
+typedef struct {
+    const uint8_t *buf; /**< Start of the frame */
+    size_t len;         /**< Bytes of it in buf */
+    size_t pos;         /**< Bytes read */
+} _cursor_t;
+
+static size_t _copy(const gnrc_pktsnip_t *pkt, uint8_t *buf, size_t len)
+{
+    size_t copied = 0;
+
+    for (; pkt != NULL && copied < len; pkt = pkt->next) {
+        if (pkt->type == GNRC_NETTYPE_NETIF) {
+            continue;
+        }
+
+        size_t n = pkt->size < len - copied ? pkt->size : len - copied;
+        memcpy(&buf[copied], pkt->data, n);
+        copied += n;
+    }
+
+    return copied;
+}
+
+static const uint8_t *_take(_cursor_t *cur, size_t len)
+{
+    if (cur->len - cur->pos < len) {
+        return NULL;
+    }
+
+    const uint8_t *data = &cur->buf[cur->pos];
+    cur->pos += len;
+
+    return data;
+}
+
+static const gnrc_netif_hdr_t *_netif_hdr(const gnrc_pktsnip_t *pkt)
+{
+    for (; pkt != NULL; pkt = pkt->next) {
+        if (pkt->type == GNRC_NETTYPE_NETIF) {
+            return pkt->data;
+        }
+    }
+
+    return NULL;
+}
+
+static bool _is_6lo(const gnrc_pktsnip_t *pkt)
+{
+#if IS_USED(MODULE_GNRC_SIXLOWPAN)
+    for (; pkt != NULL; pkt = pkt->next) {
+        if (pkt->type != GNRC_NETTYPE_NETIF) {
+            return pkt->type == GNRC_NETTYPE_SIXLOWPAN;
+        }
+    }
+#else
+    (void)pkt;
+#endif
+
+    return false;
+}
+
+static int _udp(_cursor_t *cur, netif_hook_ipv6_t *hdr)
+{
+    const udp_hdr_t *udp = (const udp_hdr_t *)_take(cur, sizeof(udp_hdr_t));
+    if (udp == NULL) {
+        return -ENOENT;
+    }
+
+    hdr->src_port = byteorder_ntohs(udp->src_port);
+    hdr->dst_port = byteorder_ntohs(udp->dst_port);
+    hdr->udp_csum = cur->pos - sizeof(udp->checksum);
+
+    return 0;
+}
+
+static int _ipv6(_cursor_t *cur, netif_hook_ipv6_t *hdr)
+{
+    const ipv6_hdr_t *ipv6 = (const ipv6_hdr_t *)_take(cur, sizeof(ipv6_hdr_t));
+    if (ipv6 == NULL || !ipv6_hdr_is(ipv6)) {
+        return -ENOENT;
+    }
+
+    memcpy(&hdr->src, &ipv6->src, sizeof(hdr->src));
+    memcpy(&hdr->dst, &ipv6->dst, sizeof(hdr->dst));
+    hdr->nh = ipv6->nh;
+
+    return hdr->nh == PROTNUM_UDP ? _udp(cur, hdr) : 0;
+}
+
+/* Unicast address of SAM or DAM mode, the IID derived from l2addr if
+ * elided */
+static int _iphc_addr(_cursor_t *cur, ipv6_addr_t *addr, unsigned mode,
+                      bool ctx, uint8_t ctx_id, const uint8_t *l2addr,
+                      size_t l2addr_len, const gnrc_netif_t *netif)
+{
+    static const uint8_t inline_len[] = { 16, 8, 2, 0 };
+    const uint8_t *data = _take(cur, inline_len[mode]);
+    if (data == NULL) {
+        return -ENOENT;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    switch (mode) {
+        case 0:
+            memcpy(addr, data, sizeof(*addr));
+            return 0;
+        case 1:
+            memcpy(&addr->u8[8], data, 8);
+            break;
+        case 2:
+            addr->u8[11] = 0xff;
+            addr->u8[12] = 0xfe;
+            memcpy(&addr->u8[14], data, 2);
+            break;
+        default:
+            if (l2addr == NULL ||
+                l2util_ipv6_iid_from_addr(netif->device_type, l2addr,
+                                          l2addr_len,
+                                          (eui64_t *)&addr->u64[1]) < 0) {
+                return -ENOTSUP;
+            }
+            break;
+    }
+
+    if (!ctx) {
+        ipv6_addr_set_link_local_prefix(addr);
+        return 0;
+    }
+
+#if IS_USED(MODULE_GNRC_SIXLOWPAN_CTX)
+    gnrc_sixlowpan_ctx_t *entry = gnrc_sixlowpan_ctx_lookup_id(ctx_id);
+    if (entry != NULL) {
+        ipv6_addr_init_prefix(addr, &entry->prefix, entry->prefix_len);
+        return 0;
+    }
+#else
+    (void)ctx_id;
+#endif
+
+    return -ENOTSUP;
+}
+
+static int _iphc_mcast(_cursor_t *cur, ipv6_addr_t *addr, unsigned mode)
+{
+    static const uint8_t inline_len[] = { 16, 6, 4, 1 };
+    const uint8_t *data = _take(cur, inline_len[mode]);
+    if (data == NULL) {
+        return -ENOENT;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->u8[0] = 0xff;
+    switch (mode) {
+        case 0:
+            memcpy(addr, data, sizeof(*addr));
+            break;
+        case 1:
+            /* ffXX::00XX:XXXX:XXXX */
+            addr->u8[1] = data[0];
+            memcpy(&addr->u8[11], &data[1], 5);
+            break;
+        case 2:
+            /* ffXX::00XX:XXXX */
+            addr->u8[1] = data[0];
+            memcpy(&addr->u8[13], &data[1], 3);
+            break;
+        default:
+            /* ff02::00XX */
+            addr->u8[1] = 0x02;
+            addr->u8[15] = data[0];
+            break;
+    }
+
+    return 0;
+}
+
+static int _iphc_udp(_cursor_t *cur, netif_hook_ipv6_t *hdr)
+{
+    static const uint8_t ports_len[] = { 4, 3, 3, 1 };
+
+    const uint8_t *nhc = _take(cur, 1);
+    if (nhc == NULL) {
+        return -ENOENT;
+    }
+    if ((*nhc & NHC_UDP_MASK) != NHC_UDP) {
+        /* Extension header */
+        return -ENOTSUP;
+    }
+
+    const uint8_t *ports = _take(cur, ports_len[*nhc & NHC_UDP_P]);
+    if (ports == NULL) {
+        return -ENOENT;
+    }
+    if (!(*nhc & NHC_UDP_C)) {
+        hdr->udp_csum = cur->pos;
+        if (_take(cur, 2) == NULL) {
+            return -ENOENT;
+        }
+    }
+
+    hdr->nh = PROTNUM_UDP;
+    switch (*nhc & NHC_UDP_P) {
+        case 0:
+            hdr->src_port = byteorder_bebuftohs(&ports[0]);
+            hdr->dst_port = byteorder_bebuftohs(&ports[2]);
+            break;
+        case 1:
+            hdr->src_port = byteorder_bebuftohs(&ports[0]);
+            hdr->dst_port = 0xf000 | ports[2];
+            break;
+        case 2:
+            hdr->src_port = 0xf000 | ports[0];
+            hdr->dst_port = byteorder_bebuftohs(&ports[1]);
+            break;
+        default:
+            hdr->src_port = 0xf0b0 | (ports[0] >> 4);
+            hdr->dst_port = 0xf0b0 | (ports[0] & 0x0f);
+            break;
+    }
+
+    return 0;
+}
+
+static int _iphc(const netif_hook_t *hook, const gnrc_pktsnip_t *pkt,
+                 _cursor_t *cur, netif_hook_ipv6_t *hdr)
+{
+    static const uint8_t tf_len[] = { 4, 3, 1, 0 };
+
+    const uint8_t *iphc = _take(cur, 2);
+    if (iphc == NULL) {
+        return -ENOENT;
+    }
+
+    uint8_t sci = 0;
+    uint8_t dci = 0;
+    if (iphc[1] & IPHC2_CID) {
+        const uint8_t *cid = _take(cur, 1);
+        if (cid == NULL) {
+            return -ENOENT;
+        }
+        sci = *cid >> 4;
+        dci = *cid & 0x0f;
+    }
+
+    if (_take(cur, tf_len[(iphc[0] & IPHC1_TF) >> 3]) == NULL) {
+        return -ENOENT;
+    }
+
+    if (!(iphc[0] & IPHC1_NH)) {
+        const uint8_t *nh = _take(cur, 1);
+        if (nh == NULL) {
+            return -ENOENT;
+        }
+        hdr->nh = *nh;
+    }
+
+    if (!(iphc[0] & IPHC1_HLIM) && _take(cur, 1) == NULL) {
+        return -ENOENT;
+    }
+
+    /* Elided addresses come from the link layer ones */
+    const gnrc_netif_t *netif = hook->netif;
+    const gnrc_netif_hdr_t *netif_hdr = _netif_hdr(pkt);
+    const uint8_t *src_l2addr = NULL;
+    size_t src_l2addr_len = 0;
+    const uint8_t *dst_l2addr = NULL;
+    size_t dst_l2addr_len = 0;
+
+    if (netif_hdr != NULL && netif_hdr->src_l2addr_len > 0) {
+        src_l2addr = gnrc_netif_hdr_get_src_addr(netif_hdr);
+        src_l2addr_len = netif_hdr->src_l2addr_len;
+    }
+    else if (netif->l2addr_len > 0) {
+        src_l2addr = netif->l2addr;
+        src_l2addr_len = netif->l2addr_len;
+    }
+    if (netif_hdr != NULL && netif_hdr->dst_l2addr_len > 0) {
+        dst_l2addr = gnrc_netif_hdr_get_dst_addr(netif_hdr);
+        dst_l2addr_len = netif_hdr->dst_l2addr_len;
+    }
+
+    unsigned sam = (iphc[1] & IPHC2_SAM) >> 4;
+    int res;
+    if ((iphc[1] & IPHC2_SAC) && sam == 0) {
+        /* Unspecified */
+        memset(&hdr->src, 0, sizeof(hdr->src));
+        res = 0;
+    }
+    else {
+        res = _iphc_addr(cur, &hdr->src, sam, iphc[1] & IPHC2_SAC, sci,
+                         src_l2addr, src_l2addr_len, netif);
+    }
+    if (res < 0) {
+        return res;
+    }
+
+    unsigned dam = iphc[1] & IPHC2_DAM;
+    if (iphc[1] & IPHC2_M) {
+        if (iphc[1] & IPHC2_DAC) {
+            /* Unicast prefix based */
+            return -ENOTSUP;
+        }
+        res = _iphc_mcast(cur, &hdr->dst, dam);
+    }
+    else if ((iphc[1] & IPHC2_DAC) && dam == 0) {
+        /* Reserved */
+        return -ENOTSUP;
+    }
+    else {
+        res = _iphc_addr(cur, &hdr->dst, dam, iphc[1] & IPHC2_DAC, dci,
+                         dst_l2addr, dst_l2addr_len, netif);
+    }
+    if (res < 0) {
+        return res;
+    }
+
+    if (iphc[0] & IPHC1_NH) {
+        return _iphc_udp(cur, hdr);
+    }
+
+    return hdr->nh == PROTNUM_UDP ? _udp(cur, hdr) : 0;
+}
+
+int netif_hook_ipv6_hdr(const netif_hook_t *hook, const gnrc_pktsnip_t *pkt,
+                        netif_hook_ipv6_t *hdr)
+{
+    assert(hook != NULL && pkt != NULL && hdr != NULL);
+
+    uint8_t buf[HDR_MAX_LEN];
+    _cursor_t cur = { .buf = buf, .len = _copy(pkt, buf, sizeof(buf)) };
+    int res;
+
+    memset(hdr, 0, sizeof(*hdr));
+
+    if (!_is_6lo(pkt)) {
+        res = _ipv6(&cur, hdr);
+    }
+    else {
+        const uint8_t *dispatch = _take(&cur, 1);
+        if (dispatch != NULL &&
+            (*dispatch & DISPATCH_FRAG_MASK) == DISPATCH_FRAG1) {
+            /* The rest of the fragment header */
+            dispatch = _take(&cur, FRAG1_HDR_LEN - 1) != NULL
+                     ? _take(&cur, 1) : NULL;
+        }
+
+        if (dispatch == NULL) {
+            res = -ENOENT;
+        }
+        else if (*dispatch == DISPATCH_IPV6) {
+            res = _ipv6(&cur, hdr);
+        }
+        else if ((*dispatch & DISPATCH_IPHC_MASK) == DISPATCH_IPHC) {
+            cur.pos--;
+            res = _iphc(hook, pkt, &cur, hdr);
+        }
+        else {
+            res = -ENOENT;
+        }
+    }
+
+    if (res < 0) {
+        return res;
+    }
+
+    hdr->offset = cur.pos;
+
+    return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_routeadv
+ * @{
+ *
+ * @file
+ * @brief       Mesh route advertisement
+ *
+ * RAs are built and sent from the medium priority event thread, routes are
+ * added and deleted from the AODVv2 thread.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "event/thread.h"
+#include "event/timeout.h"
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "net/routeadv.h"
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/ndp.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/pktbuf.h"
+#include "net/ndp.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   Route Information Option, without the variable length prefix
+ *
+ * See RFC 4191, section 2.3.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;           /**< Option type */
+    uint8_t len;            /**< Length in units of 8 bytes */
+    uint8_t pfx_len;        /**< Prefix length */
+    uint8_t flags;          /**< Route preference */
+    network_uint32_t ltime; /**< Route lifetime (s) */
+} _rio_t;
+
+/**
+ * @brief   An advertised route
+ */
+typedef struct {
+    ipv6_addr_t pfx;    /**< Destination */
+    uint8_t pfx_len;    /**< Destination prefix length */
+    bool used;          /**< Slot in use */
+    bool deleted;       /**< Advertise it with a lifetime of 0, then free it */
+    bool changed;       /**< Not advertised since it changed */
+    uint32_t expires;   /**< Expiration time (s), 0 for never */
+} _route_t;
+
+static void _advertise(event_t *event);
+
+static mutex_t _lock = MUTEX_INIT;
+
+static gnrc_netif_t *_netif;
+
+static event_t _event = { .handler = _advertise };
+static event_timeout_t _timeout;
+
+static _route_t _routes[CONFIG_ROUTEADV_NUMOF];
+
+/**
+ * @brief   Time of the last RA (ms)
+ */
+static uint32_t _last;
+
+/**
+ * @brief   Time of the next full RA (ms)
+ */
+static uint32_t _refresh;
+
+/**
+ * @brief   Time the event is scheduled for (ms)
+ */
+static uint32_t _next;
+
+static uint32_t _now_ms(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_MS);
+}
+
+static uint32_t _now_s(void)
+{
+    return (uint32_t)(xtimer_now_usec64() / US_PER_SEC);
+}
+
+/* Time from now until t, 0 if t already passed */
+static uint32_t _until(uint32_t now, uint32_t t)
+{
+    int32_t diff = (int32_t)(t - now);
+    return diff > 0 ? (uint32_t)diff : 0;
+}
+
+/* Must be called with _lock held */
+static void _schedule(uint32_t now, uint32_t at)
+{
+    if (_netif == NULL || (int32_t)(at - _next) >= 0) {
+        return;
+    }
+
+    _next = at;
+    event_timeout_set(&_timeout, _until(now, at) * US_PER_MS);
+}
+
+/* Must be called with _lock held */
+static void _changed(_route_t *route)
+{
+    route->changed = true;
+
+    uint32_t now = _now_ms();
+    uint32_t at = _last + CONFIG_ROUTEADV_MIN_INTERVAL;
+    _schedule(now, (int32_t)(at - now) > 0 ? at : now);
+}
+
+static _route_t *_find(const ipv6_addr_t *pfx, uint8_t pfx_len)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(_routes); i++) {
+        _route_t *route = &_routes[i];
+        if (route->used && route->pfx_len == pfx_len &&
+            ipv6_addr_match_prefix(&route->pfx, pfx) >= pfx_len) {
+            return route;
+        }
+    }
+
+    return NULL;
+}
+
+/* Must be called with _lock held */
+static gnrc_pktsnip_t *_rio_build(const _route_t *route, uint32_t now,
+                                  gnrc_pktsnip_t *next)
+{
+    uint32_t ltime = 0;
+    if (!route->deleted) {
+        ltime = route->expires == 0 ? UINT32_MAX
+                                    : _until(now, route->expires);
+    }
+
+    /* The prefix is sent in as many 8 byte units as it needs */
+    size_t pfx_size = ((route->pfx_len + 63) / 64) * 8;
+    gnrc_pktsnip_t *opt = gnrc_ndp_opt_build(NDP_OPT_RI,
+                                             sizeof(_rio_t) + pfx_size, next);
+    if (opt == NULL) {
+        return NULL;
+    }
+
+    _rio_t *rio = opt->data;
+    rio->pfx_len = route->pfx_len;
+    rio->flags = 0;
+    rio->ltime = byteorder_htonl(ltime);
+    memcpy(rio + 1, &route->pfx, pfx_size);
+
+    return opt;
+}
+
+static void _send(gnrc_pktsnip_t *opts)
+{
+    gnrc_pktsnip_t *pkt = gnrc_ndp_rtr_adv_build(0, 0, 0, 0, 0, opts);
+    if (pkt == NULL) {
+        DEBUG_PUTS("routeadv: couldn't allocate RA");
+        gnrc_pktbuf_release(opts);
+        return;
+    }
+
+    gnrc_pktsnip_t *ip = gnrc_ipv6_hdr_build(pkt, NULL,
+                                             &ipv6_addr_all_nodes_link_local);
+    if (ip == NULL) {
+        DEBUG_PUTS("routeadv: couldn't allocate IPv6 header");
+        gnrc_pktbuf_release(pkt);
+        return;
+    }
+    ((ipv6_hdr_t *)ip->data)->hl = NDP_HOP_LIMIT;
+
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG_PUTS("routeadv: couldn't allocate netif header");
+        gnrc_pktbuf_release(ip);
+        return;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    ((gnrc_netif_hdr_t *)netif_hdr->data)->flags |=
+        GNRC_NETIF_HDR_FLAGS_MULTICAST;
+    LL_PREPEND(ip, netif_hdr);
+
+    if (gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6,
+                                  GNRC_NETREG_DEMUX_CTX_ALL, ip) < 1) {
+        DEBUG_PUTS("routeadv: unable to locate IPv6 thread");
+        gnrc_pktbuf_release(ip);
+    }
+}
+
+static void _advertise(event_t *event)
+{
+    (void)event;
+
+    uint32_t now = _now_ms();
+    uint32_t now_s = _now_s();
+    gnrc_pktsnip_t *opts = NULL;
+
+    mutex_lock(&_lock);
+    bool full = (int32_t)(now - _refresh) >= 0;
+    bool failed = false;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_routes); i++) {
+        _route_t *route = &_routes[i];
+
+        if (!route->used) {
+            continue;
+        }
+
+        if (!route->deleted && route->expires != 0 &&
+            (int32_t)(now_s - route->expires) >= 0) {
+            /* The host expires it by itself */
+            route->used = false;
+            continue;
+        }
+
+        if (!full && !route->changed) {
+            continue;
+        }
+
+        gnrc_pktsnip_t *opt = _rio_build(route, now_s, opts);
+        if (opt == NULL) {
+            DEBUG_PUTS("routeadv: couldn't allocate RIO");
+            failed = true;
+            break;
+        }
+        opts = opt;
+
+        route->changed = false;
+        if (route->deleted) {
+            route->used = false;
+        }
+    }
+
+    if (full) {
+        /* Routes left out are sent with a full RA soon */
+        _refresh = now + (failed ? CONFIG_ROUTEADV_MIN_INTERVAL
+                                 : CONFIG_ROUTEADV_REFRESH_INTERVAL * MS_PER_SEC);
+    }
+
+    /* An RA with nothing to say isn't sent */
+    if (opts != NULL) {
+        _last = now;
+    }
+
+    /* Changes that didn't fit wait for the minimum interval */
+    _next = _refresh;
+    for (unsigned i = 0; i < ARRAY_SIZE(_routes); i++) {
+        if (_routes[i].used && _routes[i].changed) {
+            uint32_t at = _last + CONFIG_ROUTEADV_MIN_INTERVAL;
+            if ((int32_t)(at - _next) < 0) {
+                _next = at;
+            }
+            break;
+        }
+    }
+    event_timeout_set(&_timeout, _until(now, _next) * US_PER_MS);
+    mutex_unlock(&_lock);
+
+    if (opts != NULL) {
+        DEBUG_PUTS("routeadv: sending RA");
+        _send(opts);
+    }
+}
+
+int routeadv_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    mutex_lock(&_lock);
+    if (_netif != NULL) {
+        mutex_unlock(&_lock);
+        return -EALREADY;
+    }
+
+    event_timeout_init(&_timeout, EVENT_PRIO_MEDIUM, &_event);
+
+    uint32_t now = _now_ms();
+    _netif = netif;
+    _last = now - CONFIG_ROUTEADV_MIN_INTERVAL;
+    _refresh = now;
+    _next = now;
+    mutex_unlock(&_lock);
+
+    event_post(EVENT_PRIO_MEDIUM, &_event);
+
+    return 0;
+}
+
+int routeadv_add(const ipv6_addr_t *pfx, uint8_t pfx_len, uint32_t lifetime)
+{
+    assert(pfx != NULL);
+
+    if (pfx_len > 128) {
+        pfx_len = 128;
+    }
+
+    uint32_t expires = lifetime == 0 ? 0 : _now_s() + lifetime;
+    /* 0 means never, be off by a second instead */
+    if (lifetime != 0 && expires == 0) {
+        expires = 1;
+    }
+
+    mutex_lock(&_lock);
+    _route_t *route = _find(pfx, pfx_len);
+    if (route == NULL) {
+        for (unsigned i = 0; i < ARRAY_SIZE(_routes); i++) {
+            if (!_routes[i].used) {
+                route = &_routes[i];
+                break;
+            }
+        }
+
+        if (route == NULL) {
+            mutex_unlock(&_lock);
+            DEBUG_PUTS("routeadv: route table full");
+            return -ENOSPC;
+        }
+
+        /* The bits after the prefix are sent, they must be zero */
+        memset(&route->pfx, 0, sizeof(route->pfx));
+        ipv6_addr_init_prefix(&route->pfx, pfx, pfx_len);
+        route->pfx_len = pfx_len;
+        route->used = true;
+    }
+    else if (!route->deleted && route->expires == expires) {
+        /* Nothing the host doesn't know already */
+        mutex_unlock(&_lock);
+        return 0;
+    }
+
+    /* Deleted and added back before the RA, only the new lifetime is sent */
+    route->deleted = false;
+    route->expires = expires;
+    _changed(route);
+    mutex_unlock(&_lock);
+
+    return 0;
+}
+
+void routeadv_del(const ipv6_addr_t *pfx, uint8_t pfx_len)
+{
+    assert(pfx != NULL);
+
+    if (pfx_len > 128) {
+        pfx_len = 128;
+    }
+
+    mutex_lock(&_lock);
+    _route_t *route = _find(pfx, pfx_len);
+    if (route != NULL && !route->deleted) {
+        route->deleted = true;
+        _changed(route);
+    }
+    mutex_unlock(&_lock);
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_slipcredit
+ * @{
+ *
+ * @file
+ * @brief       SLIP flow control
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "mutex.h"
+#include "xtimer.h"
+
+#include "net/gnrc/netapi.h"
+#include "net/gnrc/pktbuf.h"
+#include "net/netif_hook.h"
+#include "net/slipcredit.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+static_assert(CONFIG_SLIPCREDIT_WINDOW > 0 && CONFIG_SLIPCREDIT_WINDOW <= UINT8_MAX,
+              "CONFIG_SLIPCREDIT_WINDOW doesn't fit a credit frame");
+
+/**
+ * @brief   Frame from the host on its way to the mesh
+ */
+typedef struct {
+    ipv6_addr_t src;    /**< Source address */
+    uint32_t since;     /**< Reception time (ms) */
+    bool used;          /**< Slot in use */
+} _in_flight_t;
+
+static int _slip_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+static gnrc_pktsnip_t *_slip_recv(netif_hook_t *hook);
+static int _mesh_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+
+static mutex_t _lock = MUTEX_INIT;
+
+static gnrc_netif_t *_slip;
+static netif_hook_t _slip_hook = {
+    .send = _slip_send,
+    .recv = _slip_recv,
+    .prio = NETIF_HOOK_PRIO_SLIPCREDIT,
+};
+
+static gnrc_netif_t *_mesh;
+static netif_hook_t _mesh_hook = {
+    .send = _mesh_send,
+    .prio = NETIF_HOOK_PRIO_SLIPCREDIT,
+};
+
+/* Protected by _lock */
+static _in_flight_t _in_flight[CONFIG_SLIPCREDIT_WINDOW];
+static uint16_t _received;
+static slipcredit_stats_t _stats;
+
+/* Credit frame queued on the SLIP interface, filled when it's sent so it
+ * carries the latest count. Protected by _lock */
+static gnrc_pktsnip_t *_credit_pkt;
+
+static uint32_t _now_ms(void)
+{
+    return xtimer_now_usec64() / US_PER_MS;
+}
+
+static unsigned _free_credits(void)
+{
+    unsigned free = 0;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_in_flight); i++) {
+        free += !_in_flight[i].used;
+    }
+
+    return free;
+}
+
+/* Frees the slots of the frames that are too old, needs _lock */
+static unsigned _expire(void)
+{
+    uint32_t now = _now_ms();
+    unsigned expired = 0;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_in_flight); i++) {
+        _in_flight_t *entry = &_in_flight[i];
+
+        if (entry->used && now - entry->since >= CONFIG_SLIPCREDIT_TIMEOUT) {
+            entry->used = false;
+            expired++;
+        }
+    }
+    _stats.expired += expired;
+
+    return expired;
+}
+
+/* Queues a credit frame, unless one is queued already */
+static void _send_credits(void)
+{
+    mutex_lock(&_lock);
+    if (_credit_pkt != NULL) {
+        mutex_unlock(&_lock);
+        return;
+    }
+
+    gnrc_pktsnip_t *pkt = gnrc_pktbuf_add(NULL, NULL, SLIPCREDIT_FRAME_LEN,
+                                          GNRC_NETTYPE_UNDEF);
+    if (pkt == NULL) {
+        mutex_unlock(&_lock);
+        DEBUG_PUTS("slipcredit: no space for a credit frame");
+        return;
+    }
+    _credit_pkt = pkt;
+    mutex_unlock(&_lock);
+
+    /* The SLIP interface may be the one calling */
+    if (gnrc_netapi_send(_slip->pid, pkt) < 1) {
+        DEBUG_PUTS("slipcredit: couldn't queue a credit frame");
+        mutex_lock(&_lock);
+        _credit_pkt = NULL;
+        mutex_unlock(&_lock);
+        gnrc_pktbuf_release(pkt);
+    }
+}
+
+static bool _is_local(const ipv6_addr_t *dst)
+{
+    return ipv6_addr_is_link_local(dst) || ipv6_addr_is_multicast(dst) ||
+           gnrc_netif_ipv6_addr_idx(_slip, dst) >= 0 ||
+           gnrc_netif_ipv6_addr_idx(_mesh, dst) >= 0;
+}
+
+static gnrc_pktsnip_t *_slip_recv(netif_hook_t *hook)
+{
+    gnrc_pktsnip_t *pkt = netif_hook_recv(hook);
+    if (pkt == NULL) {
+        return NULL;
+    }
+
+    /* Frames that aren't IPv6 packets stay in the node too */
+    netif_hook_ipv6_t hdr;
+    bool local = netif_hook_ipv6_hdr(hook, pkt, &hdr) < 0 ||
+                 _is_local(&hdr.dst);
+
+    mutex_lock(&_lock);
+    _received++;
+    _stats.received++;
+
+    /* Expired frames make room, the frame takes it even if the host sent
+     * more than it was allowed to */
+    bool changed = _expire() > 0;
+    if (local) {
+        _stats.local++;
+        changed = true;
+    }
+    else {
+        _in_flight_t *slot = NULL;
+        for (unsigned i = 0; i < ARRAY_SIZE(_in_flight); i++) {
+            if (!_in_flight[i].used) {
+                slot = &_in_flight[i];
+                break;
+            }
+        }
+
+        if (slot != NULL) {
+            slot->src = hdr.src;
+            slot->since = _now_ms();
+            slot->used = true;
+        }
+        else {
+            DEBUG_PUTS("slipcredit: the host sent without credits");
+        }
+    }
+    mutex_unlock(&_lock);
+
+    if (changed) {
+        _send_credits();
+    }
+
+    return pkt;
+}
+
+static int _slip_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    mutex_lock(&_lock);
+    if (pkt == _credit_pkt) {
+        uint8_t *frame = pkt->data;
+        unsigned free = _free_credits();
+
+        frame[0] = SLIPCREDIT_FRAME_START;
+        byteorder_htobebufs(&frame[1], _received);
+        frame[3] = free;
+        frame[4] = CONFIG_SLIPCREDIT_WINDOW;
+
+        _credit_pkt = NULL;
+        _stats.credits++;
+    }
+    mutex_unlock(&_lock);
+
+    return netif_hook_send(hook, pkt);
+}
+
+static int _mesh_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    netif_hook_ipv6_t hdr;
+
+    /* Compressed on a 6LoWPAN interface, only the first fragment of a
+     * packet has its header */
+    if (netif_hook_ipv6_hdr(hook, pkt, &hdr) == 0) {
+        _in_flight_t *oldest = NULL;
+
+        mutex_lock(&_lock);
+        for (unsigned i = 0; i < ARRAY_SIZE(_in_flight); i++) {
+            _in_flight_t *entry = &_in_flight[i];
+
+            if (entry->used && ipv6_addr_equal(&entry->src, &hdr.src) &&
+                (oldest == NULL ||
+                 (int32_t)(entry->since - oldest->since) < 0)) {
+                oldest = entry;
+            }
+        }
+
+        if (oldest != NULL) {
+            oldest->used = false;
+            _stats.sent++;
+        }
+        bool changed = _expire() > 0 || oldest != NULL;
+        mutex_unlock(&_lock);
+
+        if (changed) {
+            _send_credits();
+        }
+    }
+
+    /* The interface releases it */
+    return netif_hook_send(hook, pkt);
+}
+
+int slipcredit_init(gnrc_netif_t *slip, gnrc_netif_t *mesh)
+{
+    if (slip == NULL || mesh == NULL) {
+        return -EINVAL;
+    }
+
+    if (_slip != NULL) {
+        return -EALREADY;
+    }
+
+    /* Both are used as soon as the first hook is added */
+    _slip = slip;
+    _mesh = mesh;
+
+    /* The mesh hook alone does nothing, if the SLIP one can't be added */
+    int res = netif_hook_add(mesh, &_mesh_hook);
+    if (res == 0) {
+        res = netif_hook_add(slip, &_slip_hook);
+    }
+    if (res < 0) {
+        return res;
+    }
+
+    /* Tell the host it's limited from now on */
+    _send_credits();
+
+    return 0;
+}
+
+void slipcredit_stats(slipcredit_stats_t *stats)
+{
+    assert(stats != NULL);
+
+    mutex_lock(&_lock);
+    *stats = _stats;
+    stats->in_flight = CONFIG_SLIPCREDIT_WINDOW - _free_credits();
+    mutex_unlock(&_lock);
+}
@@ -0,0 +1,623 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_timesync
+ * @{
+ *
+ * @file
+ * @brief       Mesh time synchronization
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "net/timesync.h"
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/udp.h"
+#include "net/manet.h"
+#include "net/netif_hook.h"
+#include "net/protnum.h"
+
+#include "byteorder.h"
+#include "mutex.h"
+#include "random.h"
+#include "xtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/**
+ * @brief   Time to send a beacon
+ */
+#define TIMESYNC_MSG_TYPE_TICK (0x9300)
+
+/**
+ * @brief   No root known yet
+ */
+#define ROOT_NONE (UINT16_MAX)
+
+/**
+ * @brief   Outliers in a row that restart the estimate
+ */
+#define OUTLIERS_MAX (3)
+
+/**
+ * @brief   Beacon version
+ */
+#define BEACON_VERSION (1)
+
+/**
+ * @brief   Beacon
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;            /**< @ref BEACON_VERSION */
+    uint8_t hops;               /**< Hops of the sender from the root */
+    network_uint16_t root;      /**< Root short address */
+    network_uint16_t seq;       /**< Round, set by the root */
+    network_uint64_t global;    /**< Global time of the sender (us) */
+} _beacon_t;
+
+/**
+ * @brief   Reference pair
+ */
+typedef struct {
+    uint64_t local;     /**< Local time (us) */
+    int64_t offset;     /**< Global time minus @ref local */
+} _entry_t;
+
+static int _netif_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt);
+
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static char _stack[CONFIG_TIMESYNC_STACK_SIZE];
+static gnrc_netif_t *_netif;
+static gnrc_netreg_entry_t _netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
+                                                                KERNEL_PID_UNDEF);
+static gnrc_netreg_entry_t _probe_netreg = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
+                                                                      KERNEL_PID_UNDEF);
+
+static netif_hook_t _hook = {
+    .send = _netif_send,
+    .prio = NETIF_HOOK_PRIO_TIMESYNC,
+};
+
+static xtimer_t _timer;
+static msg_t _timer_msg = { .type = TIMESYNC_MSG_TYPE_TICK };
+
+/**
+ * @brief   State below, protected by `_lock`
+ */
+static mutex_t _lock = MUTEX_INIT;
+
+static uint16_t _id;
+static uint16_t _root = ROOT_NONE;
+static uint16_t _seq;
+static uint8_t _hops;
+static uint8_t _heartbeats;
+static uint8_t _outliers;
+
+static _entry_t _entries[CONFIG_TIMESYNC_ENTRIES];
+static unsigned _numof;
+static unsigned _next;
+
+/**
+ * @name    Regression of the entries
+ * @{
+ */
+static uint64_t _local_avg;
+static int64_t _offset_avg;
+static float _skew;
+static uint32_t _error;
+/** @} */
+
+/* RFC 1982 serial number arithmetic, rounds wrap around */
+static inline bool _newer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+static inline bool _synced(void)
+{
+    return _root == _id || _numof >= CONFIG_TIMESYNC_MIN_ENTRIES;
+}
+
+/* Must be called with _lock held */
+static uint64_t _estimate(uint64_t local)
+{
+    if (_numof == 0) {
+        return local;
+    }
+
+    float dl = (float)(int64_t)(local - _local_avg);
+    return local + _offset_avg + (int64_t)(_skew * dl);
+}
+
+/* Must be called with _lock held */
+static void _regress(void)
+{
+    uint64_t base = _entries[0].local;
+    int64_t sum_local = 0;
+    int64_t sum_offset = 0;
+
+    for (unsigned i = 0; i < _numof; i++) {
+        sum_local += (int64_t)(_entries[i].local - base);
+        sum_offset += _entries[i].offset;
+    }
+    _local_avg = base + sum_local / (int64_t)_numof;
+    _offset_avg = sum_offset / (int64_t)_numof;
+
+    float num = 0;
+    float den = 0;
+    for (unsigned i = 0; i < _numof; i++) {
+        float dl = (float)(int64_t)(_entries[i].local - _local_avg);
+        float doff = (float)(_entries[i].offset - _offset_avg);
+        num += dl * doff;
+        den += dl * dl;
+    }
+    _skew = den > 0 ? num / den : 0;
+
+    _error = 0;
+    for (unsigned i = 0; i < _numof; i++) {
+        int64_t err = (int64_t)(_entries[i].local + _entries[i].offset -
+                                _estimate(_entries[i].local));
+        uint32_t abs_err = (uint32_t)(err < 0 ? -err : err);
+        if (abs_err > _error) {
+            _error = abs_err;
+        }
+    }
+}
+
+/* Must be called with _lock held */
+static void _add(uint64_t local, uint64_t global)
+{
+    if (_numof >= CONFIG_TIMESYNC_MIN_ENTRIES) {
+        int64_t err = (int64_t)(global - _estimate(local));
+        if (err > CONFIG_TIMESYNC_MAX_ERROR ||
+            err < -CONFIG_TIMESYNC_MAX_ERROR) {
+            if (++_outliers < OUTLIERS_MAX) {
+                DEBUG_PUTS("timesync: outlier dropped");
+                return;
+            }
+            DEBUG_PUTS("timesync: restarting the estimate");
+            _numof = 0;
+            _next = 0;
+        }
+    }
+    _outliers = 0;
+
+    _entries[_next].local = local;
+    _entries[_next].offset = (int64_t)(global - local);
+    _next = (_next + 1) % ARRAY_SIZE(_entries);
+    if (_numof < ARRAY_SIZE(_entries)) {
+        _numof++;
+    }
+
+    _regress();
+}
+
+static void _send(const _beacon_t *beacon)
+{
+    gnrc_pktsnip_t *payload;
+    gnrc_pktsnip_t *udp;
+    gnrc_pktsnip_t *ip;
+
+    payload = gnrc_pktbuf_add(NULL, beacon, sizeof(*beacon), GNRC_NETTYPE_UNDEF);
+    if (payload == NULL) {
+        DEBUG_PUTS("timesync: couldn't allocate payload");
+        return;
+    }
+
+    uint16_t port = CONFIG_TIMESYNC_PORT;
+    udp = gnrc_udp_hdr_build(payload, port, port);
+    if (udp == NULL) {
+        DEBUG_PUTS("timesync: unable to allocate UDP header");
+        gnrc_pktbuf_release(payload);
+        return;
+    }
+
+    ip = gnrc_ipv6_hdr_build(udp, NULL, &ipv6_addr_all_manet_routers_link_local);
+    if (ip == NULL) {
+        DEBUG_PUTS("timesync: unable to allocate IPv6 header");
+        gnrc_pktbuf_release(udp);
+        return;
+    }
+
+    gnrc_pktsnip_t *netif_hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    if (netif_hdr == NULL) {
+        DEBUG_PUTS("timesync: unable to allocate netif header");
+        gnrc_pktbuf_release(ip);
+        return;
+    }
+    gnrc_netif_hdr_set_netif(netif_hdr->data, _netif);
+    LL_PREPEND(ip, netif_hdr);
+
+    if (gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP, GNRC_NETREG_DEMUX_CTX_ALL,
+                                  ip) < 1) {
+        DEBUG_PUTS("timesync: unable to locate UDP thread");
+        gnrc_pktbuf_release(ip);
+    }
+}
+
+static void _tick(void)
+{
+    bool send = false;
+    _beacon_t beacon = { .version = BEACON_VERSION };
+
+    mutex_lock(&_lock);
+    if (_root != _id && ++_heartbeats >= CONFIG_TIMESYNC_ROOT_TIMEOUT) {
+        /* Carry on with the global time estimated so far, if any */
+        DEBUG_PUTS("timesync: root lost, taking over");
+        _root = _id;
+        _hops = 0;
+    }
+
+    if (_root == _id) {
+        _seq++;
+        send = true;
+    }
+    else {
+        send = _synced();
+    }
+
+    if (send) {
+        beacon.hops = _hops;
+        beacon.root = byteorder_htons(_root);
+        beacon.seq = byteorder_htons(_seq);
+        /* Stamped again by _netif_send() */
+        beacon.global = byteorder_htonll(_estimate(xtimer_now_usec64()));
+    }
+    mutex_unlock(&_lock);
+
+    if (send) {
+        _send(&beacon);
+    }
+
+    /* Jitter by a quarter of the period, so neighbors don't collide */
+    uint32_t period = CONFIG_TIMESYNC_PERIOD * US_PER_SEC;
+    xtimer_set_msg(&_timer, period - period / 8 + random_uint32_range(0, period / 4),
+                   &_timer_msg, _pid);
+}
+
+/* Copies len bytes at offset of the frame, netif headers excluded, from buf
+ * if write, or else to buf. Returns false if the frame is shorter */
+static bool _frame_copy(gnrc_pktsnip_t *pkt, size_t offset, uint8_t *buf,
+                        size_t len, bool write)
+{
+    for (; pkt != NULL && len > 0; pkt = pkt->next) {
+        if (pkt->type == GNRC_NETTYPE_NETIF) {
+            continue;
+        }
+        if (offset >= pkt->size) {
+            offset -= pkt->size;
+            continue;
+        }
+
+        uint8_t *data = (uint8_t *)pkt->data + offset;
+        size_t n = pkt->size - offset < len ? pkt->size - offset : len;
+        if (write) {
+            memcpy(data, buf, n);
+        }
+        else {
+            memcpy(buf, data, n);
+        }
+        buf += n;
+        len -= n;
+        offset = 0;
+    }
+
+    return len == 0;
+}
+
+/* Adds the 16 bit words of data to a one's complement sum, RFC 1624 */
+static uint32_t _csum_add(uint32_t sum, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+
+    return sum;
+}
+
+/**
+ * @brief   Stamps the beacons the interface sends
+ *
+ * The timestamp of a beacon is the global time when the interface sends it,
+ * not when it was built, nor when it was queued for a broadcast copy of
+ * @ref net_dutycycle. The UDP checksum is updated for the new time.
+ */
+static int _netif_send(netif_hook_t *hook, gnrc_pktsnip_t *pkt)
+{
+    netif_hook_ipv6_t hdr;
+    _beacon_t beacon;
+    uint8_t csum[2];
+
+    if (netif_hook_ipv6_hdr(hook, pkt, &hdr) < 0 || hdr.nh != PROTNUM_UDP ||
+        hdr.src_port != CONFIG_TIMESYNC_PORT ||
+        hdr.dst_port != CONFIG_TIMESYNC_PORT || hdr.udp_csum == 0 ||
+        !_frame_copy(pkt, hdr.offset, (uint8_t *)&beacon, sizeof(beacon),
+                     false) ||
+        !_frame_copy(pkt, hdr.udp_csum, csum, sizeof(csum), false) ||
+        beacon.version != BEACON_VERSION) {
+        return netif_hook_send(hook, pkt);
+    }
+
+    network_uint64_t old = beacon.global;
+    uint64_t local = xtimer_now_usec64();
+    mutex_lock(&_lock);
+    network_uint64_t global = byteorder_htonll(_estimate(local));
+    mutex_unlock(&_lock);
+    beacon.global = global;
+
+    /* Replace the old words of the checksum with the new ones, the time is
+     * at an even offset of the payload */
+    uint32_t sum = ~((csum[0] << 8) | csum[1]) & 0xffff;
+    for (unsigned i = 0; i < sizeof(old); i++) {
+        old.u8[i] = ~old.u8[i];
+    }
+    sum = _csum_add(sum, old.u8, sizeof(old));
+    sum = _csum_add(sum, global.u8, sizeof(global));
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    sum = ~sum & 0xffff;
+    /* Zero means no checksum */
+    byteorder_htobebufs(csum, sum == 0 ? 0xffff : sum);
+
+    _frame_copy(pkt, hdr.offset, (uint8_t *)&beacon, sizeof(beacon), true);
+    _frame_copy(pkt, hdr.udp_csum, csum, sizeof(csum), true);
+
+    return netif_hook_send(hook, pkt);
+}
+
+static void _beacon(const gnrc_pktsnip_t *pkt, uint64_t local)
+{
+    if (pkt->size < sizeof(_beacon_t)) {
+        return;
+    }
+
+    _beacon_t beacon;
+    memcpy(&beacon, pkt->data, sizeof(beacon));
+    if (beacon.version != BEACON_VERSION) {
+        return;
+    }
+
+    uint16_t root = byteorder_ntohs(beacon.root);
+    uint16_t seq = byteorder_ntohs(beacon.seq);
+
+    mutex_lock(&_lock);
+    if (root != _id &&
+        (root < _root || (root == _root && _newer(seq, _seq)))) {
+        if (root != _root) {
+            DEBUG("timesync: new root %04x\n", root);
+        }
+        _root = root;
+        _seq = seq;
+        _hops = beacon.hops < UINT8_MAX ? beacon.hops + 1 : UINT8_MAX;
+        _heartbeats = 0;
+        _add(local, byteorder_ntohll(beacon.global));
+    }
+    mutex_unlock(&_lock);
+}
+
+static void _probe(const gnrc_pktsnip_t *pkt, uint64_t local)
+{
+    network_uint64_t sent;
+    if (pkt->size < sizeof(sent)) {
+        return;
+    }
+    memcpy(&sent, pkt->data, sizeof(sent));
+
+    uint64_t now;
+    int res = timesync_global(local, &now);
+
+    char addr_str[IPV6_ADDR_MAX_STR_LEN];
+    ipv6_hdr_t *hdr = gnrc_ipv6_get_header((gnrc_pktsnip_t *)pkt);
+    ipv6_addr_to_str(addr_str, &hdr->src, sizeof(addr_str));
+
+    printf("probe from %s: %" PRIi32 " us, hop limit %u%s\n", addr_str,
+           (int32_t)(now - byteorder_ntohll(sent)), hdr->hl,
+           res < 0 ? " (not synchronized)" : "");
+}
+
+static void _receive(gnrc_pktsnip_t *pkt)
+{
+    assert(pkt != NULL && pkt->data != NULL);
+
+    /* Before anything else, the timestamp is what matters */
+    uint64_t local = xtimer_now_usec64();
+
+    gnrc_pktsnip_t *udp = gnrc_pktsnip_search_type(pkt, GNRC_NETTYPE_UDP);
+    if (udp != NULL &&
+        byteorder_ntohs(((udp_hdr_t *)udp->data)->dst_port) ==
+        CONFIG_TIMESYNC_PORT) {
+        _beacon(pkt, local);
+    }
+    else {
+        _probe(pkt, local);
+    }
+
+    gnrc_pktbuf_release(pkt);
+}
+
+static void *_event_loop(void *arg)
+{
+    (void)arg;
+    msg_t msg;
+    msg_t reply;
+    msg_t msg_queue[CONFIG_TIMESYNC_MSG_QUEUE_SIZE];
+
+    msg_init_queue(msg_queue, CONFIG_TIMESYNC_MSG_QUEUE_SIZE);
+
+    reply.content.value = (uint32_t)(-ENOTSUP);
+    reply.type = GNRC_NETAPI_MSG_TYPE_ACK;
+
+    while (1) {
+        msg_receive(&msg);
+
+        switch (msg.type) {
+            case TIMESYNC_MSG_TYPE_TICK:
+                _tick();
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_RCV:
+                _receive(msg.content.ptr);
+                break;
+
+            case GNRC_NETAPI_MSG_TYPE_GET:
+            case GNRC_NETAPI_MSG_TYPE_SET:
+                msg_reply(&msg, &reply);
+                break;
+
+            default:
+                DEBUG_PUTS("timesync: received unidentified message");
+                break;
+        }
+    }
+
+    /* Never reached */
+    return NULL;
+}
+
+static uint16_t _node_id(void)
+{
+    network_uint16_t addr;
+
+    /* The short address is unique in the mesh */
+    if (gnrc_netapi_get(_netif->pid, NETOPT_ADDRESS, 0, &addr,
+                        sizeof(addr)) == sizeof(addr)) {
+        return byteorder_ntohs(addr);
+    }
+
+    return random_uint32();
+}
+
+int timesync_init(gnrc_netif_t *netif)
+{
+    assert(netif != NULL);
+
+    if (_pid != KERNEL_PID_UNDEF) {
+        return _pid;
+    }
+
+    _netif = netif;
+
+    mutex_lock(&_lock);
+    _id = _node_id();
+    mutex_unlock(&_lock);
+
+    int res = netif_hook_add(netif, &_hook);
+    if (res < 0) {
+        return res;
+    }
+
+    _pid = thread_create(_stack, sizeof(_stack), CONFIG_TIMESYNC_PRIO,
+                         THREAD_CREATE_STACKTEST, _event_loop, NULL,
+                         "timesync");
+    if (_pid < 0) {
+        return _pid;
+    }
+
+    gnrc_netreg_entry_init_pid(&_netreg, CONFIG_TIMESYNC_PORT, _pid);
+    gnrc_netreg_register(GNRC_NETTYPE_UDP, &_netreg);
+
+    /* Listen for a period before sending anything */
+    xtimer_set_msg(&_timer, CONFIG_TIMESYNC_PERIOD * US_PER_SEC, &_timer_msg,
+                   _pid);
+
+    return _pid;
+}
+
+int timesync_global(uint64_t local, uint64_t *global)
+{
+    assert(global != NULL);
+
+    mutex_lock(&_lock);
+    bool synced = _synced();
+    *global = _estimate(local);
+    mutex_unlock(&_lock);
+
+    return synced ? 0 : -EAGAIN;
+}
+
+int timesync_now(uint64_t *now)
+{
+    return timesync_global(xtimer_now_usec64(), now);
+}
+
+void timesync_info(timesync_info_t *info)
+{
+    assert(info != NULL);
+
+    mutex_lock(&_lock);
+    info->id = _id;
+    info->root = _root;
+    info->seq = _seq;
+    info->hops = _hops;
+    info->entries = _numof;
+    info->synced = _synced();
+    info->skew_ppb = (int32_t)(_skew * 1e9f);
+    info->error = _error;
+    mutex_unlock(&_lock);
+}
+
+int timesync_probe_listen(uint16_t port)
+{
+    if (_pid == KERNEL_PID_UNDEF) {
+        return -ENOTCONN;
+    }
+
+    if (_probe_netreg.target.pid != KERNEL_PID_UNDEF) {
+        gnrc_netreg_unregister(GNRC_NETTYPE_UDP, &_probe_netreg);
+        _probe_netreg.target.pid = KERNEL_PID_UNDEF;
+    }
+
+    if (port != 0) {
+        gnrc_netreg_entry_init_pid(&_probe_netreg, port, _pid);
+        gnrc_netreg_register(GNRC_NETTYPE_UDP, &_probe_netreg);
+    }
+
+    return 0;
+}
+
+void timesync_print(void)
+{
+    if (_pid == KERNEL_PID_UNDEF) {
+        puts("not initialized");
+        return;
+    }
+
+    timesync_info_t info;
+    timesync_info(&info);
+
+    if (info.root == ROOT_NONE) {
+        printf("node %04x, no root yet\n", info.id);
+    }
+    else if (info.root == info.id) {
+        printf("node %04x, root, round %u\n", info.id, info.seq);
+    }
+    else {
+        printf("node %04x, root %04x, %u hops, round %u\n", info.id,
+               info.root, info.hops, info.seq);
+    }
+
+    printf("%s, %u pairs, drift %" PRIi32 " ppb, error %" PRIu32 " us\n",
+           info.synced ? "synchronized" : "not synchronized", info.entries,
+           info.skew_ppb, info.error);
+
+    uint64_t now;
+    timesync_now(&now);
+    printf("global time %" PRIu32 ".%06" PRIu32 " s\n",
+           (uint32_t)(now / US_PER_SEC), (uint32_t)(now % US_PER_SEC));
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     net_tpc
+ * @{
+ *
+ * @file
+ * @brief       Transmit Power Control
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ * @}
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "net/tpc.h"
+
+void tpc_link_init(tpc_link_t *link)
+{
+    assert(link != NULL);
+
+    link->path_loss = TPC_PATH_LOSS_UNKNOWN;
+    link->level = 0;
+}
+
+void tpc_link_update(tpc_link_t *link, int16_t tx_dbm, int16_t rssi)
+{
+    assert(link != NULL);
+
+    int32_t sample = ((int32_t)tx_dbm - rssi) * 16;
+
+    if (link->path_loss == TPC_PATH_LOSS_UNKNOWN) {
+        link->path_loss = sample;
+        return;
+    }
+
+    int32_t pl = link->path_loss;
+    pl += (sample - pl) / (1 << CONFIG_TPC_EWMA_SHIFT);
+    link->path_loss = pl;
+}
+
+uint8_t tpc_link_select(tpc_link_t *link, const int16_t *levels,
+                        unsigned numof)
+{
+    assert(link != NULL && levels != NULL && numof > 0);
+
+    if (link->level >= numof || link->path_loss == TPC_PATH_LOSS_UNKNOWN) {
+        link->level = 0;
+        return 0;
+    }
+
+    int32_t required = CONFIG_TPC_TARGET_RSSI + tpc_link_path_loss(link);
+    int32_t wanted = required + CONFIG_TPC_MARGIN;
+
+    /* Lowest level that keeps the margin, full power otherwise */
+    uint8_t best = 0;
+    for (unsigned i = 0; i < numof; i++) {
+        if (levels[i] >= wanted) {
+            best = i;
+        }
+    }
+
+    if (levels[link->level] < required || best > link->level) {
+        link->level = best;
+    }
+
+    return link->level;
+}
@@ -23,17 +23,24 @@
 #include "net/gnrc/ipv6/nib/ft.h"
 
 #if IS_USED(MODULE_AODVV2)
-#include "net/aodvv2/rcs.h"
+#include "net/aodvv2.h"
+#endif
+
+#if IS_USED(MODULE_VAINA_EVENT)
+#include "event/thread.h"
+#include "net/sock/async/event.h"
 #endif
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
+#if !IS_USED(MODULE_VAINA_EVENT)
 #if ENABLE_DEBUG == 1
 static char _stack[THREAD_STACKSIZE_DEFAULT + THREAD_EXTRA_STACKSIZE_PRINTF];
 #else
 static char _stack[THREAD_STACKSIZE_DEFAULT];
 #endif
+#endif
 
 /**
  * @brief   UDP socket
@@ -50,7 +57,7 @@ static gnrc_netif_t *_netif;
  */
 static sock_udp_ep_t _local;
 
-static int _parse_msg(vaina_msg_t *vaina, uint8_t *buf, size_t len)
+static int _parse_msg(vaina_msg_t *vaina, const uint8_t *buf, size_t len)
 {
     memset(vaina, 0, sizeof(vaina_msg_t));
 
@@ -99,6 +106,28 @@ static int _parse_msg(vaina_msg_t *vaina, uint8_t *buf, size_t len)
             }
             break;
 
+#if IS_USED(MODULE_MESHTRACE)
+        case VAINA_MSG_ROUTE_GET:
+            if (len < (2 + sizeof(ipv6_addr_t))) {
+                return -EINVAL;
+            }
+            vaina->msg = type;
+            vaina->seqno = seqno;
+            memcpy(&vaina->payload.route_get.ip, &buf[2], sizeof(ipv6_addr_t));
+            break;
+#endif
+
+#if IS_USED(MODULE_AODVV2_LAR)
+        case VAINA_MSG_POSITION_SET:
+            if (len < (2 + AODVV2_LAR_POSITION_LEN)) {
+                return -EINVAL;
+            }
+            vaina->msg = type;
+            vaina->seqno = seqno;
+            aodvv2_lar_position_read(&buf[2], &vaina->payload.position_set);
+            break;
+#endif
+
         default:
             DEBUG_PUTS("vaina: invalid message type");
             return -EINVAL;
@@ -113,15 +142,15 @@ static int _process_msg(vaina_msg_t *msg)
 #if IS_USED(MODULE_AODVV2)
         case VAINA_MSG_RCS_ADD:
             DEBUG_PUTS("vaina: adding new client");
-            if (aodvv2_rcs_add(&msg->payload.rcs_add.ip,
-                               msg->payload.rcs_add.pfx_len, 1) == NULL) {
+            if (aodvv2_client_add(&msg->payload.rcs_add.ip,
+                                  msg->payload.rcs_add.pfx_len, 1) < 0) {
                 DEBUG_PUTS("vaina: client set is full");
                 return -ENOSPC;
             }
             break;
 
         case VAINA_MSG_RCS_DEL:
-            aodvv2_rcs_del(&msg->payload.rcs_del.ip, msg->payload.rcs_del.pfx_len);
+            aodvv2_client_del(&msg->payload.rcs_del.ip, msg->payload.rcs_del.pfx_len);
             break;
 #endif
 
@@ -143,6 +172,23 @@ static int _process_msg(vaina_msg_t *msg)
                                  msg->payload.nib_del.pfx_len);
             break;
 
+#if IS_USED(MODULE_MESHTRACE)
+        case VAINA_MSG_ROUTE_GET: {
+            /* The answer replaces the request */
+            ipv6_addr_t dst = msg->payload.route_get.ip;
+            meshtrace_route(&dst, &msg->payload.route);
+            msg->msg = VAINA_MSG_ROUTE;
+            break;
+        }
+#endif
+
+#if IS_USED(MODULE_AODVV2_LAR)
+        case VAINA_MSG_POSITION_SET:
+            DEBUG_PUTS("vaina: setting position");
+            aodvv2_position_set(&msg->payload.position_set);
+            break;
+#endif
+
         default:
             return -EINVAL;
     }
@@ -165,56 +211,124 @@ static int _send_ack(vaina_msg_t *msg, sock_udp_ep_t *remote, bool good_ack)
     return sock_udp_send(&_sock, buf, sizeof(buf), remote);
 }
 
-static void *_vaina_thread(void *arg)
+#if IS_USED(MODULE_MESHTRACE)
+static int _send_route(vaina_msg_t *msg, sock_udp_ep_t *remote)
+{
+    const meshtrace_route_t *route = &msg->payload.route;
+    uint8_t buf[10 + sizeof(ipv6_addr_t)];
+
+    DEBUG_PUTS("vaina: sending route");
+    buf[0] = VAINA_MSG_ROUTE;
+    buf[1] = msg->seqno;
+    buf[2] = route->status;
+    buf[3] = route->state;
+    buf[4] = route->metric_type;
+    buf[5] = route->metric;
+    buf[6] = (uint8_t)route->rssi;
+    buf[7] = route->lqi;
+    buf[8] = route->seqnum >> 8;
+    buf[9] = route->seqnum & 0xff;
+    memcpy(&buf[10], &route->next_hop, sizeof(ipv6_addr_t));
+
+    return sock_udp_send(&_sock, buf, sizeof(buf), remote);
+}
+#endif
+
+static void _handle_packet(const uint8_t *buf, size_t len, sock_udp_ep_t *remote)
 {
-    (void) arg;
-    uint8_t buf[UINT8_MAX];
-    sock_udp_ep_t remote;
     vaina_msg_t msg;
 
-    while (true) {
-        int received = sock_udp_recv(&_sock, buf, sizeof(buf), SOCK_NO_TIMEOUT,
-                                     &remote);
+    DEBUG("vaina: received new packet\n");
 
-        DEBUG("vaina: received new packet\n");
+    /* TODO: why remote.netif is equal to 0 when sending a receiving a
+     * packet from SLIP
+     */
+    if (remote->netif != _netif->pid && remote->netif != 0) {
+        DEBUG("vaina: not from our netif: %d\n", remote->netif);
+        return;
+    }
 
-        /* TODO: why remote.netif is equal to 0 when sending a receiving a
-         * packet from SLIP
-         */
-        if (remote.netif != _netif->pid && remote.netif != 0) {
-            DEBUG("vaina: not from our netif: %d\n", remote.netif);
-            continue;
+    if (len == 0) {
+        DEBUG_PUTS("vaina: packet doesn't have a payload, dropping");
+        return;
+    }
+
+    if (_parse_msg(&msg, buf, len) < 0) {
+        DEBUG_PUTS("vaina: couldn't parse received message.");
+        return;
+    }
+
+    bool good_ack = true;
+    if (_process_msg(&msg) < 0) {
+        DEBUG_PUTS("vaina: couldn't process message.");
+        good_ack = false;
+    }
+
+#if IS_USED(MODULE_MESHTRACE)
+    if (good_ack && msg.msg == VAINA_MSG_ROUTE) {
+        if (_send_route(&msg, remote) < 0) {
+            DEBUG_PUTS("vaina: couldn't send the route!");
         }
+        return;
+    }
+#endif
 
+    if (_send_ack(&msg, remote, good_ack) < 0) {
+        DEBUG_PUTS("vaina: couldn't send the ACK!");
+    }
+}
+
+#if IS_USED(MODULE_VAINA_EVENT)
+static void _sock_cb(sock_udp_t *sock, sock_async_flags_t flags, void *arg)
+{
+    (void)arg;
+
+    if (!(flags & SOCK_ASYNC_MSG_RECV)) {
+        return;
+    }
+
+    /* Several packets may have arrived before the event was handled, the
+     * payload is read in place from the packet buffer */
+    while (true) {
+        sock_udp_ep_t remote;
+        void *data = NULL;
+        void *ctx = NULL;
+
+        int received = sock_udp_recv_buf(sock, &data, &ctx, 0, &remote);
         if (received < 0) {
-            DEBUG_PUTS("vaina: couldn't receive packet");
-            continue;
+            break;
         }
 
-        if (received == 0) {
-            DEBUG_PUTS("vaina: packet doesn't have a payload, dropping");
-            continue;
-        }
+        _handle_packet(data, received, &remote);
 
-        if (_parse_msg(&msg, buf, received) < 0) {
-            DEBUG_PUTS("vaina: couldn't parse received message.");
-            continue;
+        /* Release the packet */
+        if (ctx != NULL) {
+            sock_udp_recv_buf(sock, &data, &ctx, 0, NULL);
         }
+    }
+}
+#else
+static void *_vaina_thread(void *arg)
+{
+    (void) arg;
+    uint8_t buf[UINT8_MAX];
+    sock_udp_ep_t remote;
 
-        bool good_ack = true;
-        if (_process_msg(&msg) < 0) {
-            DEBUG_PUTS("vaina: couldn't process message.");
-            good_ack = false;
+    while (true) {
+        int received = sock_udp_recv(&_sock, buf, sizeof(buf), SOCK_NO_TIMEOUT,
+                                     &remote);
+        if (received < 0) {
+            DEBUG_PUTS("vaina: couldn't receive packet");
+            continue;
         }
 
-        if (_send_ack(&msg, &remote, good_ack) < 0) {
-            DEBUG_PUTS("vaina: couldn't send the ACK!");
-        }
+        _handle_packet(buf, received, &remote);
     }
 
     /* Never reached */
     return NULL;
 }
+#endif
 
 int vaina_init(gnrc_netif_t *netif)
 {
@@ -242,6 +356,11 @@ int vaina_init(gnrc_netif_t *netif)
 
     _netif = netif;
 
+#if IS_USED(MODULE_VAINA_EVENT)
+    sock_udp_event_init(&_sock, EVENT_PRIO_MEDIUM, _sock_cb, NULL);
+    return 0;
+#else
     return thread_create(_stack, sizeof(_stack), THREAD_PRIORITY_MAIN + 2,
                          THREAD_CREATE_STACKTEST, _vaina_thread, NULL, "vaina");
+#endif
 }
@@ -55,12 +55,25 @@
 #include "common/netaddr.h"
 #include "common/string.h"
 
+/*
+ * The string conversions need string.c, autobuf.c and inet_pton/inet_ntop,
+ * on RIOT they are only built with the oonf_common_netaddr_string module
+ */
+#ifdef RIOT_VERSION
+#include "kernel_defines.h"
+#define NETADDR_STRING IS_USED(MODULE_OONF_COMMON_NETADDR_STRING)
+#else
+#define NETADDR_STRING 1
+#endif
+
+#if NETADDR_STRING
 static char *_mac_to_string(char *dst, size_t dst_size, const void *bin, size_t bin_size, char separator);
 static char *_uuid_to_string(char *dst, size_t dst_size, const void *bin, size_t bin_size);
 static int _bin_from_hex(void *bin, size_t bin_size, const char *src, char separator);
 static int _uuid_from_string(void *bin, size_t bin_size, const char *src);
 static int _subnetmask_to_prefixlen(const char *src);
 static int _read_hexdigit(const char c);
+#endif /* NETADDR_STRING */
 static bool _binary_is_in_subnet(const struct netaddr *subnet, const void *bin);
 
 /* predefined network prefixes */
@@ -133,6 +146,7 @@ const union netaddr_socket NETADDR_SOCKET_IPV6_ANY = { .v6 = {
                                                          .sin6_scope_id = 0,
                                                        } };
 
+#if NETADDR_STRING
 /* List of predefined address prefixes */
 static const struct {
   const char *name;
@@ -144,6 +158,7 @@ static const struct {
   { NETADDR_STR_LINKLOCAL6, &NETADDR_IPV6_LINKLOCAL },
   { NETADDR_STR_ULA, &NETADDR_IPV6_ULA },
 };
+#endif /* NETADDR_STRING */
 
 /**
  * Read the binary representation of an address into a netaddr object
@@ -278,6 +293,7 @@ netaddr_to_socket(union netaddr_socket *dst, const struct netaddr *src) {
   return 0;
 }
 
+#if NETADDR_STRING
 /**
  * Append binary address to autobuf
  * @param abuf pointer to target autobuf
@@ -296,6 +312,7 @@ netaddr_to_autobuf(struct autobuf *abuf, const struct netaddr *src) {
 
   return abuf_memcpy(abuf, src->_addr, addr_len);
 }
+#endif /* NETADDR_STRING */
 
 /**
  * Creates a host address from a netmask and a host number part. This function
@@ -508,6 +525,7 @@ netaddr_socket_get_port(const union netaddr_socket *sock) {
   }
 }
 
+#if NETADDR_STRING
 /**
  * Converts a netaddr into a string
  * @param dst target string buffer
@@ -747,6 +765,7 @@ netaddr_socket_to_string(struct netaddr_str *dst, const union netaddr_socket *sr
 
   return dst->buf;
 }
+#endif /* NETADDR_STRING */
 
 /**
  * Compares two addresses in network byte order.
@@ -964,6 +983,7 @@ inet_pton(int af, const char *src, void *dst) {
 
 #endif
 
+#if NETADDR_STRING
 /**
  * Converts a binary mac address into a string representation
  * @param dst pointer to target string buffer
@@ -1197,6 +1217,7 @@ _subnetmask_to_prefixlen(const char *src) {
   /* not wellformed */
   return -1;
 }
+#endif /* NETADDR_STRING */
 
 /**
  * Calculates if a binary address is part of a netaddr prefix.
@@ -60,6 +60,10 @@
 #include "rfc5444_api_config.h"
 #include "rfc5444_writer.h"
 
+#if defined(RIOT_VERSION) && !defined(RFC5444_MSG_BUFFER_STORAGE)
+#include "mutex.h"
+#endif
+
 /**
  * data necessary for automatic address compression
  */
@@ -92,8 +96,30 @@ static void _write_msgheader(struct rfc5444_writer *writer, struct rfc5444_write
 static uint8_t *_write_addresstlvs(struct rfc5444_writer *writer, struct rfc5444_writer_message *msg,
   struct rfc5444_writer_address *first, struct rfc5444_writer_address *last, uint8_t *ptr);
 
+/*
+ * storage class of the postprocessor buffer, hosts running one writer per
+ * thread (e.g. the AODVv2 simulator) can make it thread local.
+ */
+#ifndef RFC5444_MSG_BUFFER_STORAGE
+#define RFC5444_MSG_BUFFER_STORAGE static
+#ifdef RIOT_VERSION
+/* one buffer for every writer, serialize the threads running them */
+#define RFC5444_MSG_BUFFER_LOCK
+#endif
+#endif
+
 /*! temporary buffer for messages when going through a postprocessor */
-static uint8_t _msg_buffer[RFC5444_MAX_MESSAGE_SIZE];
+RFC5444_MSG_BUFFER_STORAGE uint8_t _msg_buffer[RFC5444_MSG_BUFFER_SIZE];
+
+#ifdef RFC5444_MSG_BUFFER_LOCK
+/*! protects _msg_buffer, taken by the public entry points using it */
+static mutex_t _msg_buffer_lock = MUTEX_INIT;
+#endif
+
+static enum rfc5444_result _create_message(
+  struct rfc5444_writer *writer, uint8_t msgid, uint8_t addr_len, rfc5444_writer_targetselector useIf, void *param);
+static enum rfc5444_result _forward_msg(
+  struct rfc5444_writer *writer, struct rfc5444_reader_tlvblock_context *context, const uint8_t *msg, size_t len);
 
 /**
  * Create a message with a defined type
@@ -110,6 +136,22 @@ static uint8_t _msg_buffer[RFC5444_MAX_MESSAGE_SIZE];
 enum rfc5444_result
 rfc5444_writer_create_message(
   struct rfc5444_writer *writer, uint8_t msgid, uint8_t addr_len, rfc5444_writer_targetselector useIf, void *param)
+{
+  enum rfc5444_result result;
+
+#ifdef RFC5444_MSG_BUFFER_LOCK
+  mutex_lock(&_msg_buffer_lock);
+#endif
+  result = _create_message(writer, msgid, addr_len, useIf, param);
+#ifdef RFC5444_MSG_BUFFER_LOCK
+  mutex_unlock(&_msg_buffer_lock);
+#endif
+  return result;
+}
+
+static enum rfc5444_result
+_create_message(
+  struct rfc5444_writer *writer, uint8_t msgid, uint8_t addr_len, rfc5444_writer_targetselector useIf, void *param)
 {
   struct rfc5444_writer_message *msg;
   struct rfc5444_writer_content_provider *prv;
@@ -169,7 +211,7 @@ rfc5444_writer_create_message(
       }
 
       /* create an unique message by recursive call */
-      result = rfc5444_writer_create_message(writer, msgid, addr_len, rfc5444_writer_singletarget_selector, target);
+      result = _create_message(writer, msgid, addr_len, rfc5444_writer_singletarget_selector, target);
       if (result != RFC5444_OKAY) {
         return result;
       }
@@ -451,6 +493,22 @@ rfc5444_writer_alltargets_selector(struct rfc5444_writer *writer __attribute__((
 enum rfc5444_result
 rfc5444_writer_forward_msg(
   struct rfc5444_writer *writer, struct rfc5444_reader_tlvblock_context *context, const uint8_t *msg, size_t len)
+{
+  enum rfc5444_result result;
+
+#ifdef RFC5444_MSG_BUFFER_LOCK
+  mutex_lock(&_msg_buffer_lock);
+#endif
+  result = _forward_msg(writer, context, msg, len);
+#ifdef RFC5444_MSG_BUFFER_LOCK
+  mutex_unlock(&_msg_buffer_lock);
+#endif
+  return result;
+}
+
+static enum rfc5444_result
+_forward_msg(
+  struct rfc5444_writer *writer, struct rfc5444_reader_tlvblock_context *context, const uint8_t *msg, size_t len)
 {
   struct rfc5444_writer_target *target;
   struct rfc5444_writer_message *rfc5444_msg;
@@ -476,6 +534,11 @@ rfc5444_writer_forward_msg(
     return RFC5444_OKAY;
   }
 
+  if (len > sizeof(_msg_buffer)) {
+    /* does not fit into the scratch buffer */
+    return RFC5444_FW_MESSAGE_TOO_LONG;
+  }
+
   /* 1.) first flush all interfaces that have (too) full buffers */
   shall_forward = false;
   oonf_list_for_each_element(&writer->_targets, target, _target_node) {
@@ -84,6 +84,11 @@ rfc5444_writer_init(struct rfc5444_writer *writer) {
   assert(writer->msg_buffer != NULL && writer->msg_size > 0);
   assert(writer->addrtlv_buffer != NULL && writer->addrtlv_size > 0);
 
+  /* messages are copied into the shared scratch buffer */
+  if (writer->msg_size > RFC5444_MSG_BUFFER_SIZE) {
+    writer->msg_size = RFC5444_MSG_BUFFER_SIZE;
+  }
+
   /* set default memory handler functions */
   if (!writer->malloc_address_entry)
     writer->malloc_address_entry = _malloc_address_entry;
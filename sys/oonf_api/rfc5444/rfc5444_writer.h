@@ -91,6 +91,15 @@ enum
   RFC5444_WRITER_PKT_POSTPROCESSOR = -1,
 };
 
+/**
+ * Size of the scratch buffer messages go through on their way to the
+ * targets, shared by all writers. Builds whose writers use smaller message
+ * buffers can shrink it, writer message buffers are capped to it.
+ */
+#ifndef RFC5444_MSG_BUFFER_SIZE
+#define RFC5444_MSG_BUFFER_SIZE RFC5444_MAX_MESSAGE_SIZE
+#endif
+
 /**
  * This INTERNAL struct represents a single address tlv
  * of an address during message serialization.
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Radio airtime accounting shell command
+ *
+ * `airtime csv` prints the counters in a form telemetry collectors can
+ * parse, one class per line.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_AIRTIME)
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "net/airtime.h"
+#include "timex.h"
+
+#if IS_USED(MODULE_BQ27441)
+#include "fuel_gauge.h"
+#endif
+
+static void _usage(const char *cmd)
+{
+    printf("usage: %s [reset|csv]\n", cmd);
+}
+
+static uint64_t _energy_uj(const airtime_stats_t *stats, airtime_class_t cls)
+{
+    return airtime_energy_uj(&stats->tx[cls], true) +
+           airtime_energy_uj(&stats->rx[cls], false);
+}
+
+static void _print_csv(const airtime_stats_t *stats)
+{
+    puts("class,tx_frames,tx_bytes,tx_us,rx_frames,rx_bytes,rx_us,energy_uj,"
+         "elapsed_ms");
+    for (unsigned i = 0; i < AIRTIME_CLASS_NUMOF; i++) {
+        const airtime_counter_t *tx = &stats->tx[i];
+        const airtime_counter_t *rx = &stats->rx[i];
+        printf("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+               ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", airtime_class_name(i),
+               tx->frames, tx->bytes, (uint32_t)tx->us, rx->frames, rx->bytes,
+               (uint32_t)rx->us, (uint32_t)_energy_uj(stats, i),
+               (uint32_t)stats->elapsed_ms);
+    }
+}
+
+static void _print(const airtime_stats_t *stats)
+{
+    uint64_t total_us = 0;
+    uint64_t total_uj = 0;
+
+    printf("airtime over %" PRIu32 " s at %u bit/s\n",
+           (uint32_t)(stats->elapsed_ms / MS_PER_SEC), CONFIG_AIRTIME_BITRATE);
+    printf("%-9s %9s %9s %9s %9s %9s\n", "class", "tx frames", "tx ms",
+           "rx frames", "rx ms", "mJ");
+    for (unsigned i = 0; i < AIRTIME_CLASS_NUMOF; i++) {
+        const airtime_counter_t *tx = &stats->tx[i];
+        const airtime_counter_t *rx = &stats->rx[i];
+        uint64_t uj = _energy_uj(stats, i);
+
+        printf("%-9s %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32
+               " %9" PRIu32 "\n", airtime_class_name(i), tx->frames,
+               (uint32_t)(tx->us / US_PER_MS), rx->frames,
+               (uint32_t)(rx->us / US_PER_MS), (uint32_t)(uj / 1000));
+
+        total_us += tx->us + rx->us;
+        total_uj += uj;
+    }
+
+    uint32_t permille = stats->elapsed_ms
+                      ? (uint32_t)(total_us / stats->elapsed_ms) : 0;
+    /* uJ / ms = mW, in uW */
+    uint32_t avg_uw = stats->elapsed_ms
+                    ? (uint32_t)(total_uj * 1000 / stats->elapsed_ms) : 0;
+    printf("radio busy %" PRIu32 ".%" PRIu32 "%%, %" PRIu32 " mJ, %" PRIu32
+           ".%03" PRIu32 " mW on average\n", permille / 10, permille % 10,
+           (uint32_t)(total_uj / 1000), avg_uw / 1000, avg_uw % 1000);
+
+#if IS_USED(MODULE_BQ27441)
+    bq27441_t *dev = fuel_gauge();
+    int16_t power;
+    if (dev == NULL || bq27441_average_power(dev, &power) != BQ27441_OK) {
+        puts("Error: couldn't read the fuel gauge");
+        return;
+    }
+
+    /* Discharge power is negative */
+    if (power < 0) {
+        uint32_t battery_uw = (uint32_t)(-power) * 1000;
+        printf("battery: %" PRIu32 " mW, %" PRIu32 "%% of it for the radio "
+               "traffic\n", battery_uw / 1000, avg_uw * 100 / battery_uw);
+        for (unsigned i = 0; i < AIRTIME_CLASS_NUMOF; i++) {
+            uint32_t uw = stats->elapsed_ms
+                        ? (uint32_t)(_energy_uj(stats, i) * 1000 /
+                                     stats->elapsed_ms) : 0;
+            printf("  %-9s %" PRIu32 ".%" PRIu32 "%%\n", airtime_class_name(i),
+                   uw * 100 / battery_uw, (uw * 1000 / battery_uw) % 10);
+        }
+    }
+#endif
+}
+
+int airtime_cmd(int argc, char **argv)
+{
+    airtime_stats_t stats;
+
+    if (argc < 2) {
+        airtime_stats(&stats);
+        _print(&stats);
+    }
+    else if (strcmp(argv[1], "reset") == 0) {
+        airtime_reset();
+    }
+    else if (strcmp(argv[1], "csv") == 0) {
+        airtime_stats(&stats);
+        _print_csv(&stats);
+    }
+    else {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
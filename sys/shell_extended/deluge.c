@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Firmware image dissemination shell command
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_DELUGE)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net/deluge.h"
+
+static void _usage(const char *cmd)
+{
+    printf("usage: %s [publish <version> <size in bytes>]\n", cmd);
+}
+
+int deluge_cmd(int argc, char **argv)
+{
+    if (argc < 2) {
+        deluge_print();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "publish") != 0 || argc != 4) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    unsigned long version = strtoul(argv[2], NULL, 0);
+    unsigned long size = strtoul(argv[3], NULL, 0);
+    if (version == 0 || version > UINT16_MAX || size == 0) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    int res = deluge_publish(version, size);
+    if (res < 0) {
+        printf("Error: couldn't publish the image (%d)\n", res);
+        return 1;
+    }
+    printf("publishing version %lu, %lu bytes\n", version, size);
+
+    return 0;
+}
+
+#endif
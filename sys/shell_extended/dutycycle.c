@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Radio duty cycling shell command
+ *
+ * `dutycycle energy` reads the BQ27441 fuel gauge when it's available, so
+ * the radio awake share can be compared with the actual battery drain with
+ * duty cycling on and off.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_DUTYCYCLE)
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "net/dutycycle.h"
+#include "timex.h"
+
+#if IS_USED(MODULE_BQ27441)
+#include "fuel_gauge.h"
+#endif
+
+static void _usage(const char *cmd)
+{
+    printf("usage: %s [on|off|energy]\n", cmd);
+}
+
+static void _print_status(void)
+{
+    dutycycle_stats_t stats;
+    dutycycle_stats(&stats);
+
+    printf("duty cycling: %s, %u ms every %u ms\n",
+           dutycycle_enabled() ? "on" : "off", CONFIG_DUTYCYCLE_WAKE,
+           CONFIG_DUTYCYCLE_PERIOD);
+    uint32_t permille = stats.total_ms
+                      ? (uint32_t)(stats.awake_ms * 1000 / stats.total_ms) : 0;
+    printf("radio awake: %" PRIu32 " of %" PRIu32 " s (%" PRIu32 ".%" PRIu32
+           "%%)\n", (uint32_t)(stats.awake_ms / MS_PER_SEC),
+           (uint32_t)(stats.total_ms / MS_PER_SEC), permille / 10,
+           permille % 10);
+    printf("wakeups: %" PRIu32 ", broadcasts: %" PRIu32 ", copies: %" PRIu32
+           " (%" PRIu32 " blind, %" PRIu32 " cut short)\n", stats.wakeups,
+           stats.bcast, stats.bcast_copies, stats.bcast_blind,
+           stats.bcast_dropped);
+    printf("neighbors: %u, %u with a known schedule\n", stats.nbrs,
+           stats.nbrs_known);
+}
+
+#if IS_USED(MODULE_BQ27441)
+static int _print_energy(void)
+{
+    bq27441_t *dev = fuel_gauge();
+    if (dev == NULL) {
+        puts("Error: couldn't initialize the fuel gauge");
+        return 1;
+    }
+
+    uint16_t volts;
+    uint16_t rem_cap;
+    int16_t current;
+    int16_t power;
+
+    if (bq27441_voltage(dev, &volts) != BQ27441_OK ||
+        bq27441_remaining_capacity_filtered(dev, &rem_cap) != BQ27441_OK ||
+        bq27441_average_current(dev, &current) != BQ27441_OK ||
+        bq27441_average_power(dev, &power) != BQ27441_OK) {
+        puts("Error: couldn't read the fuel gauge");
+        return 1;
+    }
+
+    printf("battery: %" PRIu16 " mV, %" PRIu16 " mAh left\n", volts, rem_cap);
+    printf("average: %" PRIi16 " mA, %" PRIi16 " mW\n", current, power);
+    /* Discharge current is negative */
+    if (current < 0) {
+        printf("estimated life: %" PRIu32 " h\n",
+               (uint32_t)rem_cap / (uint32_t)(-current));
+    }
+
+    return 0;
+}
+#endif
+
+int dutycycle_cmd(int argc, char **argv)
+{
+    if (argc < 2) {
+        _print_status();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "on") == 0) {
+        dutycycle_enable(true);
+    }
+    else if (strcmp(argv[1], "off") == 0) {
+        dutycycle_enable(false);
+    }
+    else if (strcmp(argv[1], "energy") == 0) {
+        _print_status();
+#if IS_USED(MODULE_BQ27441)
+        return _print_energy();
+#else
+        puts("no fuel gauge (bq27441) on this build");
+#endif
+    }
+    else {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
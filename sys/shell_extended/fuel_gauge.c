@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Fuel gauge shared by the energy shell commands
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_BQ27441)
+
+#include <stdbool.h>
+
+#include "bq27441_params.h"
+#include "fuel_gauge.h"
+
+bq27441_t *fuel_gauge(void)
+{
+    static bq27441_t dev;
+    static bool initialized;
+
+    if (!initialized) {
+        if (bq27441_init(&dev, &bq27441_params[0]) != BQ27441_OK) {
+            return NULL;
+        }
+        initialized = true;
+    }
+
+    return &dev;
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Fuel gauge shared by the energy shell commands
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ */
+
+#ifndef FUEL_GAUGE_H
+#define FUEL_GAUGE_H
+
+#include "bq27441.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Get the fuel gauge, initialized on the first call
+ *
+ * @return The device, NULL if it couldn't be initialized.
+ */
+bq27441_t *fuel_gauge(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* FUEL_GAUGE_H */
+/** @} */
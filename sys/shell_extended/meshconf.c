@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Mesh-wide configuration shell command
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_MESHCONF)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "net/meshconf.h"
+
+static void _usage(const char *cmd)
+{
+    printf("usage: %s [set <key> <hex value>|dutycycle <on|off>]\n", cmd);
+}
+
+int meshconf_cmd(int argc, char **argv)
+{
+    uint8_t value[CONFIG_MESHCONF_MAX_LEN];
+    size_t len;
+    unsigned long key;
+
+    if (argc < 2) {
+        meshconf_print();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "set") == 0 && argc == 4) {
+        key = strtoul(argv[2], NULL, 0);
+        len = strlen(argv[3]);
+        if (key > UINT8_MAX || len % 2 != 0 || len / 2 > sizeof(value) ||
+            fmt_hex_bytes(value, argv[3]) != len / 2) {
+            _usage(argv[0]);
+            return 1;
+        }
+        len /= 2;
+    }
+    else if (strcmp(argv[1], "dutycycle") == 0 && argc == 3) {
+        key = MESHCONF_KEY_DUTYCYCLE;
+        len = 1;
+        value[0] = strcmp(argv[2], "on") == 0;
+    }
+    else {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    int res = meshconf_update(key, value, len);
+    if (res < 0) {
+        printf("Error: couldn't update configuration (%d)\n", res);
+        return 1;
+    }
+    printf("configuration version %u\n", meshconf_version());
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Neighbor link table shell command
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_NBR)
+
+#include "net/nbr.h"
+
+int nbr_cmd(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    nbr_print();
+
+    return 0;
+}
+
+#endif
@@ -26,9 +26,12 @@
 
 #if IS_USED(MODULE_AODVV2)
 
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#include "net/aodvv2/rcs.h"
+#include "net/aodvv2.h"
 
 /** Default prefix length if not specified */
 #define _IPV6_DEFAULT_PREFIX_LEN (64U)
@@ -63,7 +66,7 @@ static int _rcs_add(int argc, char **argv)
         return 1;
     }
 
-    if (aodvv2_rcs_add(&addr, pfx_len, 1) == NULL) {
+    if (aodvv2_client_add(&addr, pfx_len, 1) < 0) {
         printf("error: unable to add client to RCS\n");
         return 1;
     }
@@ -74,16 +77,62 @@ static int _rcs_add(int argc, char **argv)
     return 0;
 }
 
+static void _stats(void)
+{
+    aodvv2_lrs_stats_t stats;
+
+    aodvv2_route_stats(&stats);
+    printf("routes refreshed: %" PRIu32 "\n", stats.refreshed);
+    printf("next hop changes: %" PRIu32 "\n", stats.next_hop_changes);
+    printf("held by hysteresis: %" PRIu32 "\n", stats.hysteresis);
+    printf("held by damping: %" PRIu32 "\n", stats.damped);
+}
+
+#if IS_USED(MODULE_AODVV2_LAR)
+static int _position(int argc, char **argv)
+{
+    aodvv2_position_t pos;
+
+    if (argc == 0) {
+        if (aodvv2_position_get(&pos) < 0) {
+            puts("position unknown");
+        }
+        else {
+            printf("position: %" PRId32 " %" PRId32 "\n", pos.x, pos.y);
+        }
+        return 0;
+    }
+
+    if (argc == 1 && strcmp(argv[0], "clear") == 0) {
+        aodvv2_position_set(NULL);
+        return 0;
+    }
+
+    if (argc != 2) {
+        return -1;
+    }
+
+    pos.x = strtol(argv[0], NULL, 10);
+    pos.y = strtol(argv[1], NULL, 10);
+    aodvv2_position_set(&pos);
+    return 0;
+}
+#endif
+
 int sc_aodvv2_cmd(int argc, char **argv)
 {
     if (argc < 2) {
-        printf("usage: %s [rcs]\n", argv[0]);
+#if IS_USED(MODULE_AODVV2_LAR)
+        printf("usage: %s [rcs|stats|position]\n", argv[0]);
+#else
+        printf("usage: %s [rcs|stats]\n", argv[0]);
+#endif
         return 1;
     }
 
     if (strcmp(argv[1], "rcs") == 0) {
         if (argc == 2) {
-            aodvv2_rcs_print_entries();
+            aodvv2_client_print();
         }
         else if (strcmp(argv[2], "add") == 0) {
             if (argc < 4) {
@@ -97,6 +146,17 @@ int sc_aodvv2_cmd(int argc, char **argv)
             puts("error: invalid command");
         }
     }
+    else if (strcmp(argv[1], "stats") == 0) {
+        _stats();
+    }
+#if IS_USED(MODULE_AODVV2_LAR)
+    else if (strcmp(argv[1], "position") == 0) {
+        if (_position(argc - 2, argv + 2) < 0) {
+            printf("usage: %s position [<x> <y>|clear]\n", argv[0]);
+            return 1;
+        }
+    }
+#endif
     else {
         puts("error: invalid command");
     }
@@ -24,16 +24,15 @@
 
 #include <stdio.h>
 
-#include "net/aodvv2/seqnum.h"
+#include "net/aodvv2.h"
 
 int seqnum_get_cmd(int argc, char **argv)
 {
     (void)argc;
     (void)argv;
 
-    aodvv2_seqnum_t old = aodvv2_seqnum_get();
-    aodvv2_seqnum_inc();
-    aodvv2_seqnum_t new = aodvv2_seqnum_get();
+    aodvv2_seqnum_t old = aodvv2_seqnum_current();
+    aodvv2_seqnum_t new = aodvv2_seqnum_next();
 
     printf("old = %d, new = %d\n", old, new);
 
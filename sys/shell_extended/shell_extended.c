@@ -36,6 +36,38 @@ int udp_cmd(int argc, char **argv);
 int sc_aodvv2_cmd(int argc, char **argv);
 #endif
 
+#if IS_USED(MODULE_NBR)
+int nbr_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_AIRTIME)
+int airtime_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_DUTYCYCLE)
+int dutycycle_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_MESHCONF)
+int meshconf_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_DELUGE)
+int deluge_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_SLIPCREDIT)
+int slipcredit_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_TIMESYNC)
+int timesync_cmd(int argc, char **argv);
+#endif
+
+#if IS_USED(MODULE_MESHTRACE)
+int traceroute_cmd(int argc, char **argv);
+#endif
+
 const shell_command_t shell_extended_commands[] = {
 #if IS_USED(MODULE_AODVV2)
     { "find_route", "find a route to a node using IPv6 address", find_route_cmd },
@@ -46,6 +78,30 @@ const shell_command_t shell_extended_commands[] = {
 #endif
 #if IS_USED(MODULE_AODVV2)
     { "aodvv2", "AODVv2 routing protocol command", sc_aodvv2_cmd },
+#endif
+#if IS_USED(MODULE_NBR)
+    { "nbr", "show the neighbor link table", nbr_cmd },
+#endif
+#if IS_USED(MODULE_AIRTIME)
+    { "airtime", "radio airtime and energy per traffic class", airtime_cmd },
+#endif
+#if IS_USED(MODULE_DUTYCYCLE)
+    { "dutycycle", "radio duty cycling status and energy", dutycycle_cmd },
+#endif
+#if IS_USED(MODULE_MESHCONF)
+    { "meshconf", "show or change the mesh-wide configuration", meshconf_cmd },
+#endif
+#if IS_USED(MODULE_DELUGE)
+    { "deluge", "firmware image dissemination status and publishing", deluge_cmd },
+#endif
+#if IS_USED(MODULE_SLIPCREDIT)
+    { "slipcredit", "show the flow control of the SLIP host", slipcredit_cmd },
+#endif
+#if IS_USED(MODULE_TIMESYNC)
+    { "timesync", "show the mesh time synchronization state", timesync_cmd },
+#endif
+#if IS_USED(MODULE_MESHTRACE)
+    { "traceroute", "trace the path, latency and routes to a node", traceroute_cmd },
 #endif
     { NULL, NULL, NULL }
 };
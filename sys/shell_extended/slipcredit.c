@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       SLIP flow control shell command
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_SLIPCREDIT)
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "net/slipcredit.h"
+
+int slipcredit_cmd(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    slipcredit_stats_t stats;
+    slipcredit_stats(&stats);
+
+    printf("in flight: %u of %u\n", stats.in_flight, CONFIG_SLIPCREDIT_WINDOW);
+    printf("from host: %" PRIu32 " (%" PRIu32 " for this node)\n",
+           stats.received, stats.local);
+    printf("sent on mesh: %" PRIu32 ", expired: %" PRIu32 "\n", stats.sent,
+           stats.expired);
+    printf("credit frames: %" PRIu32 "\n", stats.credits);
+
+    return 0;
+}
+
+#endif
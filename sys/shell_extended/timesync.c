@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Mesh time synchronization shell command
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_TIMESYNC)
+
+#include "net/timesync.h"
+
+int timesync_cmd(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    timesync_print();
+
+    return 0;
+}
+
+#endif
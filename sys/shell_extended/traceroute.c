@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     shell_extended
+ * @{
+ *
+ * @file
+ * @brief       Mesh traceroute shell command
+ *
+ * Hop 0 is this router. Each line gives the round trip time to the router,
+ * then its route to the destination: next hop, metric, route state,
+ * destination SeqNum and the RSSI/LQI of the link to the next hop.
+ *
+ * @author      Locha Mesh Developers <contact@locha.io>
+ *
+ * @}
+ */
+
+#include "kernel_defines.h"
+
+#if IS_USED(MODULE_MESHTRACE)
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "net/ipv6/addr.h"
+#include "net/meshtrace.h"
+#include "timex.h"
+
+static void _usage(const char *cmd)
+{
+    printf("usage: %s <addr> [max hops]\n", cmd);
+}
+
+static void _print_hop(const meshtrace_hop_t *hop, void *arg)
+{
+    (void)arg;
+
+    char addr_str[IPV6_ADDR_MAX_STR_LEN];
+
+    if (!hop->answered) {
+        printf("%3u  *\n", hop->hop);
+        return;
+    }
+
+    ipv6_addr_to_str(addr_str, &hop->addr, sizeof(addr_str));
+    printf("%3u  %s", hop->hop, addr_str);
+    if (hop->hop > 0) {
+        printf("  %" PRIu32 ".%03" PRIu32 " ms", hop->rtt / US_PER_MS,
+               hop->rtt % US_PER_MS);
+    }
+
+    const meshtrace_route_t *route = &hop->route;
+    switch (route->status) {
+        case MESHTRACE_TARGET:
+            puts("  destination");
+            break;
+
+        case MESHTRACE_ROUTE:
+            ipv6_addr_to_str(addr_str, &route->next_hop, sizeof(addr_str));
+            printf("  via %s metric %u %s seq %u", addr_str, route->metric,
+                   meshtrace_state_name(route->state), route->seqnum);
+            if (route->lqi > 0) {
+                printf(" rssi %d lqi %u", route->rssi, route->lqi);
+            }
+            puts("");
+            break;
+
+        default:
+            puts("  no route");
+            break;
+    }
+}
+
+int traceroute_cmd(int argc, char **argv)
+{
+    ipv6_addr_t dst;
+    int max_hops = CONFIG_MESHTRACE_MAX_HOPS;
+
+    if (argc < 2 || argc > 3) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    if (ipv6_addr_from_str(&dst, argv[1]) == NULL) {
+        printf("Error: invalid address %s\n", argv[1]);
+        return 1;
+    }
+
+    if (argc > 2) {
+        max_hops = atoi(argv[2]);
+        if (max_hops < 1 || max_hops > UINT8_MAX) {
+            _usage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("traceroute to %s, %d hops max\n", argv[1], max_hops);
+    int res = meshtrace_run(&dst, max_hops, _print_hop, NULL);
+    if (res == -EBUSY) {
+        puts("Error: a trace is already running");
+        return 1;
+    }
+    else if (res == -EHOSTUNREACH) {
+        puts("destination unreachable");
+        return 1;
+    }
+    else if (res == -ETIMEDOUT) {
+        puts("destination not reached");
+        return 1;
+    }
+    else if (res < 0) {
+        printf("Error: couldn't trace the path (%d)\n", res);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
@@ -36,6 +36,11 @@
 #include "utlist.h"
 #include "xtimer.h"
 
+#if IS_USED(MODULE_TIMESYNC)
+#include "byteorder.h"
+#include "net/timesync.h"
+#endif
+
 static gnrc_netreg_entry_t server = GNRC_NETREG_ENTRY_INIT_PID(GNRC_NETREG_DEMUX_CTX_ALL,
                                                                KERNEL_PID_UNDEF);
 
@@ -79,6 +84,17 @@ static void send(char *dest_addr_str, char *src_addr_str, char *port_str,
         gnrc_pktsnip_t *payload, *udp, *ip;
         unsigned payload_size;
         /* allocate payload */
+#if IS_USED(MODULE_TIMESYNC)
+        if (data == NULL) {
+            /* latency probe, the global time it's sent at */
+            uint64_t now;
+            timesync_now(&now);
+            network_uint64_t stamp = byteorder_htonll(now);
+            payload = gnrc_pktbuf_add(NULL, &stamp, sizeof(stamp),
+                                      GNRC_NETTYPE_UNDEF);
+        }
+        else
+#endif
         payload = gnrc_pktbuf_add(NULL, data, strlen(data), GNRC_NETTYPE_UNDEF);
         if (payload == NULL) {
             puts("Error: unable to copy data to packet buffer");
@@ -158,7 +174,11 @@ static void stop_server(void)
 int udp_cmd(int argc, char **argv)
 {
     if (argc < 2) {
+#if IS_USED(MODULE_TIMESYNC)
+        printf("usage: %s [send|latency|server]\n", argv[0]);
+#else
         printf("usage: %s [send|server]\n", argv[0]);
+#endif
         return 1;
     }
 
@@ -174,6 +194,20 @@ int udp_cmd(int argc, char **argv)
         }
         send(argv[2], argv[3], argv[4], argv[5], num);
     }
+#if IS_USED(MODULE_TIMESYNC)
+    else if (strcmp(argv[1], "latency") == 0) {
+        uint32_t num = 1;
+        if (argc < 5) {
+            printf("usage: %s latency <dest_addr> <src_addr> <port> [<num>]\n",
+                   argv[0]);
+            return 1;
+        }
+        if (argc > 5) {
+            num = atoi(argv[5]);
+        }
+        send(argv[2], argv[3], argv[4], NULL, num);
+    }
+#endif
     else if (strcmp(argv[1], "server") == 0) {
         if (argc < 3) {
             printf("usage: %s server [start|stop]\n", argv[0]);
@@ -189,6 +223,18 @@ int udp_cmd(int argc, char **argv)
         else if (strcmp(argv[2], "stop") == 0) {
             stop_server();
         }
+#if IS_USED(MODULE_TIMESYNC)
+        else if (strcmp(argv[2], "latency") == 0) {
+            if (argc < 4) {
+                printf("usage %s server latency <port, 0 to stop>\n", argv[0]);
+                return 1;
+            }
+            if (timesync_probe_listen(atoi(argv[3])) < 0) {
+                puts("Error: time synchronization isn't running");
+                return 1;
+            }
+        }
+#endif
         else {
             puts("error: invalid command");
         }
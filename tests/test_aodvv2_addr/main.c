@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the word-wise AODVv2 address helpers
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Checks the helpers of `net/aodvv2/addr.h` against the RIOT functions they
+ * replace, then times both. On Cortex-M3 and up the cycle counter of the
+ * DWT unit gives the cycles per call as well:
+ *
+ * ```
+ * make -C tests/test_aodvv2_addr all term
+ * make -C tests/test_aodvv2_addr BOARD=cc1312-launchpad flash term
+ * ```
+ *
+ * Each call is made through a function pointer, the `loop` line gives that
+ * overhead.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "cpu.h"
+#include "embUnit.h"
+#include "irq.h"
+#include "kernel_defines.h"
+#include "xtimer.h"
+
+#include "net/aodvv2/addr.h"
+#include "net/ipv6/addr.h"
+
+#define RUNS    (100000UL)  /**< Calls per benchmark */
+#define PAIRS   (16)        /**< Address pairs, a power of two */
+
+#if defined(DWT_CTRL_CYCCNTENA_Msk)
+#define HAS_CYCLE_COUNTER   (1)
+#else
+#define HAS_CYCLE_COUNTER   (0)
+#endif
+
+/* Pair i shares its first i * 8 bits */
+static ipv6_addr_t _a[PAIRS];
+static ipv6_addr_t _b[PAIRS];
+
+static volatile unsigned _sink;
+static uint32_t _rng = 1;
+
+static void _random_addr(ipv6_addr_t *addr)
+{
+    for (unsigned i = 0; i < sizeof(addr->u8); i++) {
+        _rng = _rng * 1103515245 + 12345;
+        addr->u8[i] = _rng >> 16;
+    }
+}
+
+static void _flip_bit(ipv6_addr_t *addr, unsigned bit)
+{
+    addr->u8[bit / 8] ^= 0x80 >> (bit % 8);
+}
+
+static void _init_pairs(void)
+{
+    for (unsigned i = 0; i < PAIRS; i++) {
+        _random_addr(&_a[i]);
+        _b[i] = _a[i];
+        _flip_bit(&_b[i], i * 8);
+    }
+}
+
+static void test_addr_equal(void)
+{
+    ipv6_addr_t a, b;
+
+    _random_addr(&a);
+    b = a;
+    TEST_ASSERT(aodvv2_addr_equal(&a, &b));
+
+    for (unsigned bit = 0; bit < 128; bit++) {
+        b = a;
+        _flip_bit(&b, bit);
+        TEST_ASSERT(!aodvv2_addr_equal(&a, &b));
+        TEST_ASSERT_EQUAL_INT(ipv6_addr_equal(&a, &b),
+                              aodvv2_addr_equal(&a, &b));
+    }
+}
+
+static void test_addr_is_unspecified(void)
+{
+    ipv6_addr_t addr = IPV6_ADDR_UNSPECIFIED;
+
+    TEST_ASSERT(aodvv2_addr_is_unspecified(&addr));
+
+    for (unsigned bit = 0; bit < 128; bit++) {
+        addr = ipv6_addr_unspecified;
+        _flip_bit(&addr, bit);
+        TEST_ASSERT(!aodvv2_addr_is_unspecified(&addr));
+    }
+}
+
+static void test_addr_match_prefix(void)
+{
+    ipv6_addr_t a, b;
+
+    _random_addr(&a);
+    b = a;
+    TEST_ASSERT_EQUAL_INT(128, aodvv2_addr_match_prefix(&a, &b));
+
+    for (unsigned bit = 0; bit < 128; bit++) {
+        b = a;
+        _flip_bit(&b, bit);
+        /* Bits after the first difference don't matter */
+        if (bit < 127) {
+            _flip_bit(&b, 127);
+        }
+        TEST_ASSERT_EQUAL_INT(bit, aodvv2_addr_match_prefix(&a, &b));
+        TEST_ASSERT_EQUAL_INT(ipv6_addr_match_prefix(&a, &b),
+                              aodvv2_addr_match_prefix(&a, &b));
+        TEST_ASSERT(aodvv2_addr_in_prefix(&a, bit, &b));
+        TEST_ASSERT(!aodvv2_addr_in_prefix(&a, bit + 1, &b));
+    }
+}
+
+static void test_addr_init_prefix(void)
+{
+    ipv6_addr_t pfx;
+
+    _random_addr(&pfx);
+
+    for (unsigned len = 0; len <= 130; len++) {
+        ipv6_addr_t out, expected = IPV6_ADDR_UNSPECIFIED;
+
+        /* The bits after the prefix are cleared, whatever was there */
+        memset(&out, 0xff, sizeof(out));
+        aodvv2_addr_init_prefix(&out, &pfx, len);
+        ipv6_addr_init_prefix(&expected, &pfx, len);
+
+        TEST_ASSERT(ipv6_addr_equal(&expected, &out));
+    }
+}
+
+static Test *tests_aodvv2_addr(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_addr_equal),
+        new_TestFixture(test_addr_is_unspecified),
+        new_TestFixture(test_addr_match_prefix),
+        new_TestFixture(test_addr_init_prefix),
+    };
+
+    EMB_UNIT_TESTCALLER(aodvv2_addr_tests, NULL, NULL, fixtures);
+
+    return (Test *)&aodvv2_addr_tests;
+}
+
+static unsigned _loop(unsigned i)
+{
+    return i;
+}
+
+static unsigned _riot_equal(unsigned i)
+{
+    return ipv6_addr_equal(&_a[i], &_b[i]);
+}
+
+static unsigned _word_equal(unsigned i)
+{
+    return aodvv2_addr_equal(&_a[i], &_b[i]);
+}
+
+static unsigned _riot_match_prefix(unsigned i)
+{
+    return ipv6_addr_match_prefix(&_a[i], &_b[i]);
+}
+
+static unsigned _word_match_prefix(unsigned i)
+{
+    return aodvv2_addr_match_prefix(&_a[i], &_b[i]);
+}
+
+static void _bench(const char *name, unsigned (*fn)(unsigned))
+{
+    unsigned sink = 0;
+    unsigned state = irq_disable();
+    uint32_t cycles = 0;
+
+#if HAS_CYCLE_COUNTER
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    uint32_t time = xtimer_now_usec();
+    for (unsigned long i = 0; i < RUNS; i++) {
+        sink += fn(i & (PAIRS - 1));
+    }
+    time = xtimer_now_usec() - time;
+
+#if HAS_CYCLE_COUNTER
+    cycles = DWT->CYCCNT;
+#endif
+
+    irq_restore(state);
+    _sink = sink;
+
+    benchmark_print_time(time, RUNS, name);
+    if (HAS_CYCLE_COUNTER) {
+        printf("%s: %lu.%02lu cycles per call\n", name,
+               (unsigned long)(cycles / RUNS),
+               (unsigned long)((cycles % RUNS) * 100 / RUNS));
+    }
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_aodvv2_addr());
+    TESTS_END();
+
+    _init_pairs();
+
+    puts("\nbenchmark, prefixes of 0 to 120 bits");
+    _bench("loop", _loop);
+    _bench("ipv6_addr_equal", _riot_equal);
+    _bench("aodvv2_addr_equal", _word_equal);
+    _bench("ipv6_addr_match_prefix", _riot_match_prefix);
+    _bench("aodvv2_addr_match_prefix", _word_match_prefix);
+
+    return 0;
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the SLIP flow control
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Hooks two interfaces without devices: frames the host sends are handed to
+ * the SLIP one, frames for the mesh to the other one as 6LoWPAN frames, the
+ * way a 6LoWPAN interface sends them. Credit frames are queued to this
+ * thread, which sends them on the SLIP interface to read them back:
+ *
+ * ```
+ * make -C tests/test_slipcredit all term
+ * ```
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "embUnit.h"
+#include "msg.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "net/gnrc/netapi.h"
+#include "net/gnrc/netif.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/pktbuf.h"
+#include "net/ipv6/hdr.h"
+#include "net/protnum.h"
+#include "net/slipcredit.h"
+
+#define MSG_QUEUE_SIZE  (8)
+
+/**
+ * @name    6LoWPAN dispatches
+ * @{
+ */
+#define FRAG1           (0xc0)  /**< First fragment, datagram size 128 */
+#define FRAGN           (0xe0)  /**< Further fragment, datagram size 128 */
+#define IPHC1           (0x7b)  /**< TF elided, NH inline, hop limit 255 */
+#define IPHC2           (0x00)  /**< Addresses inline */
+/** @} */
+
+static msg_t _msg_queue[MSG_QUEUE_SIZE];
+
+static const ipv6_addr_t _host_a = {
+    .u8 = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x0a }
+};
+static const ipv6_addr_t _host_b = {
+    .u8 = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x0b }
+};
+static const ipv6_addr_t _remote = {
+    .u8 = { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01 }
+};
+static const ipv6_addr_t _link_local = {
+    .u8 = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01 }
+};
+
+static gnrc_netif_t _slip;
+static gnrc_netif_t _mesh;
+
+/* Frame the SLIP interface receives next */
+static gnrc_pktsnip_t *_rx;
+
+/* Start of the last frame sent on an interface */
+static uint8_t _tx[SLIPCREDIT_FRAME_LEN];
+
+/* Frames the host sent so far */
+static uint16_t _host_frames;
+
+static int _dev_send(gnrc_netif_t *netif, gnrc_pktsnip_t *pkt)
+{
+    (void)netif;
+
+    gnrc_pktsnip_t *data = pkt;
+    while (data != NULL && data->type == GNRC_NETTYPE_NETIF) {
+        data = data->next;
+    }
+
+    int len = 0;
+    if (data != NULL) {
+        len = (data->size < sizeof(_tx)) ? data->size : sizeof(_tx);
+        memcpy(_tx, data->data, len);
+    }
+    gnrc_pktbuf_release(pkt);
+
+    return len;
+}
+
+static gnrc_pktsnip_t *_dev_recv(gnrc_netif_t *netif)
+{
+    (void)netif;
+
+    gnrc_pktsnip_t *pkt = _rx;
+    _rx = NULL;
+
+    return pkt;
+}
+
+static const gnrc_netif_ops_t _dev_ops = {
+    .send = _dev_send,
+    .recv = _dev_recv,
+};
+
+/* The host sends an IPv6 packet without payload */
+static void _host_sends(const ipv6_addr_t *src, const ipv6_addr_t *dst)
+{
+    ipv6_hdr_t hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    ipv6_hdr_set_version(&hdr);
+    hdr.nh = PROTNUM_IPV6_NONXT;
+    hdr.hl = 64;
+    hdr.src = *src;
+    hdr.dst = *dst;
+
+    _rx = gnrc_pktbuf_add(NULL, &hdr, sizeof(hdr), GNRC_NETTYPE_IPV6);
+    TEST_ASSERT_NOT_NULL(_rx);
+
+    gnrc_pktsnip_t *pkt = _slip.ops->recv(&_slip);
+    TEST_ASSERT_NOT_NULL(pkt);
+    gnrc_pktbuf_release(pkt);
+    _host_frames++;
+}
+
+/* The host sends something else than an IPv6 packet */
+static void _host_sends_other(void)
+{
+    static const uint8_t frame[] = { 0x0a, 'h', 'i' };
+
+    _rx = gnrc_pktbuf_add(NULL, frame, sizeof(frame), GNRC_NETTYPE_UNDEF);
+    TEST_ASSERT_NOT_NULL(_rx);
+
+    gnrc_pktsnip_t *pkt = _slip.ops->recv(&_slip);
+    TEST_ASSERT_NOT_NULL(pkt);
+    gnrc_pktbuf_release(pkt);
+    _host_frames++;
+}
+
+/* The mesh interface sends a packet from src, compressed with IPHC, as
+ * the first fragment with frag1, or a further fragment with fragn */
+static void _mesh_sends(const ipv6_addr_t *src, bool frag1, bool fragn)
+{
+    uint8_t frame[4 + 3 + 2 * sizeof(ipv6_addr_t)];
+    size_t len = 0;
+
+    if (frag1 || fragn) {
+        frame[len++] = frag1 ? FRAG1 : FRAGN;
+        frame[len++] = 0x80;
+        frame[len++] = 0x12;
+        frame[len++] = 0x34;
+    }
+    if (fragn) {
+        /* Offset, then the middle of the packet */
+        frame[len++] = 0x08;
+        memcpy(&frame[len], src, sizeof(*src));
+        len += sizeof(*src);
+    }
+    else {
+        frame[len++] = IPHC1;
+        frame[len++] = IPHC2;
+        frame[len++] = PROTNUM_IPV6_NONXT;
+        memcpy(&frame[len], src, sizeof(*src));
+        len += sizeof(*src);
+        memcpy(&frame[len], &_remote, sizeof(_remote));
+        len += sizeof(_remote);
+    }
+
+    gnrc_pktsnip_t *pkt = gnrc_pktbuf_add(NULL, frame, len,
+                                          GNRC_NETTYPE_SIXLOWPAN);
+    TEST_ASSERT_NOT_NULL(pkt);
+    gnrc_pktsnip_t *hdr = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
+    TEST_ASSERT_NOT_NULL(hdr);
+    hdr->next = pkt;
+
+    TEST_ASSERT_EQUAL_INT(len, _mesh.ops->send(&_mesh, hdr));
+}
+
+/* Sends the queued credit frame, returns the credits it gives or -1 if
+ * none was queued */
+static int _credits(void)
+{
+    msg_t msg;
+
+    if (msg_try_receive(&msg) < 1 || msg.type != GNRC_NETAPI_MSG_TYPE_SND) {
+        return -1;
+    }
+
+    memset(_tx, 0, sizeof(_tx));
+    _slip.ops->send(&_slip, msg.content.ptr);
+
+    if (_tx[0] != SLIPCREDIT_FRAME_START ||
+        _tx[4] != CONFIG_SLIPCREDIT_WINDOW ||
+        byteorder_bebuftohs(&_tx[1]) != _host_frames) {
+        return -1;
+    }
+
+    return _tx[3];
+}
+
+static uint8_t _in_flight(void)
+{
+    slipcredit_stats_t stats;
+
+    slipcredit_stats(&stats);
+    return stats.in_flight;
+}
+
+static void test_slipcredit_init(void)
+{
+    TEST_ASSERT_EQUAL_INT(-EINVAL, slipcredit_init(NULL, &_mesh));
+    TEST_ASSERT_EQUAL_INT(0, slipcredit_init(&_slip, &_mesh));
+    TEST_ASSERT_EQUAL_INT(-EALREADY, slipcredit_init(&_slip, &_mesh));
+
+    /* The host learns it's limited */
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _credits());
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+}
+
+static void test_slipcredit_local(void)
+{
+    slipcredit_stats_t stats;
+
+    /* Both leave right away, one credit frame tells the host */
+    _host_sends_other();
+    _host_sends(&_host_a, &_link_local);
+    TEST_ASSERT_EQUAL_INT(0, _in_flight());
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _credits());
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+
+    slipcredit_stats(&stats);
+    TEST_ASSERT_EQUAL_INT(2, stats.received);
+    TEST_ASSERT_EQUAL_INT(2, stats.local);
+}
+
+static void test_slipcredit_iphc(void)
+{
+    _host_sends(&_host_a, &_remote);
+    TEST_ASSERT_EQUAL_INT(1, _in_flight());
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+
+    /* Another source doesn't free it */
+    _mesh_sends(&_host_b, false, false);
+    TEST_ASSERT_EQUAL_INT(1, _in_flight());
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+
+    _mesh_sends(&_host_a, false, false);
+    TEST_ASSERT_EQUAL_INT(0, _in_flight());
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _credits());
+}
+
+static void test_slipcredit_fragments(void)
+{
+    slipcredit_stats_t stats;
+
+    _host_sends(&_host_a, &_remote);
+
+    /* A further fragment has no IPv6 header, even if its data looks like
+     * the source */
+    _mesh_sends(&_host_a, false, true);
+    TEST_ASSERT_EQUAL_INT(1, _in_flight());
+
+    _mesh_sends(&_host_a, true, false);
+    TEST_ASSERT_EQUAL_INT(0, _in_flight());
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _credits());
+
+    /* And the other fragments of the packet don't free anything */
+    _mesh_sends(&_host_a, false, true);
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+
+    slipcredit_stats(&stats);
+    TEST_ASSERT_EQUAL_INT(2, stats.sent);
+}
+
+static void test_slipcredit_window(void)
+{
+    for (unsigned i = 0; i < CONFIG_SLIPCREDIT_WINDOW; i++) {
+        _host_sends(&_host_a, &_remote);
+    }
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _in_flight());
+
+    /* Without credits, still forwarded but not counted */
+    _host_sends(&_host_b, &_remote);
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _in_flight());
+    TEST_ASSERT_EQUAL_INT(-1, _credits());
+
+    _mesh_sends(&_host_a, false, false);
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW - 1, _in_flight());
+    TEST_ASSERT_EQUAL_INT(1, _credits());
+}
+
+static void test_slipcredit_expire(void)
+{
+    slipcredit_stats_t stats;
+
+    xtimer_usleep((CONFIG_SLIPCREDIT_TIMEOUT + 50) * US_PER_MS);
+
+    /* The next frame from the host notices */
+    _host_sends_other();
+    TEST_ASSERT_EQUAL_INT(0, _in_flight());
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW, _credits());
+
+    slipcredit_stats(&stats);
+    TEST_ASSERT_EQUAL_INT(CONFIG_SLIPCREDIT_WINDOW - 1, stats.expired);
+}
+
+static Test *tests_slipcredit(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_slipcredit_init),
+        new_TestFixture(test_slipcredit_local),
+        new_TestFixture(test_slipcredit_iphc),
+        new_TestFixture(test_slipcredit_fragments),
+        new_TestFixture(test_slipcredit_window),
+        new_TestFixture(test_slipcredit_expire),
+    };
+
+    EMB_UNIT_TESTCALLER(slipcredit_tests, NULL, NULL, fixtures);
+
+    return (Test *)&slipcredit_tests;
+}
+
+int main(void)
+{
+    msg_init_queue(_msg_queue, MSG_QUEUE_SIZE);
+
+    /* Credit frames for the SLIP interface are queued to this thread */
+    _slip.ops = &_dev_ops;
+    _slip.pid = thread_getpid();
+    rmutex_init(&_slip.mutex);
+    _mesh.ops = &_dev_ops;
+    rmutex_init(&_mesh.mutex);
+
+    TESTS_START();
+    TESTS_RUN(tests_slipcredit());
+    TESTS_END();
+
+    return 0;
+}
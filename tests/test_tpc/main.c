@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2020 Locha Inc
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     tests
+ * @brief       Test application for the Transmit Power Control
+ * @author      Locha Mesh Developers <developers@locha.io>
+ * @file
+ *
+ * Runs the controller against a log-distance path loss model with uniform
+ * shadowing, using the Turpial PA table levels. Meant to be run on native:
+ *
+ * ```
+ * make -C tests/test_tpc all term
+ * ```
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "embUnit.h"
+#include "kernel_defines.h"
+
+#include "net/tpc.h"
+
+/**
+ * @brief   Turpial PA table levels (see boards/turpial/include/rf_conf.h)
+ */
+static const int16_t _levels[] = { 26, 25, 24, 23, 21, 17, 11 };
+
+#define MAX_DBM       (_levels[0])
+#define LEVELS_NUMOF  ARRAY_SIZE(_levels)
+
+/**
+ * @name    Path loss model
+ * @{
+ */
+#define PL_D0         (38.0)    /**< Path loss at 1 m, in dB */
+#define PL_EXPONENT   (3.0)     /**< Path loss exponent */
+#define SHADOWING     (3)       /**< Shadowing amplitude, in dB */
+#define SAMPLES       (64)      /**< Broadcasts received per distance */
+/** @} */
+
+static uint32_t _rng = 1;
+
+static int _shadowing(void)
+{
+    _rng = _rng * 1103515245 + 12345;
+    return (int)((_rng >> 16) % (2 * SHADOWING + 1)) - SHADOWING;
+}
+
+static int16_t _path_loss(double distance)
+{
+    return (int16_t)lround(PL_D0 + 10.0 * PL_EXPONENT * log10(distance));
+}
+
+/* Feed SAMPLES full power frames received over a link with path loss pl */
+static void _receive(tpc_link_t *link, int16_t pl)
+{
+    for (unsigned i = 0; i < SAMPLES; i++) {
+        tpc_link_update(link, MAX_DBM, MAX_DBM - pl + _shadowing());
+    }
+}
+
+static void test_tpc_unknown_link(void)
+{
+    tpc_link_t link;
+
+    tpc_link_init(&link);
+    TEST_ASSERT_EQUAL_INT(TPC_PATH_LOSS_UNKNOWN, tpc_link_path_loss(&link));
+    TEST_ASSERT_EQUAL_INT(0, tpc_link_select(&link, _levels, LEVELS_NUMOF));
+}
+
+static void test_tpc_path_loss_estimate(void)
+{
+    tpc_link_t link;
+
+    tpc_link_init(&link);
+    _receive(&link, 100);
+
+    int16_t pl = tpc_link_path_loss(&link);
+    TEST_ASSERT(pl >= 100 - SHADOWING && pl <= 100 + SHADOWING);
+}
+
+static void test_tpc_lowest_level(void)
+{
+    static const double distances[] = {
+        5, 20, 50, 100, 200, 300, 400, 500, 600, 800
+    };
+
+    for (unsigned i = 0; i < ARRAY_SIZE(distances); i++) {
+        tpc_link_t link;
+        int16_t pl = _path_loss(distances[i]);
+
+        tpc_link_init(&link);
+        _receive(&link, pl);
+
+        uint8_t level = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+        int16_t rssi = _levels[level] - pl;
+
+        printf("d = %4u m, path loss = %3d dB, power = %2d dBm, rssi = %4d dBm\n",
+               (unsigned)distances[i], pl, _levels[level], rssi);
+
+        if (MAX_DBM - pl < CONFIG_TPC_TARGET_RSSI) {
+            /* Out of reach, nothing better than full power */
+            TEST_ASSERT_EQUAL_INT(0, level);
+            continue;
+        }
+
+        /* The neighbor gets at least the target, minus estimation error */
+        TEST_ASSERT(rssi >= CONFIG_TPC_TARGET_RSSI - SHADOWING);
+
+        /* And the next level down wouldn't keep the margin */
+        if (level + 1U < LEVELS_NUMOF) {
+            TEST_ASSERT(_levels[level + 1] - pl <
+                        CONFIG_TPC_TARGET_RSSI + CONFIG_TPC_MARGIN + SHADOWING);
+        }
+    }
+}
+
+static void test_tpc_hysteresis(void)
+{
+    tpc_link_t link;
+    unsigned changes = 0;
+
+    /* Right on the edge between two levels: 21 dBm gives the target plus
+     * half the margin */
+    int16_t pl = _levels[4] - CONFIG_TPC_TARGET_RSSI - CONFIG_TPC_MARGIN / 2;
+
+    tpc_link_init(&link);
+    _receive(&link, pl);
+    uint8_t level = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+
+    for (unsigned i = 0; i < 1000; i++) {
+        tpc_link_update(&link, MAX_DBM, MAX_DBM - pl + _shadowing());
+        uint8_t next = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+        changes += next != level;
+        level = next;
+    }
+
+    TEST_ASSERT(changes <= 2);
+}
+
+static void test_tpc_link_degrades(void)
+{
+    tpc_link_t link;
+    int16_t near = _path_loss(20);
+    int16_t far = _path_loss(400);
+
+    tpc_link_init(&link);
+    _receive(&link, near);
+    uint8_t level = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+    TEST_ASSERT_EQUAL_INT(LEVELS_NUMOF - 1, level);
+
+    /* The neighbor moves away, power has to go up */
+    _receive(&link, far);
+    level = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+    TEST_ASSERT(_levels[level] - far >= CONFIG_TPC_TARGET_RSSI - SHADOWING);
+
+    /* And back down once it comes back */
+    _receive(&link, near);
+    level = tpc_link_select(&link, _levels, LEVELS_NUMOF);
+    TEST_ASSERT_EQUAL_INT(LEVELS_NUMOF - 1, level);
+}
+
+static Test *tests_tpc(void)
+{
+    EMB_UNIT_TESTFIXTURES(fixtures) {
+        new_TestFixture(test_tpc_unknown_link),
+        new_TestFixture(test_tpc_path_loss_estimate),
+        new_TestFixture(test_tpc_lowest_level),
+        new_TestFixture(test_tpc_hysteresis),
+        new_TestFixture(test_tpc_link_degrades),
+    };
+
+    EMB_UNIT_TESTCALLER(tpc_tests, NULL, NULL, fixtures);
+
+    return (Test *)&tpc_tests;
+}
+
+int main(void)
+{
+    TESTS_START();
+    TESTS_RUN(tests_tpc());
+    TESTS_END();
+
+    return 0;
+}